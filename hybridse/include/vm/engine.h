@@ -17,11 +17,18 @@
 #ifndef HYBRIDSE_INCLUDE_VM_ENGINE_H_
 #define HYBRIDSE_INCLUDE_VM_ENGINE_H_
 
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <future>  // NOLINT
 #include <map>
 #include <memory>
 #include <mutex>  //NOLINT
 #include <set>
 #include <string>
+#include <thread>  // NOLINT
+#include <tuple>
 #include <utility>
 #include <vector>
 #include <unordered_map>
@@ -42,6 +49,14 @@ namespace vm {
 using ::hybridse::codec::Row;
 
 inline constexpr const char* LONG_WINDOWS = "long_windows";
+// the session option to keep the compiled objects in the object cache dir, e.g. for the deployments
+inline constexpr const char* PERSIST_OBJECT = "persist_object";
+// the session option to compile with the shared jit even if it's not enabled by the engine options. The jit is kept
+// until all the compilations in it are gone, so it's for the long lived ones, e.g. the deployments
+inline constexpr const char* SHARED_JIT = "shared_jit";
+// the session option to compile with optimization directly even if the tiered jit is enabled, as the compiling result
+// is kept out of the engine cache, e.g. by the deployments
+inline constexpr const char* FULL_OPTIMIZE = "full_optimize";
 
 class Engine;
 /// \brief An options class for controlling engine behaviour.
@@ -113,13 +128,31 @@ class EngineOptions {
         return enable_window_column_pruning_;
     }
 
-    /// Set the maximum number of cache entries, default is `50`.
+    /// Set the maximum number of cache entries of each engine mode and db, default is `50`.
     inline void SetMaxSqlCacheSize(uint32_t size) {
         max_sql_cache_size_ = size;
     }
     /// Return the maximum number of entries we can hold for compiling cache.
     inline uint32_t GetMaxSqlCacheSize() const { return max_sql_cache_size_; }
 
+    /// Set the maximum estimated bytes of cache entries of each engine mode and db, default is `0`, not bounded.
+    inline void SetMaxSqlCacheBytes(uint64_t bytes) {
+        max_sql_cache_bytes_ = bytes;
+    }
+    /// Return the maximum estimated bytes of entries we can hold for compiling cache.
+    inline uint64_t GetMaxSqlCacheBytes() const { return max_sql_cache_bytes_; }
+
+    /// Set `true` to enable tiered jit, default `false`.
+    ///
+    /// If set `true`, a sql is compiled without optimization first, so it runs as soon as possible, and then compiled
+    /// with optimization in background, the compiling result cached is replaced once it's done.
+    inline EngineOptions* SetEnableTieredJit(bool flag) {
+        enable_tiered_jit_ = flag;
+        return this;
+    }
+    /// Return if the engine support tiered jit.
+    inline bool IsEnableTieredJit() const { return enable_tiered_jit_; }
+
     /// Return JitOptions
     inline hybridse::vm::JitOptions& jit_options() { return jit_options_; }
 
@@ -133,9 +166,28 @@ class EngineOptions {
     bool enable_batch_window_parallelization_;
     bool enable_window_column_pruning_;
     uint32_t max_sql_cache_size_;
+    uint64_t max_sql_cache_bytes_;
+    bool enable_tiered_jit_;
     JitOptions jit_options_;
 };
 
+/// \brief The counters of the compiling cache of an engine.
+struct EngineCacheStats {
+    /// The compilations got from the cache.
+    uint64_t hit_cnt = 0;
+    /// The compilations which compile the sql.
+    uint64_t miss_cnt = 0;
+    /// The compilations which wait for the same one in progress instead of compiling the sql again.
+    uint64_t wait_cnt = 0;
+    /// The total time of the compilations which compile the sql, in microseconds.
+    uint64_t compile_time_us = 0;
+    /// The entries and the estimated bytes of them in the cache.
+    uint64_t entry_cnt = 0;
+    uint64_t byte_size = 0;
+    /// The compiling results without optimization replaced by the ones with optimization for the tiered jit.
+    uint64_t upgrade_cnt = 0;
+};
+
 /// \brief A RunSession maintain SQL running context, including compile information, procedure name.
 ///
 class RunSession {
@@ -207,6 +259,11 @@ class BatchRunSession : public RunSession {
     /// Query results will be returned as std::vector<Row> in output
     int32_t Run(std::vector<Row>& output,  // NOLINT
                 uint64_t limit = 0);
+
+    /// \brief Query sql with parameter row in batch mode.
+    /// Query results are passed to callback one by one without being materialized,
+    /// the run stops early if callback returns `false`.
+    int32_t Run(const Row& parameter_row, const std::function<bool(const Row&)>& callback);
     /// Bing the run session with specific parameter schema
     void SetParameterSchema(const codec::Schema& schema) { parameter_schema_ = schema; }
     /// Return query parameter schema.
@@ -418,6 +475,9 @@ class Engine {
     /// \brief Get engine's options
     EngineOptions GetEngineOptions();
 
+    /// \brief Get the counters of engine's compiling result cache
+    EngineCacheStats GetCacheStats();
+
  private:
     bool GetDependentTables(const node::PlanNode* node, const std::string& default_db,
                             std::set<std::pair<std::string, std::string>>* db_tables, base::Status& status);  // NOLINT
@@ -428,6 +488,19 @@ class Engine {
                         EngineMode engine_mode,
                         std::shared_ptr<CompileInfo> info);
 
+    std::shared_ptr<CompileInfo> Compile(const std::string& sql, const std::string& db,
+                                         RunSession& session,  // NOLINT
+                                         bool fast_compile,
+                                         base::Status& status);  // NOLINT
+
+    bool IsTieredCompile(const RunSession& session);
+
+    // compile the sql with optimization in background and replace the cached info compiled without optimization
+    void Upgrade(const std::string& sql, const std::string& db, const RunSession& session,
+                 const std::shared_ptr<CompileInfo>& info);
+
+    void RunUpgradeTasks();
+
     bool IsCompatibleCache(RunSession& session,  // NOLINT
                            std::shared_ptr<CompileInfo> info,
                            base::Status& status);  // NOLINT
@@ -440,6 +513,20 @@ class Engine {
     EngineOptions options_;
     base::SpinMutex mu_;
     EngineLRUCache lru_cache_;
+    // the compilations in progress, the same sql waits for the result of it instead of compiling it again
+    std::map<std::tuple<EngineMode, std::string, std::string>, std::shared_future<std::shared_ptr<CompileInfo>>>
+        compiling_;
+    std::atomic<uint64_t> hit_cnt_;
+    std::atomic<uint64_t> miss_cnt_;
+    std::atomic<uint64_t> wait_cnt_;
+    std::atomic<uint64_t> compile_time_us_;
+    std::atomic<uint64_t> upgrade_cnt_;
+    // the compilations with optimization of the tiered jit, run one by one in background
+    std::mutex upgrade_mu_;
+    std::condition_variable upgrade_cv_;
+    std::deque<std::function<void()>> upgrade_tasks_;
+    bool stop_upgrade_;
+    std::thread upgrade_thread_;
 };
 
 /// \brief Local tablet is responsible to run a task locally.
@@ -15,11 +15,12 @@
  */
 #ifndef HYBRIDSE_INCLUDE_VM_ENGINE_CONTEXT_H_
 #define HYBRIDSE_INCLUDE_VM_ENGINE_CONTEXT_H_
+#include <list>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
-#include "boost/compute/detail/lru_cache.hpp"
+#include <unordered_map>
 #include "vm/physical_op.h"
 namespace hybridse {
 namespace vm {
@@ -63,6 +64,40 @@ class CompileInfo {
                                   const std::string& tab) = 0;
     virtual void DumpClusterJob(std::ostream& output,
                                 const std::string& tab) = 0;
+    /// The estimated bytes of memory held by the compiling result.
+    virtual size_t GetByteSize() = 0;
+};
+
+/// \brief A LRU cache of the compiling results by SQL string, bounded by the count and the bytes of the results.
+class CompileInfoLRUCache {
+ public:
+    /// `max_bytes` is `0` means the bytes are not bounded.
+    CompileInfoLRUCache(uint32_t max_size, uint64_t max_bytes)
+        : max_size_(max_size), max_bytes_(max_bytes), entries_(), index_(), byte_size_(0) {}
+
+    std::shared_ptr<CompileInfo> Get(const std::string& sql);
+
+    /// Insert or replace the result of the sql, the least recently used ones are evicted if it's full.
+    void Insert(const std::string& sql, const std::shared_ptr<CompileInfo>& info);
+
+    size_t Size() const { return entries_.size(); }
+
+    uint64_t GetByteSize() const { return byte_size_; }
+
+ private:
+    struct Entry {
+        std::string sql;
+        std::shared_ptr<CompileInfo> info;
+        uint64_t byte_size;
+    };
+    typedef std::list<Entry> EntryList;
+
+    uint32_t max_size_;
+    uint64_t max_bytes_;
+    // the most recently used one is at the front
+    EntryList entries_;
+    std::unordered_map<std::string, EntryList::iterator> index_;
+    uint64_t byte_size_;
 };
 
 /// @typedef EngineLRUCache
@@ -70,10 +105,7 @@ class CompileInfo {
 ///     - DB name
 ///       - SQL string
 ///           - CompileInfo
-typedef std::map<EngineMode,
-                std::map<std::string,
-                    boost::compute::detail::lru_cache<std::string, std::shared_ptr<CompileInfo>>>>
-    EngineLRUCache;
+typedef std::map<EngineMode, std::map<std::string, CompileInfoLRUCache>> EngineLRUCache;
 
 class CompileInfoCache {
  public:
@@ -101,11 +133,38 @@ class JitOptions {
     bool IsEnablePerf() const { return enable_perf_; }
     void SetEnablePerf(bool flag) { enable_perf_ = flag; }
 
+    /// Share one llvm jit and the compiled objects between compilations instead of one jit per compilation.
+    bool IsEnableSharedJit() const { return enable_shared_jit_; }
+    void SetEnableSharedJit(bool flag) { enable_shared_jit_ = flag; }
+
+    /// The dir to keep the objects compiled by the shared jit across restarts, empty means in memory only.
+    const std::string& GetObjectCacheDir() const { return object_cache_dir_; }
+    void SetObjectCacheDir(const std::string& dir) { object_cache_dir_ = dir; }
+
+    /// The max bytes of the objects in the object cache dir, the least recently used ones are removed once it's
+    /// exceeded. 0 means no limit.
+    uint64_t GetMaxObjectCacheDirBytes() const { return max_object_cache_dir_bytes_; }
+    void SetMaxObjectCacheDirBytes(uint64_t bytes) { max_object_cache_dir_bytes_ = bytes; }
+
+    /// Write the objects compiled to the object cache dir, the objects in the dir are always loaded if it's set.
+    bool IsPersistObject() const { return persist_object_; }
+    void SetPersistObject(bool flag) { persist_object_ = flag; }
+
+    /// Compile without the optimization passes and with the fast instruction selection, for the first tier of the
+    /// tiered jit.
+    bool IsFastCompile() const { return fast_compile_; }
+    void SetFastCompile(bool flag) { fast_compile_ = flag; }
+
  private:
     bool enable_mcjit_ = false;
     bool enable_vtune_ = false;
     bool enable_gdb_ = false;
     bool enable_perf_ = false;
+    bool enable_shared_jit_ = false;
+    std::string object_cache_dir_;
+    uint64_t max_object_cache_dir_bytes_ = 0;
+    bool persist_object_ = false;
+    bool fast_compile_ = false;
 };
 }  // namespace vm
 }  // namespace hybridse
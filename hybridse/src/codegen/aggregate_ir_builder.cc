@@ -26,6 +26,9 @@
 #include "codegen/variable_ir_builder.h"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
+
+DECLARE_bool(enable_window_agg_batch);
+
 namespace hybridse {
 namespace codegen {
 
@@ -363,6 +366,61 @@ class StatisticalAggGenerator {
         }
     }
 
+    // update the states with n values of each column decoded by the window
+    // agg batch, the kernel of column type updates all the states of a column
+    void GenBatchUpdate(::llvm::IRBuilder<>* builder,
+                        const std::vector<::llvm::Value*>& values,
+                        const std::vector<::llvm::Value*>& nulls,
+                        ::llvm::Value* n) {
+        ::llvm::LLVMContext& llvm_ctx = builder->getContext();
+        ::llvm::Type* llvm_ty =
+            AggregateIRBuilder::GetOutputLlvmType(llvm_ctx, "sum", col_type_);
+        ::llvm::PointerType* ptr_ty = llvm_ty->getPointerTo();
+        ::llvm::PointerType* double_ptr_ty =
+            builder->getDoubleTy()->getPointerTo();
+        ::llvm::PointerType* int64_ptr_ty =
+            builder->getInt64Ty()->getPointerTo();
+        auto update_func =
+            builder->GetInsertBlock()->getModule()->getOrInsertFunction(
+                "hybridse_window_agg_update_" + DataTypeName(col_type_),
+                ::llvm::FunctionType::get(
+                    builder->getVoidTy(),
+                    {ptr_ty, builder->getInt8PtrTy(), builder->getInt32Ty(),
+                     ptr_ty, double_ptr_ty, int64_ptr_ty, ptr_ty, ptr_ty},
+                    false));
+        auto state_or_null = [](bool used, ::llvm::Value* state,
+                                ::llvm::PointerType* ty) -> ::llvm::Value* {
+            if (used) {
+                return state;
+            }
+            return ::llvm::ConstantPointerNull::get(ty);
+        };
+        bool count_updated = false;
+        for (size_t i = 0; i < col_num_; ++i) {
+            // the same states as GenUpdate updates
+            bool update_sum = !sum_idxs_[i].empty() ||
+                              (!avg_idxs_[i].empty() && avg_states_[i] == nullptr);
+            bool update_avg = !avg_idxs_[i].empty() && avg_states_[i] != nullptr;
+            bool update_count =
+                (!avg_idxs_[i].empty() || !count_idxs_[i].empty() ||
+                 !min_idxs_[i].empty() || !max_idxs_[i].empty()) &&
+                !count_updated;
+            count_updated = count_updated || update_count;
+            if (!update_sum && !update_avg && !update_count &&
+                min_idxs_[i].empty() && max_idxs_[i].empty()) {
+                continue;
+            }
+            builder->CreateCall(
+                update_func,
+                {builder->CreateBitCast(values[i], ptr_ty), nulls[i], n,
+                 state_or_null(update_sum, sum_states_[i], ptr_ty),
+                 state_or_null(update_avg, avg_states_[i], double_ptr_ty),
+                 state_or_null(update_count, count_state_, int64_ptr_ty),
+                 state_or_null(!min_idxs_[i].empty(), min_states_[i], ptr_ty),
+                 state_or_null(!max_idxs_[i].empty(), max_states_[i], ptr_ty)});
+        }
+    }
+
     void GenOutputs(::llvm::IRBuilder<>* builder,
                     std::vector<std::pair<size_t, NativeValue>>* outputs) {
         for (size_t i = 0; i < col_num_; ++i) {
@@ -589,41 +647,13 @@ base::Status ScheduleAggGenerators(
     return base::Status::OK();
 }
 
-base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
-                                    ExprIRBuilder* expr_ir_builder,
-                                    VariableIRBuilder* variable_ir_builder,
-                                    ::llvm::BasicBlock* cur_block,
-                                    const std::string& output_ptr_name,
-                                    const vm::Schema& output_schema) {
+base::Status AggregateIRBuilder::BuildRowUpdate(::llvm::Function* fn, ::llvm::Value* input_arg,
+                                               std::vector<StatisticalAggGenerator>* generators,
+                                               ::llvm::IRBuilder<>* builder) {
     ::llvm::LLVMContext& llvm_ctx = module_->getContext();
-    ::llvm::IRBuilder<> builder(llvm_ctx);
     auto void_ty = llvm::Type::getVoidTy(llvm_ctx);
     auto int64_ty = llvm::Type::getInt64Ty(llvm_ctx);
-    expr_ir_builder->set_frame(nullptr, frame_node_);
-    NativeValue window_ptr;
-    CHECK_STATUS(expr_ir_builder->BuildWindow(&window_ptr))
-    CHECK_TRUE(nullptr != window_ptr.GetRaw(), common::kCodegenError, "Window ptr is null")
-
-    base::Status status;
-    NativeValue output_buf_wrapper;
-    CHECK_TRUE(variable_ir_builder->LoadValue(output_ptr_name, &output_buf_wrapper, status),
-               common::kCodegenLoadValueError, "fail to get output row ptr")
-    ::llvm::Value* output_buf = output_buf_wrapper.GetValue(&builder);
-
-    std::string fn_name =
-        base_funcname + "_multi_column_agg_" + std::to_string(id_) + "__";
     auto ptr_ty = llvm::Type::getInt8Ty(llvm_ctx)->getPointerTo();
-    ::llvm::FunctionType* fnt = ::llvm::FunctionType::get(
-        llvm::Type::getVoidTy(llvm_ctx), {ptr_ty, ptr_ty}, false);
-    ::llvm::Function* fn = ::llvm::Function::Create(
-        fnt, llvm::Function::ExternalLinkage, fn_name, module_);
-    builder.SetInsertPoint(cur_block);
-    builder.CreateCall(
-        module_->getOrInsertFunction(fn_name, fnt),
-        {window_ptr.GetValue(&builder), builder.CreateLoad(output_buf)});
-
-    ::llvm::BasicBlock* head_block =
-        ::llvm::BasicBlock::Create(llvm_ctx, "head", fn);
     ::llvm::BasicBlock* enter_block =
         ::llvm::BasicBlock::Create(llvm_ctx, "enter_iter", fn);
     ::llvm::BasicBlock* body_block =
@@ -631,40 +661,27 @@ base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
     ::llvm::BasicBlock* exit_block =
         ::llvm::BasicBlock::Create(llvm_ctx, "exit_iter", fn);
 
-    std::vector<StatisticalAggGenerator> generators;
-    CHECK_STATUS(ScheduleAggGenerators(agg_col_infos_, &generators), common::kCodegenUdafError,
-                 "Schedule agg ops failed")
-
-    // gen head
-    builder.SetInsertPoint(head_block);
-    for (auto& agg_generator : generators) {
-        agg_generator.GenInitState(&builder);
-    }
-
-    ::llvm::Value* input_arg = fn->arg_begin();
-    ::llvm::Value* output_arg = fn->arg_begin() + 1;
-
     // on stack unique pointer
     size_t iter_bytes = sizeof(std::unique_ptr<codec::RowIterator>);
     ::llvm::Value* iter_ptr = CreateAllocaAtHead(
-        &builder, ::llvm::Type::getInt8Ty(llvm_ctx), "row_iter",
+        builder, ::llvm::Type::getInt8Ty(llvm_ctx), "row_iter",
         ::llvm::ConstantInt::get(int64_ty, iter_bytes, true));
     auto get_iter_func = module_->getOrInsertFunction(
         "hybridse_storage_get_row_iter", void_ty, ptr_ty, ptr_ty);
-    builder.CreateCall(get_iter_func, {input_arg, iter_ptr});
-    builder.CreateBr(enter_block);
+    builder->CreateCall(get_iter_func, {input_arg, iter_ptr});
+    builder->CreateBr(enter_block);
 
     // gen iter begin
-    builder.SetInsertPoint(enter_block);
+    builder->SetInsertPoint(enter_block);
     auto bool_ty = llvm::Type::getInt1Ty(llvm_ctx);
     auto has_next_func = module_->getOrInsertFunction(
         "hybridse_storage_row_iter_has_next",
         ::llvm::FunctionType::get(bool_ty, {ptr_ty}, false));
-    ::llvm::Value* has_next = builder.CreateCall(has_next_func, iter_ptr);
-    builder.CreateCondBr(has_next, body_block, exit_block);
+    ::llvm::Value* has_next = builder->CreateCall(has_next_func, iter_ptr);
+    builder->CreateCondBr(has_next, body_block, exit_block);
 
     // gen iter body
-    builder.SetInsertPoint(body_block);
+    builder->SetInsertPoint(body_block);
     auto get_slice_func = module_->getOrInsertFunction(
         "hybridse_storage_row_iter_get_cur_slice",
         ::llvm::FunctionType::get(ptr_ty, {ptr_ty, int64_ty}, false));
@@ -689,9 +706,9 @@ base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
             ::llvm::Value* idx_value =
                 llvm::ConstantInt::get(int64_ty, slice_idx, true);
             ::llvm::Value* buf_ptr =
-                builder.CreateCall(get_slice_func, {iter_ptr, idx_value});
+                builder->CreateCall(get_slice_func, {iter_ptr, idx_value});
             ::llvm::Value* buf_size =
-                builder.CreateCall(get_slice_size_func, {iter_ptr, idx_value});
+                builder->CreateCall(get_slice_size_func, {iter_ptr, idx_value});
             used_slices[slice_idx] = {buf_ptr, buf_size};
         }
     }
@@ -723,30 +740,172 @@ base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
     }
 
     // compute accumulation
-    for (auto& agg_generator : generators) {
+    for (auto& agg_generator : *generators) {
         std::vector<::llvm::Value*> fields;
         std::vector<::llvm::Value*> fields_is_null;
         for (auto& key : agg_generator.GetColKeys()) {
             auto iter = cur_row_fields_dict.find(key);
             CHECK_TRUE(iter != cur_row_fields_dict.end(), common::kCodegenUdafError, "Fail to find row field of ", key)
             auto& field_value = iter->second;
-            fields.push_back(field_value.GetValue(&builder));
-            fields_is_null.push_back(field_value.GetIsNull(&builder));
+            fields.push_back(field_value.GetValue(builder));
+            fields_is_null.push_back(field_value.GetIsNull(builder));
         }
-        agg_generator.GenUpdate(&builder, fields, fields_is_null);
+        agg_generator.GenUpdate(builder, fields, fields_is_null);
     }
     auto next_func = module_->getOrInsertFunction(
         "hybridse_storage_row_iter_next",
         ::llvm::FunctionType::get(void_ty, {ptr_ty}, false));
-    builder.CreateCall(next_func, {iter_ptr});
-    builder.CreateBr(enter_block);
+    builder->CreateCall(next_func, {iter_ptr});
+    builder->CreateBr(enter_block);
 
     // gen iter end
-    builder.SetInsertPoint(exit_block);
+    builder->SetInsertPoint(exit_block);
     auto delete_iter_func = module_->getOrInsertFunction(
         "hybridse_storage_row_iter_delete",
         ::llvm::FunctionType::get(void_ty, {ptr_ty}, false));
-    builder.CreateCall(delete_iter_func, {iter_ptr});
+    builder->CreateCall(delete_iter_func, {iter_ptr});
+
+    return base::Status::OK();
+}
+
+base::Status AggregateIRBuilder::BuildBatchUpdate(::llvm::Function* fn, ::llvm::Value* input_arg,
+                                                 std::vector<StatisticalAggGenerator>* generators,
+                                                 ::llvm::IRBuilder<>* builder) {
+    ::llvm::LLVMContext& llvm_ctx = module_->getContext();
+    auto void_ty = builder->getVoidTy();
+    auto int32_ty = builder->getInt32Ty();
+    auto ptr_ty = builder->getInt8PtrTy();
+    auto row_format = schema_context_->GetRowFormat();
+    CHECK_TRUE(row_format != nullptr, common::kCodegenError, "Row format is null")
+    ::llvm::BasicBlock* fetch_block =
+        ::llvm::BasicBlock::Create(llvm_ctx, "fetch_batch", fn);
+    ::llvm::BasicBlock* body_block =
+        ::llvm::BasicBlock::Create(llvm_ctx, "batch_body", fn);
+    ::llvm::BasicBlock* exit_block =
+        ::llvm::BasicBlock::Create(llvm_ctx, "exit_batch", fn);
+
+    // slice index, data type, index in null bitmap and offset of each column
+    std::vector<uint32_t> specs;
+    std::unordered_map<std::string, uint32_t> batch_col_idxs;
+    for (auto& pair : agg_col_infos_) {
+        auto& info = pair.second;
+        const codec::ColInfo* col_info = row_format->GetColumnInfo(info.schema_idx, info.col_idx);
+        CHECK_TRUE(col_info != nullptr, common::kCodegenGetFieldError, "fail to resolve field info of ", pair.first)
+        batch_col_idxs[pair.first] = specs.size() / 4;
+        specs.push_back(row_format->GetSliceId(info.schema_idx));
+        specs.push_back(info.col_type);
+        specs.push_back(col_info->idx);
+        specs.push_back(col_info->offset);
+    }
+    ::llvm::Constant* spec_array = ::llvm::ConstantDataArray::get(llvm_ctx, ::llvm::ArrayRef<uint32_t>(specs));
+    ::llvm::GlobalVariable* spec_global =
+        new ::llvm::GlobalVariable(*module_, spec_array->getType(), true, ::llvm::GlobalValue::PrivateLinkage,
+                                   spec_array, fn->getName() + "_specs");
+
+    auto new_batch_func = module_->getOrInsertFunction(
+        "hybridse_window_agg_batch_new",
+        ::llvm::FunctionType::get(ptr_ty, {ptr_ty, int32_ty->getPointerTo(), int32_ty}, false));
+    ::llvm::Value* batch = builder->CreateCall(
+        new_batch_func, {input_arg, builder->CreateConstInBoundsGEP2_32(spec_array->getType(), spec_global, 0, 0),
+                         builder->getInt32(batch_col_idxs.size())});
+
+    // the buffers of columns are fixed once the batch is created
+    auto get_values_func = module_->getOrInsertFunction(
+        "hybridse_window_agg_batch_get_values", ::llvm::FunctionType::get(ptr_ty, {ptr_ty, int32_ty}, false));
+    auto get_nulls_func = module_->getOrInsertFunction(
+        "hybridse_window_agg_batch_get_nulls", ::llvm::FunctionType::get(ptr_ty, {ptr_ty, int32_ty}, false));
+    std::vector<::llvm::Value*> col_values(batch_col_idxs.size());
+    std::vector<::llvm::Value*> col_nulls(batch_col_idxs.size());
+    for (size_t i = 0; i < batch_col_idxs.size(); ++i) {
+        col_values[i] = builder->CreateCall(get_values_func, {batch, builder->getInt32(i)});
+        col_nulls[i] = builder->CreateCall(get_nulls_func, {batch, builder->getInt32(i)});
+    }
+    builder->CreateBr(fetch_block);
+
+    // gen batch fetch
+    builder->SetInsertPoint(fetch_block);
+    auto fetch_func = module_->getOrInsertFunction("hybridse_window_agg_batch_fetch",
+                                                   ::llvm::FunctionType::get(int32_ty, {ptr_ty}, false));
+    ::llvm::Value* row_cnt = builder->CreateCall(fetch_func, {batch});
+    builder->CreateCondBr(builder->CreateICmpSGT(row_cnt, builder->getInt32(0)), body_block, exit_block);
+
+    // gen batch body
+    builder->SetInsertPoint(body_block);
+    for (auto& agg_generator : *generators) {
+        std::vector<::llvm::Value*> values;
+        std::vector<::llvm::Value*> nulls;
+        for (auto& key : agg_generator.GetColKeys()) {
+            auto iter = batch_col_idxs.find(key);
+            CHECK_TRUE(iter != batch_col_idxs.end(), common::kCodegenUdafError, "Fail to find batch column of ", key)
+            values.push_back(col_values[iter->second]);
+            nulls.push_back(col_nulls[iter->second]);
+        }
+        agg_generator.GenBatchUpdate(builder, values, nulls, row_cnt);
+    }
+    builder->CreateBr(fetch_block);
+
+    // gen batch end
+    builder->SetInsertPoint(exit_block);
+    auto delete_batch_func = module_->getOrInsertFunction("hybridse_window_agg_batch_delete",
+                                                          ::llvm::FunctionType::get(void_ty, {ptr_ty}, false));
+    builder->CreateCall(delete_batch_func, {batch});
+    return base::Status::OK();
+}
+
+base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
+                                    ExprIRBuilder* expr_ir_builder,
+                                    VariableIRBuilder* variable_ir_builder,
+                                    ::llvm::BasicBlock* cur_block,
+                                    const std::string& output_ptr_name,
+                                    const vm::Schema& output_schema) {
+    ::llvm::LLVMContext& llvm_ctx = module_->getContext();
+    ::llvm::IRBuilder<> builder(llvm_ctx);
+    expr_ir_builder->set_frame(nullptr, frame_node_);
+    NativeValue window_ptr;
+    CHECK_STATUS(expr_ir_builder->BuildWindow(&window_ptr))
+    CHECK_TRUE(nullptr != window_ptr.GetRaw(), common::kCodegenError, "Window ptr is null")
+
+    base::Status status;
+    NativeValue output_buf_wrapper;
+    CHECK_TRUE(variable_ir_builder->LoadValue(output_ptr_name, &output_buf_wrapper, status),
+               common::kCodegenLoadValueError, "fail to get output row ptr")
+    ::llvm::Value* output_buf = output_buf_wrapper.GetValue(&builder);
+
+    std::string fn_name =
+        base_funcname + "_multi_column_agg_" + std::to_string(id_) + "__";
+    auto ptr_ty = llvm::Type::getInt8Ty(llvm_ctx)->getPointerTo();
+    ::llvm::FunctionType* fnt = ::llvm::FunctionType::get(
+        llvm::Type::getVoidTy(llvm_ctx), {ptr_ty, ptr_ty}, false);
+    ::llvm::Function* fn = ::llvm::Function::Create(
+        fnt, llvm::Function::ExternalLinkage, fn_name, module_);
+    builder.SetInsertPoint(cur_block);
+    builder.CreateCall(
+        module_->getOrInsertFunction(fn_name, fnt),
+        {window_ptr.GetValue(&builder), builder.CreateLoad(output_buf)});
+
+    ::llvm::BasicBlock* head_block =
+        ::llvm::BasicBlock::Create(llvm_ctx, "head", fn);
+
+    std::vector<StatisticalAggGenerator> generators;
+    CHECK_STATUS(ScheduleAggGenerators(agg_col_infos_, &generators), common::kCodegenUdafError,
+                 "Schedule agg ops failed")
+
+    // gen head
+    builder.SetInsertPoint(head_block);
+    for (auto& agg_generator : generators) {
+        agg_generator.GenInitState(&builder);
+    }
+
+    ::llvm::Value* input_arg = fn->arg_begin();
+    ::llvm::Value* output_arg = fn->arg_begin() + 1;
+
+    // the builder is at the exit block once the states are updated
+    if (FLAGS_enable_window_agg_batch) {
+        CHECK_STATUS(BuildBatchUpdate(fn, input_arg, &generators, &builder))
+    } else {
+        CHECK_STATUS(BuildRowUpdate(fn, input_arg, &generators, &builder))
+    }
+    ::llvm::BasicBlock* exit_block = builder.GetInsertBlock();
 
     // store results to output row
     std::map<uint32_t, NativeValue> dummy_map;
@@ -32,6 +32,8 @@
 namespace hybridse {
 namespace codegen {
 
+class StatisticalAggGenerator;
+
 struct AggColumnInfo {
     ::hybridse::node::ColumnRefNode* col;
     node::DataType col_type;
@@ -104,6 +106,16 @@ class AggregateIRBuilder {
     bool empty() const { return agg_col_infos_.empty(); }
 
  private:
+    // update the agg states row by row through the row iterator
+    base::Status BuildRowUpdate(::llvm::Function* fn, ::llvm::Value* input_arg,
+                                std::vector<StatisticalAggGenerator>* generators,
+                                ::llvm::IRBuilder<>* builder);
+
+    // update the agg states batch by batch through the window agg batch
+    base::Status BuildBatchUpdate(::llvm::Function* fn, ::llvm::Value* input_arg,
+                                  std::vector<StatisticalAggGenerator>* generators,
+                                  ::llvm::IRBuilder<>* builder);
+
     const vm::SchemasContext* schema_context_;
     ::llvm::Module* module_;
     const node::FrameNode* frame_node_;
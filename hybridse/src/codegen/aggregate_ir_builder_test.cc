@@ -17,6 +17,9 @@
 #include <string>
 #include <vector>
 #include "codegen/fn_let_ir_builder_test.h"
+#include "gflags/gflags.h"
+
+DECLARE_bool(enable_window_agg_batch);
 
 namespace hybridse {
 namespace codegen {
@@ -31,8 +34,9 @@ class AggregateIRBuilderTest : public ::testing::Test {
     node::NodeManager manager;
 };
 
-TEST_F(AggregateIRBuilderTest, TestMixedMultipleAgg) {
-    std::string sql =
+// sum, avg, count, min and max of col1 to col5 over a window
+const char* MixedMultipleAggSql() {
+    return
         "SELECT "
         "sum(col1) OVER w1 as col1_sum, "
         "avg(col1) OVER w1 as col1_avg, "
@@ -68,6 +72,10 @@ TEST_F(AggregateIRBuilderTest, TestMixedMultipleAgg) {
         "w1 AS "
         "(PARTITION BY COL2 ORDER BY `TS` ROWS_RANGE BETWEEN 3 PRECEDING AND "
         "CURRENT ROW) limit 10;";
+}
+
+TEST_F(AggregateIRBuilderTest, TestMixedMultipleAgg) {
+    std::string sql = MixedMultipleAggSql();
 
     int8_t* ptr = NULL;
     std::vector<Row> window;
@@ -124,6 +132,69 @@ TEST_F(AggregateIRBuilderTest, TestMixedMultipleAgg) {
     free(ptr);
 }
 
+// a window of count rows, col1, col4 and col5 are null in some rows
+void BuildNullableWindow(const type::TableDef& table, uint32_t count, std::vector<Row>* rows) {
+    rows->clear();
+    codec::RowBuilder builder(table.columns());
+    for (uint32_t i = 0; i < count; i++) {
+        std::string str = "str" + std::to_string(i);
+        uint32_t size = builder.CalTotalLength(str.size());
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(buf, size);
+        if (i % 7 == 0) {
+            builder.AppendNULL();
+        } else {
+            builder.AppendInt32(static_cast<int32_t>(i) * 3 - 1000);
+        }
+        builder.AppendInt16(i % 100);
+        builder.AppendFloat(i * 0.7f);
+        if (i % 5 == 0) {
+            builder.AppendNULL();
+        } else {
+            builder.AppendDouble(i * 1.1 - 300.0);
+        }
+        if (i % 7 == 3) {
+            builder.AppendNULL();
+        } else {
+            builder.AppendInt64(i * 1000000007L - 123456789L);
+        }
+        builder.AppendString(str.c_str(), str.size());
+        builder.AppendTimestamp(1590115420000L + i);
+        rows->push_back(Row(base::RefCountedSlice::CreateManaged(buf, size)));
+    }
+}
+
+TEST_F(AggregateIRBuilderTest, TestBatchAggSameAsRowAgg) {
+    std::string sql = MixedMultipleAggSql();
+    int8_t* ptr = NULL;
+    std::vector<Row> window;
+    type::TableDef table1;
+    BuildWindow(table1, window, &ptr);
+    codec::ListRef<Row> window_ref;
+    window_ref.list = ptr;
+    int8_t* window_ptr = reinterpret_cast<int8_t*>(&window_ref);
+    // less than, equal to and more than a batch
+    for (uint32_t count : {1u, 256u, 1000u}) {
+        BuildNullableWindow(table1, count, &window);
+        int8_t* row_ptr = reinterpret_cast<int8_t*>(&window[window.size() - 1]);
+        std::string outputs[2];
+        for (int batch = 0; batch < 2; batch++) {
+            FLAGS_enable_window_agg_batch = batch == 1;
+            node::NodeManager nm;
+            int8_t* output = NULL;
+            codec::Schema schema;
+            CheckFnLetBuilder(&nm, table1, "", sql, row_ptr, window_ptr, &schema, &output);
+            codec::RowView view(schema);
+            view.Reset(output, view.GetSize(output));
+            ASSERT_EQ(count - (count + 6) / 7, view.GetInt64Unsafe(2));
+            outputs[batch] = std::string(reinterpret_cast<char*>(output), view.GetSize(output));
+        }
+        ASSERT_EQ(outputs[0], outputs[1]) << "window size " << count;
+    }
+    FLAGS_enable_window_agg_batch = true;
+    free(ptr);
+}
+
 }  // namespace codegen
 }  // namespace hybridse
 
@@ -22,3 +22,8 @@ DEFINE_string(default_db_name, "_hybridse",
 // Offline Spark config
 DEFINE_bool(enable_spark_unsaferow_format, false,
             "config if codec uses Spark UnsafeRow format");
+
+// Codegen config
+DEFINE_bool(enable_window_agg_batch, true,
+            "config if the window aggregations over columns decode the rows "
+            "in batches and update them by the vectorized kernels");
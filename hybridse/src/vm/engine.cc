@@ -15,12 +15,11 @@
  */
 
 #include "vm/engine.h"
+#include <chrono>  // NOLINT
 #include <string>
 #include <utility>
 #include <vector>
 #include "base/fe_strings.h"
-#include "boost/none.hpp"
-#include "boost/optional.hpp"
 #include "codec/fe_row_codec.h"
 #include "codec/fe_schema_codec.h"
 #include "codec/list_iterator_codec.h"
@@ -50,13 +49,57 @@ EngineOptions::EngineOptions()
       enable_expr_optimize_(true),
       enable_batch_window_parallelization_(false),
       enable_window_column_pruning_(false),
-      max_sql_cache_size_(50) {
+      max_sql_cache_size_(50),
+      max_sql_cache_bytes_(0),
+      enable_tiered_jit_(false) {
 }
 
-Engine::Engine(const std::shared_ptr<Catalog>& catalog) : cl_(catalog), options_(), mu_(), lru_cache_() {}
+Engine::Engine(const std::shared_ptr<Catalog>& catalog)
+    : cl_(catalog),
+      options_(),
+      mu_(),
+      lru_cache_(),
+      compiling_(),
+      hit_cnt_(0),
+      miss_cnt_(0),
+      wait_cnt_(0),
+      compile_time_us_(0),
+      upgrade_cnt_(0),
+      upgrade_mu_(),
+      upgrade_cv_(),
+      upgrade_tasks_(),
+      stop_upgrade_(false),
+      upgrade_thread_() {}
 Engine::Engine(const std::shared_ptr<Catalog>& catalog, const EngineOptions& options)
-    : cl_(catalog), options_(options), mu_(), lru_cache_() {}
-Engine::~Engine() {}
+    : cl_(catalog),
+      options_(options),
+      mu_(),
+      lru_cache_(),
+      compiling_(),
+      hit_cnt_(0),
+      miss_cnt_(0),
+      wait_cnt_(0),
+      compile_time_us_(0),
+      upgrade_cnt_(0),
+      upgrade_mu_(),
+      upgrade_cv_(),
+      upgrade_tasks_(),
+      stop_upgrade_(false),
+      upgrade_thread_() {
+    if (options_.IsEnableTieredJit()) {
+        upgrade_thread_ = std::thread(&Engine::RunUpgradeTasks, this);
+    }
+}
+Engine::~Engine() {
+    {
+        std::lock_guard<std::mutex> lock(upgrade_mu_);
+        stop_upgrade_ = true;
+    }
+    upgrade_cv_.notify_all();
+    if (upgrade_thread_.joinable()) {
+        upgrade_thread_.join();
+    }
+}
 void Engine::InitializeGlobalLLVM() {
     if (LLVM_IS_INITIALIZED) return;
     LLVMInitializeNativeTarget();
@@ -172,6 +215,13 @@ bool Engine::IsCompatibleCache(RunSession& session,  // NOLINT
         return false;
     }
     auto& cache_ctx = std::dynamic_pointer_cast<SqlCompileInfo>(info)->get_sql_context();
+    // the sessions asking for optimization, e.g. of deployments, don't take the one compiled without it
+    auto& options = session.GetOptions();
+    if (cache_ctx.jit_options.IsFastCompile() && options &&
+        (options->count(PERSIST_OBJECT) || options->count(FULL_OPTIMIZE))) {
+        status = Status(common::kEngineCacheError, "Inconsistent cache, it's compiled without optimization");
+        return false;
+    }
 
     if (session.engine_mode() == kBatchMode) {
         auto batch_sess = dynamic_cast<BatchRunSession*>(&session);
@@ -206,6 +256,7 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
                  base::Status& status) {  // NOLINT (runtime/references)
     std::shared_ptr<CompileInfo> cached_info = GetCacheLocked(db, sql, session.engine_mode());
     if (cached_info && IsCompatibleCache(session, cached_info, status)) {
+        hit_cnt_.fetch_add(1, std::memory_order_relaxed);
         session.SetCompileInfo(cached_info);
         return true;
     }
@@ -214,10 +265,76 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
         LOG(WARNING) << status;
         status = base::Status::OK();
     }
+    // only one of the concurrent compilations of the same sql compiles it, the others wait for its result
+    auto key = std::make_tuple(session.engine_mode(), db, sql);
+    std::promise<std::shared_ptr<CompileInfo>> promise;
+    std::shared_future<std::shared_ptr<CompileInfo>> compiling;
+    bool is_leader = false;
+    {
+        std::lock_guard<base::SpinMutex> lock(mu_);
+        auto it = compiling_.find(key);
+        if (it == compiling_.end()) {
+            compiling_.emplace(key, promise.get_future().share());
+            is_leader = true;
+        } else {
+            compiling = it->second;
+        }
+    }
+    if (!is_leader) {
+        auto info = compiling.get();
+        if (info && IsCompatibleCache(session, info, status)) {
+            wait_cnt_.fetch_add(1, std::memory_order_relaxed);
+            session.SetCompileInfo(info);
+            return true;
+        }
+        // the compilation fails or it's not compatible, e.g. with other parameter types, compile it by itself
+        status = base::Status::OK();
+    }
+    bool fast_compile = IsTieredCompile(session);
+    miss_cnt_.fetch_add(1, std::memory_order_relaxed);
+    auto start_time = std::chrono::steady_clock::now();
+    auto info = Compile(sql, db, session, fast_compile, status);
+    compile_time_us_.fetch_add(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count(),
+        std::memory_order_relaxed);
+    if (info) {
+        SetCacheLocked(db, sql, session.engine_mode(), info);
+    }
+    if (is_leader) {
+        {
+            std::lock_guard<base::SpinMutex> lock(mu_);
+            compiling_.erase(key);
+        }
+        promise.set_value(info);
+    }
+    if (info && fast_compile) {
+        Upgrade(sql, db, session, info);
+    }
+    if (!info) {
+        return false;
+    }
+    session.SetCompileInfo(info);
+    if (session.is_debug_) {
+        auto& sql_context = std::dynamic_pointer_cast<SqlCompileInfo>(info)->get_sql_context();
+        std::ostringstream plan_oss;
+        if (nullptr != sql_context.physical_plan) {
+            sql_context.physical_plan->Print(plan_oss, "");
+            LOG(INFO) << "physical plan:\n" << plan_oss.str() << std::endl;
+        }
+        std::ostringstream runner_oss;
+        sql_context.cluster_job.Print(runner_oss, "");
+        LOG(INFO) << "cluster job:\n" << runner_oss.str() << std::endl;
+    }
+    return true;
+}
+
+std::shared_ptr<CompileInfo> Engine::Compile(const std::string& sql, const std::string& db, RunSession& session,
+                                             bool fast_compile,
+                                             base::Status& status) {  // NOLINT (runtime/references)
     DLOG(INFO) << "Compile Engine ...";
     status = base::Status::OK();
     std::shared_ptr<SqlCompileInfo> info = std::make_shared<SqlCompileInfo>();
-    auto& sql_context = std::dynamic_pointer_cast<SqlCompileInfo>(info)->get_sql_context();
+    auto& sql_context = info->get_sql_context();
     sql_context.sql = sql;
     sql_context.db = db;
     sql_context.engine_mode = session.engine_mode();
@@ -228,6 +345,13 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
     sql_context.enable_expr_optimize = options_.IsEnableExprOptimize();
     sql_context.jit_options = options_.jit_options();
     sql_context.options = session.GetOptions();
+    if (sql_context.options && sql_context.options->count(PERSIST_OBJECT)) {
+        sql_context.jit_options.SetPersistObject(true);
+    }
+    if (sql_context.options && sql_context.options->count(SHARED_JIT)) {
+        sql_context.jit_options.SetEnableSharedJit(true);
+    }
+    sql_context.jit_options.SetFastCompile(fast_compile);
     if (session.engine_mode() == kBatchMode) {
         sql_context.parameter_types = dynamic_cast<BatchRunSession*>(&session)->GetParameterSchema();
     } else if (session.engine_mode() == kBatchRequestMode) {
@@ -239,29 +363,120 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
                          options_.IsPlanOnly());
     bool ok = compiler.Compile(info->get_sql_context(), status);
     if (!ok || 0 != status.code) {
-        return false;
+        return nullptr;
     }
     if (!options_.IsCompileOnly()) {
         ok = compiler.BuildClusterJob(info->get_sql_context(), status);
         if (!ok || 0 != status.code) {
             LOG(WARNING) << "fail to build cluster job: " << status.msg;
-            return false;
+            return nullptr;
         }
     }
 
-    SetCacheLocked(db, sql, session.engine_mode(), info);
-    session.SetCompileInfo(info);
-    if (session.is_debug_) {
-        std::ostringstream plan_oss;
-        if (nullptr != sql_context.physical_plan) {
-            sql_context.physical_plan->Print(plan_oss, "");
-            LOG(INFO) << "physical plan:\n" << plan_oss.str() << std::endl;
+    return info;
+}
+
+// the maximum compilations with optimization waiting in background, the sqls are compiled with optimization directly
+// once there are too many
+static constexpr size_t kMaxUpgradeTasks = 64;
+
+bool Engine::IsTieredCompile(const RunSession& session) {
+    if (!options_.IsEnableTieredJit() || options_.IsPlanOnly()) {
+        return false;
+    }
+    // the objects persisted are for the steady state
+    auto& options = session.GetOptions();
+    if (options_.jit_options().IsPersistObject() ||
+        (options && (options->count(PERSIST_OBJECT) || options->count(FULL_OPTIMIZE)))) {
+        return false;
+    }
+    switch (session.engine_mode()) {
+        case kBatchMode:
+        case kRequestMode:
+        case kBatchRequestMode:
+            break;
+        default:
+            return false;
+    }
+    std::lock_guard<std::mutex> lock(upgrade_mu_);
+    return upgrade_tasks_.size() < kMaxUpgradeTasks;
+}
+
+void Engine::Upgrade(const std::string& sql, const std::string& db, const RunSession& session,
+                     const std::shared_ptr<CompileInfo>& info) {
+    // the session is copied as the task runs after it's gone
+    std::shared_ptr<RunSession> upgrade_session;
+    switch (session.engine_mode()) {
+        case kBatchMode: {
+            auto batch_session = std::make_shared<BatchRunSession>();
+            batch_session->SetParameterSchema(dynamic_cast<const BatchRunSession&>(session).GetParameterSchema());
+            upgrade_session = batch_session;
+            break;
         }
-        std::ostringstream runner_oss;
-        sql_context.cluster_job.Print(runner_oss, "");
-        LOG(INFO) << "cluster job:\n" << runner_oss.str() << std::endl;
+        case kRequestMode: {
+            upgrade_session = std::make_shared<RequestRunSession>();
+            break;
+        }
+        case kBatchRequestMode: {
+            auto batch_request_session = std::make_shared<BatchRequestRunSession>();
+            for (auto idx : dynamic_cast<const BatchRequestRunSession&>(session).common_column_indices()) {
+                batch_request_session->AddCommonColumnIdx(idx);
+            }
+            upgrade_session = batch_request_session;
+            break;
+        }
+        default:
+            return;
+    }
+    upgrade_session->SetOptions(session.GetOptions());
+    std::weak_ptr<CompileInfo> fast_info = info;
+    std::lock_guard<std::mutex> lock(upgrade_mu_);
+    upgrade_tasks_.emplace_back([this, sql, db, upgrade_session, fast_info] {
+        if (fast_info.expired()) {
+            // it's evicted from the cache and not running
+            return;
+        }
+        base::Status status;
+        auto info = Compile(sql, db, *upgrade_session, false, status);
+        if (!info) {
+            LOG(WARNING) << "fail to compile sql with optimization: " << status;
+            return;
+        }
+        std::lock_guard<base::SpinMutex> lock(mu_);
+        auto mode_iter = lru_cache_.find(upgrade_session->engine_mode());
+        if (mode_iter == lru_cache_.end()) {
+            return;
+        }
+        auto db_iter = mode_iter->second.find(db);
+        if (db_iter == mode_iter->second.end()) {
+            return;
+        }
+        // replace it only if it's the one compiled without optimization, the sessions running it keep it alive
+        auto cached_info = db_iter->second.Get(sql);
+        if (cached_info != nullptr && cached_info == fast_info.lock()) {
+            db_iter->second.Insert(sql, info);
+            upgrade_cnt_.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    upgrade_cv_.notify_one();
+}
+
+void Engine::RunUpgradeTasks() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(upgrade_mu_);
+            while (upgrade_tasks_.empty() && !stop_upgrade_) {
+                upgrade_cv_.wait(lock);
+            }
+            if (stop_upgrade_) {
+                return;
+            }
+            task = std::move(upgrade_tasks_.front());
+            upgrade_tasks_.pop_front();
+        }
+        task();
     }
-    return true;
 }
 
 base::Status Engine::RegisterExternalFunction(const std::string& name, node::DataType return_type,
@@ -384,6 +599,23 @@ EngineOptions Engine::GetEngineOptions() {
     return options_;
 }
 
+EngineCacheStats Engine::GetCacheStats() {
+    EngineCacheStats stats;
+    stats.hit_cnt = hit_cnt_.load(std::memory_order_relaxed);
+    stats.miss_cnt = miss_cnt_.load(std::memory_order_relaxed);
+    stats.wait_cnt = wait_cnt_.load(std::memory_order_relaxed);
+    stats.compile_time_us = compile_time_us_.load(std::memory_order_relaxed);
+    stats.upgrade_cnt = upgrade_cnt_.load(std::memory_order_relaxed);
+    std::lock_guard<base::SpinMutex> lock(mu_);
+    for (const auto& mode_cache : lru_cache_) {
+        for (const auto& db_cache : mode_cache.second) {
+            stats.entry_cnt += db_cache.second.Size();
+            stats.byte_size += db_cache.second.GetByteSize();
+        }
+    }
+    return stats;
+}
+
 std::shared_ptr<CompileInfo> Engine::GetCacheLocked(const std::string& db, const std::string& sql,
                                                     EngineMode engine_mode) {
     std::lock_guard<base::SpinMutex> lock(mu_);
@@ -398,15 +630,8 @@ std::shared_ptr<CompileInfo> Engine::GetCacheLocked(const std::string& db, const
     if (db_iter == mode_cache.end()) {
         return nullptr;
     }
-    auto& lru = db_iter->second;
-
     // Check SQL
-    auto value = lru.get(sql);
-    if (value == boost::none) {
-        return nullptr;
-    } else {
-        return value.value();
-    }
+    return db_iter->second.Get(sql);
 }
 
 bool Engine::SetCacheLocked(const std::string& db, const std::string& sql, EngineMode engine_mode,
@@ -414,15 +639,15 @@ bool Engine::SetCacheLocked(const std::string& db, const std::string& sql, Engin
     std::lock_guard<base::SpinMutex> lock(mu_);
 
     auto& mode_cache = lru_cache_[engine_mode];
-    using BoostLRU = boost::compute::detail::lru_cache<std::string, std::shared_ptr<CompileInfo>>;
-    std::map<std::string, BoostLRU>::iterator db_iter = mode_cache.find(db);
+    auto db_iter = mode_cache.find(db);
     if (db_iter == mode_cache.end()) {
-        db_iter = mode_cache.insert(db_iter, {db, BoostLRU(options_.GetMaxSqlCacheSize())});
+        db_iter = mode_cache
+                      .emplace(db, CompileInfoLRUCache(options_.GetMaxSqlCacheSize(), options_.GetMaxSqlCacheBytes()))
+                      .first;
     }
     auto& lru = db_iter->second;
-    auto value = lru.get(sql);
-    if (value == boost::none || engine_mode == kBatchRequestMode) {
-        lru.insert(sql, info);
+    if (lru.Get(sql) == nullptr || engine_mode == kBatchRequestMode) {
+        lru.Insert(sql, info);
         return true;
     } else {
         // TODO(xxx): Ensure compile result is stable
@@ -431,6 +656,34 @@ bool Engine::SetCacheLocked(const std::string& db, const std::string& sql, Engin
     }
 }
 
+std::shared_ptr<CompileInfo> CompileInfoLRUCache::Get(const std::string& sql) {
+    auto it = index_.find(sql);
+    if (it == index_.end()) {
+        return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->info;
+}
+
+void CompileInfoLRUCache::Insert(const std::string& sql, const std::shared_ptr<CompileInfo>& info) {
+    auto it = index_.find(sql);
+    if (it != index_.end()) {
+        byte_size_ -= it->second->byte_size;
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+    entries_.push_front({sql, info, info->GetByteSize()});
+    index_.emplace(sql, entries_.begin());
+    byte_size_ += entries_.front().byte_size;
+    // the one inserted is kept even if it's larger than max bytes
+    while (entries_.size() > 1 &&
+           (entries_.size() > max_size_ || (max_bytes_ > 0 && byte_size_ > max_bytes_))) {
+        byte_size_ -= entries_.back().byte_size;
+        index_.erase(entries_.back().sql);
+        entries_.pop_back();
+    }
+}
+
 RunSession::RunSession(EngineMode engine_mode) : engine_mode_(engine_mode), is_debug_(false), sp_name_("") {}
 RunSession::~RunSession() {}
 
@@ -498,6 +751,12 @@ int32_t BatchRunSession::Run(std::vector<Row>& rows, uint64_t limit) {
     return Run(Row(), rows, limit);
 }
 int32_t BatchRunSession::Run(const Row& parameter_row, std::vector<Row>& rows, uint64_t limit) {
+    return Run(parameter_row, [&rows](const Row& row) {
+        rows.push_back(row);
+        return true;
+    });
+}
+int32_t BatchRunSession::Run(const Row& parameter_row, const std::function<bool(const Row&)>& callback) {
     auto& sql_ctx = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context();
     RunnerContext ctx(&sql_ctx.cluster_job, parameter_row, is_debug_);
     auto output = sql_ctx.cluster_job.GetTask(0).GetRoot()->RunWithCache(ctx);
@@ -513,13 +772,15 @@ int32_t BatchRunSession::Run(const Row& parameter_row, std::vector<Row>& rows, u
             }
             iter->SeekToFirst();
             while (iter->Valid()) {
-                rows.push_back(iter->GetValue());
+                if (!callback(iter->GetValue())) {
+                    break;
+                }
                 iter->Next();
             }
             return 0;
         }
         case kRowHandler: {
-            rows.push_back(std::dynamic_pointer_cast<RowHandler>(output)->GetValue());
+            callback(std::dynamic_pointer_cast<RowHandler>(output)->GetValue());
             return 0;
         }
         case kPartitionHandler: {
@@ -14,11 +14,16 @@
  * limitations under the License.
  */
 
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <vector>
 #include "case/case_data_mock.h"
 #include "gtest/gtest.h"
 #include "gtest/internal/gtest-param-util.h"
 #include "testing/engine_test_base.h"
 #include "udf/openmldb_udf.h"
+#include "vm/sql_compiler.h"
 
 using namespace llvm;       // NOLINT (build/namespaces)
 using namespace llvm::orc;  // NOLINT (build/namespaces)
@@ -84,6 +89,156 @@ TEST_F(EngineCompileTest, EngineLRUCacheTest) {
 }
 
 
+static std::shared_ptr<SimpleCatalog> BuildCacheTestCatalog() {
+    auto catalog = BuildSimpleCatalog();
+    hybridse::type::Database db;
+    db.set_name("simple_db");
+    hybridse::type::TableDef table_def;
+    sqlcase::CaseSchemaMock::BuildTableDef(table_def);
+    table_def.set_name("t1");
+    AddTable(db, table_def);
+    catalog->AddDatabase(db);
+    return catalog;
+}
+
+TEST_F(EngineCompileTest, EngineLRUCacheBytesTest) {
+    auto catalog = BuildCacheTestCatalog();
+    EngineOptions options;
+    options.SetCompileOnly(true);
+    // only the latest one is kept
+    options.SetMaxSqlCacheBytes(1);
+    Engine engine(catalog, options);
+    std::string sql = "select col1, col2 from t1;";
+    std::string sql2 = "select col1, col2 as cl2 from t1;";
+    base::Status get_status;
+    BatchRunSession bsession1;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", bsession1, get_status)) << get_status;
+    ASSERT_GT(bsession1.GetCompileInfo()->GetByteSize(), 0u);
+    BatchRunSession bsession2;
+    ASSERT_TRUE(engine.Get(sql2, "simple_db", bsession2, get_status)) << get_status;
+    auto stats = engine.GetCacheStats();
+    ASSERT_EQ(1u, stats.entry_cnt);
+    ASSERT_EQ(bsession2.GetCompileInfo()->GetByteSize(), stats.byte_size);
+    BatchRunSession bsession3;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", bsession3, get_status)) << get_status;
+    ASSERT_NE(bsession1.GetCompileInfo().get(), bsession3.GetCompileInfo().get());
+    stats = engine.GetCacheStats();
+    ASSERT_EQ(0u, stats.hit_cnt);
+    ASSERT_EQ(3u, stats.miss_cnt);
+}
+
+TEST_F(EngineCompileTest, EngineSingleFlightCompileTest) {
+    auto catalog = BuildCacheTestCatalog();
+    EngineOptions options;
+    Engine engine(catalog, options);
+    std::string sql = "select col1, col2 + 1 as cl2, col3 * 2 as cl3 from t1;";
+    const int thread_num = 8;
+    std::vector<std::shared_ptr<CompileInfo>> infos(thread_num);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; i++) {
+        threads.emplace_back([&engine, &sql, &infos, i] {
+            base::Status get_status;
+            BatchRunSession session;
+            if (engine.Get(sql, "simple_db", session, get_status)) {
+                infos[i] = session.GetCompileInfo();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    // the sql is compiled once, all of them get the same result
+    for (int i = 0; i < thread_num; i++) {
+        ASSERT_TRUE(infos[i] != nullptr);
+        ASSERT_EQ(infos[0].get(), infos[i].get());
+    }
+    auto stats = engine.GetCacheStats();
+    ASSERT_EQ(1u, stats.miss_cnt);
+    ASSERT_EQ(static_cast<uint64_t>(thread_num - 1), stats.hit_cnt + stats.wait_cnt);
+    ASSERT_EQ(1u, stats.entry_cnt);
+}
+
+
+TEST_F(EngineCompileTest, EngineTieredJitTest) {
+    auto catalog = BuildCacheTestCatalog();
+    EngineOptions options;
+    options.SetEnableTieredJit(true);
+    Engine engine(catalog, options);
+    std::string sql = "select col1, col2 + 1 as cl2 from t1;";
+    base::Status get_status;
+    BatchRunSession bsession1;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", bsession1, get_status)) << get_status;
+    auto info1 = std::dynamic_pointer_cast<SqlCompileInfo>(bsession1.GetCompileInfo());
+    ASSERT_TRUE(info1->get_sql_context().jit_options.IsFastCompile());
+    // the one compiled with optimization replaces it in background
+    for (int i = 0; i < 1000 && engine.GetCacheStats().upgrade_cnt == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(1u, engine.GetCacheStats().upgrade_cnt);
+    BatchRunSession bsession2;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", bsession2, get_status)) << get_status;
+    auto info2 = std::dynamic_pointer_cast<SqlCompileInfo>(bsession2.GetCompileInfo());
+    ASSERT_NE(info1.get(), info2.get());
+    ASSERT_FALSE(info2->get_sql_context().jit_options.IsFastCompile());
+
+    // compiled with optimization directly
+    BatchRunSession bsession3;
+    auto session_options = std::make_shared<std::unordered_map<std::string, std::string>>();
+    session_options->emplace(FULL_OPTIMIZE, "true");
+    bsession3.SetOptions(session_options);
+    ASSERT_TRUE(engine.Get("select col1, col2 + 2 as cl2 from t1;", "simple_db", bsession3, get_status))
+        << get_status;
+    auto info3 = std::dynamic_pointer_cast<SqlCompileInfo>(bsession3.GetCompileInfo());
+    ASSERT_FALSE(info3->get_sql_context().jit_options.IsFastCompile());
+}
+
+TEST_F(EngineCompileTest, EngineTieredJitOptimizeSessionTest) {
+    auto catalog = BuildCacheTestCatalog();
+    EngineOptions options;
+    options.SetEnableTieredJit(true);
+    Engine engine(catalog, options);
+    std::string sql = "select col1, col2 + 1 as cl2 from t1;";
+    auto session_options = std::make_shared<std::unordered_map<std::string, std::string>>();
+    session_options->emplace(FULL_OPTIMIZE, "true");
+    // the sessions asking for optimization don't take the cached or the compiling one without optimization
+    const int thread_num = 8;
+    std::vector<std::shared_ptr<SqlCompileInfo>> infos(thread_num);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; i++) {
+        threads.emplace_back([&engine, &sql, &infos, &session_options, i] {
+            base::Status get_status;
+            BatchRunSession session;
+            if (i % 2 == 1) {
+                session.SetOptions(session_options);
+            }
+            if (engine.Get(sql, "simple_db", session, get_status)) {
+                infos[i] = std::dynamic_pointer_cast<SqlCompileInfo>(session.GetCompileInfo());
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (int i = 1; i < thread_num; i += 2) {
+        ASSERT_TRUE(infos[i] != nullptr);
+        ASSERT_FALSE(infos[i]->get_sql_context().jit_options.IsFastCompile());
+    }
+    BatchRunSession bsession;
+    base::Status get_status;
+    ASSERT_TRUE(engine.Get("select col1, col2 + 2 as cl2 from t1;", "simple_db", bsession, get_status))
+        << get_status;
+    auto info = std::dynamic_pointer_cast<SqlCompileInfo>(bsession.GetCompileInfo());
+    ASSERT_TRUE(info->get_sql_context().jit_options.IsFastCompile());
+    BatchRunSession bsession_opt;
+    bsession_opt.SetOptions(session_options);
+    ASSERT_TRUE(engine.Get("select col1, col2 + 2 as cl2 from t1;", "simple_db", bsession_opt, get_status))
+        << get_status;
+    auto info_opt = std::dynamic_pointer_cast<SqlCompileInfo>(bsession_opt.GetCompileInfo());
+    ASSERT_NE(info.get(), info_opt.get());
+    ASSERT_FALSE(info_opt->get_sql_context().jit_options.IsFastCompile());
+}
+
+
 TEST_F(EngineCompileTest, EngineWithParameterizedLRUCacheTest) {
     // Build Simple Catalog
     auto catalog = BuildSimpleCatalog();
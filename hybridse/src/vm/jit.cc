@@ -15,13 +15,17 @@
  */
 
 #include "vm/jit.h"
+#include <utime.h>
+#include <algorithm>
 #include <string>
 #include <utility>
+#include <vector>
 extern "C" {
 #include <cmath>
 #include <cstdlib>
 }
 #include "glog/logging.h"
+#include "hybridse_version.h"  // NOLINT
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITSymbol.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
@@ -32,10 +36,15 @@ extern "C" {
 #include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
@@ -148,10 +157,25 @@ bool HybridSeJit::AddSymbol(::llvm::orc::JITDylib& jd,
     }
 }
 
+// the target machine of the host, which generates code without optimization for fast compiling
+static ::llvm::Expected<::llvm::orc::JITTargetMachineBuilder> DetectHost(bool fast_compile) {
+    auto jtmb = ::llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (jtmb && fast_compile) {
+        jtmb->setCodeGenOptLevel(::llvm::CodeGenOpt::None);
+        jtmb->getOptions().EnableFastISel = true;
+    }
+    return jtmb;
+}
+
 bool HybridSeLlvmJitWrapper::Init() {
     DLOG(INFO) << "Start to initialize hybridse jit";
+    auto jtmb = DetectHost(fast_compile_);
+    if (!jtmb) {
+        LOG(WARNING) << "fail to detect host: " << ::llvm::toString(jtmb.takeError());
+        return false;
+    }
     auto jit = ::llvm::Expected<std::unique_ptr<HybridSeJit>>(
-        HybridSeJitBuilder().create());
+        HybridSeJitBuilder().setJITTargetMachineBuilder(std::move(*jtmb)).create());
     {
         ::llvm::Error e = jit.takeError();
         if (e) {
@@ -170,6 +194,9 @@ bool HybridSeLlvmJitWrapper::Init() {
 }
 
 bool HybridSeLlvmJitWrapper::OptModule(::llvm::Module* module) {
+    if (fast_compile_) {
+        return true;
+    }
     return jit_->OptModule(module);
 }
 
@@ -205,6 +232,342 @@ bool HybridSeLlvmJitWrapper::AddExternalFunction(const std::string& name,
                                                 name, addr);
 }
 
+// a new shared jit is created once the current one holds so many modules
+static constexpr uint64_t kMaxSharedJitModules = 1024;
+static constexpr uint64_t kMaxObjectCacheBytes = 256 * 1024 * 1024;
+
+// the objects depend on the engine and llvm version, the host cpu and the optimization besides the module, which
+// contains the row layouts of the schemas, so an object persisted is never loaded after any of them changes
+static std::string HashModule(::llvm::Module* m, bool fast_compile) {
+    ::llvm::MD5 md5;
+    md5.update(fast_compile ? "fast" : "opt");
+    md5.update(std::to_string(HYBRIDSE_VERSION_MAJOR) + "." + std::to_string(HYBRIDSE_VERSION_MINOR) + "." +
+               std::to_string(HYBRIDSE_VERSION_BUG));
+    md5.update(LLVM_VERSION_STRING);
+    md5.update(::llvm::sys::getProcessTriple());
+    md5.update(::llvm::sys::getHostCPUName());
+    md5.update(LlvmToString(*m));
+    ::llvm::MD5::MD5Result result;
+    md5.final(result);
+    return "sql_" + result.digest().str().str();
+}
+
+HybridSeObjectCache* HybridSeObjectCache::Get() {
+    static HybridSeObjectCache cache;
+    return &cache;
+}
+
+void HybridSeObjectCache::SetDir(const std::string& dir, uint64_t max_dir_bytes) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (dir_ == dir && max_dir_bytes_ == max_dir_bytes) {
+        return;
+    }
+    auto ec = ::llvm::sys::fs::create_directories(dir);
+    if (ec) {
+        LOG(WARNING) << "fail to create object cache dir " << dir << ": " << ec.message();
+        return;
+    }
+    dir_ = dir;
+    max_dir_bytes_ = max_dir_bytes;
+    Sweep();
+}
+
+void HybridSeObjectCache::Sweep() {
+    struct Object {
+        ::llvm::sys::TimePoint<> time;
+        std::string path;
+        uint64_t size;
+    };
+    std::vector<Object> objects;
+    dir_bytes_ = 0;
+    std::error_code ec;
+    for (::llvm::sys::fs::directory_iterator it(dir_, ec), end; it != end && !ec; it.increment(ec)) {
+        const std::string& path = it->path();
+        if (::llvm::StringRef(path).endswith(".tmp")) {
+            ::llvm::sys::fs::remove(path);
+            continue;
+        }
+        auto status = it->status();
+        if (!status || !::llvm::StringRef(path).endswith(".o")) {
+            continue;
+        }
+        objects.push_back({status->getLastModificationTime(), path, status->getSize()});
+        dir_bytes_ += status->getSize();
+    }
+    if (max_dir_bytes_ == 0 || dir_bytes_ <= max_dir_bytes_) {
+        return;
+    }
+    // the objects loaded or written latest are kept
+    std::sort(objects.begin(), objects.end(), [](const Object& a, const Object& b) { return a.time < b.time; });
+    for (auto& object : objects) {
+        if (dir_bytes_ <= max_dir_bytes_) {
+            break;
+        }
+        if (!::llvm::sys::fs::remove(object.path)) {
+            DLOG(INFO) << "remove object " << object.path << " as the object cache dir is full";
+            dir_bytes_ -= object.size;
+        }
+    }
+}
+
+std::string HybridSeObjectCache::GetPath(const std::string& key) const { return dir_ + "/" + key + ".o"; }
+
+void HybridSeObjectCache::Persist(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (dir_.empty() || ::llvm::sys::fs::exists(GetPath(key))) {
+        return;
+    }
+    // the object may be compiled before without being persisted
+    auto it = objects_.find(key);
+    if (it != objects_.end()) {
+        Write(key, it->second->getBuffer());
+    } else {
+        persist_keys_.insert(key);
+    }
+}
+
+bool HybridSeObjectCache::Contains(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mu_);
+    return objects_.find(key) != objects_.end() || (!dir_.empty() && ::llvm::sys::fs::exists(GetPath(key)));
+}
+
+void HybridSeObjectCache::Put(const std::string& key, ::llvm::StringRef obj) {
+    if (objects_.find(key) != objects_.end() || obj.size() > kMaxObjectCacheBytes) {
+        return;
+    }
+    while (bytes_ + obj.size() > kMaxObjectCacheBytes && !keys_.empty()) {
+        auto it = objects_.find(keys_.front());
+        bytes_ -= it->second->getBufferSize();
+        objects_.erase(it);
+        keys_.pop_front();
+    }
+    objects_.emplace(key, ::llvm::MemoryBuffer::getMemBufferCopy(obj, key));
+    keys_.push_back(key);
+    bytes_ += obj.size();
+}
+
+void HybridSeObjectCache::notifyObjectCompiled(const ::llvm::Module* m, ::llvm::MemoryBufferRef obj) {
+    const std::string& key = m->getModuleIdentifier();
+    std::lock_guard<std::mutex> lock(mu_);
+    Put(key, obj.getBuffer());
+    if (!dir_.empty() && persist_keys_.erase(key) > 0) {
+        Write(key, obj.getBuffer());
+    }
+}
+
+void HybridSeObjectCache::Write(const std::string& key, ::llvm::StringRef obj) {
+    // write to a temp file first, so a partial object is never loaded
+    std::string path = GetPath(key);
+    std::string tmp_path = path + ".tmp";
+    {
+        std::error_code ec;
+        ::llvm::raw_fd_ostream out(tmp_path, ec, ::llvm::sys::fs::F_None);
+        if (ec) {
+            LOG(WARNING) << "fail to open " << tmp_path << ": " << ec.message();
+            return;
+        }
+        out << obj;
+    }
+    auto ec = ::llvm::sys::fs::rename(tmp_path, path);
+    if (ec) {
+        LOG(WARNING) << "fail to write " << path << ": " << ec.message();
+        return;
+    }
+    dir_bytes_ += obj.size();
+    if (max_dir_bytes_ > 0 && dir_bytes_ > max_dir_bytes_) {
+        Sweep();
+    }
+}
+
+std::unique_ptr<::llvm::MemoryBuffer> HybridSeObjectCache::getObject(const ::llvm::Module* m) {
+    const std::string& key = m->getModuleIdentifier();
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = objects_.find(key);
+    if (it != objects_.end()) {
+        hit_cnt_.fetch_add(1, std::memory_order_relaxed);
+        return ::llvm::MemoryBuffer::getMemBufferCopy(it->second->getBuffer(), key);
+    }
+    if (dir_.empty()) {
+        return nullptr;
+    }
+    auto buf = ::llvm::MemoryBuffer::getFile(GetPath(key));
+    if (!buf) {
+        return nullptr;
+    }
+    DLOG(INFO) << "load object of module " << key << " from " << dir_;
+    hit_cnt_.fetch_add(1, std::memory_order_relaxed);
+    // the modification time is the last time the object is used, so the objects of the deployments alive are not
+    // swept
+    ::utime(GetPath(key).c_str(), nullptr);
+    Put(key, (*buf)->getBuffer());
+    return std::move(*buf);
+}
+
+std::shared_ptr<SharedJit> SharedJit::GetCurrent(bool fast_compile) {
+    static std::mutex mu;
+    static std::shared_ptr<SharedJit> current[2];
+    std::lock_guard<std::mutex> lock(mu);
+    auto& jit = current[fast_compile ? 1 : 0];
+    if (jit == nullptr || jit->GetModuleCnt() >= kMaxSharedJitModules) {
+        auto new_jit = std::make_shared<SharedJit>();
+        if (!new_jit->Init(fast_compile)) {
+            return nullptr;
+        }
+        jit = new_jit;
+    }
+    return jit;
+}
+
+bool SharedJit::Init(bool fast_compile) {
+    auto jtmb = DetectHost(fast_compile);
+    if (!jtmb) {
+        LOG(WARNING) << "fail to detect host: " << ::llvm::toString(jtmb.takeError());
+        return false;
+    }
+    auto cache = HybridSeObjectCache::Get();
+    auto jit = HybridSeJitBuilder()
+                   .setJITTargetMachineBuilder(std::move(*jtmb))
+                   .setCompileFunctionCreator(
+                       [cache](::llvm::orc::JITTargetMachineBuilder jtmb)
+                           -> ::llvm::Expected<::llvm::orc::IRCompileLayer::CompileFunction> {
+                           return ::llvm::orc::ConcurrentIRCompiler(std::move(jtmb), cache);
+                       })
+                   .create();
+    {
+        ::llvm::Error e = jit.takeError();
+        if (e) {
+            LOG(WARNING) << "fail to init shared jit: " << LlvmToString(e);
+            return false;
+        }
+    }
+    jit_ = std::move(jit.get());
+    jit_->Init();
+    mi_ = std::unique_ptr<::llvm::orc::MangleAndInterner>(
+        new ::llvm::orc::MangleAndInterner(jit_->getExecutionSession(), jit_->getDataLayout()));
+    return true;
+}
+
+bool SharedJit::DefineSymbol(const std::string& name, void* addr) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = symbols_.find(name);
+    if (it != symbols_.end()) {
+        return it->second == addr;
+    }
+    if (!HybridSeJit::AddSymbol(jit_->getMainJITDylib(), *mi_, name, addr)) {
+        return false;
+    }
+    symbols_.emplace(name, addr);
+    return true;
+}
+
+::llvm::orc::JITDylib* SharedJit::FindModule(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = modules_.find(key);
+    return it == modules_.end() ? nullptr : it->second;
+}
+
+::llvm::orc::JITDylib* SharedJit::AddModule(const std::string& key,
+                                            const std::map<std::string, void*>& private_symbols,
+                                            ::llvm::orc::ThreadSafeModule tsm) {
+    std::lock_guard<std::mutex> lock(mu_);
+    bool shared = private_symbols.empty();
+    if (shared) {
+        auto it = modules_.find(key);
+        if (it != modules_.end()) {
+            return it->second;
+        }
+    }
+    // the dylib is not added to the search order of main dylib, so the symbols of the modules don't clash, and it
+    // links against main dylib for the builtin and udf symbols
+    auto& jd = jit_->getExecutionSession().createJITDylib(key + "_" + std::to_string(dylib_cnt_++), false);
+    jd.addToSearchOrder(jit_->getMainJITDylib());
+    for (auto& pair : private_symbols) {
+        if (!HybridSeJit::AddSymbol(jd, *mi_, pair.first, pair.second)) {
+            return nullptr;
+        }
+    }
+    ::llvm::Error e = jit_->addIRModule(jd, std::move(tsm));
+    if (e) {
+        LOG(WARNING) << "fail to add ir module: " << LlvmToString(e);
+        return nullptr;
+    }
+    if (shared) {
+        modules_.emplace(key, &jd);
+    }
+    return &jd;
+}
+
+size_t SharedJit::GetModuleCnt() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return dylib_cnt_;
+}
+
+HybridSeSharedJitWrapper::HybridSeSharedJitWrapper(const JitOptions& jit_options)
+    : persist_(jit_options.IsPersistObject()), fast_compile_(jit_options.IsFastCompile()) {
+    if (!jit_options.GetObjectCacheDir().empty()) {
+        HybridSeObjectCache::Get()->SetDir(jit_options.GetObjectCacheDir(),
+                                           jit_options.GetMaxObjectCacheDirBytes());
+    }
+}
+
+bool HybridSeSharedJitWrapper::Init() {
+    shared_ = SharedJit::GetCurrent(fast_compile_);
+    return shared_ != nullptr;
+}
+
+bool HybridSeSharedJitWrapper::OptModule(::llvm::Module* module) {
+    key_ = HashModule(module, fast_compile_);
+    module->setModuleIdentifier(key_);
+    // the object is compiled from the optimized module, the opt passes don't change the symbols of it
+    if (fast_compile_ || shared_->FindModule(key_) != nullptr || HybridSeObjectCache::Get()->Contains(key_)) {
+        DLOG(INFO) << "module " << key_ << " is compiled before, skip opt";
+        return true;
+    }
+    return shared_->jit()->OptModule(module);
+}
+
+bool HybridSeSharedJitWrapper::AddModule(
+    std::unique_ptr<llvm::Module> module,
+    std::unique_ptr<llvm::LLVMContext> llvm_ctx) {
+    if (key_.empty()) {
+        key_ = HashModule(module.get(), fast_compile_);
+        module->setModuleIdentifier(key_);
+    }
+    if (persist_) {
+        HybridSeObjectCache::Get()->Persist(key_);
+    }
+    if (private_symbols_.empty()) {
+        jd_ = shared_->FindModule(key_);
+        if (jd_ != nullptr) {
+            return true;
+        }
+    }
+    jd_ = shared_->AddModule(key_, private_symbols_,
+                             ::llvm::orc::ThreadSafeModule(std::move(module), std::move(llvm_ctx)));
+    return jd_ != nullptr;
+}
+
+bool HybridSeSharedJitWrapper::AddExternalFunction(const std::string& name, void* addr) {
+    if (!shared_->DefineSymbol(name, addr)) {
+        private_symbols_[name] = addr;
+    }
+    return true;
+}
+
+RawPtrHandle HybridSeSharedJitWrapper::FindFunction(const std::string& funcname) {
+    if (funcname == "" || jd_ == nullptr) {
+        return 0;
+    }
+    ::llvm::Expected<::llvm::JITEvaluatedSymbol> symbol(shared_->jit()->lookup(*jd_, funcname));
+    ::llvm::Error e = symbol.takeError();
+    if (e) {
+        LOG(WARNING) << "fail to resolve fn address of" << funcname << ": "
+                     << LlvmToString(e);
+        return 0;
+    }
+    return reinterpret_cast<const int8_t*>(symbol->getAddress());
+}
+
 #ifdef LLVM_EXT_ENABLE
 bool HybridSeMcJitWrapper::Init() { return true; }
 
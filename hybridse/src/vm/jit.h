@@ -17,10 +17,16 @@
 #ifndef HYBRIDSE_SRC_VM_JIT_H_
 #define HYBRIDSE_SRC_VM_JIT_H_
 
+#include <atomic>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
 #include "vm/jit_wrapper.h"
 
@@ -87,7 +93,8 @@ std::string LlvmToString(const T& value) {
 
 class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
  public:
-    HybridSeLlvmJitWrapper() {}
+    HybridSeLlvmJitWrapper() : fast_compile_(false) {}
+    explicit HybridSeLlvmJitWrapper(const JitOptions& jit_options) : fast_compile_(jit_options.IsFastCompile()) {}
     ~HybridSeLlvmJitWrapper() {}
 
     bool Init() override;
@@ -103,10 +110,124 @@ class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
         const std::string& funcname) override;
 
  private:
+    bool fast_compile_;
     std::unique_ptr<HybridSeJit> jit_;
     std::unique_ptr<::llvm::orc::MangleAndInterner> mi_;
 };
 
+// HybridSeObjectCache caches the objects compiled by the shared jit by the module identifier, which is the hash of
+// the module content. The objects are kept in memory up to a limit, and the objects of the modules persisted are
+// written to dir if it's set, so the same modules compiled after the eviction of the engine cache or a restart are
+// loaded instead of compiled again. The objects in dir are kept up to max_dir_bytes if it's not 0, the objects not
+// loaded or written for the longest time are removed once it's exceeded.
+class HybridSeObjectCache : public ::llvm::ObjectCache {
+ public:
+    static HybridSeObjectCache* Get();
+
+    void SetDir(const std::string& dir, uint64_t max_dir_bytes = 0);
+
+    bool Contains(const std::string& key);
+
+    // write the object of the module to dir once it's compiled
+    void Persist(const std::string& key);
+
+    void notifyObjectCompiled(const ::llvm::Module* m, ::llvm::MemoryBufferRef obj) override;
+
+    std::unique_ptr<::llvm::MemoryBuffer> getObject(const ::llvm::Module* m) override;
+
+    uint64_t GetHitCnt() const { return hit_cnt_.load(std::memory_order_relaxed); }
+
+ private:
+    HybridSeObjectCache() {}
+
+    std::string GetPath(const std::string& key) const;
+
+    void Put(const std::string& key, ::llvm::StringRef obj);
+
+    void Write(const std::string& key, ::llvm::StringRef obj);
+
+    // remove the temp files left by a crash and the least recently used objects over max_dir_bytes_
+    void Sweep();
+
+ private:
+    std::mutex mu_;
+    std::string dir_;
+    std::unordered_map<std::string, std::unique_ptr<::llvm::MemoryBuffer>> objects_;
+    // the objects are evicted in the order they are put
+    std::deque<std::string> keys_;
+    std::unordered_set<std::string> persist_keys_;
+    uint64_t bytes_ = 0;
+    uint64_t max_dir_bytes_ = 0;
+    uint64_t dir_bytes_ = 0;
+    std::atomic<uint64_t> hit_cnt_{0};
+};
+
+// SharedJit is a llvm jit shared by the compilations. The builtin and udf symbols are defined once in its main dylib,
+// and every module is added to its own dylib, which is shared by the compilations of the same module content.
+// The dylibs can't be removed from a jit, so a new jit is created once the current one holds too many modules, and
+// the old one is freed with the last compilation holding it.
+class SharedJit {
+ public:
+    // the current jit compiling with or without optimization
+    static std::shared_ptr<SharedJit> GetCurrent(bool fast_compile);
+
+    SharedJit() {}
+    SharedJit(const SharedJit&) = delete;
+
+    bool Init(bool fast_compile);
+
+    HybridSeJit* jit() { return jit_.get(); }
+
+    // define the symbol in main dylib, it fails if the name is defined with another address, e.g. a dynamic udf is
+    // registered again
+    bool DefineSymbol(const std::string& name, void* addr);
+
+    ::llvm::orc::JITDylib* FindModule(const std::string& key);
+
+    // add the module to a new dylib with the private symbols, the dylib is shared by key if there are no private
+    // symbols, the existing one is returned if the module is added by another compilation
+    ::llvm::orc::JITDylib* AddModule(const std::string& key, const std::map<std::string, void*>& private_symbols,
+                                     ::llvm::orc::ThreadSafeModule tsm);
+
+    size_t GetModuleCnt();
+
+ private:
+    std::unique_ptr<HybridSeJit> jit_;
+    std::unique_ptr<::llvm::orc::MangleAndInterner> mi_;
+    std::mutex mu_;
+    std::unordered_map<std::string, void*> symbols_;
+    std::unordered_map<std::string, ::llvm::orc::JITDylib*> modules_;
+    uint64_t dylib_cnt_ = 0;
+};
+
+class HybridSeSharedJitWrapper : public HybridSeJitWrapper {
+ public:
+    explicit HybridSeSharedJitWrapper(const JitOptions& jit_options);
+    ~HybridSeSharedJitWrapper() {}
+
+    bool Init() override;
+
+    // the module is named by the hash of its content, the opt passes are skipped if it's compiled before
+    bool OptModule(::llvm::Module* module) override;
+
+    bool AddModule(std::unique_ptr<llvm::Module> module,
+                   std::unique_ptr<llvm::LLVMContext> llvm_ctx) override;
+
+    bool AddExternalFunction(const std::string& name, void* addr) override;
+
+    hybridse::vm::RawPtrHandle FindFunction(
+        const std::string& funcname) override;
+
+ private:
+    std::shared_ptr<SharedJit> shared_;
+    bool persist_;
+    bool fast_compile_;
+    std::string key_;
+    // the symbols conflicted with main dylib, defined in the dylib of the module
+    std::map<std::string, void*> private_symbols_;
+    ::llvm::orc::JITDylib* jd_ = nullptr;
+};
+
 #ifdef LLVM_EXT_ENABLE
 class HybridSeMcJitWrapper : public HybridSeJitWrapper {
  public:
@@ -39,6 +39,7 @@
 #include "udf/default_udf_library.h"
 #include "udf/udf.h"
 #include "vm/jit.h"
+#include "vm/window_agg_batch.h"
 
 namespace hybridse {
 namespace vm {
@@ -83,7 +84,10 @@ HybridSeJitWrapper* HybridSeJitWrapper::Create(const JitOptions& jit_options) {
             jit_options.IsEnableGdb()) {
             LOG(WARNING) << "LLJIT do not support jit events";
         }
-        return new HybridSeLlvmJitWrapper();
+        if (jit_options.IsEnableSharedJit()) {
+            return new HybridSeSharedJitWrapper(jit_options);
+        }
+        return new HybridSeLlvmJitWrapper(jit_options);
     }
 }
 
@@ -197,6 +201,38 @@ void InitBuiltinJitSymbols(HybridSeJitWrapper* jit) {
     jit->AddExternalFunction(
         "hybridse_storage_row_iter_delete",
         reinterpret_cast<void*>(&hybridse::vm::RowIterDelete));
+    // window agg batch
+    jit->AddExternalFunction(
+        "hybridse_window_agg_batch_new",
+        reinterpret_cast<void*>(&hybridse::vm::NewWindowAggBatch));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_batch_fetch",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggBatchFetch));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_batch_get_values",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggBatchGetValues));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_batch_get_nulls",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggBatchGetNulls));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_batch_delete",
+        reinterpret_cast<void*>(&hybridse::vm::DeleteWindowAggBatch));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_update_int16",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggUpdate<int16_t>));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_update_int32",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggUpdate<int32_t>));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_update_int64",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggUpdate<int64_t>));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_update_float",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggUpdate<float>));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_update_double",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggUpdate<double>));
+
     jit->AddExternalFunction(
         "hybridse_storage_get_row_slice",
         reinterpret_cast<void*>(&hybridse::vm::RowGetSlice));
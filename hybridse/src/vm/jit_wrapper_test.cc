@@ -15,10 +15,21 @@
  */
 
 #include "vm/jit_wrapper.h"
+#include <unistd.h>
+#include <utime.h>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "codec/fe_row_codec.h"
 #include "gtest/gtest.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "udf/default_udf_library.h"
 #include "udf/udf.h"
+#include "udf/udf_registry.h"
 #include "vm/engine.h"
+#include "vm/jit.h"
 #include "vm/simple_catalog.h"
 #include "vm/sql_compiler.h"
 
@@ -162,6 +173,217 @@ TEST_F(JitWrapperTest, test_window) {
     delete jit;
 }
 
+TEST_F(JitWrapperTest, test_shared_jit) {
+    EngineOptions options;
+    options.jit_options().SetEnableSharedJit(true);
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, col_2 + 1 from t1;";
+    // the engines don't share the compile cache, but the second compilation reuses the module of the first one
+    auto compile_info1 = Compile(sql, options, catalog);
+    ASSERT_TRUE(compile_info1 != nullptr);
+    auto compile_info2 = Compile(sql, options, catalog);
+    ASSERT_TRUE(compile_info2 != nullptr);
+    auto &ctx1 = compile_info1->get_sql_context();
+    auto &ctx2 = compile_info2->get_sql_context();
+    ASSERT_NE(ctx1.jit, ctx2.jit);
+    auto fn_name = ctx1.physical_plan->GetFnInfos()[0]->fn_name();
+    auto fn = ctx1.jit->FindFunction(fn_name);
+    ASSERT_TRUE(fn != nullptr);
+    ASSERT_EQ(fn, ctx2.jit->FindFunction(ctx2.physical_plan->GetFnInfos()[0]->fn_name()));
+
+    // the module of another sql is compiled into its own dylib
+    auto compile_info3 = Compile("select col_1, col_2 + 2 from t1;", options, catalog);
+    ASSERT_TRUE(compile_info3 != nullptr);
+    auto &ctx3 = compile_info3->get_sql_context();
+    auto fn3 = ctx3.jit->FindFunction(ctx3.physical_plan->GetFnInfos()[0]->fn_name());
+    ASSERT_TRUE(fn3 != nullptr);
+    ASSERT_NE(fn, fn3);
+
+    int8_t buf[1024];
+    auto schema = catalog->GetTable("db", "t1")->GetSchema();
+    codec::RowBuilder row_builder(*schema);
+    row_builder.SetBuffer(buf, 1024);
+    row_builder.AppendDouble(3.14);
+    row_builder.AppendInt64(42);
+    hybridse::codec::Row empty_parameter;
+    hybridse::codec::Row row(base::RefCountedSlice::Create(buf, 1024));
+    compile_info1.reset();
+    hybridse::codec::Row output = CoreAPI::RowProject(fn, row, empty_parameter);
+    codec::RowView row_view(*schema, output.buf(), output.size());
+    int64_t c2;
+    ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
+    ASSERT_EQ(c2, 43);
+    output = CoreAPI::RowProject(fn3, row, empty_parameter);
+    row_view.Reset(output.buf(), output.size());
+    ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
+    ASSERT_EQ(c2, 44);
+}
+
+TEST_F(JitWrapperTest, test_shared_jit_session_option) {
+    // the shared jit is not enabled by the engine options, only the sessions with the option share it
+    EngineOptions options;
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, col_2 + 6 from t1;";
+    auto session_options = std::make_shared<std::unordered_map<std::string, std::string>>();
+    session_options->emplace(SHARED_JIT, "true");
+    auto compile = [&](bool shared) -> std::shared_ptr<SqlCompileInfo> {
+        base::Status status;
+        BatchRunSession session;
+        if (shared) {
+            session.SetOptions(session_options);
+        }
+        Engine engine(catalog, options);
+        if (!engine.Get(sql, "db", session, status)) {
+            LOG(WARNING) << "Fail to compile sql. error " << status.msg;
+            return nullptr;
+        }
+        return std::dynamic_pointer_cast<SqlCompileInfo>(session.GetCompileInfo());
+    };
+    auto find_fn = [](const std::shared_ptr<SqlCompileInfo> &info) {
+        auto &ctx = info->get_sql_context();
+        return ctx.jit->FindFunction(ctx.physical_plan->GetFnInfos()[0]->fn_name());
+    };
+    auto compile_info1 = compile(true);
+    ASSERT_TRUE(compile_info1 != nullptr);
+    auto compile_info2 = compile(true);
+    ASSERT_TRUE(compile_info2 != nullptr);
+    auto compile_info3 = compile(false);
+    ASSERT_TRUE(compile_info3 != nullptr);
+    auto fn = find_fn(compile_info1);
+    ASSERT_TRUE(fn != nullptr);
+    ASSERT_EQ(fn, find_fn(compile_info2));
+    ASSERT_NE(fn, find_fn(compile_info3));
+}
+
+static int64_t inc_int64_for_test(int64_t x) { return x + 1; }
+
+TEST_F(JitWrapperTest, test_shared_jit_run_sql) {
+    // the module calls a builtin function, an udf and the window aggregation, which are all defined in main dylib
+    udf::DefaultUdfLibrary::get()->RegisterExternal("shared_jit_inc").args<int64_t>(
+        static_cast<int64_t (*)(int64_t)>(inc_int64_for_test));
+    hybridse::type::Database db;
+    db.set_name("db");
+    ::hybridse::type::TableDef *table = db.add_tables();
+    table->set_name("t2");
+    table->set_catalog("db");
+    {
+        ::hybridse::type::ColumnDef *column = table->add_columns();
+        column->set_type(::hybridse::type::kVarchar);
+        column->set_name("c1");
+    }
+    {
+        ::hybridse::type::ColumnDef *column = table->add_columns();
+        column->set_type(::hybridse::type::kInt64);
+        column->set_name("c2");
+    }
+    {
+        ::hybridse::type::ColumnDef *column = table->add_columns();
+        column->set_type(::hybridse::type::kInt64);
+        column->set_name("c3");
+    }
+    auto catalog = std::make_shared<SimpleCatalog>();
+    catalog->AddDatabase(db);
+    std::vector<codec::Row> rows;
+    codec::RowBuilder builder(table->columns());
+    std::string key = "key";
+    for (int64_t i = 0; i < 5; i++) {
+        uint32_t size = builder.CalTotalLength(key.size());
+        int8_t *buf = static_cast<int8_t *>(malloc(size));
+        builder.SetBuffer(buf, size);
+        builder.AppendString(key.data(), key.size());
+        builder.AppendInt64(i);
+        builder.AppendInt64(1000 + i);
+        rows.push_back(codec::Row(base::RefCountedSlice::CreateManaged(buf, size)));
+    }
+    ASSERT_TRUE(catalog->InsertRows("db", "t2", rows));
+
+    EngineOptions options;
+    options.jit_options().SetEnableSharedJit(true);
+    Engine engine(catalog, options);
+    std::string sql =
+        "select substring(c1, 1, 2) as s, shared_jit_inc(c2) as inc, sum(c2) over w as w_sum from t2 "
+        "window w as (partition by c1 order by c3 rows between 2 preceding and current row);";
+    base::Status status;
+    BatchRunSession session;
+    ASSERT_TRUE(engine.Get(sql, "db", session, status)) << status.msg;
+    std::vector<codec::Row> outputs;
+    ASSERT_EQ(0, session.Run(outputs));
+    ASSERT_EQ(5u, outputs.size());
+    codec::RowView row_view(session.GetSchema());
+    for (auto &output : outputs) {
+        row_view.Reset(output.buf(), output.size());
+        ASSERT_EQ("ke", row_view.GetStringUnsafe(0));
+        int64_t inc = row_view.GetInt64Unsafe(1);
+        int64_t i = inc - 1;
+        ASSERT_TRUE(i >= 0 && i < 5);
+        int64_t expect_sum = i + (i >= 1 ? i - 1 : 0) + (i >= 2 ? i - 2 : 0);
+        ASSERT_EQ(expect_sum, row_view.GetInt64Unsafe(2));
+    }
+}
+
+static size_t CountObjects(const std::string &dir) {
+    size_t cnt = 0;
+    std::error_code ec;
+    for (::llvm::sys::fs::directory_iterator it(dir, ec), end; it != end && !ec; it.increment(ec)) {
+        cnt++;
+    }
+    return cnt;
+}
+
+TEST_F(JitWrapperTest, test_persist_object) {
+    std::string dir = "/tmp/hybridse_jit_cache_" + std::to_string(::getpid());
+    EngineOptions options;
+    options.jit_options().SetEnableSharedJit(true);
+    options.jit_options().SetObjectCacheDir(dir);
+    auto catalog = GetTestCatalog();
+    // the objects are not written unless they are persisted
+    ASSERT_TRUE(Compile("select col_1, col_2 + 3 from t1;", options, catalog) != nullptr);
+    ASSERT_EQ(0u, CountObjects(dir));
+    options.jit_options().SetPersistObject(true);
+    ASSERT_TRUE(Compile("select col_1, col_2 + 4 from t1;", options, catalog) != nullptr);
+    ASSERT_EQ(1u, CountObjects(dir));
+    // the object compiled before is written once it's persisted
+    ASSERT_TRUE(Compile("select col_1, col_2 + 3 from t1;", options, catalog) != nullptr);
+    ASSERT_EQ(2u, CountObjects(dir));
+    ::llvm::sys::fs::remove_directories(dir);
+}
+
+static void WriteObject(const std::string &path, size_t size, time_t mtime) {
+    std::error_code ec;
+    {
+        ::llvm::raw_fd_ostream out(path, ec, ::llvm::sys::fs::F_None);
+        ASSERT_FALSE(ec);
+        out << std::string(size, 'o');
+    }
+    struct utimbuf times = {mtime, mtime};
+    ASSERT_EQ(0, ::utime(path.c_str(), &times));
+}
+
+TEST_F(JitWrapperTest, test_sweep_object_cache_dir) {
+    std::string dir = "/tmp/hybridse_jit_sweep_" + std::to_string(::getpid());
+    ASSERT_FALSE(::llvm::sys::fs::create_directories(dir));
+    time_t now = ::time(nullptr);
+    WriteObject(dir + "/sql_a.o", 100, now - 300);
+    WriteObject(dir + "/sql_b.o", 100, now - 200);
+    WriteObject(dir + "/sql_c.o", 100, now - 100);
+    WriteObject(dir + "/sql_d.o.tmp", 10, now);
+    // the least recently used object and the temp file are removed
+    HybridSeObjectCache::Get()->SetDir(dir, 250);
+    ASSERT_EQ(2u, CountObjects(dir));
+    ASSERT_FALSE(::llvm::sys::fs::exists(dir + "/sql_a.o"));
+    ASSERT_TRUE(::llvm::sys::fs::exists(dir + "/sql_b.o"));
+    ASSERT_TRUE(::llvm::sys::fs::exists(dir + "/sql_c.o"));
+    // the objects written later are kept up to the limit as well
+    EngineOptions options;
+    options.jit_options().SetEnableSharedJit(true);
+    options.jit_options().SetObjectCacheDir(dir);
+    options.jit_options().SetMaxObjectCacheDirBytes(250);
+    options.jit_options().SetPersistObject(true);
+    ASSERT_TRUE(Compile("select col_1, col_2 + 5 from t1;", options, GetTestCatalog()) != nullptr);
+    ASSERT_FALSE(::llvm::sys::fs::exists(dir + "/sql_b.o"));
+    ::llvm::sys::fs::remove_directories(dir);
+}
+
 }  // namespace vm
 }  // namespace hybridse
 
@@ -129,6 +129,7 @@ bool SqlCompiler::Compile(SqlContext& ctx, Status& status) {  // NOLINT
         LOG(WARNING) << "fail to opt ir module for sql " << ctx.sql;
         return false;
     }
+    ctx.instruction_cnt = m->getInstructionCount();
     if (keep_ir_) {
         KeepIR(ctx, m.get());
     }
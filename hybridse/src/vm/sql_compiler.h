@@ -66,6 +66,8 @@ struct SqlContext {
     uint32_t row_size;
     uint32_t limit_cnt = 0;
     std::string ir;
+    // the instructions of the module optimized, to estimate the size of the native code
+    uint64_t instruction_cnt = 0;
     std::string logical_plan_str;
     std::string physical_plan_str;
     std::string encoded_schema;
@@ -138,6 +140,13 @@ class SqlCompileInfo : public CompileInfo {
     virtual void DumpClusterJob(std::ostream& output, const std::string& tab) {
         sql_ctx.cluster_job.Print(output, tab);
     }
+    size_t GetByteSize() {
+        // a rough estimation by the average bytes of a plan node or runner and of a native instruction
+        return sizeof(SqlCompileInfo) + sql_ctx.sql.size() + sql_ctx.ir.size() + sql_ctx.logical_plan_str.size() +
+               sql_ctx.physical_plan_str.size() + sql_ctx.encoded_schema.size() +
+               sql_ctx.encoded_request_schema.size() + sql_ctx.nm.GetNodeListSize() * 256 +
+               sql_ctx.instruction_cnt * 16;
+    }
     static SqlCompileInfo* CastFrom(CompileInfo* node) {
         return dynamic_cast<SqlCompileInfo*>(node);
     }
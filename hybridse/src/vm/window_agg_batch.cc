@@ -0,0 +1,389 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/window_agg_batch.h"
+
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "codec/list_iterator_codec.h"
+#include "codec/type_codec.h"
+#include "glog/logging.h"
+#include "node/node_enum.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HYBRIDSE_WINDOW_AGG_AVX2
+#include <immintrin.h>
+#endif
+
+namespace hybridse {
+namespace vm {
+
+WindowAggBatch::WindowAggBatch(std::unique_ptr<codec::RowIterator> iter, const int32_t* specs, int32_t col_num)
+    : iter_(std::move(iter)), specs_(specs, specs + col_num * 4), col_num_(col_num) {
+    Buffer& free_buffer = GetFreeBuffer();
+    if (free_buffer.col_num >= col_num) {
+        buffer_ = std::move(free_buffer);
+        free_buffer.col_num = 0;
+    } else {
+        buffer_.col_num = col_num;
+        buffer_.values.reset(new int64_t[col_num * kBatchSize]);
+        buffer_.nulls.reset(new int8_t[col_num * kBatchSize]);
+    }
+    if (iter_) {
+        iter_->SeekToFirst();
+    }
+}
+
+WindowAggBatch::~WindowAggBatch() {
+    // the larger buffer is kept, the batches of a thread are nested rarely
+    Buffer& free_buffer = GetFreeBuffer();
+    if (buffer_.col_num > free_buffer.col_num) {
+        free_buffer = std::move(buffer_);
+    }
+}
+
+WindowAggBatch::Buffer& WindowAggBatch::GetFreeBuffer() {
+    thread_local Buffer buffer;
+    return buffer;
+}
+
+int32_t WindowAggBatch::Fetch() {
+    if (!iter_) {
+        return 0;
+    }
+    int32_t n = 0;
+    while (n < kBatchSize && iter_->Valid()) {
+        const codec::Row& row = iter_->GetValue();
+        for (int32_t i = 0; i < col_num_; i++) {
+            const int32_t* spec = &specs_[i * 4];
+            const int8_t* buf = row.buf(spec[0]);
+            uint32_t idx = spec[2];
+            uint32_t offset = spec[3];
+            int8_t* is_null = GetNulls(i) + n;
+            int8_t* values = GetValues(i);
+            switch (spec[1]) {
+                case node::kInt16:
+                    reinterpret_cast<int16_t*>(values)[n] = codec::v1::GetInt16Field(buf, idx, offset, is_null);
+                    break;
+                case node::kInt32:
+                    reinterpret_cast<int32_t*>(values)[n] = codec::v1::GetInt32Field(buf, idx, offset, is_null);
+                    break;
+                case node::kInt64:
+                    reinterpret_cast<int64_t*>(values)[n] = codec::v1::GetInt64Field(buf, idx, offset, is_null);
+                    break;
+                case node::kFloat:
+                    reinterpret_cast<float*>(values)[n] = codec::v1::GetFloatField(buf, idx, offset, is_null);
+                    break;
+                case node::kDouble:
+                    reinterpret_cast<double*>(values)[n] = codec::v1::GetDoubleField(buf, idx, offset, is_null);
+                    break;
+                default:
+                    LOG(WARNING) << "unsupported type of window agg batch: " << spec[1];
+                    reinterpret_cast<int64_t*>(values)[n] = 0;
+                    *is_null = true;
+                    break;
+            }
+        }
+        iter_->Next();
+        n++;
+    }
+    return n;
+}
+
+int8_t* NewWindowAggBatch(int8_t* input, const int32_t* specs, int32_t col_num) {
+    auto list_ref = reinterpret_cast<codec::ListRef<codec::Row>*>(input);
+    auto handler = reinterpret_cast<codec::ListV<codec::Row>*>(list_ref->list);
+    return reinterpret_cast<int8_t*>(new WindowAggBatch(handler->GetIterator(), specs, col_num));
+}
+
+int32_t WindowAggBatchFetch(int8_t* batch) { return reinterpret_cast<WindowAggBatch*>(batch)->Fetch(); }
+
+int8_t* WindowAggBatchGetValues(int8_t* batch, int32_t idx) {
+    return reinterpret_cast<WindowAggBatch*>(batch)->GetValues(idx);
+}
+
+int8_t* WindowAggBatchGetNulls(int8_t* batch, int32_t idx) {
+    return reinterpret_cast<WindowAggBatch*>(batch)->GetNulls(idx);
+}
+
+void DeleteWindowAggBatch(int8_t* batch) { delete reinterpret_cast<WindowAggBatch*>(batch); }
+
+namespace {
+
+// integers wrap around on overflow as the row-wise add does, and the null values are 0
+template <typename T>
+T SumInt(const T* values, int32_t n, T sum) {
+    using U = typename std::make_unsigned<T>::type;
+    U res = static_cast<U>(sum);
+    for (int32_t i = 0; i < n; i++) {
+        res += static_cast<U>(values[i]);
+    }
+    return static_cast<T>(res);
+}
+
+template <typename T>
+T SumFloat(const T* values, const int8_t* nulls, int32_t n, T sum) {
+    for (int32_t i = 0; i < n; i++) {
+        if (!nulls[i]) {
+            sum += values[i];
+        }
+    }
+    return sum;
+}
+
+// the comparisons are the same as the row-wise ones, which matters for nan
+template <typename T>
+T MinScalar(const T* values, const int8_t* nulls, int32_t n, T min) {
+    for (int32_t i = 0; i < n; i++) {
+        if (!nulls[i]) {
+            min = min < values[i] ? min : values[i];
+        }
+    }
+    return min;
+}
+
+template <typename T>
+T MaxScalar(const T* values, const int8_t* nulls, int32_t n, T max) {
+    for (int32_t i = 0; i < n; i++) {
+        if (!nulls[i]) {
+            max = max < values[i] ? values[i] : max;
+        }
+    }
+    return max;
+}
+
+#ifdef HYBRIDSE_WINDOW_AGG_AVX2
+bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+__attribute__((target("avx2"))) int32_t SumInt32Avx2(const int32_t* values, int32_t n, int32_t sum) {
+    __m256i acc = _mm256_setzero_si256();
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_add_epi32(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)));
+    }
+    alignas(32) int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    sum = SumInt(lanes, 8, sum);
+    return SumInt(values + i, n - i, sum);
+}
+
+__attribute__((target("avx2"))) int64_t SumInt64Avx2(const int64_t* values, int32_t n, int64_t sum) {
+    __m256i acc = _mm256_setzero_si256();
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_epi64(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)));
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    sum = SumInt(lanes, 4, sum);
+    return SumInt(values + i, n - i, sum);
+}
+
+// the lanes of null values are replaced by the identity of min or max
+__attribute__((target("avx2"))) __m256i LoadInt32(const int32_t* values, const int8_t* nulls, __m256i identity) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values));
+    __m256i is_null = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(nulls)));
+    return _mm256_blendv_epi8(v, identity, _mm256_cmpgt_epi32(is_null, _mm256_setzero_si256()));
+}
+
+__attribute__((target("avx2"))) __m256i LoadInt64(const int64_t* values, const int8_t* nulls, __m256i identity) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values));
+    int32_t bits;
+    memcpy(&bits, nulls, sizeof(bits));
+    __m256i is_null = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(bits));
+    return _mm256_blendv_epi8(v, identity, _mm256_cmpgt_epi64(is_null, _mm256_setzero_si256()));
+}
+
+__attribute__((target("avx2"))) int32_t MinInt32Avx2(const int32_t* values, const int8_t* nulls, int32_t n,
+                                                     int32_t min) {
+    __m256i identity = _mm256_set1_epi32(std::numeric_limits<int32_t>::max());
+    __m256i acc = identity;
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_min_epi32(acc, LoadInt32(values + i, nulls + i, identity));
+    }
+    alignas(32) int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    int8_t lane_nulls[8] = {0};
+    min = MinScalar(lanes, lane_nulls, 8, min);
+    return MinScalar(values + i, nulls + i, n - i, min);
+}
+
+__attribute__((target("avx2"))) int32_t MaxInt32Avx2(const int32_t* values, const int8_t* nulls, int32_t n,
+                                                     int32_t max) {
+    __m256i identity = _mm256_set1_epi32(std::numeric_limits<int32_t>::lowest());
+    __m256i acc = identity;
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_max_epi32(acc, LoadInt32(values + i, nulls + i, identity));
+    }
+    alignas(32) int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    int8_t lane_nulls[8] = {0};
+    max = MaxScalar(lanes, lane_nulls, 8, max);
+    return MaxScalar(values + i, nulls + i, n - i, max);
+}
+
+__attribute__((target("avx2"))) int64_t MinInt64Avx2(const int64_t* values, const int8_t* nulls, int32_t n,
+                                                     int64_t min) {
+    __m256i identity = _mm256_set1_epi64x(std::numeric_limits<int64_t>::max());
+    __m256i acc = identity;
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = LoadInt64(values + i, nulls + i, identity);
+        acc = _mm256_blendv_epi8(acc, v, _mm256_cmpgt_epi64(acc, v));
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    int8_t lane_nulls[4] = {0};
+    min = MinScalar(lanes, lane_nulls, 4, min);
+    return MinScalar(values + i, nulls + i, n - i, min);
+}
+
+__attribute__((target("avx2"))) int64_t MaxInt64Avx2(const int64_t* values, const int8_t* nulls, int32_t n,
+                                                     int64_t max) {
+    __m256i identity = _mm256_set1_epi64x(std::numeric_limits<int64_t>::lowest());
+    __m256i acc = identity;
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = LoadInt64(values + i, nulls + i, identity);
+        acc = _mm256_blendv_epi8(acc, v, _mm256_cmpgt_epi64(v, acc));
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    int8_t lane_nulls[4] = {0};
+    max = MaxScalar(lanes, lane_nulls, 4, max);
+    return MaxScalar(values + i, nulls + i, n - i, max);
+}
+#endif
+
+int16_t Sum(const int16_t* values, const int8_t* nulls, int32_t n, int16_t sum) { return SumInt(values, n, sum); }
+
+int32_t Sum(const int32_t* values, const int8_t* nulls, int32_t n, int32_t sum) {
+#ifdef HYBRIDSE_WINDOW_AGG_AVX2
+    if (HasAvx2()) {
+        return SumInt32Avx2(values, n, sum);
+    }
+#endif
+    return SumInt(values, n, sum);
+}
+
+int64_t Sum(const int64_t* values, const int8_t* nulls, int32_t n, int64_t sum) {
+#ifdef HYBRIDSE_WINDOW_AGG_AVX2
+    if (HasAvx2()) {
+        return SumInt64Avx2(values, n, sum);
+    }
+#endif
+    return SumInt(values, n, sum);
+}
+
+float Sum(const float* values, const int8_t* nulls, int32_t n, float sum) {
+    return SumFloat(values, nulls, n, sum);
+}
+
+double Sum(const double* values, const int8_t* nulls, int32_t n, double sum) {
+    return SumFloat(values, nulls, n, sum);
+}
+
+template <typename T>
+T Min(const T* values, const int8_t* nulls, int32_t n, T min) {
+    return MinScalar(values, nulls, n, min);
+}
+
+template <typename T>
+T Max(const T* values, const int8_t* nulls, int32_t n, T max) {
+    return MaxScalar(values, nulls, n, max);
+}
+
+#ifdef HYBRIDSE_WINDOW_AGG_AVX2
+template <>
+int32_t Min(const int32_t* values, const int8_t* nulls, int32_t n, int32_t min) {
+    return HasAvx2() ? MinInt32Avx2(values, nulls, n, min) : MinScalar(values, nulls, n, min);
+}
+
+template <>
+int32_t Max(const int32_t* values, const int8_t* nulls, int32_t n, int32_t max) {
+    return HasAvx2() ? MaxInt32Avx2(values, nulls, n, max) : MaxScalar(values, nulls, n, max);
+}
+
+template <>
+int64_t Min(const int64_t* values, const int8_t* nulls, int32_t n, int64_t min) {
+    return HasAvx2() ? MinInt64Avx2(values, nulls, n, min) : MinScalar(values, nulls, n, min);
+}
+
+template <>
+int64_t Max(const int64_t* values, const int8_t* nulls, int32_t n, int64_t max) {
+    return HasAvx2() ? MaxInt64Avx2(values, nulls, n, max) : MaxScalar(values, nulls, n, max);
+}
+#endif
+
+int64_t CountNonNull(const int8_t* nulls, int32_t n) {
+    int64_t null_cnt = 0;
+    for (int32_t i = 0; i < n; i++) {
+        null_cnt += nulls[i] != 0;
+    }
+    return n - null_cnt;
+}
+
+}  // namespace
+
+template <typename T>
+void WindowAggUpdate(const T* values, const int8_t* nulls, int32_t n, T* sum, double* avg_sum, int64_t* cnt, T* min,
+                     T* max) {
+    if (n <= 0) {
+        return;
+    }
+    if (sum != nullptr) {
+        *sum = Sum(values, nulls, n, *sum);
+    }
+    if (avg_sum != nullptr) {
+        double res = *avg_sum;
+        for (int32_t i = 0; i < n; i++) {
+            if (!nulls[i]) {
+                res += static_cast<double>(values[i]);
+            }
+        }
+        *avg_sum = res;
+    }
+    if (cnt != nullptr) {
+        *cnt += CountNonNull(nulls, n);
+    }
+    if (min != nullptr) {
+        *min = Min(values, nulls, n, *min);
+    }
+    if (max != nullptr) {
+        *max = Max(values, nulls, n, *max);
+    }
+}
+
+template void WindowAggUpdate<int16_t>(const int16_t*, const int8_t*, int32_t, int16_t*, double*, int64_t*, int16_t*,
+                                       int16_t*);
+template void WindowAggUpdate<int32_t>(const int32_t*, const int8_t*, int32_t, int32_t*, double*, int64_t*, int32_t*,
+                                       int32_t*);
+template void WindowAggUpdate<int64_t>(const int64_t*, const int8_t*, int32_t, int64_t*, double*, int64_t*, int64_t*,
+                                       int64_t*);
+template void WindowAggUpdate<float>(const float*, const int8_t*, int32_t, float*, double*, int64_t*, float*, float*);
+template void WindowAggUpdate<double>(const double*, const int8_t*, int32_t, double*, double*, int64_t*, double*,
+                                      double*);
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HYBRIDSE_SRC_VM_WINDOW_AGG_BATCH_H_
+#define HYBRIDSE_SRC_VM_WINDOW_AGG_BATCH_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "codec/row_iterator.h"
+
+namespace hybridse {
+namespace vm {
+
+// WindowAggBatch decodes the aggregated columns of a window into columnar buffers batch by batch, so the
+// aggregations of the window run over contiguous values instead of calling into the iterator row by row.
+// Each column is described by four int32 in specs: slice index, node::DataType, index in the null bitmap and
+// offset in the row. The value of a null field is decoded as 0.
+// A batch is created for every row of the window aggregation, so the buffers are kept by the thread once the batch
+// is deleted and reused by the next batch.
+class WindowAggBatch {
+ public:
+    static constexpr int32_t kBatchSize = 256;
+
+    WindowAggBatch(std::unique_ptr<codec::RowIterator> iter, const int32_t* specs, int32_t col_num);
+    ~WindowAggBatch();
+
+    // decode the next kBatchSize rows at most, returns the count of rows decoded
+    int32_t Fetch();
+
+    int8_t* GetValues(int32_t idx) { return reinterpret_cast<int8_t*>(buffer_.values.get() + idx * kBatchSize); }
+
+    int8_t* GetNulls(int32_t idx) { return buffer_.nulls.get() + idx * kBatchSize; }
+
+ private:
+    struct Buffer {
+        // the count of columns the buffer holds
+        int32_t col_num = 0;
+        // every value takes 8 bytes at most
+        std::unique_ptr<int64_t[]> values;
+        std::unique_ptr<int8_t[]> nulls;
+    };
+
+    // the buffer kept by the current thread
+    static Buffer& GetFreeBuffer();
+
+ private:
+    std::unique_ptr<codec::RowIterator> iter_;
+    std::vector<int32_t> specs_;
+    int32_t col_num_;
+    Buffer buffer_;
+};
+
+// window agg batch interfaces for llvm, input is the ListRef of window
+int8_t* NewWindowAggBatch(int8_t* input, const int32_t* specs, int32_t col_num);
+int32_t WindowAggBatchFetch(int8_t* batch);
+int8_t* WindowAggBatchGetValues(int8_t* batch, int32_t idx);
+int8_t* WindowAggBatchGetNulls(int8_t* batch, int32_t idx);
+void DeleteWindowAggBatch(int8_t* batch);
+
+// update the aggregation states of a column with n decoded values, the states which are null are skipped.
+// the results are the same as the row-wise aggregations, so the floating point ones are accumulated in order and
+// only the integer ones are vectorized by avx2 if the cpu supports it.
+// cnt is the count of non-null values, avg_sum is the sum in double for avg of non-double columns.
+template <typename T>
+void WindowAggUpdate(const T* values, const int8_t* nulls, int32_t n, T* sum, double* avg_sum, int64_t* cnt, T* min,
+                     T* max);
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_VM_WINDOW_AGG_BATCH_H_
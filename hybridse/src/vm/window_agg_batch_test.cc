@@ -0,0 +1,121 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/window_agg_batch.h"
+
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+
+class WindowAggBatchTest : public ::testing::Test {};
+
+// update the states in two calls and check them with the row-wise results
+template <typename T>
+void CheckWindowAggUpdate(std::mt19937_64* rng, int32_t n) {
+    std::vector<T> values(n);
+    std::vector<int8_t> nulls(n);
+    for (int32_t i = 0; i < n; i++) {
+        nulls[i] = (*rng)() % 5 == 0;
+        values[i] = nulls[i] ? 0 : static_cast<T>(static_cast<int64_t>((*rng)()));
+    }
+    using U = typename std::make_unsigned<T>::type;
+    U expect_sum = 0;
+    double expect_avg_sum = 0;
+    int64_t expect_cnt = 0;
+    T expect_min = std::numeric_limits<T>::max();
+    T expect_max = std::numeric_limits<T>::lowest();
+    for (int32_t i = 0; i < n; i++) {
+        if (!nulls[i]) {
+            expect_sum += static_cast<U>(values[i]);
+            expect_avg_sum += static_cast<double>(values[i]);
+            expect_cnt++;
+            expect_min = expect_min < values[i] ? expect_min : values[i];
+            expect_max = expect_max < values[i] ? values[i] : expect_max;
+        }
+    }
+
+    T sum = 0;
+    double avg_sum = 0;
+    int64_t cnt = 0;
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+    int32_t half = n / 3;
+    WindowAggUpdate<T>(values.data(), nulls.data(), half, &sum, &avg_sum, &cnt, &min, &max);
+    WindowAggUpdate<T>(values.data() + half, nulls.data() + half, n - half, &sum, &avg_sum, &cnt, &min, &max);
+    ASSERT_EQ(static_cast<T>(expect_sum), sum);
+    ASSERT_EQ(expect_avg_sum, avg_sum);
+    ASSERT_EQ(expect_cnt, cnt);
+    ASSERT_EQ(expect_min, min);
+    ASSERT_EQ(expect_max, max);
+}
+
+TEST_F(WindowAggBatchTest, IntegerUpdate) {
+    std::mt19937_64 rng(1);
+    for (int32_t n = 0; n < 300; n++) {
+        CheckWindowAggUpdate<int16_t>(&rng, n);
+        CheckWindowAggUpdate<int32_t>(&rng, n);
+        CheckWindowAggUpdate<int64_t>(&rng, n);
+    }
+}
+
+TEST_F(WindowAggBatchTest, SkipNullStates) {
+    double values[3] = {1.5, 0, 2.5};
+    int8_t nulls[3] = {0, 1, 0};
+    double sum = 1.0;
+    int64_t cnt = 0;
+    WindowAggUpdate<double>(values, nulls, 3, &sum, nullptr, &cnt, nullptr, nullptr);
+    ASSERT_EQ(5.0, sum);
+    ASSERT_EQ(2, cnt);
+    float float_values[2] = {-1.5f, 3.0f};
+    int8_t float_nulls[2] = {0, 0};
+    float min = std::numeric_limits<float>::max();
+    double avg_sum = 0;
+    WindowAggUpdate<float>(float_values, float_nulls, 2, nullptr, &avg_sum, nullptr, &min, nullptr);
+    ASSERT_EQ(1.5, avg_sum);
+    ASSERT_EQ(-1.5f, min);
+}
+
+TEST_F(WindowAggBatchTest, ReuseBuffer) {
+    int32_t specs[8] = {0};
+    int8_t* values = nullptr;
+    {
+        WindowAggBatch batch(nullptr, specs, 2);
+        values = batch.GetValues(0);
+        ASSERT_EQ(0, batch.Fetch());
+    }
+    {
+        // the buffer of the batch deleted is reused
+        WindowAggBatch batch(nullptr, specs, 1);
+        ASSERT_EQ(values, batch.GetValues(0));
+        // the nested batch allocates its own buffer
+        WindowAggBatch nested(nullptr, specs, 2);
+        ASSERT_NE(values, nested.GetValues(0));
+    }
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
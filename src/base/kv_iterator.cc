@@ -16,9 +16,55 @@
 
 #include "base/kv_iterator.h"
 
+#include <algorithm>
+
 namespace openmldb {
 namespace base {
 
+void KvIterator::SetBuffer(std::string* pairs, const std::shared_ptr<butil::IOBuf>& attachment) {
+    if (attachment && !attachment->empty()) {
+        attachment_ = attachment;
+        tsize_ = attachment->size();
+    } else {
+        buffer_ = reinterpret_cast<char*>(&((*pairs)[0]));
+        tsize_ = pairs->size();
+    }
+}
+
+const char* KvIterator::Fetch(uint32_t n, std::string* aux) {
+    if (!attachment_) {
+        const char* data = buffer_;
+        buffer_ += n;
+        return data;
+    }
+    while (block_idx_ < attachment_->backing_block_num() &&
+           block_offset_ >= attachment_->backing_block(block_idx_).size()) {
+        block_idx_++;
+        block_offset_ = 0;
+    }
+    butil::StringPiece block;
+    if (block_idx_ < attachment_->backing_block_num()) {
+        block = attachment_->backing_block(block_idx_);
+    }
+    if (block_offset_ + n <= block.size()) {
+        const char* data = block.data() + block_offset_;
+        block_offset_ += n;
+        return data;
+    }
+    aux->clear();
+    while (aux->size() < n && block_idx_ < attachment_->backing_block_num()) {
+        block = attachment_->backing_block(block_idx_);
+        size_t len = std::min(block.size() - block_offset_, n - aux->size());
+        aux->append(block.data() + block_offset_, len);
+        block_offset_ += len;
+        if (block_offset_ == block.size()) {
+            block_idx_++;
+            block_offset_ = 0;
+        }
+    }
+    return aux->data();
+}
+
 bool ScanKvIterator::Valid() {
     if (tsize_ < 12 || offset_ > tsize_) {
         return false;
@@ -32,12 +78,10 @@ void ScanKvIterator::Next() {
         return;
     }
     uint32_t block_size = 0;
-    memcpy(static_cast<void*>(&block_size), buffer_, 4);
-    buffer_ += 4;
-    memcpy(static_cast<void*>(&time_), buffer_, 8);
-    buffer_ += 8;
-    tmp_.reset(buffer_, block_size - 8);
-    buffer_ += (block_size - 8);
+    const char* header = Fetch(12, &header_buf_);
+    memcpy(static_cast<void*>(&block_size), header, 4);
+    memcpy(static_cast<void*>(&time_), header + 4, 8);
+    tmp_.reset(Fetch(block_size - 8, &value_buf_), block_size - 8);
     offset_ += (4 + block_size);
 }
 
@@ -54,17 +98,13 @@ void TraverseKvIterator::Next() {
         return;
     }
     uint32_t total_size = 0;
-    memcpy(static_cast<void*>(&total_size), buffer_, 4);
-    buffer_ += 4;
+    const char* header = Fetch(16, &header_buf_);
+    memcpy(static_cast<void*>(&total_size), header, 4);
     uint32_t pk_size = 0;
-    memcpy(static_cast<void*>(&pk_size), buffer_, 4);
-    buffer_ += 4;
-    memcpy(static_cast<void*>(&time_), buffer_, 8);
-    buffer_ += 8;
-    pk_.assign(buffer_, pk_size);
-    buffer_ += pk_size;
-    tmp_.reset(buffer_, total_size - pk_size - 8);
-    buffer_ += (total_size - pk_size - 8);
+    memcpy(static_cast<void*>(&pk_size), header + 4, 4);
+    memcpy(static_cast<void*>(&time_), header + 8, 8);
+    pk_.assign(Fetch(pk_size, &header_buf_), pk_size);
+    tmp_.reset(Fetch(total_size - pk_size - 8, &value_buf_), total_size - pk_size - 8);
     offset_ += (8 + total_size);
 }
 
@@ -78,6 +118,8 @@ void TraverseKvIterator::NextPK() {
 void TraverseKvIterator::Reset() {
     auto response = std::dynamic_pointer_cast<::openmldb::api::TraverseResponse>(response_);
     buffer_ = reinterpret_cast<char*>(&((*response->mutable_pairs())[0]));
+    block_idx_ = 0;
+    block_offset_ = 0;
     offset_ = 0;
 }
 
@@ -25,15 +25,19 @@
 #include <string>
 
 #include "base/slice.h"
+#include "butil/iobuf.h"
 #include "proto/tablet.pb.h"
 
 namespace openmldb {
 namespace base {
 
+// KvIterator reads the pairs from the field pairs of the response, or from the attachment if it's not empty.
+// The attachment is walked block by block, and a row is copied only if it spans two blocks
 class KvIterator {
  public:
     explicit KvIterator(const std::shared_ptr<::google::protobuf::Message>& response) :
-        response_(response), buffer_(nullptr), is_finish_(true), tsize_(0), offset_(0), tmp_() {}
+        response_(response), buffer_(nullptr), is_finish_(true), tsize_(0), offset_(0), tmp_(),
+        block_idx_(0), block_offset_(0) {}
 
     virtual ~KvIterator() {}
 
@@ -47,10 +51,18 @@ class KvIterator {
 
     std::shared_ptr<::google::protobuf::Message> GetResponse() const { return response_; }
 
+    const std::shared_ptr<butil::IOBuf>& GetAttachment() const { return attachment_; }
+
     virtual void Next() = 0;
 
     virtual bool Valid() = 0;
 
+ protected:
+    void SetBuffer(std::string* pairs, const std::shared_ptr<butil::IOBuf>& attachment);
+
+    // return the next n bytes, they are copied into aux only if they span the blocks of the attachment
+    const char* Fetch(uint32_t n, std::string* aux);
+
  protected:
     std::shared_ptr<::google::protobuf::Message> response_;
     char* buffer_;
@@ -60,15 +72,20 @@ class KvIterator {
     uint64_t time_;
     Slice tmp_;
     std::string pk_;
+    std::shared_ptr<butil::IOBuf> attachment_;
+    size_t block_idx_;
+    size_t block_offset_;
+    std::string header_buf_;
+    std::string value_buf_;
 };
 
 class ScanKvIterator : public KvIterator {
  public:
-    ScanKvIterator(const std::string& pk, const std::shared_ptr<::openmldb::api::ScanResponse>& response)
+    ScanKvIterator(const std::string& pk, const std::shared_ptr<::openmldb::api::ScanResponse>& response,
+                   const std::shared_ptr<butil::IOBuf>& attachment = std::shared_ptr<butil::IOBuf>())
         : KvIterator(response) {
-        buffer_ = reinterpret_cast<char*>(&((*response->mutable_pairs())[0]));
+        SetBuffer(response->mutable_pairs(), attachment);
         is_finish_ = response->is_finish();
-        tsize_ = response->pairs().size();
         pk_ = pk;
         Next();
     }
@@ -80,13 +97,13 @@ class ScanKvIterator : public KvIterator {
 
 class TraverseKvIterator : public KvIterator {
  public:
-    explicit TraverseKvIterator(const std::shared_ptr<::openmldb::api::TraverseResponse>& response)
+    explicit TraverseKvIterator(const std::shared_ptr<::openmldb::api::TraverseResponse>& response,
+                                const std::shared_ptr<butil::IOBuf>& attachment = std::shared_ptr<butil::IOBuf>())
         : KvIterator(response),
           last_pk_(response->pk()),
           last_ts_(response->ts()) {
-        buffer_ = reinterpret_cast<char*>(&((*response->mutable_pairs())[0]));
+        SetBuffer(response->mutable_pairs(), attachment);
         is_finish_ = response->is_finish();
-        tsize_ = response->pairs().size();
         Next();
     }
 
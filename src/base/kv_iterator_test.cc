@@ -15,7 +15,10 @@
  */
 
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <string>
 
 #include "base/kv_iterator.h"
 #include "base/strings.h"
@@ -143,6 +146,60 @@ TEST_F(KvIteratorTest, NextPK) {
     ASSERT_EQ(count, 3);
 }
 
+static void NoopDeleter(void*) {}
+
+TEST_F(KvIteratorTest, Attachment) {
+    std::string pairs;
+    pairs.resize(16 * 6 + 6 * 5 + 3 * 10 + 3 * 100);
+    char* data = reinterpret_cast<char*>(&pairs[0]);
+    uint32_t offset = 0;
+    for (int i = 0; i < 6; i++) {
+        std::string pk = "test" + std::to_string(i % 2);
+        std::string value(i % 2 == 0 ? 10 : 100, 'a' + i);
+        ::openmldb::codec::EncodeFull(pk, 9500 - i, value.data(), value.size(), data, offset);
+        offset += 16 + pk.size() + value.size();
+    }
+    ASSERT_EQ(pairs.size(), offset);
+    // the pairs span the blocks of the attachment
+    auto attachment = std::make_shared<butil::IOBuf>();
+    for (uint32_t pos = 0; pos < pairs.size(); pos += 7) {
+        attachment->append_user_data(&pairs[pos], std::min<size_t>(7, pairs.size() - pos), NoopDeleter);
+    }
+    auto response = std::make_shared<::openmldb::api::TraverseResponse>();
+    TraverseKvIterator kv_it(response, attachment);
+    int count = 0;
+    while (kv_it.Valid()) {
+        ASSERT_EQ("test" + std::to_string(count % 2), kv_it.GetPK());
+        ASSERT_EQ(9500u - count, kv_it.GetKey());
+        ASSERT_EQ(std::string(count % 2 == 0 ? 10 : 100, 'a' + count), kv_it.GetValue().ToString());
+        count++;
+        kv_it.Next();
+    }
+    ASSERT_EQ(6, count);
+    kv_it.Seek("test1");
+    ASSERT_TRUE(kv_it.Valid());
+    ASSERT_EQ(9499u, kv_it.GetKey());
+
+    auto scan_response = std::make_shared<::openmldb::api::ScanResponse>();
+    auto scan_attachment = std::make_shared<butil::IOBuf>();
+    char header[::openmldb::codec::PAIR_HEADER_SIZE];
+    std::string value(20, 'v');
+    for (int i = 0; i < 3; i++) {
+        ::openmldb::codec::EncodeHeader(9527 + i, value.size(), header);
+        scan_attachment->append(header, sizeof(header));
+        scan_attachment->append_user_data(&value[0], value.size(), NoopDeleter);
+    }
+    ScanKvIterator scan_it("pk", scan_response, scan_attachment);
+    count = 0;
+    while (scan_it.Valid()) {
+        ASSERT_EQ(9527u + count, scan_it.GetKey());
+        ASSERT_EQ(value, scan_it.GetValue().ToString());
+        count++;
+        scan_it.Next();
+    }
+    ASSERT_EQ(3, count);
+}
+
 }  // namespace base
 }  // namespace openmldb
 
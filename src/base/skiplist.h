@@ -21,9 +21,14 @@
 #include <stdint.h>
 
 #include <atomic>
+#include <functional>
 #include <iostream>
+#include <new>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "base/random.h"
+#include "base/slab_allocator.h"
 
 namespace openmldb {
 namespace base {
@@ -45,14 +50,18 @@ class Node {
  public:
     // Set data reference and Node height
     Node(const K& key, V& value, uint8_t height)  // NOLINT
-        : height_(height), key_(key), value_(value) {
+        : height_(height), own_nexts_(true), key_(key), value_(value) {
         nexts_ = new std::atomic<Node<K, V>*>[height];
     }
 
-    Node(uint8_t height) : height_(height), key_(), value_() {  // NOLINT
+    Node(uint8_t height) : height_(height), own_nexts_(true), key_(), value_() {  // NOLINT
         nexts_ = new std::atomic<Node<K, V>*>[height];
     }
 
+    // The next pointers are placed by the caller, see Skiplist::NewNode
+    Node(const K& key, V& value, uint8_t height, std::atomic<Node<K, V>*>* nexts)  // NOLINT
+        : height_(height), own_nexts_(false), key_(key), value_(value), nexts_(nexts) {}
+
     // Set the next node with memory barrier
     void SetNext(uint8_t level, Node<K, V>* node) {
         assert(level < height_ && level >= 0);
@@ -65,6 +74,12 @@ class Node {
         nexts_[level].store(node, std::memory_order_relaxed);
     }
 
+    // Set the next node only if it's still the expected one
+    bool CasNext(uint8_t level, Node<K, V>* expected, Node<K, V>* node) {
+        assert(level < height_ && level >= 0);
+        return nexts_[level].compare_exchange_strong(expected, node, std::memory_order_acq_rel);
+    }
+
     uint8_t Height() { return height_; }
 
     Node<K, V>* GetNext(uint8_t level) {
@@ -81,16 +96,164 @@ class Node {
 
     const K& GetKey() const { return key_; }
 
-    ~Node() { delete[] nexts_; }
+    ~Node() {
+        if (own_nexts_) {
+            delete[] nexts_;
+        }
+    }
+
+    // the byte size of the node and its next pointers allocated in one block
+    static uint32_t ByteSize(uint8_t height) { return sizeof(Node<K, V>) + height * sizeof(std::atomic<Node<K, V>*>); }
+
+    // The node is carved out of slab if it's not null, and the next pointers are placed right after it
+    static Node<K, V>* New(const K& key, V& value, uint8_t height, SlabAllocator* slab) {  // NOLINT
+        if (slab == nullptr) {
+            return new Node<K, V>(key, value, height);
+        }
+        char* buf = static_cast<char*>(slab->Allocate(ByteSize(height)));
+        auto* nexts = reinterpret_cast<std::atomic<Node<K, V>*>*>(buf + sizeof(Node<K, V>));
+        for (uint8_t i = 0; i < height; i++) {
+            new (&nexts[i]) std::atomic<Node<K, V>*>(NULL);
+        }
+        return new (buf) Node<K, V>(key, value, height, nexts);
+    }
+
+    static Node<K, V>* NewHead(uint8_t height) { return new Node<K, V>(height); }
+
+    // the slab must be the one used in New
+    static void Free(Node<K, V>* node, SlabAllocator* slab) {
+        if (slab == nullptr) {
+            delete node;
+            return;
+        }
+        uint32_t byte_size = ByteSize(node->Height());
+        node->~Node<K, V>();
+        slab->Free(node, byte_size);
+    }
+
+    static void Retire(Node<K, V>* node, SlabAllocator* slab, uint64_t version) {
+        if (slab == nullptr) {
+            delete node;
+            return;
+        }
+        uint32_t byte_size = ByteSize(node->Height());
+        node->~Node<K, V>();
+        slab->Retire(node, byte_size, version);
+    }
 
  private:
     uint8_t const height_;
+    bool const own_nexts_;
     K const key_;
     V value_;
     std::atomic<Node<K, V>*>* nexts_;
 };
 
-template <class K, class V, class Comparator>
+// Skiplist node with the next pointers inlined at the tail of the node, so a hop doesn't
+// touch another cache line to load the pointer array. It must be created by New or NewHead
+// and freed by Free or Retire
+template <class K, class V>
+class InlineNode {
+ public:
+    static InlineNode<K, V>* New(const K& key, V& value, uint8_t height, SlabAllocator* slab) {  // NOLINT
+        uint32_t byte_size = ByteSize(height);
+        void* buf = slab == nullptr ? ::operator new(byte_size) : slab->Allocate(byte_size);
+        return new (buf) InlineNode<K, V>(key, value, height);
+    }
+
+    static InlineNode<K, V>* NewHead(uint8_t height) {
+        void* buf = ::operator new(ByteSize(height));
+        return new (buf) InlineNode<K, V>(height);
+    }
+
+    // the slab must be the one used in New
+    static void Free(InlineNode<K, V>* node, SlabAllocator* slab) {
+        uint32_t byte_size = ByteSize(node->Height());
+        node->~InlineNode<K, V>();
+        if (slab == nullptr) {
+            ::operator delete(node);
+        } else {
+            slab->Free(node, byte_size);
+        }
+    }
+
+    static void Retire(InlineNode<K, V>* node, SlabAllocator* slab, uint64_t version) {
+        if (slab == nullptr) {
+            Free(node, slab);
+            return;
+        }
+        uint32_t byte_size = ByteSize(node->Height());
+        node->~InlineNode<K, V>();
+        slab->Retire(node, byte_size, version);
+    }
+
+    // the byte size of node without next pointers
+    static constexpr uint32_t HeaderSize() {
+        return sizeof(InlineNode<K, V>) - sizeof(std::atomic<InlineNode<K, V>*>);
+    }
+
+    static uint32_t ByteSize(uint8_t height) { return HeaderSize() + height * sizeof(std::atomic<InlineNode<K, V>*>); }
+
+    // Set the next node with memory barrier
+    void SetNext(uint8_t level, InlineNode<K, V>* node) {
+        assert(level < height_ && level >= 0);
+        nexts_[level].store(node, std::memory_order_release);
+    }
+
+    // Set the next node without memory barrier
+    void SetNextNoBarrier(uint8_t level, InlineNode<K, V>* node) {
+        assert(level < height_ && level >= 0);
+        nexts_[level].store(node, std::memory_order_relaxed);
+    }
+
+    // Set the next node only if it's still the expected one
+    bool CasNext(uint8_t level, InlineNode<K, V>* expected, InlineNode<K, V>* node) {
+        assert(level < height_ && level >= 0);
+        return nexts_[level].compare_exchange_strong(expected, node, std::memory_order_acq_rel);
+    }
+
+    uint8_t Height() { return height_; }
+
+    InlineNode<K, V>* GetNext(uint8_t level) {
+        assert(level < height_ && level >= 0);
+        return nexts_[level].load(std::memory_order_acquire);
+    }
+
+    InlineNode<K, V>* GetNextNoBarrier(uint8_t level) {
+        assert(level < height_ && level >= 0);
+        return nexts_[level].load(std::memory_order_relaxed);
+    }
+
+    V& GetValue() { return value_; }
+
+    const K& GetKey() const { return key_; }
+
+ private:
+    InlineNode(const K& key, V& value, uint8_t height)  // NOLINT
+        : height_(height), key_(key), value_(value) {
+        InitNexts();
+    }
+
+    explicit InlineNode(uint8_t height) : height_(height), key_(), value_() { InitNexts(); }
+
+    ~InlineNode() {}
+
+    void InitNexts() {
+        for (uint8_t i = 0; i < height_; i++) {
+            new (&nexts_[i]) std::atomic<InlineNode<K, V>*>(NULL);
+        }
+    }
+
+ private:
+    uint8_t const height_;
+    K const key_;
+    V value_;
+    // the real length is height_
+    std::atomic<InlineNode<K, V>*> nexts_[1];
+};
+
+// NodeType can be Node or InlineNode
+template <class K, class V, class Comparator, class NodeType = Node<K, V>>
 class Skiplist {
  public:
     Skiplist(uint8_t max_height, uint8_t branch, const Comparator& compare)
@@ -101,18 +264,19 @@ class Skiplist {
           rand_(0xdeadbeef),
           head_(NULL),
           tail_(NULL) {
-        head_ = new Node<K, V>(MaxHeight);
+        head_ = NodeType::NewHead(MaxHeight);
         for (uint8_t i = 0; i < head_->Height(); i++) {
             head_->SetNext(i, NULL);
         }
         max_height_.store(1, std::memory_order_relaxed);
     }
-    ~Skiplist() { delete head_; }
+    ~Skiplist() { NodeType::Free(head_, nullptr); }
 
     // Insert need external synchronized
-    uint8_t Insert(const K& key, V& value) {  // NOLINT
+    // The node is carved out of slab if it's not null, and it must be freed with the same slab
+    uint8_t Insert(const K& key, V& value, SlabAllocator* slab = nullptr) {  // NOLINT
         uint8_t height = RandomHeight();
-        Node<K, V>* pre[MaxHeight];
+        NodeType* pre[MaxHeight];
         FindLessOrEqual(key, pre);
         if (height > GetMaxHeight()) {
             for (uint8_t i = GetMaxHeight(); i < height; i++) {
@@ -120,7 +284,7 @@ class Skiplist {
             }
             max_height_.store(height, std::memory_order_relaxed);
         }
-        Node<K, V>* node = NewNode(key, value, height);
+        NodeType* node = NewNode(key, value, height, slab);
         if (pre[0]->GetNext(0) == NULL) {
             tail_.store(node, std::memory_order_release);
         }
@@ -131,6 +295,19 @@ class Skiplist {
         return height;
     }
 
+    // ConcurrentInsert can be called by several writers at the same time, the node is linked
+    // level by level with CAS. It must not run along with Insert, Remove, Split, Clear or AddToFirst,
+    // the caller should block them with a lock which writers share
+    uint8_t ConcurrentInsert(const K& key, V& value, SlabAllocator* slab = nullptr) {  // NOLINT
+        return InsertWithCas(key, value, slab, false);
+    }
+
+    // Same as ConcurrentInsert, but if the key exists value is set to the existing one
+    // and 0 is returned
+    uint8_t ConcurrentInsertIfAbsent(const K& key, V& value, SlabAllocator* slab = nullptr) {  // NOLINT
+        return InsertWithCas(key, value, slab, true);
+    }
+
     bool IsEmpty() {
         if (head_->GetNextNoBarrier(0) == NULL) {
             return true;
@@ -139,16 +316,16 @@ class Skiplist {
     }
 
     // Remove need external synchronized
-    Node<K, V>* Remove(const K& key) {
-        Node<K, V>* pre[MaxHeight];
+    NodeType* Remove(const K& key) {
+        NodeType* pre[MaxHeight];
         for (uint8_t i = 0; i < MaxHeight; i++) {
             pre[i] = head_;
         }
-        Node<K, V>* target = FindLessOrEqual(key, pre);
+        NodeType* target = FindLessOrEqual(key, pre);
         if (target == NULL) {
             return NULL;
         }
-        Node<K, V>* result = target->GetNextNoBarrier(0);
+        NodeType* result = target->GetNextNoBarrier(0);
         if (result == NULL || compare_(result->GetKey(), key) != 0) {
             return NULL;
         }
@@ -164,17 +341,18 @@ class Skiplist {
     }
 
     // Split list two parts, the return part is just a linkedlist
-    Node<K, V>* Split(const K& key) {
-        Node<K, V>* pre[MaxHeight];
+    NodeType* Split(const K& key) {
+        NodeType* pre[MaxHeight];
         for (uint8_t i = 0; i < MaxHeight; i++) {
             pre[i] = NULL;
         }
-        Node<K, V>* target = FindLessOrEqual(key, pre);
+        NodeType* target = FindLessOrEqual(key, pre);
         if (target == NULL) {
             return NULL;
         }
-        tail_.store(target, std::memory_order_release);
-        Node<K, V>* result = target->GetNextNoBarrier(0);
+        target == head_ ? tail_.store(NULL, std::memory_order_release)
+                        : tail_.store(target, std::memory_order_release);
+        NodeType* result = target->GetNextNoBarrier(0);
         for (uint8_t i = 0; i < MaxHeight; i++) {
             if (pre[i] == NULL) {
                 continue;
@@ -184,8 +362,8 @@ class Skiplist {
         return result;
     }
 
-    Node<K, V>* SplitByPos(uint64_t pos) {
-        Node<K, V>* pos_node = head_->GetNext(0);
+    NodeType* SplitByPos(uint64_t pos) {
+        NodeType* pos_node = head_->GetNext(0);
         for (uint64_t idx = 0; idx < pos; idx++) {
             if (pos_node == NULL) {
                 return NULL;
@@ -198,8 +376,8 @@ class Skiplist {
         return SplitOnPosNode(pos, pos_node);
     }
 
-    Node<K, V>* SplitByKeyOrPos(const K& key, uint64_t pos) {
-        Node<K, V>* pos_node = head_->GetNext(0);
+    NodeType* SplitByKeyOrPos(const K& key, uint64_t pos) {
+        NodeType* pos_node = head_->GetNext(0);
         for (uint64_t idx = 0; idx < pos; idx++) {
             if (pos_node == NULL) {  // doesnt find key or pos, just return
                 return NULL;
@@ -215,8 +393,8 @@ class Skiplist {
         return SplitOnPosNode(pos, pos_node);
     }
 
-    Node<K, V>* SplitByKeyAndPos(const K& key, uint64_t pos) {
-        Node<K, V>* pos_node = head_->GetNext(0);
+    NodeType* SplitByKeyAndPos(const K& key, uint64_t pos) {
+        NodeType* pos_node = head_->GetNext(0);
         bool find_key = false;
         for (uint64_t idx = 0; idx < pos; idx++) {
             if (pos_node == NULL) {  // doesnt find pos, just return
@@ -238,12 +416,12 @@ class Skiplist {
     }
 
     const V& Get(const K& key) {
-        Node<K, V>* node = FindEqual(key);
+        NodeType* node = FindEqual(key);
         return node->GetValue();
     }
 
     int Get(const K& key, V& v) {  // NOLINT
-        Node<K, V>* node = FindEqual(key);
+        NodeType* node = FindEqual(key);
         if (node != NULL && compare_(node->GetKey(), key) == 0) {
             v = node->GetValue();
             return 0;
@@ -251,14 +429,23 @@ class Skiplist {
         return -1;
     }
 
-    Node<K, V>* GetLast() { return tail_.load(std::memory_order_acquire); }
+    // return the node of key, NULL if it's not found
+    NodeType* GetNode(const K& key) {
+        NodeType* node = FindEqual(key);
+        if (node != NULL && compare_(node->GetKey(), key) == 0) {
+            return node;
+        }
+        return NULL;
+    }
+
+    NodeType* GetLast() { return tail_.load(std::memory_order_acquire); }
 
     uint32_t GetSize() {
         uint32_t cnt = 0;
-        Node<K, V>* node = head_->GetNext(0);
+        NodeType* node = head_->GetNext(0);
         while (node != NULL) {
             cnt++;
-            Node<K, V>* tmp = node->GetNext(0);
+            NodeType* tmp = node->GetNext(0);
             // find the end
             if (tmp == NULL) {
                 break;
@@ -269,9 +456,9 @@ class Skiplist {
     }
 
     // Need external synchronized
-    uint64_t Clear() {
+    uint64_t Clear(SlabAllocator* slab = nullptr) {
         uint64_t cnt = 0;
-        Node<K, V>* node = head_->GetNext(0);
+        NodeType* node = head_->GetNext(0);
         // Unlink all next node
         for (uint8_t i = 0; i < head_->Height(); i++) {
             head_->SetNextNoBarrier(i, NULL);
@@ -280,13 +467,13 @@ class Skiplist {
 
         while (node != NULL) {
             cnt++;
-            Node<K, V>* tmp = node;
+            NodeType* tmp = node;
             node = node->GetNext(0);
             // Unlink all next node
             for (uint8_t i = 0; i < tmp->Height(); i++) {
                 tmp->SetNextNoBarrier(i, NULL);
             }
-            delete tmp;
+            FreeNode(tmp, slab);
         }
         return cnt;
     }
@@ -294,20 +481,20 @@ class Skiplist {
     // Need external synchronized
     bool AddToFirst(const K& key, V& value) {  // NOLINT
         {
-            Node<K, V>* node = head_->GetNext(0);
+            NodeType* node = head_->GetNext(0);
             if (node != NULL && compare_(key, node->GetKey()) > 0) {
                 return false;
             }
         }
         uint8_t height = RandomHeight();
-        Node<K, V>* pre[MaxHeight];
+        NodeType* pre[MaxHeight];
         for (uint8_t i = 0; i < height; i++) {
             pre[i] = head_;
         }
         if (height > GetMaxHeight()) {
             max_height_.store(height, std::memory_order_relaxed);
         }
-        Node<K, V>* node = NewNode(key, value, height);
+        NodeType* node = NewNode(key, value, height, nullptr);
         if (pre[0]->GetNext(0) == NULL) {
             tail_.store(node, std::memory_order_release);
         }
@@ -320,7 +507,7 @@ class Skiplist {
 
     class Iterator {
      public:
-        Iterator(Skiplist<K, V, Comparator>* list) : node_(NULL), list_(list) {}  // NOLINT
+        Iterator(Skiplist<K, V, Comparator, NodeType>* list) : node_(NULL), list_(list) {}  // NOLINT
         ~Iterator() {}
 
         bool Valid() const { return node_ != NULL; }
@@ -355,17 +542,66 @@ class Skiplist {
         uint32_t GetSize() { return list_->GetSize(); }
 
      private:
-        Node<K, V>* node_;
-        Skiplist<K, V, Comparator>* const list_;
+        NodeType* node_;
+        Skiplist<K, V, Comparator, NodeType>* const list_;
     };
 
     // delete the iterator after it's used
     Iterator* NewIterator() { return new Iterator(this); }
 
+    // Appender builds the list from sorted keys, it links every key after the last node of each level
+    // without searching. Need external synchronized, and the list must not be changed in other ways
+    // while the appender is used
+    class Appender {
+     public:
+        explicit Appender(Skiplist<K, V, Comparator, NodeType>* list) : list_(list), lasts_(list->MaxHeight) {
+            NodeType* node = list_->head_;
+            for (int i = list_->MaxHeight - 1; i >= 0; i--) {
+                NodeType* next = node->GetNext(i);
+                while (next != NULL) {
+                    node = next;
+                    next = node->GetNext(i);
+                }
+                lasts_[i] = node;
+            }
+        }
+        ~Appender() {}
+
+        // return the height of the new node, or 0 if the key is less than the last one
+        uint8_t Append(const K& key, V& value, SlabAllocator* slab = nullptr) {  // NOLINT
+            if (lasts_[0] != list_->head_ && list_->compare_(key, lasts_[0]->GetKey()) < 0) {
+                return 0;
+            }
+            uint8_t height = list_->RandomHeight();
+            if (height > list_->GetMaxHeight()) {
+                list_->max_height_.store(height, std::memory_order_relaxed);
+            }
+            NodeType* node = list_->NewNode(key, value, height, slab);
+            for (uint8_t i = 0; i < height; i++) {
+                node->SetNextNoBarrier(i, NULL);
+                lasts_[i]->SetNext(i, node);
+                lasts_[i] = node;
+            }
+            list_->tail_.store(node, std::memory_order_release);
+            return height;
+        }
+
+     private:
+        Skiplist<K, V, Comparator, NodeType>* list_;
+        std::vector<NodeType*> lasts_;
+    };
+
+    // free the node which is removed or split from the list, the slab must be the one used in Insert
+    static void FreeNode(NodeType* node, SlabAllocator* slab) { NodeType::Free(node, slab); }
+
+    // the node memory will not be reused until slab reclaims the version
+    static void RetireNode(NodeType* node, SlabAllocator* slab, uint64_t version) {
+        NodeType::Retire(node, slab, version);
+    }
+
  private:
-    Node<K, V>* NewNode(const K& key, V& value, uint8_t height) {  // NOLINT
-        Node<K, V>* node = new Node<K, V>(key, value, height);
-        return node;
+    NodeType* NewNode(const K& key, V& value, uint8_t height, SlabAllocator* slab) {  // NOLINT
+        return NodeType::New(key, value, height, slab);
     }
 
     uint8_t RandomHeight() {
@@ -376,12 +612,86 @@ class Skiplist {
         return height;
     }
 
-    Node<K, V>* FindLessOrEqual(const K& key, Node<K, V>** nodes) {
+    // the generator is per thread as concurrent writers can't share rand_
+    uint8_t ConcurrentRandomHeight() {
+        static thread_local Random rand(0xdeadbeef ^ std::hash<std::thread::id>()(std::this_thread::get_id()));
+        uint8_t height = 1;
+        while (height < MaxHeight && (rand.Next() % Branch) == 0) {
+            height++;
+        }
+        return height;
+    }
+
+    uint8_t InsertWithCas(const K& key, V& value, SlabAllocator* slab, bool unique) {  // NOLINT
+        uint8_t height = ConcurrentRandomHeight();
+        uint8_t max_height = GetMaxHeight();
+        while (height > max_height) {
+            if (max_height_.compare_exchange_weak(max_height, height, std::memory_order_relaxed)) {
+                max_height = height;
+            }
+        }
+        NodeType* pre[MaxHeight];
+        NodeType* next[MaxHeight];
+        NodeType* node = head_;
+        for (int i = max_height - 1; i >= 0; i--) {
+            FindSpliceForLevel(key, node, i, &pre[i], &next[i]);
+            node = pre[i];
+        }
+        if (unique && IsEqualNode(key, next[0])) {
+            value = next[0]->GetValue();
+            return 0;
+        }
+        node = NewNode(key, value, height, slab);
+        for (uint8_t i = 0; i < height; i++) {
+            while (true) {
+                node->SetNextNoBarrier(i, next[i]);
+                if (pre[i]->CasNext(i, next[i], node)) {
+                    break;
+                }
+                // nodes are never removed during concurrent insert, so the splice is after pre[i]
+                FindSpliceForLevel(key, pre[i], i, &pre[i], &next[i]);
+                if (i == 0 && unique && IsEqualNode(key, next[0])) {
+                    value = next[0]->GetValue();
+                    FreeNode(node, slab);
+                    return 0;
+                }
+            }
+        }
+        while (node->GetNext(0) == NULL) {
+            NodeType* tail = tail_.load(std::memory_order_acquire);
+            if (tail != NULL && compare_(key, tail->GetKey()) < 0) {
+                break;
+            }
+            if (tail_.compare_exchange_weak(tail, node, std::memory_order_acq_rel)) {
+                break;
+            }
+        }
+        return height;
+    }
+
+    // find pre and next of the key at the level, the search starts from the node before
+    void FindSpliceForLevel(const K& key, NodeType* before, uint8_t level, NodeType** pre, NodeType** next) {
+        while (true) {
+            NodeType* node = before->GetNext(level);
+            if (!IsAfterNode(key, node)) {
+                *pre = before;
+                *next = node;
+                return;
+            }
+            before = node;
+        }
+    }
+
+    bool IsEqualNode(const K& key, NodeType* node) const {
+        return node != NULL && compare_(node->GetKey(), key) == 0;
+    }
+
+    NodeType* FindLessOrEqual(const K& key, NodeType** nodes) {
         assert(nodes != NULL);
-        Node<K, V>* node = head_;
+        NodeType* node = head_;
         uint8_t level = GetMaxHeight() - 1;
         while (true) {
-            Node<K, V>* next = node->GetNext(level);
+            NodeType* next = node->GetNext(level);
             if (IsAfterNode(key, next)) {
                 node = next;
             } else {
@@ -394,11 +704,11 @@ class Skiplist {
         }
     }
 
-    Node<K, V>* FindEqual(const K& key) {
-        Node<K, V>* node = head_;
+    NodeType* FindEqual(const K& key) {
+        NodeType* node = head_;
         uint8_t level = GetMaxHeight() - 1;
         while (true) {
-            Node<K, V>* next = node->GetNext(level);
+            NodeType* next = node->GetNext(level);
             if (next == NULL || compare_(next->GetKey(), key) > 0) {
                 if (level <= 0) {
                     return node;
@@ -410,12 +720,12 @@ class Skiplist {
         }
     }
 
-    Node<K, V>* FindLessThan(const K& key) {
-        Node<K, V>* node = head_;
+    NodeType* FindLessThan(const K& key) {
+        NodeType* node = head_;
         uint8_t level = GetMaxHeight() - 1;
         while (true) {
             assert(node == head_ || compare_(node->GetKey(), key) < 0);
-            Node<K, V>* next = node->GetNext(level);
+            NodeType* next = node->GetNext(level);
             if (next == NULL || compare_(next->GetKey(), key) >= 0) {
                 if (level <= 0) {
                     return node;
@@ -427,15 +737,15 @@ class Skiplist {
         }
     }
 
-    bool IsAfterNode(const K& key, const Node<K, V>* node) const {
+    bool IsAfterNode(const K& key, const NodeType* node) const {
         return (node != NULL) && (compare_(key, node->GetKey()) > 0);
     }
 
     uint8_t GetMaxHeight() const { return max_height_.load(std::memory_order_relaxed); }
 
-    Node<K, V>* SplitOnPosNode(uint64_t pos, Node<K, V>* pos_node) {
-        Node<K, V>* node = head_;
-        Node<K, V>* pre = head_;
+    NodeType* SplitOnPosNode(uint64_t pos, NodeType* pos_node) {
+        NodeType* node = head_;
+        NodeType* pre = head_;
         pos++;
         uint64_t cnt = 0;
         while (node != NULL) {
@@ -447,7 +757,7 @@ class Skiplist {
                 return node;
             }
             for (uint8_t i = 1; i < node->Height(); i++) {
-                Node<K, V>* next = node->GetNext(i);
+                NodeType* next = node->GetNext(i);
                 if (next != NULL && compare_(pos_node->GetKey(), next->GetKey()) <= 0) {
                     node->SetNext(i, NULL);
                 }
@@ -465,8 +775,8 @@ class Skiplist {
     std::atomic<uint8_t> max_height_;
     Comparator const compare_;
     Random rand_;
-    Node<K, V>* head_;
-    std::atomic<Node<K, V>*> tail_;
+    NodeType* head_;
+    std::atomic<NodeType*> tail_;
     friend Iterator;
 };
 
@@ -17,6 +17,7 @@
 #include "base/skiplist.h"
 
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "base/slice.h"
@@ -94,6 +95,62 @@ TEST_F(NodeTest, NodeByteSize) {
     ASSERT_EQ(40u, sizeof(Node<Slice, void*>));
 }
 
+TEST_F(NodeTest, InlineNodeByteSize) {
+    typedef InlineNode<uint64_t, void*> TimeNode;
+    typedef InlineNode<Slice, void*> KeyNode;
+    ASSERT_EQ(24u, TimeNode::HeaderSize());
+    ASSERT_EQ(32u, KeyNode::HeaderSize());
+    ASSERT_EQ(24u + 12 * 8, TimeNode::ByteSize(12));
+    uint64_t key = 1;
+    void* value = nullptr;
+    TimeNode* node = TimeNode::New(key, value, 4, nullptr);
+    TimeNode* node2 = TimeNode::New(key, value, 4, nullptr);
+    for (uint8_t i = 0; i < node->Height(); i++) {
+        ASSERT_TRUE(node->GetNext(i) == nullptr);
+    }
+    node->SetNext(3, node2);
+    ASSERT_EQ(node2, node->GetNext(3));
+    ASSERT_TRUE(node->GetNext(2) == nullptr);
+    TimeNode::Free(node, nullptr);
+    TimeNode::Free(node2, nullptr);
+}
+
+TEST_F(SkiplistTest, InlineNode) {
+    typedef Skiplist<uint32_t, uint32_t, DescComparator, InlineNode<uint32_t, uint32_t>> InlineList;
+    DescComparator cmp;
+    SlabAllocator slab;
+    for (auto height : vec) {
+        for (SlabAllocator* cur_slab : {static_cast<SlabAllocator*>(nullptr), &slab}) {
+            InlineList sl(height, 4, cmp);
+            for (uint32_t i = 0; i < 100; i++) {
+                sl.Insert(i, i, cur_slab);
+            }
+            ASSERT_EQ(100u, sl.GetSize());
+            InlineList::Iterator* it = sl.NewIterator();
+            it->Seek(50);
+            for (uint32_t i = 50; i > 0; i--) {
+                ASSERT_TRUE(it->Valid());
+                ASSERT_EQ(i, it->GetKey());
+                it->Next();
+            }
+            ASSERT_EQ(0u, it->GetKey());
+            delete it;
+            InlineNode<uint32_t, uint32_t>* node = sl.Split(10);
+            uint32_t cnt = 0;
+            while (node != NULL) {
+                InlineNode<uint32_t, uint32_t>* tmp = node;
+                node = node->GetNextNoBarrier(0);
+                InlineList::FreeNode(tmp, cur_slab);
+                cnt++;
+            }
+            ASSERT_EQ(11u, cnt);
+            ASSERT_EQ(11u, sl.GetLast()->GetKey());
+            ASSERT_EQ(89u, sl.Clear(cur_slab));
+        }
+    }
+    ASSERT_EQ(0u, slab.GetUsedByteSize());
+}
+
 TEST_F(NodeTest, SliceTest) {
     SliceComparator cmp;
     Skiplist<Slice, KE*, SliceComparator> sl(12, 4, cmp);
@@ -663,6 +720,119 @@ TEST_F(SkiplistTest, Duplicate) {
     ASSERT_FALSE(it->Valid());
 }
 
+TEST_F(SkiplistTest, ConcurrentInsert) {
+    typedef Skiplist<uint32_t, uint32_t, DescComparator, InlineNode<uint32_t, uint32_t>> InlineList;
+    DescComparator cmp;
+    SlabAllocator slab;
+    InlineList sl(12, 4, cmp);
+    uint32_t thread_num = 8;
+    uint32_t key_num = 10000;
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&sl, &slab, i, thread_num, key_num] {
+            for (uint32_t key = i; key < key_num; key += thread_num) {
+                // every key is inserted twice
+                uint32_t value = key;
+                sl.ConcurrentInsert(key, value, &slab);
+                sl.ConcurrentInsert(key, value, &slab);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(key_num * 2, sl.GetSize());
+    InlineList::Iterator* it = sl.NewIterator();
+    it->SeekToFirst();
+    uint32_t expect = key_num * 2 - 1;
+    while (it->Valid()) {
+        ASSERT_EQ(expect / 2, it->GetKey());
+        ASSERT_EQ(expect / 2, it->GetValue());
+        it->Next();
+        expect--;
+    }
+    it->Seek(100);
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(100u, it->GetKey());
+    delete it;
+    ASSERT_EQ(0u, sl.GetLast()->GetKey());
+    ASSERT_EQ(key_num * 2, sl.Clear(&slab));
+    ASSERT_EQ(0u, slab.GetUsedByteSize());
+}
+
+TEST_F(SkiplistTest, ConcurrentInsertIfAbsent) {
+    typedef Skiplist<uint32_t, uint32_t, Comparator, InlineNode<uint32_t, uint32_t>> InlineList;
+    Comparator cmp;
+    InlineList sl(12, 4, cmp);
+    uint32_t thread_num = 8;
+    uint32_t key_num = 1000;
+    std::vector<uint32_t> inserted(thread_num, 0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&sl, &inserted, i, key_num] {
+            for (uint32_t key = 0; key < key_num; key++) {
+                uint32_t value = key * 10 + i;
+                if (sl.ConcurrentInsertIfAbsent(key, value) > 0) {
+                    inserted[i]++;
+                } else {
+                    ASSERT_EQ(key, value / 10);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    uint32_t total = 0;
+    for (auto cnt : inserted) {
+        total += cnt;
+    }
+    ASSERT_EQ(key_num, total);
+    ASSERT_EQ(key_num, sl.GetSize());
+    uint32_t value = 0;
+    ASSERT_EQ(0, sl.Get(500, value));
+    ASSERT_EQ(500u, value / 10);
+    ASSERT_EQ(key_num - 1, sl.GetLast()->GetKey());
+}
+
+TEST_F(SkiplistTest, Appender) {
+    typedef Skiplist<uint32_t, uint32_t, DescComparator, InlineNode<uint32_t, uint32_t>> InlineList;
+    DescComparator cmp;
+    InlineList sl(12, 4, cmp);
+    uint32_t value = 0;
+    sl.Insert(1000, value);
+    InlineList::Appender appender(&sl);
+    for (uint32_t key = 999; key > 0; key--) {
+        value = key;
+        ASSERT_GT(appender.Append(key, value), 0);
+    }
+    // the key is greater than the last one
+    ASSERT_EQ(0, appender.Append(10, value));
+    ASSERT_EQ(1000u, sl.GetSize());
+    ASSERT_EQ(1u, sl.GetLast()->GetKey());
+    InlineList::Iterator* it = sl.NewIterator();
+    it->SeekToFirst();
+    uint32_t expect = 1000;
+    while (it->Valid()) {
+        ASSERT_EQ(expect, it->GetKey());
+        it->Next();
+        expect--;
+    }
+    ASSERT_EQ(0u, expect);
+    for (uint32_t key = 1; key < 1000; key += 7) {
+        it->Seek(key);
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(key, it->GetKey());
+    }
+    delete it;
+    // the list can be appended again after it's changed
+    sl.Insert(0, value);
+    InlineList::Appender appender2(&sl);
+    ASSERT_GT(appender2.Append(0, value), 0);
+    ASSERT_EQ(1002u, sl.GetSize());
+    ASSERT_EQ(1002u, sl.Clear());
+}
+
 }  // namespace base
 }  // namespace openmldb
 
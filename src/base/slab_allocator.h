@@ -0,0 +1,227 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_SLAB_ALLOCATOR_H_
+#define SRC_BASE_SLAB_ALLOCATOR_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "base/spinlock.h"
+
+namespace openmldb {
+namespace base {
+
+// SlabAllocator carves small objects out of large chunks. The request size is rounded up
+// to a size class and a freed block is pushed to the free list of its class for reuse.
+// Chunks are only given back when the allocator is destroyed.
+// A block which may still be visible to readers can be retired with a version, it will be
+// moved to the free list by Reclaim once the version is safe.
+class SlabAllocator {
+ public:
+    static constexpr uint32_t kDefaultChunkSize = 1024 * 1024;
+    // request larger than kMaxSlabSize is served by new directly
+    static constexpr uint32_t kMaxSlabSize = 8192;
+
+    explicit SlabAllocator(uint32_t chunk_size = kDefaultChunkSize)
+        : chunk_size_(std::max(chunk_size, kMaxSlabSize)),
+          cur_(nullptr),
+          left_(0),
+          retired_head_(nullptr),
+          retired_tail_(nullptr),
+          used_byte_size_(0),
+          reserved_byte_size_(0) {
+        for (uint32_t size = kAlignment; size <= kSmallSlabSize; size += kAlignment) {
+            class_size_.push_back(size);
+        }
+        // four classes between two powers of two
+        for (uint32_t size = kSmallSlabSize * 2; size <= kMaxSlabSize; size *= 2) {
+            uint32_t step = size / 8;
+            for (uint32_t cur = size / 2 + step; cur <= size; cur += step) {
+                class_size_.push_back(cur);
+            }
+        }
+        free_list_.resize(class_size_.size(), nullptr);
+    }
+
+    ~SlabAllocator() {
+        for (char* chunk : chunks_) {
+            delete[] chunk;
+        }
+        chunks_.clear();
+    }
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    void* Allocate(uint32_t size) {
+        if (size > kMaxSlabSize) {
+            used_byte_size_.fetch_add(size, std::memory_order_relaxed);
+            return new char[size];
+        }
+        uint32_t idx = SizeClass(size);
+        uint32_t block_size = class_size_[idx];
+        std::lock_guard<SpinMutex> lock(mu_);
+        used_byte_size_.fetch_add(block_size, std::memory_order_relaxed);
+        FreeBlock* block = free_list_[idx];
+        if (block != nullptr) {
+            free_list_[idx] = block->next;
+            return block;
+        }
+        if (left_ < block_size) {
+            cur_ = new char[chunk_size_];
+            left_ = chunk_size_;
+            chunks_.push_back(cur_);
+            reserved_byte_size_.fetch_add(chunk_size_, std::memory_order_relaxed);
+        }
+        char* result = cur_;
+        cur_ += block_size;
+        left_ -= block_size;
+        return result;
+    }
+
+    // the size must be the same as the one passed to Allocate
+    void Free(void* ptr, uint32_t size) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (size > kMaxSlabSize) {
+            used_byte_size_.fetch_sub(size, std::memory_order_relaxed);
+            delete[] static_cast<char*>(ptr);
+            return;
+        }
+        std::lock_guard<SpinMutex> lock(mu_);
+        FreeUnlock(ptr, size);
+    }
+
+    // Retire a block that can not be reused until Reclaim is called with a version not less than
+    // the given one. The version should not decrease between two calls.
+    void Retire(void* ptr, uint32_t size, uint64_t version) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (size < sizeof(RetiredBlock)) {
+            // too small to hold the retired info
+            Free(ptr, size);
+            return;
+        }
+        RetiredBlock* block = static_cast<RetiredBlock*>(ptr);
+        block->next = nullptr;
+        block->version = version;
+        block->size = size;
+        std::lock_guard<SpinMutex> lock(mu_);
+        if (retired_tail_ == nullptr) {
+            retired_head_ = block;
+        } else {
+            retired_tail_->next = block;
+        }
+        retired_tail_ = block;
+    }
+
+    // Free all retired blocks whose version is not greater than the given one
+    uint64_t Reclaim(uint64_t version) {
+        uint64_t cnt = 0;
+        RetiredBlock* large_block = nullptr;
+        {
+            std::lock_guard<SpinMutex> lock(mu_);
+            while (retired_head_ != nullptr && retired_head_->version <= version) {
+                RetiredBlock* block = retired_head_;
+                retired_head_ = block->next;
+                if (block->size > kMaxSlabSize) {
+                    block->next = large_block;
+                    large_block = block;
+                } else {
+                    FreeUnlock(block, block->size);
+                }
+                cnt++;
+            }
+            if (retired_head_ == nullptr) {
+                retired_tail_ = nullptr;
+            }
+        }
+        while (large_block != nullptr) {
+            RetiredBlock* block = large_block;
+            large_block = block->next;
+            Free(block, block->size);
+        }
+        return cnt;
+    }
+
+    // the byte size of blocks in use, including the retired blocks
+    uint64_t GetUsedByteSize() const { return used_byte_size_.load(std::memory_order_relaxed); }
+
+    // the byte size of chunks allocated from system
+    uint64_t GetReservedByteSize() const { return reserved_byte_size_.load(std::memory_order_relaxed); }
+
+    // the real byte size of the block which serves the request size
+    uint32_t GetBlockSize(uint32_t size) const {
+        if (size > kMaxSlabSize) {
+            return size;
+        }
+        return class_size_[SizeClass(size)];
+    }
+
+ private:
+    static constexpr uint32_t kAlignment = 8;
+    static constexpr uint32_t kSmallSlabSize = 256;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct RetiredBlock {
+        RetiredBlock* next;
+        uint64_t version;
+        uint32_t size;
+    };
+
+    uint32_t SizeClass(uint32_t size) const {
+        if (size <= kSmallSlabSize) {
+            return size == 0 ? 0 : (size + kAlignment - 1) / kAlignment - 1;
+        }
+        return std::lower_bound(class_size_.begin(), class_size_.end(), size) - class_size_.begin();
+    }
+
+    void FreeUnlock(void* ptr, uint32_t size) {
+        uint32_t idx = SizeClass(size);
+        used_byte_size_.fetch_sub(class_size_[idx], std::memory_order_relaxed);
+        FreeBlock* block = static_cast<FreeBlock*>(ptr);
+        block->next = free_list_[idx];
+        free_list_[idx] = block;
+    }
+
+ private:
+    uint32_t const chunk_size_;
+    std::vector<uint32_t> class_size_;
+    std::vector<FreeBlock*> free_list_;
+    std::vector<char*> chunks_;
+    char* cur_;
+    uint32_t left_;
+    RetiredBlock* retired_head_;
+    RetiredBlock* retired_tail_;
+    SpinMutex mu_;
+    std::atomic<uint64_t> used_byte_size_;
+    std::atomic<uint64_t> reserved_byte_size_;
+};
+
+}  // namespace base
+}  // namespace openmldb
+
+#endif  // SRC_BASE_SLAB_ALLOCATOR_H_
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/slab_allocator.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "base/skiplist.h"
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace base {
+
+class SlabAllocatorTest : public ::testing::Test {
+ public:
+    SlabAllocatorTest() {}
+    ~SlabAllocatorTest() {}
+};
+
+struct Comparator {
+    int operator()(const uint64_t a, const uint64_t b) const {
+        if (a > b) {
+            return 1;
+        } else if (a == b) {
+            return 0;
+        }
+        return -1;
+    }
+};
+
+TEST_F(SlabAllocatorTest, SizeClass) {
+    SlabAllocator slab;
+    ASSERT_EQ(8u, slab.GetBlockSize(1));
+    ASSERT_EQ(40u, slab.GetBlockSize(40));
+    ASSERT_EQ(48u, slab.GetBlockSize(41));
+    ASSERT_EQ(256u, slab.GetBlockSize(256));
+    ASSERT_EQ(320u, slab.GetBlockSize(257));
+    ASSERT_EQ(1024u, slab.GetBlockSize(1000));
+    ASSERT_EQ(8192u, slab.GetBlockSize(8000));
+    ASSERT_EQ(10000u, slab.GetBlockSize(10000));
+}
+
+TEST_F(SlabAllocatorTest, AllocateAndFree) {
+    SlabAllocator slab(64 * 1024);
+    std::vector<char*> blocks;
+    for (uint32_t i = 1; i <= 1000; i++) {
+        char* buf = static_cast<char*>(slab.Allocate(i));
+        memset(buf, i % 128, i);
+        blocks.push_back(buf);
+    }
+    for (uint32_t i = 1; i <= 1000; i++) {
+        ASSERT_EQ(static_cast<char>(i % 128), blocks[i - 1][i - 1]);
+    }
+    uint64_t reserved = slab.GetReservedByteSize();
+    ASSERT_GT(slab.GetUsedByteSize(), 0u);
+    for (uint32_t i = 1; i <= 1000; i++) {
+        slab.Free(blocks[i - 1], i);
+    }
+    ASSERT_EQ(0u, slab.GetUsedByteSize());
+    // freed blocks are reused
+    for (uint32_t i = 1; i <= 1000; i++) {
+        blocks[i - 1] = static_cast<char*>(slab.Allocate(i));
+    }
+    ASSERT_EQ(reserved, slab.GetReservedByteSize());
+    for (uint32_t i = 1; i <= 1000; i++) {
+        slab.Free(blocks[i - 1], i);
+    }
+    void* large = slab.Allocate(SlabAllocator::kMaxSlabSize + 1);
+    ASSERT_EQ(SlabAllocator::kMaxSlabSize + 1, slab.GetUsedByteSize());
+    slab.Free(large, SlabAllocator::kMaxSlabSize + 1);
+    ASSERT_EQ(0u, slab.GetUsedByteSize());
+}
+
+TEST_F(SlabAllocatorTest, RetireAndReclaim) {
+    SlabAllocator slab;
+    void* b1 = slab.Allocate(64);
+    void* b2 = slab.Allocate(64);
+    void* b3 = slab.Allocate(SlabAllocator::kMaxSlabSize * 2);
+    slab.Retire(b1, 64, 1);
+    slab.Retire(b2, 64, 2);
+    slab.Retire(b3, SlabAllocator::kMaxSlabSize * 2, 3);
+    ASSERT_EQ(128u + SlabAllocator::kMaxSlabSize * 2, slab.GetUsedByteSize());
+    ASSERT_EQ(0u, slab.Reclaim(0));
+    ASSERT_EQ(1u, slab.Reclaim(1));
+    // the retired block is not reused before reclaimed
+    void* b4 = slab.Allocate(64);
+    ASSERT_EQ(b1, b4);
+    ASSERT_EQ(2u, slab.Reclaim(10));
+    ASSERT_EQ(64u, slab.GetUsedByteSize());
+    slab.Free(b4, 64);
+    ASSERT_EQ(0u, slab.Reclaim(10));
+}
+
+TEST_F(SlabAllocatorTest, Skiplist) {
+    SlabAllocator slab;
+    Comparator cmp;
+    Skiplist<uint64_t, uint64_t, Comparator> sl(12, 4, cmp);
+    for (uint64_t i = 0; i < 1000; i++) {
+        sl.Insert(i, i, &slab);
+    }
+    ASSERT_EQ(1000u, sl.GetSize());
+    Skiplist<uint64_t, uint64_t, Comparator>::Iterator* it = sl.NewIterator();
+    it->Seek(500);
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(500u, it->GetValue());
+    delete it;
+    ASSERT_GT(slab.GetUsedByteSize(), 0u);
+    Node<uint64_t, uint64_t>* node = sl.Split(499);
+    while (node != NULL) {
+        Node<uint64_t, uint64_t>* tmp = node;
+        node = node->GetNextNoBarrier(0);
+        Skiplist<uint64_t, uint64_t, Comparator>::RetireNode(tmp, &slab, 1);
+    }
+    ASSERT_EQ(501u, slab.Reclaim(1));
+    ASSERT_EQ(499u, sl.Clear(&slab));
+    ASSERT_EQ(0u, slab.GetUsedByteSize());
+}
+
+}  // namespace base
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -361,12 +361,14 @@ std::unique_ptr<::hybridse::codec::RowIterator> DistributeWindowIterator::GetVal
     auto traverse_it = std::dynamic_pointer_cast<openmldb::base::TraverseKvIterator>(kv_it_);
     if (traverse_it) {
         auto response = std::dynamic_pointer_cast<::openmldb::api::TraverseResponse>(traverse_it->GetResponse());
-        auto new_traverse_it = std::make_shared<openmldb::base::TraverseKvIterator>(response);
+        auto new_traverse_it =
+            std::make_shared<openmldb::base::TraverseKvIterator>(response, traverse_it->GetAttachment());
         new_traverse_it->Seek(traverse_it->GetPK());
         return new RemoteWindowIterator(tid_, cur_pid_, index_name_, new_traverse_it, tablet_clients_[cur_pid_]);
     } else {
         auto response = std::dynamic_pointer_cast<::openmldb::api::ScanResponse>(kv_it_->GetResponse());
-        auto scan_it = std::make_shared<openmldb::base::ScanKvIterator>(kv_it_->GetPK(), response);
+        auto scan_it =
+            std::make_shared<openmldb::base::ScanKvIterator>(kv_it_->GetPK(), response, kv_it_->GetAttachment());
         return new RemoteWindowIterator(tid_, cur_pid_, index_name_, scan_it, tablet_clients_[cur_pid_]);
     }
 }
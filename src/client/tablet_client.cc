@@ -71,13 +71,15 @@ bool TabletClient::Query(const std::string& db, const std::string& sql, const st
 bool TabletClient::Query(const std::string& db, const std::string& sql,
                          const std::vector<openmldb::type::DataType>& parameter_types,
                          const std::string& parameter_row,
-                         brpc::Controller* cntl, ::openmldb::api::QueryResponse* response, const bool is_debug) {
+                         brpc::Controller* cntl, ::openmldb::api::QueryResponse* response, const bool is_debug,
+                         const bool stream_result) {
     if (cntl == NULL || response == NULL) return false;
     ::openmldb::api::QueryRequest request;
     request.set_sql(sql);
     request.set_db(db);
     request.set_is_batch(true);
     request.set_is_debug(is_debug);
+    request.set_stream_result(stream_result);
     request.set_parameter_row_size(parameter_row.size());
     request.set_parameter_row_slices(1);
     for (auto& type : parameter_types) {
@@ -261,6 +263,63 @@ bool TabletClient::Put(uint32_t tid, uint32_t pid, uint64_t time, const std::str
     return false;
 }
 
+static void PackPutBatch(uint64_t time, const std::vector<const std::string*>& values,
+                         const std::vector<const std::vector<std::pair<std::string, uint32_t>>*>& dimensions,
+                         ::openmldb::api::PutBatchRequest* request, butil::IOBuf* io_buf) {
+    for (size_t i = 0; i < values.size(); i++) {
+        auto* row = request->add_rows();
+        row->set_time(time);
+        row->set_size(values[i]->size());
+        for (const auto& dim : *dimensions[i]) {
+            auto* d = row->add_dimensions();
+            d->set_key(dim.first);
+            d->set_idx(dim.second);
+        }
+        io_buf->append(*values[i]);
+    }
+}
+
+bool TabletClient::PutBatch(uint32_t tid, uint32_t pid, uint64_t time, const std::vector<const std::string*>& values,
+                            const std::vector<const std::vector<std::pair<std::string, uint32_t>>*>& dimensions,
+                            uint32_t* put_cnt) {
+    if (put_cnt == NULL || values.size() != dimensions.size()) {
+        return false;
+    }
+    *put_cnt = 0;
+    ::openmldb::api::PutBatchRequest request;
+    request.set_tid(tid);
+    request.set_pid(pid);
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(FLAGS_request_timeout_ms);
+    PackPutBatch(time, values, dimensions, &request, &cntl.request_attachment());
+    ::openmldb::api::PutBatchResponse response;
+    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::PutBatch, &cntl, &request, &response);
+    if (!ok) {
+        return false;
+    }
+    *put_cnt = response.put_cnt();
+    if (response.code() == 0) {
+        return true;
+    }
+    LOG(WARNING) << "fail to put batch for " << response.msg() << " and error code " << response.code();
+    return false;
+}
+
+bool TabletClient::PutBatch(uint32_t tid, uint32_t pid, uint64_t time, const std::vector<const std::string*>& values,
+                            const std::vector<const std::vector<std::pair<std::string, uint32_t>>*>& dimensions,
+                            brpc::Controller* cntl, ::openmldb::api::PutBatchResponse* response,
+                            google::protobuf::Closure* done) {
+    if (cntl == NULL || response == NULL || done == NULL || values.size() != dimensions.size()) {
+        return false;
+    }
+    ::openmldb::api::PutBatchRequest request;
+    request.set_tid(tid);
+    request.set_pid(pid);
+    PackPutBatch(time, values, dimensions, &request, &cntl->request_attachment());
+    // the request is serialized before the call returns
+    return client_.SendRequest(&::openmldb::api::TabletServer_Stub::PutBatch, cntl, &request, response, done);
+}
+
 bool TabletClient::Put(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time, const std::string& value) {
     ::openmldb::api::PutRequest request;
     auto dim = request.add_dimensions();
@@ -591,16 +650,18 @@ std::shared_ptr<openmldb::base::ScanKvIterator> TabletClient::Scan(uint32_t tid,
     }
     request.set_limit(limit);
     request.set_skip_record_num(skip_record_num);
+    request.set_pairs_in_attachment(true);
     auto response = std::make_shared<openmldb::api::ScanResponse>();
-    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Scan, &request, response.get(),
-                FLAGS_request_timeout_ms, 1);
+    auto attachment = std::make_shared<butil::IOBuf>();
+    bool ok = client_.SendRequestGetAttachment(&::openmldb::api::TabletServer_Stub::Scan, &request, response.get(),
+                FLAGS_request_timeout_ms, 1, attachment.get());
     if (response->has_msg()) {
         msg = response->msg();
     }
     if (!ok || response->code() != 0) {
         return {};
     }
-    return std::make_shared<::openmldb::base::ScanKvIterator>(pk, response);
+    return std::make_shared<::openmldb::base::ScanKvIterator>(pk, response, attachment);
 }
 
 std::shared_ptr<openmldb::base::ScanKvIterator> TabletClient::Scan(uint32_t tid, uint32_t pid,
@@ -899,13 +960,16 @@ std::shared_ptr<openmldb::base::TraverseKvIterator> TabletClient::Traverse(uint3
         request.set_ts(ts);
     }
     request.set_skip_current_pk(skip_current_pk);
-    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Traverse, &request, response.get(),
-                                  FLAGS_request_timeout_ms, FLAGS_request_max_retry);
+    request.set_pairs_in_attachment(true);
+    auto attachment = std::make_shared<butil::IOBuf>();
+    bool ok = client_.SendRequestGetAttachment(&::openmldb::api::TabletServer_Stub::Traverse, &request,
+                                               response.get(), FLAGS_request_timeout_ms, FLAGS_request_max_retry,
+                                               attachment.get());
     if (!ok || response->code() != 0) {
         return {};
     }
     count = response->count();
-    return std::make_shared<openmldb::base::TraverseKvIterator>(response);
+    return std::make_shared<openmldb::base::TraverseKvIterator>(response, attachment);
 }
 
 bool TabletClient::SetMode(bool mode) {
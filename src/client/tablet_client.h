@@ -67,9 +67,12 @@ class TabletClient : public Client {
                                     const openmldb::common::VersionPair& pair,
                                     std::string& msg);  // NOLINT
 
+    // the rows are pushed to the stream created on cntl if stream_result is set and the tablet supports it,
+    // see QueryResponse.stream_result
     bool Query(const std::string& db, const std::string& sql,
                const std::vector<openmldb::type::DataType>& parameter_types, const std::string& parameter_row,
-               brpc::Controller* cntl, ::openmldb::api::QueryResponse* response, const bool is_debug = false);
+               brpc::Controller* cntl, ::openmldb::api::QueryResponse* response, const bool is_debug = false,
+               const bool stream_result = false);
 
     bool Query(const std::string& db, const std::string& sql, const std::string& row, brpc::Controller* cntl,
                ::openmldb::api::QueryResponse* response, const bool is_debug = false);
@@ -83,6 +86,18 @@ class TabletClient : public Client {
     bool Put(uint32_t tid, uint32_t pid, uint64_t time, const std::string& value,
              const std::vector<std::pair<std::string, uint32_t>>& dimensions);
 
+    // put the rows with the same time in one request, dimensions[i] is the dimensions of values[i].
+    // the rows are put in order and put_cnt is the count of rows put, it's less than values.size() if failed
+    bool PutBatch(uint32_t tid, uint32_t pid, uint64_t time, const std::vector<const std::string*>& values,
+                  const std::vector<const std::vector<std::pair<std::string, uint32_t>>*>& dimensions,
+                  uint32_t* put_cnt);
+
+    // the async version, done is run when the response comes back
+    bool PutBatch(uint32_t tid, uint32_t pid, uint64_t time, const std::vector<const std::string*>& values,
+                  const std::vector<const std::vector<std::pair<std::string, uint32_t>>*>& dimensions,
+                  brpc::Controller* cntl, ::openmldb::api::PutBatchResponse* response,
+                  google::protobuf::Closure* done);
+
     bool Get(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time, std::string& value,  // NOLINT
              uint64_t& ts,                                                                          // NOLINT
              std::string& msg);                        ;                                             // NOLINT
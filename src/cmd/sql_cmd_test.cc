@@ -392,6 +392,37 @@ TEST_F(SqlCmdTest, LoadData) {
     unlink(file_name.c_str());
 }
 
+TEST_F(SqlCmdTest, LoadDataMultiThread) {
+    sr = standalone_cli.sr;
+    cs = standalone_cli.cs;
+    HandleSQL("create database test1;");
+    HandleSQL("use test1;");
+    std::string create_sql = "create table trans (c1 string, c2 int);";
+    HandleSQL(create_sql);
+    std::string file_name = "./myfile_multi_thread.csv";
+    std::ofstream ofile;
+    ofile.open(file_name);
+    ofile << "c1,c2" << std::endl;
+    for (int i = 0; i < 3000; i++) {
+        ofile << "aa" << i % 100 << "," << i << std::endl;
+    }
+    // the last line has no line end
+    ofile << "bb,3000";
+    ofile.close();
+    std::string load_sql = "LOAD DATA INFILE '" + file_name + "' INTO TABLE trans OPTIONS(thread=4);";
+    hybridse::sdk::Status status;
+    sr->ExecuteSQL(load_sql, &status);
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+    auto result = sr->ExecuteSQL("select * from trans;", &status);
+    ASSERT_TRUE(status.IsOK());
+    ASSERT_EQ(3001, result->Size());
+    sr->ExecuteSQL("LOAD DATA INFILE '" + file_name + "' INTO TABLE trans OPTIONS(thread=0);", &status);
+    ASSERT_FALSE(status.IsOK());
+    HandleSQL("drop table trans;");
+    HandleSQL("drop database test1;");
+    unlink(file_name.c_str());
+}
+
 TEST_P(DBSDKTest, Deploy) {
     auto cli = GetParam();
     cs = cli->cs;
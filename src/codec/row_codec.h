@@ -211,15 +211,22 @@ __attribute__((unused)) static bool DecodeRows(const std::string& data, uint32_t
     return true;
 }
 
-static inline void Encode(uint64_t time, const char* data, const size_t size, char* buffer, uint32_t offset) {
-    buffer += offset;
+// the header of a pair, it's followed by the row of size
+static constexpr uint32_t PAIR_HEADER_SIZE = 4 + 8;
+
+static inline void EncodeHeader(uint64_t time, const size_t size, char* buffer) {
     uint32_t total_size = 8 + size;
     memcpy(buffer, static_cast<const void*>(&total_size), 4);
     memrev32ifbe(buffer);
     buffer += 4;
     memcpy(buffer, static_cast<const void*>(&time), 8);
     memrev64ifbe(buffer);
-    buffer += 8;
+}
+
+static inline void Encode(uint64_t time, const char* data, const size_t size, char* buffer, uint32_t offset) {
+    buffer += offset;
+    EncodeHeader(time, size, buffer);
+    buffer += PAIR_HEADER_SIZE;
     memcpy(buffer, static_cast<const void*>(data), size);
 }
 
@@ -279,10 +286,10 @@ static inline int32_t EncodeRows(const boost::container::deque<std::pair<uint64_
     return total_size;
 }
 
-// encode pk, ts and value
-static inline void EncodeFull(const std::string& pk, uint64_t time, const char* data, const size_t size, char* buffer,
-                              uint32_t offset) {
-    buffer += offset;
+// the header of a pair with pk is followed by the pk and the row of size
+static constexpr uint32_t FULL_PAIR_HEADER_SIZE = 4 + 4 + 8;
+
+static inline void EncodeFullHeader(const std::string& pk, uint64_t time, const size_t size, char* buffer) {
     uint32_t pk_size = pk.length();
     uint32_t total_size = 8 + pk_size + size;
     DEBUGLOG("encode total size %u pk size %u", total_size, pk_size);
@@ -294,9 +301,16 @@ static inline void EncodeFull(const std::string& pk, uint64_t time, const char*
     buffer += 4;
     memcpy(buffer, static_cast<const void*>(&time), 8);
     memrev64ifbe(buffer);
-    buffer += 8;
-    memcpy(buffer, static_cast<const void*>(pk.c_str()), pk_size);
-    buffer += pk_size;
+}
+
+// encode pk, ts and value
+static inline void EncodeFull(const std::string& pk, uint64_t time, const char* data, const size_t size, char* buffer,
+                              uint32_t offset) {
+    buffer += offset;
+    EncodeFullHeader(pk, time, size, buffer);
+    buffer += FULL_PAIR_HEADER_SIZE;
+    memcpy(buffer, static_cast<const void*>(pk.c_str()), pk.length());
+    buffer += pk.length();
     memcpy(buffer, static_cast<const void*>(data), size);
 }
 static inline void EncodeFull(const std::string& pk, uint64_t time, const DataBlock* data, char* buffer,
@@ -16,6 +16,8 @@
 
 #include "codec/sql_rpc_row_codec.h"
 
+#include <cstring>
+
 namespace openmldb {
 namespace codec {
 
@@ -105,5 +107,29 @@ bool EncodeRpcRow(const int8_t* buf, size_t size, butil::IOBuf* io_buf) {
     return true;
 }
 
+void EncodeQueryStreamHeader(int32_t code, uint32_t count, uint32_t byte_size, butil::IOBuf* buf) {
+    char header[QUERY_STREAM_HEADER_SIZE];
+    memcpy(header, &code, 4);
+    memcpy(header + 4, &count, 4);
+    memcpy(header + 8, &byte_size, 4);
+    buf->append(header, QUERY_STREAM_HEADER_SIZE);
+}
+
+bool DecodeQueryStreamHeader(butil::IOBuf* buf, int32_t* code, uint32_t* count, uint32_t* byte_size) {
+    char header[QUERY_STREAM_HEADER_SIZE];
+    if (buf->cutn(header, QUERY_STREAM_HEADER_SIZE) != QUERY_STREAM_HEADER_SIZE) {
+        LOG(WARNING) << "query stream message is too short";
+        return false;
+    }
+    memcpy(code, header, 4);
+    memcpy(count, header + 4, 4);
+    memcpy(byte_size, header + 8, 4);
+    if (buf->size() != *byte_size) {
+        LOG(WARNING) << "query stream message size mismatch " << buf->size() << ", expect " << *byte_size;
+        return false;
+    }
+    return true;
+}
+
 }  // namespace codec
 }  // namespace openmldb
@@ -37,6 +37,15 @@ bool EncodeRpcRow(const hybridse::codec::Row& row, butil::IOBuf* buf, size_t* to
 
 bool EncodeRpcRow(const int8_t* buf, size_t size, butil::IOBuf* io_buf);
 
+// a message of the query result stream is a header {int32 code, uint32 count, uint32 byte_size} followed by
+// byte_size bytes of count rows, or of the error msg if code is not 0. a message without rows ends the stream
+constexpr size_t QUERY_STREAM_HEADER_SIZE = 12;
+
+void EncodeQueryStreamHeader(int32_t code, uint32_t count, uint32_t byte_size, butil::IOBuf* buf);
+
+// the header is cut from buf
+bool DecodeQueryStreamHeader(butil::IOBuf* buf, int32_t* code, uint32_t* count, uint32_t* byte_size);
+
 }  // namespace codec
 }  // namespace openmldb
 #endif  // SRC_CODEC_SQL_RPC_ROW_CODEC_H_
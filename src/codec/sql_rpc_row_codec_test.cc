@@ -123,6 +123,30 @@ TEST_F(SqlRpcRowCodecTest, TestMultiSlice) {
     ASSERT_EQ(0, decoded.size(3));
 }
 
+TEST_F(SqlRpcRowCodecTest, TestQueryStreamHeader) {
+    butil::IOBuf iobuf;
+    EncodeQueryStreamHeader(0, 2, 10, &iobuf);
+    iobuf.append("0123456789");
+    ASSERT_EQ(QUERY_STREAM_HEADER_SIZE + 10, iobuf.size());
+    int32_t code = -1;
+    uint32_t count = 0;
+    uint32_t byte_size = 0;
+    ASSERT_TRUE(DecodeQueryStreamHeader(&iobuf, &code, &count, &byte_size));
+    ASSERT_EQ(0, code);
+    ASSERT_EQ(2u, count);
+    ASSERT_EQ(10u, byte_size);
+    ASSERT_EQ("0123456789", iobuf.to_string());
+
+    // the size of rows mismatches
+    iobuf.clear();
+    EncodeQueryStreamHeader(0, 2, 10, &iobuf);
+    iobuf.append("01234");
+    ASSERT_FALSE(DecodeQueryStreamHeader(&iobuf, &code, &count, &byte_size));
+    iobuf.clear();
+    iobuf.append("0123");
+    ASSERT_FALSE(DecodeQueryStreamHeader(&iobuf, &code, &count, &byte_size));
+}
+
 }  // namespace codec
 }  // namespace openmldb
 
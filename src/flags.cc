@@ -49,10 +49,17 @@ DEFINE_uint32(replica_num, 3, "config the default replica_num. if set 3, there i
 DEFINE_uint32(system_table_replica_num, 1, "config the default replica_num of system table.");
 DEFINE_int32(gc_interval, 120, "the gc interval of tablet every two hour");
 DEFINE_int32(disk_gc_interval, 120, "the rocksdb gc interval of tablet");
+DEFINE_bool(disk_gc_compact_range, false,
+            "compact the whole indexes with latest ttl of the disk tables on every gc. if false, the expired rows "
+            "are only dropped by the background compactions");
 DEFINE_int32(gc_pool_size, 2, "the size of tablet gc thread pool");
+DEFINE_uint32(gc_segment_thread_num, 1,
+              "the number of threads to gc the segments of a memtable index in parallel, 1 means in the gc thread");
+DEFINE_uint32(gc_cpu_percent, 100, "the max cpu percent a memtable gc thread takes, 100 means no limit");
 DEFINE_int32(gc_safe_offset, 1, "the safe offset of tablet gc in minute");
 DEFINE_uint64(gc_on_table_recover_count, 10000000, "make a gc on recover count");
-DEFINE_uint32(gc_deleted_pk_version_delta, 2, "config the gc version delta");
+DEFINE_uint32(gc_deleted_pk_version_delta, 2, "deprecated, the deleted keys are freed by the epoch reclaim");
+DEFINE_uint32(epoch_reclaim_interval_ms, 100, "the interval to free the memory retired by memtable gc");
 DEFINE_double(mem_release_rate, 5, "specify memory release rate, which should be in 0 ~ 10");
 DEFINE_int32(task_pool_size, 3, "the size of tablet task thread pool");
 DEFINE_int32(io_pool_size, 2, "the size of tablet io task thread pool");
@@ -64,6 +71,29 @@ DEFINE_string(bucket_size, "1d", "the default bucket size in pre-aggr table");
 
 // scan configuration
 DEFINE_uint32(scan_max_bytes_size, 2 * 1024 * 1024, "config the max size of scan bytes size");
+DEFINE_uint32(zero_copy_min_row_size, 512,
+              "the rows of memtable not smaller than it are sent in the attachment of scan and traverse without copying");
+DEFINE_uint32(zero_copy_max_pinned_mb, 256, "the rows are copied once the rows sent without copying reach it in MB");
+DEFINE_uint32(zero_copy_max_pin_ms, 3000,
+              "the rows are copied once a response sent without copying is not released for longer than it in ms");
+DEFINE_int32(stream_query_pool_size, 4, "the size of tablet thread pool for pushing the rows of streaming batch query");
+DEFINE_uint32(stream_query_chunk_size, 1024 * 1024, "the bytes of rows in a message of streaming batch query");
+DEFINE_bool(enable_shared_jit, false,
+            "share one jit and the compiled objects between all the sql compilations, the deployments always share "
+            "it. a jit of up to 1024 modules is kept until all the compiled sqls in it are gone");
+DEFINE_bool(enable_jit_disk_cache, false,
+            "keep the objects compiled by the shared jit in db_root_path/jit_cache, it works with enable_shared_jit");
+DEFINE_bool(enable_deploy_jit_cache, true,
+            "keep the objects of the deployments compiled by the shared jit in db_root_path/jit_cache");
+DEFINE_uint32(jit_cache_max_mb, 1024,
+              "the max size in MB of db_root_path/jit_cache, the objects not used for the longest time are removed "
+              "once it's exceeded, 0 means no limit");
+DEFINE_uint32(deploy_compile_threads, 8, "the number of threads to compile the deployments after the tablet restarts");
+DEFINE_uint32(max_sql_cache_size, 50, "the max number of the compiled sqls cached of each engine mode and db");
+DEFINE_uint64(max_sql_cache_bytes, 0,
+              "the max estimated bytes of the compiled sqls cached of each engine mode and db, 0 means unlimited");
+DEFINE_bool(enable_tiered_jit, false,
+            "compile the sqls without optimization first and then with optimization in background, except deployments");
 DEFINE_uint32(scan_reserve_size, 1024, "config the size of vec reserve");
 DEFINE_uint32(preview_limit_max_num, 1000, "config the max num of preview limit");
 DEFINE_uint32(preview_default_limit, 100, "config the default limit of preview");
@@ -75,6 +105,8 @@ DEFINE_bool(binlog_enable_crc, false, "enable crc");
 DEFINE_int32(binlog_coffee_time, 1000, "config the coffee time");
 DEFINE_int32(binlog_sync_wait_time, 100, "config the sync log wait time");
 DEFINE_int32(binlog_sync_to_disk_interval, 20000, "config the interval of sync binlog to disk time");
+DEFINE_bool(binlog_sync_on_append, false, "sync binlog to disk before the put returns, the concurrent puts share one sync");
+DEFINE_uint32(binlog_group_commit_max_size, 256, "the max count of entries written to binlog in one group commit");
 DEFINE_int32(binlog_delete_interval, 60000, "config the interval of delete binlog");
 DEFINE_int32(binlog_match_logoffset_interval, 1000, "config the interval of match log offset ");
 DEFINE_int32(binlog_name_length, 8, "binlog name length");
@@ -117,6 +149,9 @@ DEFINE_uint32(make_snapshot_offline_interval, 60 * 60 * 24,
               "config tablet self makesnapshot when how long time do not "
               "makesnapshot from ns. unit is second");
 DEFINE_string(snapshot_compression, "off", "Type of snapshot compression, can be off, snappy, zlib");
+DEFINE_bool(snapshot_memory_image, false,
+            "dump a memory image of the memory table after the snapshot is made, so the table can be recovered "
+            "from it without decoding the rows");
 DEFINE_int32(snapshot_pool_size, 1, "the size of tablet thread pool for making snapshot");
 
 DEFINE_uint32(load_index_max_wait_time, 120 * 60 * 1000, "config the max wait time of load index");
@@ -133,6 +168,15 @@ DEFINE_uint32(skiplist_max_height, 12, "the max height of skiplist");
 DEFINE_uint32(key_entry_max_height, 8, "the max height of key entry");
 DEFINE_uint32(latest_default_skiplist_height, 1, "the default height of skiplist for latest table");
 DEFINE_uint32(absolute_default_skiplist_height, 4, "the default height of skiplist for absolute table");
+DEFINE_bool(enable_slab_allocator, false, "enable the slab allocator for rows and skiplist nodes of memtable");
+DEFINE_uint32(slab_chunk_size, 1024 * 1024, "the chunk size of slab allocator in byte");
+DEFINE_uint32(cold_block_age, 0,
+              "the rows of absolute ttl index older than it are frozen into compact blocks in minute, 0 means disabled");
+DEFINE_bool(enable_gc_expire_index, false,
+            "index the keys of absolute ttl memtable by the minute of the oldest row, gc only visits expired keys");
+DEFINE_uint32(mem_table_tier_age, 0,
+              "the rows of absolute ttl index older than it are spilled from memtable to a disk tier in minute, "
+              "0 means disabled");
 DEFINE_bool(enable_show_tp, false, "enable show tp");
 DEFINE_uint32(max_col_display_length, 256, "config the max length of column display");
 
@@ -145,11 +189,17 @@ DEFINE_uint32(block_cache_mb, 4096,
 DEFINE_uint32(write_buffer_mb, 128, "Memtable size");
 DEFINE_uint32(block_cache_shardbits, 8, "Divide block cache into 2^8 shards to avoid cache contention");
 DEFINE_bool(verify_compression, false, "For debug");
+DEFINE_bool(disk_table_single_copy, false,
+            "store the rows of a new disk table once in a row column family, the indexes only keep the row ids");
+DEFINE_uint32(disk_row_cache_mb, 0,
+              "the memory of every disk table to cache the rows of hot keys for lookups, 0 means disabled");
+DEFINE_uint32(disk_row_cache_max_key_rows, 1000, "the keys with more rows are not put into the disk row cache");
 
 // load table resouce control
 DEFINE_uint32(load_table_batch, 30, "set laod table batch size");
 DEFINE_uint32(load_table_thread_num, 3, "set load tabale thread pool size");
 DEFINE_uint32(load_table_queue_size, 1000, "set load tabale queue size");
+DEFINE_uint32(load_table_read_thread_num, 2, "the number of threads reading one snapshot file in parallel");
 
 // multiple data center
 DEFINE_uint32(get_replica_status_interval, 10000, "config the interval to sync replica cluster status time");
@@ -35,6 +35,8 @@
 
 DECLARE_int32(binlog_single_file_max_size);
 DECLARE_int32(binlog_name_length);
+DECLARE_bool(binlog_sync_on_append);
+DECLARE_uint32(binlog_group_commit_max_size);
 DECLARE_string(zk_cluster);
 
 namespace openmldb {
@@ -59,11 +61,17 @@ LogReplicator::LogReplicator(uint32_t tid, uint32_t pid, const std::string& path
       term_(0),
       mu_(),
       cv_(),
-      wmu_() {
+      wmu_(),
+      pending_mu_(),
+      pending_(),
+      buffer_(),
+      buffer_ends_() {
     binlog_index_ = 0;
     snapshot_log_part_index_.store(-1, std::memory_order_relaxed);
     snapshot_last_offset_.store(0, std::memory_order_relaxed);
     follower_offset_.store(0);
+    sync_fail_cnt_.store(0, std::memory_order_relaxed);
+    sync_failed_ = false;
 }
 
 LogReplicator::~LogReplicator() {
@@ -90,6 +98,8 @@ void LogReplicator::SyncToDisk() {
         ::openmldb::log::Status status = wh_->Sync();
         if (!status.ok()) {
             PDLOG(WARNING, "fail to sync data for path %s", path_.c_str());
+        } else {
+            sync_failed_ = false;
         }
         consumed = ::baidu::common::timer::get_micros() - consumed;
         if (consumed > 20000) {
@@ -433,30 +443,121 @@ bool LogReplicator::DelAllReplicateNode() {
     return true;
 }
 
-bool LogReplicator::AppendEntry(LogEntry& entry) {
+bool LogReplicator::AppendEntry(LogEntry& entry) { return Append(&entry, 1); }
+
+bool LogReplicator::AppendEntries(std::vector<LogEntry>& entries) {
+    if (entries.empty()) {
+        return true;
+    }
+    return Append(entries.data(), entries.size());
+}
+
+bool LogReplicator::Append(LogEntry* entries, size_t cnt) {
+    PendingEntry pending(entries, cnt);
+    std::vector<PendingEntry*> batch;
+    {
+        std::unique_lock<bthread::Mutex> lock(pending_mu_);
+        pending_.push_back(&pending);
+        while (!pending.done && &pending != pending_.front()) {
+            pending.cv.wait(lock);
+        }
+        if (pending.done) {
+            return pending.ok;
+        }
+        // the front one writes for the entries queued behind it
+        size_t entry_cnt = 0;
+        for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+            if (!batch.empty() && entry_cnt + (*it)->cnt > FLAGS_binlog_group_commit_max_size) {
+                break;
+            }
+            batch.push_back(*it);
+            entry_cnt += (*it)->cnt;
+        }
+    }
+    WriteEntries(batch);
+    std::lock_guard<bthread::Mutex> lock(pending_mu_);
+    for (PendingEntry* cur : batch) {
+        pending_.pop_front();
+        cur->done = true;
+        if (cur != &pending) {
+            cur->cv.notify_one();
+        }
+    }
+    if (!pending_.empty()) {
+        pending_.front()->cv.notify_one();
+    }
+    return pending.ok;
+}
+
+void LogReplicator::WriteEntries(const std::vector<PendingEntry*>& batch) {
     std::lock_guard<std::mutex> lock(wmu_);
+    if (FLAGS_binlog_sync_on_append && sync_failed_ && wh_ != NULL) {
+        // reject the appends until the binlog written before can be synced, check it before the current
+        // file is rolled
+        ::openmldb::log::Status status = wh_->Sync();
+        if (!status.ok()) {
+            sync_fail_cnt_.fetch_add(1, std::memory_order_relaxed);
+            PDLOG(WARNING, "fail to sync data for path %s: %s, reject the appends", path_.c_str(),
+                  status.ToString().c_str());
+            return;
+        }
+        sync_failed_ = false;
+    }
     if (wh_ == NULL || wh_->GetSize() / (1024 * 1024) > (uint32_t)FLAGS_binlog_single_file_max_size) {
         bool ok = RollWLogFile();
         if (!ok) {
-            return false;
+            return;
         }
     }
     uint64_t cur_offset = log_offset_.load(std::memory_order_relaxed);
-    entry.set_log_index(1 + cur_offset);
-    std::string buffer;
-    entry.SerializeToString(&buffer);
-    ::openmldb::base::Slice slice(buffer);
-    ::openmldb::log::Status status = wh_->Write(slice);
-    if (!status.ok()) {
-        PDLOG(WARNING, "fail to write replication log in dir %s for %s", path_.c_str(), status.ToString().c_str());
-        return false;
+    buffer_.clear();
+    buffer_ends_.clear();
+    for (PendingEntry* pending : batch) {
+        for (size_t i = 0; i < pending->cnt; i++) {
+            pending->entries[i].set_log_index(cur_offset + 1 + buffer_ends_.size());
+            pending->entries[i].AppendToString(&buffer_);
+            buffer_ends_.push_back(buffer_.size());
+        }
+    }
+    size_t start = 0;
+    uint64_t cnt = 0;
+    for (; cnt < buffer_ends_.size(); cnt++) {
+        ::openmldb::base::Slice slice(buffer_.data() + start, buffer_ends_[cnt] - start);
+        ::openmldb::log::Status status = wh_->Write(slice);
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to write replication log in dir %s for %s", path_.c_str(),
+                  status.ToString().c_str());
+            break;
+        }
+        start = buffer_ends_[cnt];
+    }
+    if (cnt == 0) {
+        return;
     }
-    log_offset_.fetch_add(1, std::memory_order_relaxed);
+    log_offset_.fetch_add(cnt, std::memory_order_relaxed);
     if (local_endpoints_.empty()) {  // if local replica are dead, leader direct
                                      // sync to remote replica
-        follower_offset_.store(cur_offset + 1, std::memory_order_relaxed);
+        follower_offset_.store(cur_offset + cnt, std::memory_order_relaxed);
+    }
+    if (FLAGS_binlog_sync_on_append) {
+        // the entries are written and will be replicated already, a failed sync doesn't fail the appends,
+        // or the retries of clients would write the rows twice. the later appends fail until a sync succeeds
+        ::openmldb::log::Status status = wh_->Sync();
+        if (!status.ok()) {
+            sync_fail_cnt_.fetch_add(1, std::memory_order_relaxed);
+            sync_failed_ = true;
+            PDLOG(WARNING, "fail to sync data for path %s: %s, offset %lu", path_.c_str(), status.ToString().c_str(),
+                  cur_offset + cnt);
+        }
+    }
+    uint64_t end = 0;
+    for (PendingEntry* pending : batch) {
+        end += pending->cnt;
+        if (end > cnt) {
+            break;
+        }
+        pending->ok = true;
     }
-    return true;
 }
 
 bool LogReplicator::RollWLogFile() {
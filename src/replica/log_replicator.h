@@ -19,6 +19,7 @@
 
 #include <atomic>
 #include <condition_variable>  // NOLINT
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
@@ -63,9 +64,13 @@ class LogReplicator {
     // the slave node receives master log entries
     bool ApplyEntry(const ::openmldb::api::LogEntry& entry);
 
-    // the master node append entry
+    // the master node append entry. The concurrent calls are grouped, the first one in the queue
+    // writes the entries of all of them and syncs once if binlog_sync_on_append is set
     bool AppendEntry(::openmldb::api::LogEntry& entry);  // NOLINT
 
+    // append the entries with consecutive log index in one group commit
+    bool AppendEntries(std::vector<::openmldb::api::LogEntry>& entries);  // NOLINT
+
     //  data to slave nodes
     void Notify();
     // recover logs meta
@@ -97,6 +102,10 @@ class LogReplicator {
     LogParts* GetLogPart();
 
     inline uint64_t GetLogOffset() { return log_offset_.load(std::memory_order_relaxed); }
+
+    // the count of failed syncs of binlog. the entries of a failed sync are still written, the appends
+    // after it are rejected until a sync succeeds
+    inline uint64_t GetSyncFailCnt() { return sync_fail_cnt_.load(std::memory_order_relaxed); }
     void SetRole(const ReplicatorRole& role);
 
     uint64_t GetLeaderTerm();
@@ -111,8 +120,24 @@ class LogReplicator {
     const std::string& GetLogPath() {return log_path_;}
 
  private:
+    // the entries of one caller waiting in the group commit queue
+    struct PendingEntry {
+        PendingEntry(LogEntry* log_entries, size_t entry_cnt)
+            : entries(log_entries), cnt(entry_cnt), ok(false), done(false), cv() {}
+        LogEntry* entries;
+        size_t cnt;
+        bool ok;
+        bool done;
+        bthread::ConditionVariable cv;
+    };
+
     bool OpenSeqFile(const std::string& path, SequentialFile** sf);
 
+    bool Append(LogEntry* entries, size_t cnt);
+
+    // write the entries in order and set ok of the callers whose entries are all written
+    void WriteEntries(const std::vector<PendingEntry*>& batch);
+
  private:
     // the replicator root data path
     uint32_t tid_;
@@ -122,6 +147,9 @@ class LogReplicator {
     // the term for leader judgement
     std::atomic<uint64_t> log_offset_;
     std::atomic<uint64_t> follower_offset_;
+    std::atomic<uint64_t> sync_fail_cnt_;
+    // guarded by wmu_
+    bool sync_failed_;
     std::atomic<uint32_t> binlog_index_;
     LogParts* logs_;
     WriteHandle* wh_;
@@ -139,6 +167,13 @@ class LogReplicator {
     std::atomic<uint64_t> snapshot_last_offset_;
 
     std::mutex wmu_;
+
+    // the group commit queue of AppendEntry
+    bthread::Mutex pending_mu_;
+    std::deque<PendingEntry*> pending_;
+    // serialized entries of one group, only used by the front of pending_
+    std::string buffer_;
+    std::vector<size_t> buffer_ends_;
 };
 
 }  // namespace replica
@@ -24,7 +24,10 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <set>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
 #include "base/glog_wapper.h"
 #include "base/status.h"
@@ -46,6 +49,8 @@ using ::openmldb::storage::Table;
 using ::openmldb::storage::TableIterator;
 using ::openmldb::storage::Ticket;
 
+DECLARE_bool(binlog_sync_on_append);
+
 namespace openmldb {
 namespace replica {
 
@@ -147,6 +152,64 @@ TEST_F(LogReplicatorTest, BenchMark) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(LogReplicatorTest, GroupCommit) {
+    FLAGS_binlog_sync_on_append = true;
+    std::map<std::string, std::string> map;
+    std::string folder = "/tmp/" + GenRand() + "/";
+    LogReplicator replicator(1, 1, folder, map, kLeaderNode);
+    ASSERT_TRUE(replicator.Init());
+    int thread_num = 8;
+    int entry_num = 100;
+    std::vector<std::vector<uint64_t>> log_index(thread_num);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; i++) {
+        threads.emplace_back([&replicator, &log_index, i, entry_num] {
+            for (int j = 0; j < entry_num; j++) {
+                ::openmldb::api::LogEntry entry;
+                entry.set_term(1);
+                entry.set_pk("key" + std::to_string(i));
+                entry.set_value(std::to_string(j));
+                entry.set_ts(j);
+                if (replicator.AppendEntry(entry)) {
+                    log_index[i].push_back(entry.log_index());
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    FLAGS_binlog_sync_on_append = false;
+    ASSERT_EQ((uint64_t)(thread_num * entry_num), replicator.GetOffset());
+    std::set<uint64_t> all_index;
+    for (const auto& index : log_index) {
+        ASSERT_EQ(entry_num, (int)index.size());
+        // the entries of one thread are in order
+        for (size_t k = 1; k < index.size(); k++) {
+            ASSERT_LT(index[k - 1], index[k]);
+        }
+        all_index.insert(index.begin(), index.end());
+    }
+    ASSERT_EQ((size_t)(thread_num * entry_num), all_index.size());
+    // the entries are on disk already
+    ::openmldb::log::LogReader log_reader(replicator.GetLogPart(), replicator.GetLogPath(), false);
+    std::string buffer;
+    uint64_t cnt = 0;
+    while (true) {
+        buffer.clear();
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = log_reader.ReadNextRecord(&record, &buffer);
+        if (!status.ok()) {
+            break;
+        }
+        ::openmldb::api::LogEntry entry;
+        ASSERT_TRUE(entry.ParseFromString(record.ToString()));
+        cnt++;
+        ASSERT_EQ(cnt, entry.log_index());
+    }
+    ASSERT_EQ((uint64_t)(thread_num * entry_num), cnt);
+}
+
 TEST_F(LogReplicatorTest, LeaderAndFollowerMulti) {
     brpc::ServerOptions options;
     brpc::Server server0;
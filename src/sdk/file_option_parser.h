@@ -145,7 +145,25 @@ class FileOptionsParser {
 
 class ReadFileOptionsParser : public FileOptionsParser {
  public:
-    ReadFileOptionsParser() { quote_ = '\0'; }
+    ReadFileOptionsParser() {
+        quote_ = '\0';
+        check_map_.emplace("thread", std::make_pair(CheckThread(), hybridse::node::kInt32));
+    }
+    uint32_t GetThread() const { return thread_; }
+
+ private:
+    // the count of threads to parse and put the rows
+    uint32_t thread_ = 1;
+    std::function<bool(const hybridse::node::ConstNode* node)> CheckThread() {
+        return [this](const hybridse::node::ConstNode* node) {
+            int32_t thread = node->GetAsInt32();
+            if (thread <= 0) {
+                return false;
+            }
+            thread_ = thread;
+            return true;
+        };
+    }
 };
 
 class WriteFileOptionsParser : public FileOptionsParser {
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sdk/result_set_stream.h"
+
+#include <mutex>  // NOLINT
+#include <utility>
+
+#include "codec/fe_schema_codec.h"
+#include "codec/sql_rpc_row_codec.h"
+#include "glog/logging.h"
+
+namespace openmldb {
+namespace sdk {
+
+ResultSetStream::ResultSetStream(uint32_t max_chunks)
+    : max_chunks_(max_chunks == 0 ? 1 : max_chunks),
+      stream_id_(brpc::INVALID_STREAM_ID),
+      mu_(),
+      cv_(),
+      chunks_(),
+      closed_(false),
+      canceled_(false),
+      finished_(false),
+      schema_(),
+      schema_impl_(),
+      chunk_(),
+      result_set_base_(),
+      count_(0),
+      status_() {}
+
+ResultSetStream::~ResultSetStream() {
+    if (stream_id_ == brpc::INVALID_STREAM_ID) {
+        return;
+    }
+    std::unique_lock<bthread::Mutex> lock(mu_);
+    // wake up the handler blocked by the full buffer
+    canceled_ = true;
+    cv_.notify_all();
+    lock.unlock();
+    brpc::StreamClose(stream_id_);
+    lock.lock();
+    while (!closed_) {
+        cv_.wait(lock);
+    }
+}
+
+bool ResultSetStream::Open(brpc::Controller* cntl) {
+    brpc::StreamOptions options;
+    options.handler = this;
+    options.messages_in_batch = 1;
+    // the stream is closed if no rows arrive in the timeout of the query
+    options.idle_timeout_ms = cntl->timeout_ms();
+    if (brpc::StreamCreate(&stream_id_, *cntl, &options) != 0) {
+        stream_id_ = brpc::INVALID_STREAM_ID;
+        LOG(WARNING) << "fail to create the query stream";
+        return false;
+    }
+    return true;
+}
+
+bool ResultSetStream::Init(const std::string& encoded_schema) {
+    if (!::hybridse::codec::SchemaCodec::Decode(encoded_schema, &schema_)) {
+        LOG(WARNING) << "fail to decode the schema of the query stream";
+        return false;
+    }
+    schema_impl_.SetSchema(schema_);
+    return true;
+}
+
+bool ResultSetStream::Next() {
+    while (true) {
+        if (result_set_base_ && result_set_base_->Next()) {
+            count_++;
+            return true;
+        }
+        if (!NextChunk()) {
+            return false;
+        }
+    }
+}
+
+bool ResultSetStream::NextChunk() {
+    if (finished_ || !status_.IsOK()) {
+        return false;
+    }
+    result_set_base_.reset();
+    {
+        std::unique_lock<bthread::Mutex> lock(mu_);
+        while (chunks_.empty() && !closed_) {
+            cv_.wait(lock);
+        }
+        if (chunks_.empty()) {
+            status_.code = -1;
+            status_.msg = "the query stream is closed before the end";
+            return false;
+        }
+        chunk_.swap(chunks_.front());
+        chunks_.pop_front();
+        cv_.notify_all();
+    }
+    int32_t code = 0;
+    uint32_t count = 0;
+    uint32_t byte_size = 0;
+    if (!::openmldb::codec::DecodeQueryStreamHeader(&chunk_, &code, &count, &byte_size)) {
+        status_.code = -1;
+        status_.msg = "fail to decode the message of the query stream";
+        return false;
+    }
+    if (code != 0) {
+        status_.code = code;
+        status_.msg = chunk_.to_string();
+        return false;
+    }
+    if (count == 0) {
+        finished_ = true;
+        return false;
+    }
+    std::unique_ptr<::hybridse::sdk::RowIOBufView> row_view(new ::hybridse::sdk::RowIOBufView(schema_));
+    result_set_base_.reset(new ResultSetBase(&chunk_, count, byte_size, std::move(row_view), schema_));
+    return true;
+}
+
+int ResultSetStream::on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) {
+    std::unique_lock<bthread::Mutex> lock(mu_);
+    for (size_t i = 0; i < size; i++) {
+        // the feedback of the consumed messages is not sent until it returns, so the tablet waits as well
+        while (chunks_.size() >= max_chunks_ && !canceled_) {
+            cv_.wait(lock);
+        }
+        if (canceled_) {
+            return 0;
+        }
+        chunks_.emplace_back();
+        chunks_.back().swap(*messages[i]);
+    }
+    cv_.notify_all();
+    return 0;
+}
+
+void ResultSetStream::on_idle_timeout(brpc::StreamId id) {
+    LOG(WARNING) << "the query stream " << id << " is idle too long, close it";
+    brpc::StreamClose(id);
+}
+
+void ResultSetStream::on_closed(brpc::StreamId id) {
+    std::lock_guard<bthread::Mutex> lock(mu_);
+    closed_ = true;
+    cv_.notify_all();
+}
+
+}  // namespace sdk
+}  // namespace openmldb
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SDK_RESULT_SET_STREAM_H_
+#define SRC_SDK_RESULT_SET_STREAM_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "brpc/controller.h"
+#include "brpc/stream.h"
+#include "bthread/condition_variable.h"
+#include "bthread/mutex.h"
+#include "butil/iobuf.h"
+#include "sdk/base_impl.h"
+#include "sdk/result_set.h"
+#include "sdk/result_set_base.h"
+
+namespace openmldb {
+namespace sdk {
+
+// ResultSetStream reads the rows of a batch query which are pushed by the tablet through a brpc stream chunk by
+// chunk, instead of being returned in the response attachment. At most max_chunks chunks are buffered, the stream
+// is not consumed once the buffer is full, so the tablet is blocked by the back pressure of brpc.
+// The rows can't be read again, Reset is not supported and Size is the count of rows read so far.
+class ResultSetStream : public ::hybridse::sdk::ResultSet, public brpc::StreamInputHandler {
+ public:
+    explicit ResultSetStream(uint32_t max_chunks);
+
+    // close the stream and wait for it's closed as brpc may still call the handler
+    ~ResultSetStream();
+
+    // create the stream on cntl before the query is sent
+    bool Open(brpc::Controller* cntl);
+
+    bool Init(const std::string& encoded_schema);
+
+    bool Reset() override { return false; }
+
+    bool Next() override;
+
+    bool IsNULL(int index) override { return result_set_base_->IsNULL(index); }
+
+    bool GetString(uint32_t index, std::string* str) override { return result_set_base_->GetString(index, str); }
+
+    bool GetBool(uint32_t index, bool* result) override { return result_set_base_->GetBool(index, result); }
+
+    bool GetChar(uint32_t index, char* result) override { return result_set_base_->GetChar(index, result); }
+
+    bool GetInt16(uint32_t index, int16_t* result) override { return result_set_base_->GetInt16(index, result); }
+
+    bool GetInt32(uint32_t index, int32_t* result) override { return result_set_base_->GetInt32(index, result); }
+
+    bool GetInt64(uint32_t index, int64_t* result) override { return result_set_base_->GetInt64(index, result); }
+
+    bool GetFloat(uint32_t index, float* result) override { return result_set_base_->GetFloat(index, result); }
+
+    bool GetDouble(uint32_t index, double* result) override { return result_set_base_->GetDouble(index, result); }
+
+    bool GetDate(uint32_t index, int32_t* date) override { return result_set_base_->GetDate(index, date); }
+
+    bool GetDate(uint32_t index, int32_t* year, int32_t* month, int32_t* day) override {
+        return result_set_base_->GetDate(index, year, month, day);
+    }
+
+    bool GetTime(uint32_t index, int64_t* mills) override { return result_set_base_->GetTime(index, mills); }
+
+    const ::hybridse::sdk::Schema* GetSchema() override { return &schema_impl_; }
+
+    int32_t Size() override { return count_; }
+
+    // the error pushed by the tablet or of the stream, it's set once Next returns false
+    const ::hybridse::sdk::Status& GetStatus() const { return status_; }
+
+    int on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) override;
+
+    void on_idle_timeout(brpc::StreamId id) override;
+
+    void on_closed(brpc::StreamId id) override;
+
+ private:
+    bool NextChunk();
+
+ private:
+    uint32_t max_chunks_;
+    brpc::StreamId stream_id_;
+    bthread::Mutex mu_;
+    bthread::ConditionVariable cv_;
+    std::deque<butil::IOBuf> chunks_;
+    bool closed_;
+    bool canceled_;
+    bool finished_;
+    ::hybridse::vm::Schema schema_;
+    ::hybridse::sdk::SchemaImpl schema_impl_;
+    butil::IOBuf chunk_;
+    std::unique_ptr<ResultSetBase> result_set_base_;
+    int32_t count_;
+    ::hybridse::sdk::Status status_;
+};
+
+}  // namespace sdk
+}  // namespace openmldb
+
+#endif  // SRC_SDK_RESULT_SET_STREAM_H_
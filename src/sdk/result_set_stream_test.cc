@@ -0,0 +1,148 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sdk/result_set_stream.h"
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+
+#include "codec/fe_row_codec.h"
+#include "codec/fe_schema_codec.h"
+#include "codec/sql_rpc_row_codec.h"
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace sdk {
+
+class ResultSetStreamTest : public ::testing::Test {
+ public:
+    ResultSetStreamTest() {
+        auto column = schema_.Add();
+        column->set_name("col1");
+        column->set_type(::hybridse::type::kInt32);
+        column = schema_.Add();
+        column->set_name("col2");
+        column->set_type(::hybridse::type::kVarchar);
+        ::hybridse::codec::SchemaCodec::Encode(schema_, &encoded_schema_);
+    }
+    ~ResultSetStreamTest() {}
+
+    // a message of count rows starting from begin
+    butil::IOBuf Chunk(int32_t begin, uint32_t count) {
+        butil::IOBuf rows;
+        ::hybridse::codec::RowBuilder builder(schema_);
+        for (uint32_t i = 0; i < count; i++) {
+            std::string str = "v" + std::to_string(begin + i);
+            uint32_t size = builder.CalTotalLength(str.size());
+            std::string row(size, '\0');
+            builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), size);
+            builder.AppendInt32(begin + i);
+            builder.AppendString(str.data(), str.size());
+            rows.append(row);
+        }
+        butil::IOBuf msg;
+        ::openmldb::codec::EncodeQueryStreamHeader(0, count, rows.size(), &msg);
+        msg.append(rows);
+        return msg;
+    }
+
+    butil::IOBuf Error(int32_t code, const std::string& error) {
+        butil::IOBuf msg;
+        ::openmldb::codec::EncodeQueryStreamHeader(code, 0, error.size(), &msg);
+        msg.append(error);
+        return msg;
+    }
+
+ protected:
+    ::hybridse::vm::Schema schema_;
+    std::string encoded_schema_;
+};
+
+TEST_F(ResultSetStreamTest, ReadChunks) {
+    ResultSetStream rs(2);
+    ASSERT_TRUE(rs.Init(encoded_schema_));
+    ASSERT_EQ(2, rs.GetSchema()->GetColumnCnt());
+    std::atomic<int32_t> pushed{0};
+    std::thread producer([&] {
+        for (int32_t i = 0; i < 10; i++) {
+            butil::IOBuf msg = Chunk(i * 3, 3);
+            butil::IOBuf* msgs[1] = {&msg};
+            rs.on_received_messages(0, msgs, 1);
+            pushed++;
+        }
+        butil::IOBuf end = Chunk(0, 0);
+        butil::IOBuf* msgs[1] = {&end};
+        rs.on_received_messages(0, msgs, 1);
+        rs.on_closed(0);
+    });
+    // the producer is blocked once two chunks are not consumed
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(2, pushed.load());
+    int32_t expect = 0;
+    while (rs.Next()) {
+        int32_t val = 0;
+        ASSERT_TRUE(rs.GetInt32(0, &val));
+        ASSERT_EQ(expect, val);
+        std::string str;
+        ASSERT_TRUE(rs.GetString(1, &str));
+        ASSERT_EQ("v" + std::to_string(expect), str);
+        expect++;
+    }
+    producer.join();
+    ASSERT_EQ(30, expect);
+    ASSERT_EQ(30, rs.Size());
+    ASSERT_TRUE(rs.GetStatus().IsOK());
+    ASSERT_FALSE(rs.Next());
+}
+
+TEST_F(ResultSetStreamTest, Error) {
+    ResultSetStream rs(4);
+    ASSERT_TRUE(rs.Init(encoded_schema_));
+    butil::IOBuf msg = Chunk(0, 2);
+    butil::IOBuf error = Error(-1, "fail to run sql");
+    butil::IOBuf* msgs[2] = {&msg, &error};
+    rs.on_received_messages(0, msgs, 2);
+    rs.on_closed(0);
+    ASSERT_TRUE(rs.Next());
+    ASSERT_TRUE(rs.Next());
+    ASSERT_FALSE(rs.Next());
+    ASSERT_EQ(-1, rs.GetStatus().code);
+    ASSERT_EQ("fail to run sql", rs.GetStatus().msg);
+}
+
+TEST_F(ResultSetStreamTest, ClosedBeforeEnd) {
+    ResultSetStream rs(4);
+    ASSERT_TRUE(rs.Init(encoded_schema_));
+    butil::IOBuf msg = Chunk(0, 1);
+    butil::IOBuf* msgs[1] = {&msg};
+    rs.on_received_messages(0, msgs, 1);
+    rs.on_closed(0);
+    ASSERT_TRUE(rs.Next());
+    ASSERT_FALSE(rs.Next());
+    ASSERT_FALSE(rs.GetStatus().IsOK());
+}
+
+}  // namespace sdk
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    return RUN_ALL_TESTS();
+}
@@ -16,9 +16,18 @@
 
 #include "sdk/sql_cluster_router.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -46,11 +55,13 @@
 #include "sdk/file_option_parser.h"
 #include "sdk/node_adapter.h"
 #include "sdk/result_set_sql.h"
+#include "sdk/result_set_stream.h"
 #include "sdk/split.h"
 
 DECLARE_int32(request_timeout_ms);
 DECLARE_string(bucket_size);
 DEFINE_string(spark_conf, "", "The config file of Spark job");
+DEFINE_uint32(put_batch_size, 1000, "The max count of rows put to one partition in a request");
 DECLARE_uint32(replica_num);
 
 namespace openmldb {
@@ -189,6 +200,216 @@ class BatchQueryFutureImpl : public QueryFuture {
     openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>* callback_;
 };
 
+// InsertFutureImpl puts the rows to every partition with batch requests. The requests of one tablet are
+// pipelined with at most max_inflight of them in flight, and different tablets are put concurrently.
+class InsertFutureImpl : public InsertFuture, public std::enable_shared_from_this<InsertFutureImpl> {
+ public:
+    InsertFutureImpl(uint32_t tid, const std::vector<std::shared_ptr<SQLInsertRow>>& rows, uint32_t max_inflight)
+        : tid_(tid),
+          rows_(rows),
+          max_inflight_(std::max(max_inflight, 1u)),
+          time_(::baidu::common::timer::get_micros() / 1000),
+          remaining_(0),
+          acked_cnt_(0),
+          ok_(true) {}
+    ~InsertFutureImpl() {}
+
+    // split the rows into the requests of every tablet
+    bool Init(const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
+              hybridse::sdk::Status* status) {
+        std::map<uint32_t, Chunk> pid_rows;
+        row_pending_.assign(rows_.size(), 0);
+        for (size_t i = 0; i < rows_.size(); i++) {
+            const auto& row = rows_[i];
+            for (const auto& kv : row->GetDimensions()) {
+                auto& chunk = pid_rows[kv.first];
+                chunk.pid = kv.first;
+                chunk.rows.push_back(i);
+                chunk.values.push_back(&row->GetRow());
+                chunk.dimensions.push_back(&kv.second);
+                row_pending_[i]++;
+            }
+        }
+        size_t batch_size = std::max(FLAGS_put_batch_size, 1u);
+        for (auto& kv : pid_rows) {
+            uint32_t pid = kv.first;
+            std::shared_ptr<::openmldb::client::TabletClient> client;
+            if (pid < tablets.size() && tablets[pid]) {
+                client = tablets[pid]->GetClient();
+            }
+            if (!client) {
+                status->msg = "fail to get tablet client. pid " + std::to_string(pid);
+                LOG(WARNING) << status->msg;
+                return false;
+            }
+            auto& queue = queues_[client->GetEndpoint()];
+            queue.client = client;
+            const auto& chunk = kv.second;
+            for (size_t start = 0; start < chunk.values.size(); start += batch_size) {
+                size_t end = std::min(chunk.values.size(), start + batch_size);
+                queue.chunks.emplace_back();
+                auto& part = queue.chunks.back();
+                part.pid = pid;
+                part.rows.assign(chunk.rows.begin() + start, chunk.rows.begin() + end);
+                part.values.assign(chunk.values.begin() + start, chunk.values.begin() + end);
+                part.dimensions.assign(chunk.dimensions.begin() + start, chunk.dimensions.begin() + end);
+                remaining_++;
+            }
+        }
+        return true;
+    }
+
+    void Start() {
+        std::vector<PutBatchClosure*> reqs;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            for (auto& kv : queues_) {
+                PopChunks(&kv.second, &reqs);
+            }
+        }
+        Send(reqs);
+    }
+
+    bool Wait(hybridse::sdk::Status* status) override {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return remaining_ == 0; });
+        if (!ok_ && status != nullptr) {
+            status->code = status_.code;
+            status->msg = status_.msg;
+        }
+        return ok_;
+    }
+
+    bool IsDone() const override {
+        std::lock_guard<std::mutex> lock(mu_);
+        return remaining_ == 0;
+    }
+
+    size_t GetAckedCnt() const override {
+        std::lock_guard<std::mutex> lock(mu_);
+        return acked_cnt_;
+    }
+
+ private:
+    struct Chunk {
+        uint32_t pid = 0;
+        // the index of every row in rows_
+        std::vector<size_t> rows;
+        std::vector<const std::string*> values;
+        std::vector<const std::vector<std::pair<std::string, uint32_t>>*> dimensions;
+    };
+
+    struct TabletQueue {
+        std::shared_ptr<::openmldb::client::TabletClient> client;
+        std::vector<Chunk> chunks;
+        size_t next = 0;
+        uint32_t inflight = 0;
+    };
+
+    class PutBatchClosure : public google::protobuf::Closure {
+     public:
+        PutBatchClosure(const std::shared_ptr<InsertFutureImpl>& future, TabletQueue* queue, const Chunk* chunk)
+            : future_(future), queue_(queue), chunk_(chunk) {
+            cntl_.set_timeout_ms(FLAGS_request_timeout_ms);
+        }
+
+        void Run() override {
+            future_->OnDone(this);
+            delete this;
+        }
+
+     private:
+        friend class InsertFutureImpl;
+        std::shared_ptr<InsertFutureImpl> future_;
+        TabletQueue* queue_;
+        const Chunk* chunk_;
+        brpc::Controller cntl_;
+        ::openmldb::api::PutBatchResponse response_;
+    };
+
+    // take the chunks which can be sent now, must hold mu_
+    void PopChunks(TabletQueue* queue, std::vector<PutBatchClosure*>* reqs) {
+        while (ok_ && queue->inflight < max_inflight_ && queue->next < queue->chunks.size()) {
+            reqs->push_back(new PutBatchClosure(shared_from_this(), queue, &queue->chunks[queue->next]));
+            queue->next++;
+            queue->inflight++;
+        }
+    }
+
+    void Send(const std::vector<PutBatchClosure*>& reqs) {
+        for (auto* req : reqs) {
+            const Chunk* chunk = req->chunk_;
+            DLOG(INFO) << "put " << chunk->values.size() << " rows to endpoint " << req->queue_->client->GetEndpoint();
+            if (!req->queue_->client->PutBatch(tid_, chunk->pid, time_, chunk->values, chunk->dimensions, &req->cntl_,
+                                               &req->response_, req)) {
+                req->cntl_.SetFailed("fail to send put batch request");
+                req->Run();
+            }
+        }
+    }
+
+    void OnDone(PutBatchClosure* req) {
+        const Chunk* chunk = req->chunk_;
+        std::string msg;
+        if (req->cntl_.Failed()) {
+            msg = req->cntl_.ErrorText();
+        } else if (req->response_.code() != ::openmldb::base::kOk) {
+            msg = req->response_.msg();
+        }
+        std::vector<PutBatchClosure*> reqs;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            auto* queue = req->queue_;
+            queue->inflight--;
+            remaining_--;
+            if (msg.empty()) {
+                // a row is acked when the requests of all its partitions succeed
+                for (auto idx : chunk->rows) {
+                    if (--row_pending_[idx] == 0) {
+                        acked_cnt_++;
+                    }
+                }
+            } else if (ok_) {
+                ok_ = false;
+                status_.code = hybridse::common::kRpcError;
+                status_.msg = "fail to make a put batch request to table. tid " + std::to_string(tid_) + ", pid " +
+                              std::to_string(chunk->pid) + ", " + msg;
+                LOG(WARNING) << status_.msg;
+            }
+            if (ok_) {
+                PopChunks(queue, &reqs);
+            } else {
+                // the chunks not sent are given up
+                for (auto& kv : queues_) {
+                    remaining_ -= kv.second.chunks.size() - kv.second.next;
+                    kv.second.next = kv.second.chunks.size();
+                }
+            }
+            if (remaining_ == 0) {
+                cv_.notify_all();
+            }
+        }
+        Send(reqs);
+    }
+
+ private:
+    uint32_t tid_;
+    // hold the rows until the requests are done
+    std::vector<std::shared_ptr<SQLInsertRow>> rows_;
+    uint32_t max_inflight_;
+    uint64_t time_;
+    // the request queue of every tablet endpoint
+    std::map<std::string, TabletQueue> queues_;
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    size_t remaining_;
+    // the count of partitions not acked of every row
+    std::vector<uint32_t> row_pending_;
+    size_t acked_cnt_;
+    bool ok_;
+    hybridse::sdk::Status status_;
+};
+
 SQLClusterRouter::SQLClusterRouter(const SQLRouterOptions& options)
     : options_(options),
       is_cluster_mode_(true),
@@ -1135,12 +1356,30 @@ std::shared_ptr<::hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQLParamete
     cntl->set_timeout_ms(options_.request_timeout);
     DLOG(INFO) << " send query to tablet " << client->GetEndpoint();
     auto response = std::make_shared<::openmldb::api::QueryResponse>();
+    std::shared_ptr<ResultSetStream> stream_rs;
+    if (options_.stream_batch_query) {
+        stream_rs = std::make_shared<ResultSetStream>(options_.stream_max_chunks);
+        if (!stream_rs->Open(cntl.get())) {
+            status->msg = "fail to create the query stream";
+            status->code = -1;
+            return {};
+        }
+    }
     if (!client->Query(db, sql, parameter_types, parameter ? parameter->GetRow() : "", cntl.get(), response.get(),
-                       options_.enable_debug)) {
+                       options_.enable_debug, stream_rs != nullptr)) {
         status->msg = response->msg();
         status->code = -1;
         return {};
     }
+    if (stream_rs && response->stream_result()) {
+        if (!stream_rs->Init(response->schema())) {
+            status->msg = "request error, fail to decodec schema";
+            status->code = -1;
+            return {};
+        }
+        return stream_rs;
+    }
+    // the tablet doesn't support streaming
     return ResultSetSQL::MakeResultSet(response, cntl, status);
 }
 
@@ -1203,6 +1442,7 @@ bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& s
         return false;
     }
     size_t cnt = 0;
+    std::vector<std::shared_ptr<SQLInsertRow>> rows;
     for (size_t i = 0; i < default_maps.size(); i++) {
         auto row = std::make_shared<SQLInsertRow>(table_info, schema, default_maps[i], str_lengths[i]);
         if (!row) {
@@ -1217,15 +1457,18 @@ bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& s
             LOG(WARNING) << "fail to build row[" << i << "]";
             continue;
         }
-        if (!PutRow(table_info->tid(), row, tablets, status)) {
-            LOG(WARNING) << "fail to put row[" << i << "] due to: " << status->msg;
-            continue;
-        }
-        cnt++;
+        rows.push_back(row);
+    }
+    if (!rows.empty() && !PutRows(table_info->tid(), rows, tablets, status, &cnt)) {
+        LOG(WARNING) << "fail to put rows due to: " << status->msg;
     }
     if (cnt < default_maps.size()) {
-        status->msg = "Error occur when execute insert, success/total: " + std::to_string(cnt) + "/" +
-                      std::to_string(default_maps.size());
+        std::string msg = "Error occur when execute insert, success/total: " + std::to_string(cnt) + "/" +
+                          std::to_string(default_maps.size());
+        if (!status->msg.empty()) {
+            msg.append(", ").append(status->msg);
+        }
+        status->msg = msg;
         status->code = 1;
         return false;
     }
@@ -1266,6 +1509,34 @@ bool SQLClusterRouter::PutRow(uint32_t tid, const std::shared_ptr<SQLInsertRow>&
     return true;
 }
 
+bool SQLClusterRouter::PutRows(uint32_t tid, const std::vector<std::shared_ptr<SQLInsertRow>>& rows,
+                               const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
+                               ::hybridse::sdk::Status* status, size_t* acked_cnt) {
+    if (status == nullptr) {
+        return false;
+    }
+    if (acked_cnt != nullptr) {
+        *acked_cnt = 0;
+    }
+    if (rows.size() == 1) {
+        bool ok = PutRow(tid, rows[0], tablets, status);
+        if (ok && acked_cnt != nullptr) {
+            *acked_cnt = 1;
+        }
+        return ok;
+    }
+    auto future = std::make_shared<InsertFutureImpl>(tid, rows, options_.max_put_inflight);
+    if (!future->Init(tablets, status)) {
+        return false;
+    }
+    future->Start();
+    bool ok = future->Wait(status);
+    if (acked_cnt != nullptr) {
+        *acked_cnt = future->GetAckedCnt();
+    }
+    return ok;
+}
+
 bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& sql, std::shared_ptr<SQLInsertRows> rows,
                                      hybridse::sdk::Status* status) {
     if (!rows || !status) {
@@ -1281,19 +1552,51 @@ bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& s
             status->msg = "fail to get table " + table_info->name() + " tablet";
             return false;
         }
+        std::vector<std::shared_ptr<SQLInsertRow>> row_vec;
         for (uint32_t i = 0; i < rows->GetCnt(); ++i) {
-            std::shared_ptr<SQLInsertRow> row = rows->GetRow(i);
-            if (!PutRow(table_info->tid(), row, tablets, status)) {
-                return false;
-            }
+            row_vec.push_back(rows->GetRow(i));
         }
-        return true;
+        return PutRows(table_info->tid(), row_vec, tablets, status);
     } else {
         status->msg = "please use getInsertRow with " + sql + " first";
         return false;
     }
 }
 
+std::shared_ptr<InsertFuture> SQLClusterRouter::ExecuteInsertAsync(const std::string& db, const std::string& sql,
+                                                                   std::shared_ptr<SQLInsertRows> rows,
+                                                                   hybridse::sdk::Status* status) {
+    if (!rows || !status) {
+        LOG(WARNING) << "input is invalid";
+        return nullptr;
+    }
+    std::shared_ptr<SQLCache> cache = GetCache(db, sql, hybridse::vm::kBatchMode);
+    if (!cache) {
+        status->code = -1;
+        status->msg = "please use getInsertRow with " + sql + " first";
+        return nullptr;
+    }
+    std::shared_ptr<::openmldb::nameserver::TableInfo> table_info = cache->table_info;
+    std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>> tablets;
+    bool ret = cluster_sdk_->GetTablet(db, table_info->name(), &tablets);
+    if (!ret || tablets.empty()) {
+        status->code = -1;
+        status->msg = "fail to get table " + table_info->name() + " tablet";
+        return nullptr;
+    }
+    std::vector<std::shared_ptr<SQLInsertRow>> row_vec;
+    for (uint32_t i = 0; i < rows->GetCnt(); ++i) {
+        row_vec.push_back(rows->GetRow(i));
+    }
+    auto future = std::make_shared<InsertFutureImpl>(table_info->tid(), row_vec, options_.max_put_inflight);
+    if (!future->Init(tablets, status)) {
+        status->code = -1;
+        return nullptr;
+    }
+    future->Start();
+    return future;
+}
+
 bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& sql, std::shared_ptr<SQLInsertRow> row,
                                      hybridse::sdk::Status* status) {
     if (!row || !status) {
@@ -2746,15 +3049,35 @@ hybridse::sdk::Status SQLClusterRouter::HandleLoadDataInfile(
     if (!base::IsExists(file_path)) {
         return {::hybridse::common::StatusCode::kCmdError, "file not exist"};
     }
-    std::ifstream file(file_path);
-    if (!file.is_open()) {
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
         return {::hybridse::common::StatusCode::kCmdError, "open file failed"};
     }
-
-    std::string line;
-    if (!std::getline(file, line)) {
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(fd);
         return {::hybridse::common::StatusCode::kCmdError, "read from file failed"};
     }
+    uint64_t size = file_stat.st_size;
+    void* addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return {::hybridse::common::StatusCode::kCmdError, "mmap file failed"};
+    }
+    madvise(addr, size, MADV_SEQUENTIAL);
+    std::shared_ptr<void> mapped(addr, [size](void* p) { munmap(p, size); });
+    const char* data = static_cast<const char*>(addr);
+    const char* data_end = data + size;
+    auto next_line = [data_end](const char* pos) {
+        const char* eol = static_cast<const char*>(memchr(pos, '\n', data_end - pos));
+        return eol == nullptr ? data_end : eol + 1;
+    };
+
+    const char* pos = next_line(data);
+    std::string line(data, pos - data);
+    if (!line.empty() && line.back() == '\n') {
+        line.pop_back();
+    }
     std::vector<std::string> cols;
     ::openmldb::sdk::SplitLineWithDelimiterForStrings(line, options_parse.GetDelimiter(), &cols,
                                                       options_parse.GetQuote());
@@ -2773,8 +3096,9 @@ hybridse::sdk::Status SQLClusterRouter::HandleLoadDataInfile(
                 return {::hybridse::common::StatusCode::kCmdError, "mismatch column name"};
             }
         }
-        // then read the first row of data
-        std::getline(file, line);
+    } else {
+        // the first line is a row of data
+        pos = data;
     }
 
     // build placeholder
@@ -2782,7 +3106,6 @@ hybridse::sdk::Status SQLClusterRouter::HandleLoadDataInfile(
     for (auto i = 0; i < schema->GetColumnCnt(); ++i) {
         holders += ((i == 0) ? "?" : ",?");
     }
-    hybridse::sdk::Status status;
     std::string insert_placeholder = "insert into " + table + " values(" + holders + ");";
     std::vector<int> str_cols_idx;
     for (int i = 0; i < schema->GetColumnCnt(); ++i) {
@@ -2790,36 +3113,51 @@ hybridse::sdk::Status SQLClusterRouter::HandleLoadDataInfile(
             str_cols_idx.emplace_back(i);
         }
     }
-    uint64_t i = 0;
-    do {
-        cols.clear();
-        std::string error;
-        ::openmldb::sdk::SplitLineWithDelimiterForStrings(line, options_parse.GetDelimiter(), &cols,
-                                                          options_parse.GetQuote());
-        auto ret = InsertOneRow(database, insert_placeholder, str_cols_idx, options_parse.GetNullValue(), cols);
-        if (!ret.IsOK()) {
-            return {::hybridse::common::StatusCode::kCmdError, "line [" + line + "] insert failed, " + ret.msg};
-        }
-        ++i;
-    } while (std::getline(file, line));
-    return {0, "Load " + std::to_string(i) + " rows"};
-}
 
-hybridse::sdk::Status SQLClusterRouter::InsertOneRow(const std::string& database, const std::string& insert_placeholder,
-                                                     const std::vector<int>& str_col_idx, const std::string& null_value,
-                                                     const std::vector<std::string>& cols) {
-    if (cols.empty()) {
-        return {::hybridse::common::StatusCode::kCmdError, "cols is empty"};
-    }
-    if (database.empty()) {
-        return {::hybridse::common::StatusCode::kCmdError, "database is empty"};
+    // split the file into chunks at line ends, every chunk is loaded by one thread
+    uint64_t thread_num = options_parse.GetThread();
+    uint64_t chunk_size = std::max<uint64_t>((data_end - pos) / thread_num, 1);
+    std::atomic<bool> failed(false);
+    std::atomic<uint64_t> loaded_rows(0);
+    std::atomic<uint64_t> loaded_bytes(pos - data);
+    std::vector<std::future<hybridse::sdk::Status>> results;
+    while (pos < data_end) {
+        const char* end = data_end;
+        if (results.size() + 1 < thread_num && static_cast<uint64_t>(data_end - pos) > chunk_size) {
+            end = next_line(pos + chunk_size - 1);
+        }
+        results.emplace_back(std::async(std::launch::async, [&, pos, end] {
+            return LoadDataChunk(database, insert_placeholder, str_cols_idx, options_parse, pos, end, &failed,
+                                 &loaded_rows, &loaded_bytes);
+        }));
+        pos = end;
     }
     hybridse::sdk::Status status;
-    auto row = GetInsertRow(database, insert_placeholder, &status);
-    if (!row) {
-        return status;
+    for (auto& result : results) {
+        while (result.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+            std::string progress = "load " + file_path + ": " + std::to_string(loaded_rows.load()) + " rows, " +
+                                   std::to_string(loaded_bytes.load() * 100 / size) + "%";
+            if (interactive_) {
+                printf("%s\n", progress.c_str());
+            } else {
+                LOG(INFO) << progress;
+            }
+        }
+        auto ret = result.get();
+        if (!ret.IsOK() && status.IsOK()) {
+            status = ret;
+        }
+    }
+    if (!status.IsOK()) {
+        return {::hybridse::common::StatusCode::kCmdError, status.msg};
     }
-    // build row from cols
+    return {0, "Load " + std::to_string(loaded_rows.load()) + " rows"};
+}
+
+// fill the insert row with the values of one line
+static hybridse::sdk::Status FillInsertRow(const std::vector<int>& str_col_idx, const std::string& null_value,
+                                           const std::vector<std::string>& cols,
+                                           const std::shared_ptr<SQLInsertRow>& row) {
     auto& schema = row->GetSchema();
     auto cnt = schema->GetColumnCnt();
     if (cnt != static_cast<int>(cols.size())) {
@@ -2840,8 +3178,91 @@ hybridse::sdk::Status SQLClusterRouter::InsertOneRow(const std::string& database
             return {::hybridse::common::StatusCode::kCmdError, "translate to insert row failed"};
         }
     }
-    if (!ExecuteInsert(database, insert_placeholder, row, &status)) {
-        return {::hybridse::common::StatusCode::kCmdError, "insert row failed"};
+    return {};
+}
+
+hybridse::sdk::Status SQLClusterRouter::LoadDataChunk(const std::string& database,
+                                                      const std::string& insert_placeholder,
+                                                      const std::vector<int>& str_col_idx,
+                                                      const ReadFileOptionsParser& options_parse, const char* start,
+                                                      const char* end, std::atomic<bool>* failed,
+                                                      std::atomic<uint64_t>* loaded_rows,
+                                                      std::atomic<uint64_t>* loaded_bytes) {
+    size_t batch_size = std::max(FLAGS_put_batch_size, 1u);
+    hybridse::sdk::Status status;
+    std::shared_ptr<SQLInsertRows> rows;
+    // the rows of the last batch are being put while the next batch is parsed
+    std::shared_ptr<InsertFuture> future;
+    uint64_t future_rows = 0;
+    uint64_t future_bytes = 0;
+    uint64_t batch_bytes = 0;
+    auto wait_future = [&]() {
+        if (future) {
+            if (!future->Wait(&status)) {
+                failed->store(true);
+                return false;
+            }
+            loaded_rows->fetch_add(future_rows);
+            loaded_bytes->fetch_add(future_bytes);
+            future.reset();
+        }
+        return true;
+    };
+    auto put_batch = [&]() {
+        if (!wait_future()) {
+            return false;
+        }
+        future = ExecuteInsertAsync(database, insert_placeholder, rows, &status);
+        if (!future) {
+            failed->store(true);
+            return false;
+        }
+        future_rows = rows->GetCnt();
+        future_bytes = batch_bytes;
+        batch_bytes = 0;
+        rows.reset();
+        return true;
+    };
+    std::vector<std::string> cols;
+    std::string line;
+    const char* pos = start;
+    while (pos < end) {
+        if (failed->load(std::memory_order_relaxed)) {
+            // other thread fails, stop loading
+            wait_future();
+            return {};
+        }
+        const char* eol = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        if (eol == nullptr) {
+            eol = end;
+        }
+        line.assign(pos, eol - pos);
+        pos = eol == end ? end : eol + 1;
+        batch_bytes += line.size() + 1;
+        if (!rows) {
+            rows = GetInsertRows(database, insert_placeholder, &status);
+            if (!rows) {
+                failed->store(true);
+                return {::hybridse::common::StatusCode::kCmdError, "insert failed, " + status.msg};
+            }
+        }
+        cols.clear();
+        ::openmldb::sdk::SplitLineWithDelimiterForStrings(line, options_parse.GetDelimiter(), &cols,
+                                                          options_parse.GetQuote());
+        auto ret = FillInsertRow(str_col_idx, options_parse.GetNullValue(), cols, rows->NewRow());
+        if (!ret.IsOK()) {
+            failed->store(true);
+            return {::hybridse::common::StatusCode::kCmdError, "line [" + line + "] insert failed, " + ret.msg};
+        }
+        if (rows->GetCnt() >= batch_size && !put_batch()) {
+            return {::hybridse::common::StatusCode::kCmdError, "insert failed, " + status.msg};
+        }
+    }
+    if (rows && !put_batch()) {
+        return {::hybridse::common::StatusCode::kCmdError, "insert failed, " + status.msg};
+    }
+    if (!wait_future()) {
+        return {::hybridse::common::StatusCode::kCmdError, "insert failed, " + status.msg};
     }
     return {};
 }
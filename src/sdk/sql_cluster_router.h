@@ -17,6 +17,7 @@
 #ifndef SRC_SDK_SQL_CLUSTER_ROUTER_H_
 #define SRC_SDK_SQL_CLUSTER_ROUTER_H_
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <set>
@@ -42,6 +43,8 @@ typedef ::google::protobuf::RepeatedPtrField<::openmldb::common::ColumnDesc> PBS
 
 constexpr const char* FORMAT_STRING_KEY = "!%$FORMAT_STRING_KEY";
 
+class ReadFileOptionsParser;
+
 static std::shared_ptr<::hybridse::sdk::Schema> ConvertToSchema(
     std::shared_ptr<::openmldb::nameserver::TableInfo> table_info) {
     ::hybridse::vm::Schema schema;
@@ -137,6 +140,10 @@ class SQLClusterRouter : public SQLRouter {
     bool ExecuteInsert(const std::string& db, const std::string& sql, std::shared_ptr<SQLInsertRows> rows,
                        hybridse::sdk::Status* status) override;
 
+    std::shared_ptr<InsertFuture> ExecuteInsertAsync(const std::string& db, const std::string& sql,
+                                                     std::shared_ptr<SQLInsertRows> rows,
+                                                     hybridse::sdk::Status* status) override;
+
     std::shared_ptr<TableReader> GetTableReader() override;
 
     std::shared_ptr<ExplainInfo> Explain(const std::string& db, const std::string& sql,
@@ -303,6 +310,12 @@ class SQLClusterRouter : public SQLRouter {
                 const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
                 ::hybridse::sdk::Status* status);
 
+    // put the rows to every partition with batch requests, the tablets are put concurrently.
+    // acked_cnt is set to the count of rows put to all their partitions if it is not null
+    bool PutRows(uint32_t tid, const std::vector<std::shared_ptr<SQLInsertRow>>& rows,
+                 const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
+                 ::hybridse::sdk::Status* status, size_t* acked_cnt = nullptr);
+
     bool IsConstQuery(::hybridse::vm::PhysicalOpNode* node);
     std::shared_ptr<SQLCache> GetCache(const std::string& db, const std::string& sql,
                                        const hybridse::vm::EngineMode engine_mode);
@@ -348,9 +361,11 @@ class SQLClusterRouter : public SQLRouter {
             const std::string& table, const std::string& file_path,
             const std::shared_ptr<hybridse::node::OptionsMap>& options);
 
-    hybridse::sdk::Status InsertOneRow(const std::string& database,
-            const std::string& insert_placeholder, const std::vector<int>& str_col_idx,
-            const std::string& null_value, const std::vector<std::string>& cols);
+    // load the lines in [start, end) of the file, the rows are put with async batch requests
+    hybridse::sdk::Status LoadDataChunk(const std::string& database, const std::string& insert_placeholder,
+            const std::vector<int>& str_col_idx, const ReadFileOptionsParser& options_parse,
+            const char* start, const char* end, std::atomic<bool>* failed,
+            std::atomic<uint64_t>* loaded_rows, std::atomic<uint64_t>* loaded_bytes);
 
     hybridse::sdk::Status HandleDeploy(const hybridse::node::DeployPlanNode* deploy_node);
 
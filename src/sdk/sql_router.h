@@ -40,6 +40,12 @@ struct BasicRouterOptions {
     bool enable_debug = false;
     uint32_t max_sql_cache_size = 10;
     uint32_t request_timeout = 60000;
+    // the max put requests in flight to one tablet for insert
+    uint32_t max_put_inflight = 4;
+    // the rows of batch query are pushed by the tablet in chunks and read lazily instead of being truncated
+    // by the max response size, up to stream_max_chunks chunks are buffered
+    bool stream_batch_query = false;
+    uint32_t stream_max_chunks = 4;
 };
 
 struct SQLRouterOptions : BasicRouterOptions {
@@ -75,6 +81,18 @@ class QueryFuture {
     virtual bool IsDone() const = 0;
 };
 
+class InsertFuture {
+ public:
+    InsertFuture() {}
+    virtual ~InsertFuture() {}
+
+    // wait until all rows are put, return false if any of them fails
+    virtual bool Wait(hybridse::sdk::Status* status) = 0;
+    virtual bool IsDone() const = 0;
+    // the count of rows put to all their partitions so far
+    virtual size_t GetAckedCnt() const = 0;
+};
+
 class SQLRouter {
  public:
     SQLRouter() {}
@@ -98,6 +116,11 @@ class SQLRouter {
     virtual bool ExecuteInsert(const std::string& db, const std::string& sql,
                                std::shared_ptr<openmldb::sdk::SQLInsertRows> row, hybridse::sdk::Status* status) = 0;
 
+    // put the rows without waiting, the rows of different tablets are sent concurrently
+    virtual std::shared_ptr<openmldb::sdk::InsertFuture> ExecuteInsertAsync(
+        const std::string& db, const std::string& sql, std::shared_ptr<openmldb::sdk::SQLInsertRows> rows,
+        hybridse::sdk::Status* status) = 0;
+
     virtual std::shared_ptr<openmldb::sdk::TableReader> GetTableReader() = 0;
 
     virtual std::shared_ptr<ExplainInfo> Explain(const std::string& db, const std::string& sql,
@@ -322,6 +322,53 @@ TEST_F(SQLRouterTest, test_sql_insert_placeholder) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(SQLRouterTest, test_sql_insert_async) {
+    SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = mc_->GetZkCluster();
+    sql_opt.zk_path = mc_->GetZkPath();
+    sql_opt.max_put_inflight = 2;
+    auto router = NewClusterSQLRouter(sql_opt);
+    ASSERT_TRUE(router != nullptr);
+    std::string name = "test" + GenRand();
+    std::string db = "db" + GenRand();
+    ::hybridse::sdk::Status status;
+    bool ok = router->CreateDB(db, &status);
+    ASSERT_TRUE(ok);
+    std::string ddl = "create table " + name +
+                      "("
+                      "col1 string, col2 bigint,"
+                      "index(key=col1, ts=col2)) options(partitionnum=8);";
+    ok = router->ExecuteDDL(db, ddl, &status);
+    ASSERT_TRUE(ok);
+    ASSERT_TRUE(router->RefreshCatalog());
+
+    std::string insert_placeholder = "insert into " + name + " values(?, ?);";
+    std::shared_ptr<SQLInsertRows> insert_rows = router->GetInsertRows(db, insert_placeholder, &status);
+    ASSERT_EQ(status.code, 0);
+    for (int i = 0; i < 100; i++) {
+        std::string key = "key" + std::to_string(i % 10);
+        std::shared_ptr<SQLInsertRow> row = insert_rows->NewRow();
+        ASSERT_TRUE(row->Init(key.size()));
+        ASSERT_TRUE(row->AppendString(key));
+        ASSERT_TRUE(row->AppendInt64(1000 + i));
+        ASSERT_TRUE(row->Build());
+    }
+    auto future = router->ExecuteInsertAsync(db, insert_placeholder, insert_rows, &status);
+    ASSERT_TRUE(future != nullptr) << status.msg;
+    ASSERT_TRUE(future->Wait(&status)) << status.msg;
+    ASSERT_TRUE(future->IsDone());
+
+    std::string sql_select = "select col1, col2 from " + name + ";";
+    auto rs = router->ExecuteSQL(db, sql_select, &status);
+    ASSERT_TRUE(rs != nullptr);
+    ASSERT_EQ(100, rs->Size());
+
+    ok = router->ExecuteDDL(db, "drop table " + name + ";", &status);
+    ASSERT_TRUE(ok);
+    ok = router->DropDB(db, &status);
+    ASSERT_TRUE(ok);
+}
+
 TEST_F(SQLRouterTest, test_sql_insert_with_column_list) {
     SQLRouterOptions sql_opt;
     sql_opt.zk_cluster = mc_->GetZkCluster();
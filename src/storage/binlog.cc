@@ -29,9 +29,13 @@
 #include "gflags/gflags.h"
 #include "log/log_writer.h"
 #include "log/status.h"
+#include "storage/table_loader.h"
 
 DECLARE_uint64(gc_on_table_recover_count);
 DECLARE_int32(binlog_name_length);
+DECLARE_uint32(load_table_batch);
+DECLARE_uint32(load_table_thread_num);
+DECLARE_uint32(load_table_queue_size);
 
 namespace openmldb {
 namespace storage {
@@ -52,6 +56,9 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
     uint64_t consumed = ::baidu::common::timer::now_time();
     int last_log_index = log_reader.GetLogIndex();
     bool reach_end_log = true;
+    // the puts are applied in parallel by segment, a delete waits for the puts before it
+    TableLoader loader(table, FLAGS_load_table_thread_num, FLAGS_load_table_batch, FLAGS_load_table_queue_size);
+    TableLoader::Writer writer(&loader);
     while (true) {
         buffer.clear();
         ::openmldb::base::Slice record;
@@ -111,12 +118,15 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
             if (entry.dimensions_size() == 0) {
                 PDLOG(WARNING, "no dimesion. tid %u pid %u offset %lu", tid, pid, entry.log_index());
             } else {
+                writer.Flush();
+                loader.Wait();
                 table->Delete(entry.dimensions(0).key(), entry.dimensions(0).idx());
             }
+            cur_offset = entry.log_index();
         } else {
-            table->Put(entry);
+            cur_offset = entry.log_index();
+            writer.Put(&entry);
         }
-        cur_offset = entry.log_index();
         succ_cnt++;
         if (succ_cnt % 100000 == 0) {
             PDLOG(INFO,
@@ -128,6 +138,8 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
             table->SchedGc();
         }
     }
+    writer.Flush();
+    loader.Wait();
     latest_offset = cur_offset;
     if (!reach_end_log) {
         int log_index = log_reader.GetLogIndex();
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/cold_block.h"
+
+#include <assert.h>
+
+#include <algorithm>
+
+namespace openmldb {
+namespace storage {
+
+static inline void PutVarint64(std::string* dst, uint64_t v) {
+    while (v >= 0x80) {
+        dst->push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    dst->push_back(static_cast<char>(v));
+}
+
+static inline uint64_t GetVarint64(const std::string& src, uint32_t* offset) {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift <= 63; shift += 7) {
+        uint64_t byte = static_cast<unsigned char>(src[(*offset)++]);
+        result |= (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    return result;
+}
+
+void ColdBlockBuilder::Add(uint64_t time, const char* data, uint32_t size, bool owned) {
+    if (block_ == NULL) {
+        block_ = new ColdBlock();
+        block_->max_time_ = time;
+    }
+    assert(block_->count_ == 0 || time <= last_time_);
+    if (block_->count_ % ColdBlock::kChunkRows == 0) {
+        block_->chunks_.push_back({time, static_cast<uint32_t>(block_->meta_.size()),
+                                   static_cast<uint32_t>(block_->data_.size())});
+    } else {
+        PutVarint64(&block_->meta_, last_time_ - time);
+    }
+    // the lowest bit marks the owned row
+    PutVarint64(&block_->meta_, (static_cast<uint64_t>(size) << 1) | (owned ? 1 : 0));
+    block_->data_.append(data, size);
+    block_->min_time_ = time;
+    block_->count_++;
+    if (owned) {
+        block_->owned_count_++;
+    }
+    last_time_ = time;
+}
+
+ColdBlock* ColdBlockBuilder::Finish() {
+    ColdBlock* block = block_;
+    block_ = NULL;
+    if (block != NULL) {
+        block->chunks_.shrink_to_fit();
+        block->meta_.shrink_to_fit();
+        block->data_.shrink_to_fit();
+    }
+    return block;
+}
+
+ColdBlock::Iterator::Iterator(ColdBlock* block)
+    : head_(block), block_(NULL), idx_(0), meta_offset_(0), data_offset_(0), size_(0), time_(0), owned_(false) {}
+
+void ColdBlock::Iterator::SeekToChunk(ColdBlock* block, uint32_t chunk) {
+    block_ = block;
+    if (block_ == NULL) {
+        return;
+    }
+    const Chunk& c = block_->chunks_[chunk];
+    idx_ = chunk * kChunkRows;
+    meta_offset_ = c.meta_offset;
+    data_offset_ = c.data_offset;
+    time_ = c.max_time;
+    ParseRow(true);
+}
+
+void ColdBlock::Iterator::ParseRow(bool chunk_start) {
+    if (!chunk_start) {
+        time_ -= GetVarint64(block_->meta_, &meta_offset_);
+    }
+    uint64_t value = GetVarint64(block_->meta_, &meta_offset_);
+    size_ = static_cast<uint32_t>(value >> 1);
+    owned_ = (value & 1) == 1;
+}
+
+void ColdBlock::Iterator::Next() {
+    assert(Valid());
+    idx_++;
+    if (idx_ >= block_->count_) {
+        SeekToChunk(block_->GetNext(), 0);
+        return;
+    }
+    data_offset_ += size_;
+    if (idx_ % kChunkRows == 0) {
+        time_ = block_->chunks_[idx_ / kChunkRows].max_time;
+        ParseRow(true);
+    } else {
+        ParseRow(false);
+    }
+}
+
+void ColdBlock::Iterator::Seek(uint64_t time) {
+    ColdBlock* block = head_;
+    while (block != NULL && block->min_time_ > time) {
+        block = block->GetNext();
+    }
+    if (block == NULL) {
+        block_ = NULL;
+        return;
+    }
+    // the first chunk whose max time is not greater than time, the target is in it or the chunk before
+    auto it = std::lower_bound(block->chunks_.begin(), block->chunks_.end(), time,
+                               [](const Chunk& c, uint64_t t) { return c.max_time > t; });
+    uint32_t chunk = it - block->chunks_.begin();
+    SeekToChunk(block, chunk > 0 ? chunk - 1 : 0);
+    while (Valid() && time_ > time) {
+        Next();
+    }
+}
+
+void ColdBlock::Iterator::SeekToFirst() { SeekToChunk(head_, 0); }
+
+void ColdBlock::Iterator::SeekToLast() {
+    ColdBlock* block = head_;
+    if (block == NULL) {
+        block_ = NULL;
+        return;
+    }
+    while (block->GetNext() != NULL) {
+        block = block->GetNext();
+    }
+    SeekToChunk(block, block->chunks_.size() - 1);
+    while (idx_ + 1 < block_->count_) {
+        Next();
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
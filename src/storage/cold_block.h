@@ -0,0 +1,150 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_COLD_BLOCK_H_
+#define SRC_STORAGE_COLD_BLOCK_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "base/slice.h"
+
+namespace openmldb {
+namespace storage {
+
+// ColdBlock is an immutable and compact copy of the old rows of a time list. The times are delta
+// encoded and the rows are stored one after another in one buffer, so a row costs a few bytes besides
+// its data instead of a DataBlock and a skiplist node. The rows are kept as they are, the slice returned
+// by the iterator is valid as long as the block.
+// The blocks of a key entry are chained from the newest to the oldest and their time ranges don't overlap.
+class ColdBlock {
+ public:
+    // the start of every chunk records the full time and offsets, Seek jumps to it by binary search
+    static constexpr uint32_t kChunkRows = 16;
+
+    ~ColdBlock() {}
+
+    ColdBlock(const ColdBlock&) = delete;
+    ColdBlock& operator=(const ColdBlock&) = delete;
+
+    uint32_t GetCount() const { return count_; }
+
+    // the count of rows whose data block was freed by this index when they were frozen
+    uint32_t GetOwnedCount() const { return owned_count_; }
+
+    uint64_t GetMaxTime() const { return max_time_; }
+
+    uint64_t GetMinTime() const { return min_time_; }
+
+    // the memory held by the block
+    uint64_t GetByteSize() const {
+        return sizeof(ColdBlock) + chunks_.capacity() * sizeof(Chunk) + meta_.capacity() + data_.capacity();
+    }
+
+    ColdBlock* GetNext() const { return next_.load(std::memory_order_acquire); }
+
+    void SetNext(ColdBlock* next) { next_.store(next, std::memory_order_release); }
+
+    // Iterator goes through the block and the blocks chained after it in time desc order
+    class Iterator {
+     public:
+        explicit Iterator(ColdBlock* block);
+        ~Iterator() {}
+
+        bool Valid() const { return block_ != NULL; }
+
+        void Next();
+
+        // seek to the first row whose time is not greater than the given one
+        void Seek(uint64_t time);
+
+        void SeekToFirst();
+
+        void SeekToLast();
+
+        const uint64_t& GetKey() const { return time_; }
+
+        ::openmldb::base::Slice GetValue() const {
+            return ::openmldb::base::Slice(block_->data_.data() + data_offset_, size_);
+        }
+
+        bool IsOwned() const { return owned_; }
+
+        // the block of the current row
+        ColdBlock* GetBlock() const { return block_; }
+
+     private:
+        void SeekToChunk(ColdBlock* block, uint32_t chunk);
+        void ParseRow(bool chunk_start);
+
+     private:
+        ColdBlock* head_;
+        ColdBlock* block_;
+        uint32_t idx_;
+        uint32_t meta_offset_;
+        uint32_t data_offset_;
+        uint32_t size_;
+        uint64_t time_;
+        bool owned_;
+    };
+
+ private:
+    friend class ColdBlockBuilder;
+
+    struct Chunk {
+        uint64_t max_time;
+        uint32_t meta_offset;
+        uint32_t data_offset;
+    };
+
+    ColdBlock() : count_(0), owned_count_(0), max_time_(0), min_time_(0), next_(NULL) {}
+
+ private:
+    uint32_t count_;
+    uint32_t owned_count_;
+    uint64_t max_time_;
+    uint64_t min_time_;
+    std::vector<Chunk> chunks_;
+    // the time delta and size of every row
+    std::string meta_;
+    std::string data_;
+    std::atomic<ColdBlock*> next_;
+};
+
+class ColdBlockBuilder {
+ public:
+    ColdBlockBuilder() : block_(NULL), last_time_(0) {}
+    ~ColdBlockBuilder() { delete block_; }
+
+    // the rows must be added in time desc order
+    void Add(uint64_t time, const char* data, uint32_t size, bool owned);
+
+    uint32_t GetCount() const { return block_ == NULL ? 0 : block_->count_; }
+
+    // return NULL if no row is added
+    ColdBlock* Finish();
+
+ private:
+    ColdBlock* block_;
+    uint64_t last_time_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_COLD_BLOCK_H_
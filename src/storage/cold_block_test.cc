@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/cold_block.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace storage {
+
+class ColdBlockTest : public ::testing::Test {
+ public:
+    ColdBlockTest() {}
+    ~ColdBlockTest() {}
+};
+
+// the times are from max_time down to max_time - (cnt - 1) * step
+static ColdBlock* BuildBlock(uint64_t max_time, uint32_t cnt, uint64_t step) {
+    ColdBlockBuilder builder;
+    for (uint32_t i = 0; i < cnt; i++) {
+        uint64_t time = max_time - i * step;
+        std::string value = "value" + std::to_string(time);
+        builder.Add(time, value.c_str(), value.size(), i % 2 == 0);
+    }
+    return builder.Finish();
+}
+
+TEST_F(ColdBlockTest, Build) {
+    ColdBlockBuilder builder;
+    ASSERT_EQ(0u, builder.GetCount());
+    ASSERT_TRUE(builder.Finish() == NULL);
+    ColdBlock* block = BuildBlock(1000, 100, 3);
+    ASSERT_EQ(100u, block->GetCount());
+    ASSERT_EQ(50u, block->GetOwnedCount());
+    ASSERT_EQ(1000u, block->GetMaxTime());
+    ASSERT_EQ(703u, block->GetMinTime());
+    ASSERT_GT(block->GetByteSize(), 100u * 8);
+    ColdBlock::Iterator it(block);
+    it.SeekToFirst();
+    uint32_t cnt = 0;
+    while (it.Valid()) {
+        uint64_t time = 1000 - cnt * 3;
+        ASSERT_EQ(time, it.GetKey());
+        ASSERT_EQ("value" + std::to_string(time), it.GetValue().ToString());
+        ASSERT_EQ(cnt % 2 == 0, it.IsOwned());
+        ASSERT_EQ(block, it.GetBlock());
+        it.Next();
+        cnt++;
+    }
+    ASSERT_EQ(100u, cnt);
+    it.SeekToLast();
+    ASSERT_TRUE(it.Valid());
+    ASSERT_EQ(703u, it.GetKey());
+    it.Next();
+    ASSERT_FALSE(it.Valid());
+    delete block;
+}
+
+TEST_F(ColdBlockTest, Seek) {
+    ColdBlock* block = BuildBlock(1000, 100, 3);
+    ColdBlock::Iterator it(block);
+    it.Seek(2000);
+    ASSERT_TRUE(it.Valid());
+    ASSERT_EQ(1000u, it.GetKey());
+    // seek to the start and the middle of chunks
+    for (uint64_t time = 1000; time >= 703; time -= 3) {
+        it.Seek(time);
+        ASSERT_TRUE(it.Valid());
+        ASSERT_EQ(time, it.GetKey());
+        ASSERT_EQ("value" + std::to_string(time), it.GetValue().ToString());
+        it.Seek(time - 1);
+        if (time == 703) {
+            ASSERT_FALSE(it.Valid());
+        } else {
+            ASSERT_TRUE(it.Valid());
+            ASSERT_EQ(time - 3, it.GetKey());
+        }
+    }
+    delete block;
+}
+
+TEST_F(ColdBlockTest, Chain) {
+    ColdBlock* b1 = BuildBlock(1000, 20, 1);
+    ColdBlock* b2 = BuildBlock(500, 40, 2);
+    ColdBlock* b3 = BuildBlock(100, 1, 1);
+    b1->SetNext(b2);
+    b2->SetNext(b3);
+    ColdBlock::Iterator it(b1);
+    it.SeekToFirst();
+    uint32_t cnt = 0;
+    uint64_t last = UINT64_MAX;
+    while (it.Valid()) {
+        ASSERT_LT(it.GetKey(), last);
+        last = it.GetKey();
+        it.Next();
+        cnt++;
+    }
+    ASSERT_EQ(61u, cnt);
+    // the time between two blocks
+    it.Seek(600);
+    ASSERT_TRUE(it.Valid());
+    ASSERT_EQ(500u, it.GetKey());
+    ASSERT_EQ(b2, it.GetBlock());
+    it.Seek(423);
+    ASSERT_EQ(422u, it.GetKey());
+    it.Next();
+    ASSERT_EQ(100u, it.GetKey());
+    ASSERT_EQ(b3, it.GetBlock());
+    it.SeekToLast();
+    ASSERT_EQ(100u, it.GetKey());
+    it.Seek(99);
+    ASSERT_FALSE(it.Valid());
+    delete b1;
+    delete b2;
+    delete b3;
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/disk_row_cache.h"
+
+namespace openmldb {
+namespace storage {
+
+// the memory taken by an entry besides the key and the rows
+static constexpr uint64_t ENTRY_OVERHEAD = 96;
+
+DiskRowCache::DiskRowCache(uint64_t capacity, uint32_t max_key_rows)
+    : shard_capacity_(capacity / kShardNum > 0 ? capacity / kShardNum : 1),
+      max_key_rows_(max_key_rows),
+      hit_cnt_(0),
+      miss_cnt_(0) {}
+
+std::string DiskRowCache::GetKey(uint32_t cf_id, uint32_t ts_idx, const std::string& pk) {
+    std::string key;
+    key.reserve(sizeof(cf_id) + sizeof(ts_idx) + pk.size());
+    key.append(reinterpret_cast<const char*>(&cf_id), sizeof(cf_id));
+    key.append(reinterpret_cast<const char*>(&ts_idx), sizeof(ts_idx));
+    key.append(pk);
+    return key;
+}
+
+std::shared_ptr<const DiskRowCache::Rows> DiskRowCache::Lookup(const std::string& key) {
+    Shard& shard = GetShard(std::hash<std::string>()(key));
+    std::lock_guard<std::mutex> lock(shard.mu);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end() || it->second->rows->too_many) {
+        miss_cnt_.fetch_add(1, std::memory_order_relaxed);
+        return it == shard.entries.end() ? NULL : it->second->rows;
+    }
+    hit_cnt_.fetch_add(1, std::memory_order_relaxed);
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->rows;
+}
+
+uint64_t DiskRowCache::GetVersion(const std::string& key) {
+    size_t hash = std::hash<std::string>()(key);
+    Shard& shard = GetShard(hash);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    return shard.versions[GetVersionSlot(hash)];
+}
+
+void DiskRowCache::Insert(const std::string& key, std::shared_ptr<const Rows> rows, uint64_t version) {
+    uint64_t charge = ENTRY_OVERHEAD + key.size() * 2;
+    for (const auto& row : rows->rows) {
+        charge += sizeof(row) + row.second.capacity();
+    }
+    if (charge > shard_capacity_) {
+        return;
+    }
+    size_t hash = std::hash<std::string>()(key);
+    Shard& shard = GetShard(hash);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    if (shard.versions[GetVersionSlot(hash)] != version) {
+        return;
+    }
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        shard.usage -= it->second->charge;
+        shard.lru.erase(it->second);
+        shard.entries.erase(it);
+    }
+    while (shard.usage + charge > shard_capacity_ && !shard.lru.empty()) {
+        Entry& last = shard.lru.back();
+        shard.usage -= last.charge;
+        shard.entries.erase(last.key);
+        shard.lru.pop_back();
+    }
+    shard.lru.push_front(Entry{key, std::move(rows), charge});
+    shard.entries.emplace(key, shard.lru.begin());
+    shard.usage += charge;
+}
+
+void DiskRowCache::Invalidate(const std::string& key) {
+    size_t hash = std::hash<std::string>()(key);
+    Shard& shard = GetShard(hash);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    shard.versions[GetVersionSlot(hash)]++;
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        shard.usage -= it->second->charge;
+        shard.lru.erase(it->second);
+        shard.entries.erase(it);
+    }
+}
+
+uint64_t DiskRowCache::GetByteSize() {
+    uint64_t size = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mu);
+        size += shard.usage;
+    }
+    return size;
+}
+
+uint64_t DiskRowCache::GetKeyCnt() {
+    uint64_t cnt = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mu);
+        cnt += shard.entries.size();
+    }
+    return cnt;
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_DISK_ROW_CACHE_H_
+#define SRC_STORAGE_DISK_ROW_CACHE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace openmldb {
+namespace storage {
+
+// DiskRowCache keeps the rows of the hot keys of a disk table in memory, so the window and point lookups of them
+// don't seek and copy out of the rocksdb blocks. The rows of a key are cached as a whole and the key is invalidated
+// when it's put or deleted. The least recently used keys are evicted when the cache is full.
+// The rows read on a miss are dropped if a key of the same version slot is invalidated in the meantime. There are
+// kVersionNum slots, so a busy table only drops the rows of the few keys which share a slot with the written ones.
+class DiskRowCache {
+ public:
+    struct Rows {
+        // the key has more rows than max_key_rows, it's always read from rocksdb
+        bool too_many = false;
+        // the time and the row in time desc order
+        std::vector<std::pair<uint64_t, std::string>> rows;
+    };
+
+    DiskRowCache(uint64_t capacity, uint32_t max_key_rows);
+
+    DiskRowCache(const DiskRowCache&) = delete;
+    DiskRowCache& operator=(const DiskRowCache&) = delete;
+
+    // cf_id is the column family of the index, ts_idx is UINT32_MAX if the key has no ts column id
+    static std::string GetKey(uint32_t cf_id, uint32_t ts_idx, const std::string& pk);
+
+    // return NULL if the key is not cached
+    std::shared_ptr<const Rows> Lookup(const std::string& key);
+
+    // get the version before reading the rows to insert, the rows are dropped if the key is invalidated in between
+    uint64_t GetVersion(const std::string& key);
+
+    void Insert(const std::string& key, std::shared_ptr<const Rows> rows, uint64_t version);
+
+    // it should be called after the put or delete is written
+    void Invalidate(const std::string& key);
+
+    uint32_t GetMaxKeyRows() const { return max_key_rows_; }
+    uint64_t GetHitCnt() const { return hit_cnt_.load(std::memory_order_relaxed); }
+    uint64_t GetMissCnt() const { return miss_cnt_.load(std::memory_order_relaxed); }
+    uint64_t GetByteSize();
+    uint64_t GetKeyCnt();
+
+ private:
+    static constexpr uint32_t kShardNum = 16;
+    static constexpr uint32_t kVersionNum = 4096;
+
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const Rows> rows;
+        uint64_t charge;
+    };
+
+    struct Shard {
+        std::mutex mu;
+        // the most recently used entry is at the front
+        std::list<Entry> lru;
+        std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+        uint64_t usage = 0;
+        // versions[i] is increased by every invalidation of the keys in the slot i of the shard
+        uint64_t versions[kVersionNum / kShardNum] = {};
+    };
+
+    Shard& GetShard(size_t hash) { return shards_[hash % kShardNum]; }
+
+    static uint32_t GetVersionSlot(size_t hash) { return (hash / kShardNum) % (kVersionNum / kShardNum); }
+
+ private:
+    const uint64_t shard_capacity_;
+    const uint32_t max_key_rows_;
+    Shard shards_[kShardNum];
+    std::atomic<uint64_t> hit_cnt_;
+    std::atomic<uint64_t> miss_cnt_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_DISK_ROW_CACHE_H_
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/disk_row_cache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace storage {
+
+class DiskRowCacheTest : public ::testing::Test {
+ public:
+    DiskRowCacheTest() {}
+    ~DiskRowCacheTest() {}
+};
+
+static std::shared_ptr<DiskRowCache::Rows> GenRows(uint32_t cnt, uint32_t row_size) {
+    auto rows = std::make_shared<DiskRowCache::Rows>();
+    for (uint32_t i = 0; i < cnt; i++) {
+        rows->rows.emplace_back(1000 - i, std::string(row_size, 'a' + i % 26));
+    }
+    return rows;
+}
+
+TEST_F(DiskRowCacheTest, LookupAndInsert) {
+    DiskRowCache cache(1024 * 1024, 100);
+    std::string key = DiskRowCache::GetKey(1, UINT32_MAX, "pk1");
+    ASSERT_NE(key, DiskRowCache::GetKey(1, 0, "pk1"));
+    ASSERT_NE(key, DiskRowCache::GetKey(2, UINT32_MAX, "pk1"));
+    ASSERT_TRUE(cache.Lookup(key) == NULL);
+    ASSERT_EQ(1u, cache.GetMissCnt());
+    cache.Insert(key, GenRows(10, 16), cache.GetVersion(key));
+    auto rows = cache.Lookup(key);
+    ASSERT_TRUE(rows != NULL);
+    ASSERT_EQ(10u, rows->rows.size());
+    ASSERT_EQ(1000u, rows->rows[0].first);
+    ASSERT_EQ(1u, cache.GetHitCnt());
+    ASSERT_EQ(1u, cache.GetKeyCnt());
+    ASSERT_GT(cache.GetByteSize(), 160u);
+
+    cache.Invalidate(key);
+    ASSERT_TRUE(cache.Lookup(key) == NULL);
+    ASSERT_EQ(0u, cache.GetKeyCnt());
+    ASSERT_EQ(0u, cache.GetByteSize());
+    // the rows are still valid after the key is invalidated
+    ASSERT_EQ(10u, rows->rows.size());
+}
+
+TEST_F(DiskRowCacheTest, InvalidateBeforeInsert) {
+    DiskRowCache cache(1024 * 1024, 100);
+    std::string key = DiskRowCache::GetKey(1, UINT32_MAX, "pk1");
+    uint64_t version = cache.GetVersion(key);
+    // a put happens between reading the rows and inserting them
+    cache.Invalidate(key);
+    cache.Insert(key, GenRows(10, 16), version);
+    ASSERT_TRUE(cache.Lookup(key) == NULL);
+    cache.Insert(key, GenRows(11, 16), cache.GetVersion(key));
+    auto rows = cache.Lookup(key);
+    ASSERT_TRUE(rows != NULL);
+    ASSERT_EQ(11u, rows->rows.size());
+}
+
+TEST_F(DiskRowCacheTest, InvalidateOtherKeys) {
+    DiskRowCache cache(64 * 1024 * 1024, 100);
+    std::vector<std::string> keys;
+    std::vector<uint64_t> versions;
+    for (int i = 0; i < 100; i++) {
+        keys.push_back(DiskRowCache::GetKey(1, UINT32_MAX, "pk" + std::to_string(i)));
+        versions.push_back(cache.GetVersion(keys.back()));
+    }
+    // the puts of other keys only drop the rows of the keys in the same version slot
+    for (int i = 0; i < 100; i++) {
+        cache.Invalidate(DiskRowCache::GetKey(1, UINT32_MAX, "other" + std::to_string(i)));
+    }
+    for (int i = 0; i < 100; i++) {
+        cache.Insert(keys[i], GenRows(10, 16), versions[i]);
+    }
+    ASSERT_GE(cache.GetKeyCnt(), 90u);
+}
+
+TEST_F(DiskRowCacheTest, TooMany) {
+    DiskRowCache cache(1024 * 1024, 10);
+    ASSERT_EQ(10u, cache.GetMaxKeyRows());
+    std::string key = DiskRowCache::GetKey(1, UINT32_MAX, "pk1");
+    auto marker = std::make_shared<DiskRowCache::Rows>();
+    marker->too_many = true;
+    cache.Insert(key, marker, cache.GetVersion(key));
+    auto rows = cache.Lookup(key);
+    ASSERT_TRUE(rows != NULL);
+    ASSERT_TRUE(rows->too_many);
+    ASSERT_EQ(0u, cache.GetHitCnt());
+    ASSERT_EQ(1u, cache.GetMissCnt());
+}
+
+TEST_F(DiskRowCacheTest, Evict) {
+    // every shard can hold about 2 keys of 10 rows of 100 bytes
+    DiskRowCache cache(16 * 2500, 100);
+    for (uint32_t i = 0; i < 200; i++) {
+        std::string key = DiskRowCache::GetKey(1, UINT32_MAX, "pk" + std::to_string(i));
+        cache.Insert(key, GenRows(10, 100), cache.GetVersion(key));
+    }
+    ASSERT_LE(cache.GetByteSize(), 16 * 2500u);
+    ASSERT_GT(cache.GetKeyCnt(), 0u);
+    ASSERT_LT(cache.GetKeyCnt(), 200u);
+    // the last key is the most recently used one of its shard
+    ASSERT_TRUE(cache.Lookup(DiskRowCache::GetKey(1, UINT32_MAX, "pk199")) != NULL);
+    // a key larger than a shard is not cached
+    std::string key = DiskRowCache::GetKey(1, UINT32_MAX, "large");
+    cache.Insert(key, GenRows(10, 1000), cache.GetVersion(key));
+    ASSERT_TRUE(cache.Lookup(key) == NULL);
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
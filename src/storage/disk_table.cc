@@ -15,13 +15,20 @@
  */
 
 #include "storage/disk_table.h"
+#include <algorithm>
 #include <utility>
 #include "base/file_util.h"
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/hash.h"
 #include "config.h"  // NOLINT
+#include "rocksdb/convenience.h"
+#include "rocksdb/table_properties.h"
 
 DECLARE_bool(disable_wal);
+DECLARE_bool(disk_gc_compact_range);
+DECLARE_bool(disk_table_single_copy);
+DECLARE_uint32(disk_row_cache_mb);
+DECLARE_uint32(disk_row_cache_max_key_rows);
 DECLARE_uint32(max_traverse_cnt);
 
 DECLARE_string(file_compression);
@@ -35,7 +42,70 @@ namespace storage {
 
 static rocksdb::Options ssd_option_template;
 static rocksdb::Options hdd_option_template;
+static std::shared_ptr<rocksdb::TableFactory> row_table_factory;
 static bool options_template_initialized = false;
+static const uint32_t MAX_ROW_READ_AHEAD = 64;
+
+// the ref count of a row which is marked not referred has this bit, and the count is followed by the sequence
+// it's found not referred at
+static const uint32_t ROW_UNREFERRED_FLAG = 0x80000000;
+
+// the row of single copy layout: the ref count, the inner pos, the key size and the key of every index entry,
+// then the row data
+static void EncodeRow(const std::vector<std::pair<uint32_t, std::string>>& refs, const std::string& data,
+                      std::string* row) {
+    uint32_t cnt = refs.size();
+    row->clear();
+    row->append(reinterpret_cast<const char*>(&cnt), sizeof(cnt));
+    for (const auto& ref : refs) {
+        uint32_t key_size = ref.second.size();
+        row->append(reinterpret_cast<const char*>(&ref.first), sizeof(ref.first));
+        row->append(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+        row->append(ref.second);
+    }
+    row->append(data);
+}
+
+// call the func with the inner pos and the key of every ref until it returns true, and set data to the row data
+template <typename Func>
+static bool DecodeRow(const rocksdb::Slice& row, Func func, rocksdb::Slice* data) {
+    const char* ptr = row.data();
+    const char* end = row.data() + row.size();
+    uint32_t cnt = 0;
+    if (end - ptr < static_cast<int64_t>(sizeof(cnt))) {
+        return false;
+    }
+    memcpy(&cnt, ptr, sizeof(cnt));
+    ptr += sizeof(cnt);
+    if (cnt & ROW_UNREFERRED_FLAG) {
+        if (end - ptr < static_cast<int64_t>(sizeof(uint64_t))) {
+            return false;
+        }
+        cnt &= ~ROW_UNREFERRED_FLAG;
+        ptr += sizeof(uint64_t);
+    }
+    for (uint32_t i = 0; i < cnt; i++) {
+        uint32_t inner_pos = 0;
+        uint32_t key_size = 0;
+        if (end - ptr < static_cast<int64_t>(sizeof(inner_pos) + sizeof(key_size))) {
+            return false;
+        }
+        memcpy(&inner_pos, ptr, sizeof(inner_pos));
+        memcpy(&key_size, ptr + sizeof(inner_pos), sizeof(key_size));
+        ptr += sizeof(inner_pos) + sizeof(key_size);
+        if (end - ptr < key_size) {
+            return false;
+        }
+        if (func(inner_pos, rocksdb::Slice(ptr, key_size))) {
+            return true;
+        }
+        ptr += key_size;
+    }
+    if (data != NULL) {
+        *data = rocksdb::Slice(ptr, end - ptr);
+    }
+    return true;
+}
 
 DiskTable::DiskTable(const std::string& name, uint32_t id, uint32_t pid, const std::map<std::string, uint32_t>& mapping,
                      uint64_t ttl, ::openmldb::type::TTLType ttl_type, ::openmldb::common::StorageMode storage_mode,
@@ -44,7 +114,14 @@ DiskTable::DiskTable(const std::string& name, uint32_t id, uint32_t pid, const s
             ::openmldb::type::CompressType::kNoCompress),
       write_opts_(),
       offset_(0),
-      table_path_(table_path) {
+      table_path_(table_path),
+      single_copy_(false),
+      row_cf_(NULL),
+      row_id_(0),
+      row_gc_ready_(false),
+      ttl_ready_(false),
+      has_range_del_(false),
+      row_cache_() {
     if (!options_template_initialized) {
         initOptionTemplate();
     }
@@ -58,7 +135,14 @@ DiskTable::DiskTable(const ::openmldb::api::TableMeta& table_meta, const std::st
             ::openmldb::type::CompressType::kNoCompress),
       write_opts_(),
       offset_(0),
-      table_path_(table_path) {
+      table_path_(table_path),
+      single_copy_(false),
+      row_cf_(NULL),
+      row_id_(0),
+      row_gc_ready_(false),
+      ttl_ready_(false),
+      has_range_del_(false),
+      row_cache_() {
     if (!options_template_initialized) {
         initOptionTemplate();
     }
@@ -69,6 +153,12 @@ DiskTable::DiskTable(const ::openmldb::api::TableMeta& table_meta, const std::st
 }
 
 DiskTable::~DiskTable() {
+    if (db_ != nullptr) {
+        // the filters read the index column families
+        row_gc_ready_.store(false, std::memory_order_release);
+        ttl_ready_.store(false, std::memory_order_release);
+        rocksdb::CancelAllBackgroundWork(db_, true);
+    }
     for (auto handle : cf_hs_) {
         delete handle;
     }
@@ -101,8 +191,8 @@ void DiskTable::initOptionTemplate() {
     // table_options.cache_index_and_filter_blocks = true;
     // table_options.pin_l0_filter_and_index_blocks_in_cache = true;
     table_options.block_cache = cache;
-    // table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10,
-    // false));
+    // the bloom filter is built on the prefix of KeyTsPrefixTransform, so it works for the seek and get of a pk
+    table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
     table_options.whole_key_filtering = false;
     table_options.block_size = 256 << 10;
     table_options.use_delta_encoding = false;
@@ -123,6 +213,10 @@ void DiskTable::initOptionTemplate() {
     if (FLAGS_verify_compression) table_options.verify_compression = true;
 #endif
     ssd_option_template.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+    // the rows of single copy layout are read by row id
+    rocksdb::BlockBasedTableOptions row_table_options = table_options;
+    row_table_options.whole_key_filtering = true;
+    row_table_factory.reset(rocksdb::NewBlockBasedTableFactory(row_table_options));
     // HDD options template
     hdd_option_template.max_open_files = -1;
     hdd_option_template.env->SetBackgroundThreads(1, rocksdb::Env::Priority::HIGH);  // flush threads
@@ -164,13 +258,19 @@ bool DiskTable::InitColumnFamilyDescriptor() {
         cfo.prefix_extractor.reset(new KeyTsPrefixTransform());
         const auto& indexs = inner_index->GetIndex();
         auto index_def = indexs.front();
-        if (index_def->GetTTLType() == ::openmldb::storage::TTLType::kAbsoluteTime ||
-            index_def->GetTTLType() == ::openmldb::storage::TTLType::kAbsOrLat) {
-            cfo.compaction_filter_factory = std::make_shared<AbsoluteTTLFilterFactory>(inner_index);
-        }
+        // the ttl may be updated, so the filter is set for all ttl types
+        cfo.compaction_filter_factory = std::make_shared<TTLFilterFactory>(this, inner_index);
         cf_ds_.push_back(rocksdb::ColumnFamilyDescriptor(index_def->GetName(), cfo));
         DEBUGLOG("add cf_name %s. tid %u pid %u", index_def->GetName().c_str(), id_, pid_);
     }
+    if (single_copy_) {
+        rocksdb::ColumnFamilyOptions cfo(storage_mode_ == ::openmldb::common::StorageMode::kSSD
+                                             ? ssd_option_template
+                                             : hdd_option_template);
+        cfo.table_factory = row_table_factory;
+        cfo.compaction_filter_factory = std::make_shared<RowRefFilterFactory>(this);
+        cf_ds_.push_back(rocksdb::ColumnFamilyDescriptor(ROW_CF_NAME, cfo));
+    }
     return true;
 }
 
@@ -178,7 +278,6 @@ bool DiskTable::Init() {
     if (!InitFromMeta()) {
         return false;
     }
-    InitColumnFamilyDescriptor();
     std::string path = table_path_ + "/data";
     if (!openmldb::base::IsExists(path)) {
         PDLOG(INFO, "Create new disk table with path %s", path);
@@ -188,6 +287,14 @@ bool DiskTable::Init() {
         PDLOG(WARNING, "fail to create path %s", path.c_str());
         return false;
     }
+    // the layout of an existing table is kept
+    std::vector<std::string> cf_names;
+    if (rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(), path, &cf_names).ok()) {
+        single_copy_ = std::find(cf_names.begin(), cf_names.end(), ROW_CF_NAME) != cf_names.end();
+    } else {
+        single_copy_ = FLAGS_disk_table_single_copy;
+    }
+    InitColumnFamilyDescriptor();
     options_.create_if_missing = true;
     options_.error_if_exists = false;
     options_.create_missing_column_families = true;
@@ -196,6 +303,30 @@ bool DiskTable::Init() {
         PDLOG(WARNING, "rocksdb open failed. tid %u pid %u error %s", id_, pid_, s.ToString().c_str());
         return false;
     }
+    for (size_t i = 1; i < cf_hs_.size() && !has_range_del_.load(std::memory_order_relaxed); i++) {
+        rocksdb::TablePropertiesCollection props;
+        s = db_->GetPropertiesOfAllTables(cf_hs_[i], &props);
+        bool found = !s.ok();
+        for (const auto& kv : props) {
+            found = found || kv.second->num_range_deletions > 0;
+        }
+        has_range_del_.store(found, std::memory_order_relaxed);
+    }
+    ttl_ready_.store(true, std::memory_order_release);
+    if (single_copy_) {
+        row_cf_ = cf_hs_.back();
+        rocksdb::Iterator* it = db_->NewIterator(rocksdb::ReadOptions(), row_cf_);
+        it->SeekToLast();
+        row_id_.store(it->Valid() ? DecodeRowId(it->key()) + 1 : 0, std::memory_order_relaxed);
+        delete it;
+        row_gc_ready_.store(true, std::memory_order_release);
+        PDLOG(INFO, "disk table stores the rows once. tid %u pid %u next row id %lu", id_, pid_,
+              row_id_.load(std::memory_order_relaxed));
+    }
+    if (FLAGS_disk_row_cache_mb > 0) {
+        row_cache_.reset(new DiskRowCache(static_cast<uint64_t>(FLAGS_disk_row_cache_mb) * 1024 * 1024,
+                                          FLAGS_disk_row_cache_max_key_rows));
+    }
     PDLOG(INFO, "Open DB. tid %u pid %u ColumnFamilyHandle size %u with data path %s", id_, pid_, GetIdxCnt(),
           path.c_str());
     return true;
@@ -205,9 +336,22 @@ bool DiskTable::Put(const std::string& pk, uint64_t time, const char* data, uint
     rocksdb::Status s;
     std::string combine_key = CombineKeyTs(pk, time);
     rocksdb::Slice spk = rocksdb::Slice(combine_key);
-    s = db_->Put(write_opts_, cf_hs_[1], spk, rocksdb::Slice(data, size));
+    if (row_cf_ != NULL) {
+        std::string row_id = EncodeRowId(row_id_.fetch_add(1, std::memory_order_relaxed));
+        std::string row;
+        EncodeRow({std::make_pair(0u, combine_key)}, std::string(data, size), &row);
+        rocksdb::WriteBatch batch;
+        batch.Put(cf_hs_[1], spk, row_id);
+        batch.Put(row_cf_, row_id, row);
+        s = db_->Write(write_opts_, &batch);
+    } else {
+        s = db_->Put(write_opts_, cf_hs_[1], spk, rocksdb::Slice(data, size));
+    }
     if (s.ok()) {
         offset_.fetch_add(1, std::memory_order_relaxed);
+        if (row_cache_) {
+            InvalidateRowCache({DiskRowCache::GetKey(cf_hs_[1]->GetID(), UINT32_MAX, pk)});
+        }
         return true;
     } else {
         DEBUGLOG("Put failed. tid %u pid %u msg %s", id_, pid_, s.ToString().c_str());
@@ -218,6 +362,12 @@ bool DiskTable::Put(const std::string& pk, uint64_t time, const char* data, uint
 bool DiskTable::Put(uint64_t time, const std::string& value, const Dimensions& dimensions) {
     rocksdb::WriteBatch batch;
     rocksdb::Status s;
+    std::string row_id;
+    std::vector<std::pair<uint32_t, std::string>> refs;
+    std::vector<std::string> cache_keys;
+    if (row_cf_ != NULL) {
+        row_id = EncodeRowId(row_id_.fetch_add(1, std::memory_order_relaxed));
+    }
     Dimensions::const_iterator it = dimensions.begin();
     for (; it != dimensions.end(); ++it) {
         const int8_t* data = reinterpret_cast<const int8_t*>(value.data());
@@ -246,19 +396,34 @@ bool DiskTable::Put(uint64_t time, const std::string& value, const Dimensions& d
                     PDLOG(WARNING, "get ts failed. tid %u pid %u", id_, pid_);
                     return false;
                 }
-                if (inner_index->GetIndex().size() > 1) {
-                    combine_key = CombineKeyTs(it->key(), ts, ts_col->GetId());
+                uint32_t ts_idx = inner_index->GetIndex().size() > 1 ? ts_col->GetId() : UINT32_MAX;
+                if (ts_idx != UINT32_MAX) {
+                    combine_key = CombineKeyTs(it->key(), ts, ts_idx);
                 } else {
                     combine_key = CombineKeyTs(it->key(), ts);
                 }
+                if (row_cache_) {
+                    cache_keys.push_back(DiskRowCache::GetKey(cf_hs_[inner_pos + 1]->GetID(), ts_idx, it->key()));
+                }
                 rocksdb::Slice spk = rocksdb::Slice(combine_key);
-                batch.Put(cf_hs_[inner_pos + 1], spk, value);
+                if (row_cf_ != NULL) {
+                    batch.Put(cf_hs_[inner_pos + 1], spk, row_id);
+                    refs.emplace_back(inner_pos, std::move(combine_key));
+                } else {
+                    batch.Put(cf_hs_[inner_pos + 1], spk, value);
+                }
             }
         }
     }
+    if (!refs.empty()) {
+        std::string row;
+        EncodeRow(refs, value, &row);
+        batch.Put(row_cf_, row_id, row);
+    }
     s = db_->Write(write_opts_, &batch);
     if (s.ok()) {
         offset_.fetch_add(1, std::memory_order_relaxed);
+        InvalidateRowCache(cache_keys);
         return true;
     } else {
         DEBUGLOG("Put failed. tid %u pid %u msg %s", id_, pid_, s.ToString().c_str());
@@ -272,7 +437,10 @@ bool DiskTable::Delete(const std::string& pk, uint32_t idx) {
     if (!index_def) {
         return false;
     }
+    // the ttl filters created later check the live keys
+    has_range_del_.store(true, std::memory_order_release);
     auto inner_index = table_index_.GetInnerIndex(index_def->GetInnerPos());
+    std::vector<std::string> cache_keys;
     if (inner_index && inner_index->GetIndex().size() > 1) {
         const auto& indexs = inner_index->GetIndex();
         for (const auto& index : indexs) {
@@ -283,15 +451,22 @@ bool DiskTable::Delete(const std::string& pk, uint32_t idx) {
             std::string combine_key1 = CombineKeyTs(pk, UINT64_MAX, ts_col->GetId());
             std::string combine_key2 = CombineKeyTs(pk, 0, ts_col->GetId());
             batch.DeleteRange(cf_hs_[idx + 1], rocksdb::Slice(combine_key1), rocksdb::Slice(combine_key2));
+            if (row_cache_) {
+                cache_keys.push_back(DiskRowCache::GetKey(cf_hs_[idx + 1]->GetID(), ts_col->GetId(), pk));
+            }
         }
     } else {
         std::string combine_key1 = CombineKeyTs(pk, UINT64_MAX);
         std::string combine_key2 = CombineKeyTs(pk, 0);
         batch.DeleteRange(cf_hs_[idx + 1], rocksdb::Slice(combine_key1), rocksdb::Slice(combine_key2));
+        if (row_cache_) {
+            cache_keys.push_back(DiskRowCache::GetKey(cf_hs_[idx + 1]->GetID(), UINT32_MAX, pk));
+        }
     }
     rocksdb::Status s = db_->Write(write_opts_, &batch);
     if (s.ok()) {
         offset_.fetch_add(1, std::memory_order_relaxed);
+        InvalidateRowCache(cache_keys);
         return true;
     } else {
         DEBUGLOG("Delete failed. tid %u pid %u msg %s", id_, pid_, s.ToString().c_str());
@@ -321,118 +496,42 @@ void DiskTable::SchedGc() {
 }
 
 void DiskTable::GcHead() {
+    if (!FLAGS_disk_gc_compact_range) {
+        return;
+    }
     uint64_t start_time = ::baidu::common::timer::get_micros() / 1000;
+    bool compacted = false;
     auto inner_indexs = table_index_.GetAllInnerIndex();
     for (const auto& inner_index : *inner_indexs) {
-        uint32_t idx = inner_index->GetId();
-        rocksdb::ReadOptions ro = rocksdb::ReadOptions();
-        const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
-        ro.snapshot = snapshot;
-        // ro.prefix_same_as_start = true;
-        ro.pin_data = true;
-        rocksdb::Iterator* it = db_->NewIterator(ro, cf_hs_[idx + 1]);
-        it->SeekToFirst();
-        const auto& indexs = inner_index->GetIndex();
-        if (indexs.size() > 1) {
-            bool need_ttl = false;
-            std::map<uint32_t, uint64_t> ttl_map;
-            for (const auto& index : indexs) {
-                auto ts_col = index->GetTsColumn();
-                if (ts_col) {
-                    auto lat_ttl = index->GetTTL()->lat_ttl;
-                    if (lat_ttl > 0) {
-                        ttl_map.emplace(ts_col->GetId(), lat_ttl);
-                        need_ttl = true;
-                    }
-                }
-            }
-            if (!need_ttl) {
-                continue;
-            }
-            std::map<uint32_t, uint32_t> key_cnt;
-            std::map<uint32_t, uint64_t> delete_key_map;
-            std::string last_pk;
-            while (it->Valid()) {
-                std::string cur_pk;
-                uint64_t ts = 0;
-                uint32_t ts_idx = 0;
-                ParseKeyAndTs(true, it->key(), cur_pk, ts, ts_idx);
-                if (!last_pk.empty() && cur_pk == last_pk) {
-                    auto ttl_iter = ttl_map.find(ts_idx);
-                    if (ttl_iter != ttl_map.end() && ttl_iter->second > 0) {
-                        auto key_cnt_iter = key_cnt.find(ts_idx);
-                        if (key_cnt_iter == key_cnt.end()) {
-                            key_cnt.insert(std::make_pair(ts_idx, 1));
-                        } else {
-                            key_cnt_iter->second++;
-                        }
-                        if (key_cnt_iter->second > ttl_iter->second &&
-                            delete_key_map.find(ts_idx) == delete_key_map.end()) {
-                            delete_key_map.insert(std::make_pair(ts_idx, ts));
-                        }
-                    }
-                } else {
-                    for (const auto& kv : delete_key_map) {
-                        std::string combine_key1 = CombineKeyTs(last_pk, kv.second, kv.first);
-                        std::string combine_key2 = CombineKeyTs(last_pk, 0, kv.first);
-                        rocksdb::Status s = db_->DeleteRange(write_opts_, cf_hs_[idx + 1], rocksdb::Slice(combine_key1),
-                                                             rocksdb::Slice(combine_key2));
-                        if (!s.ok()) {
-                            PDLOG(WARNING, "Delete failed. tid %u pid %u msg %s", id_, pid_, s.ToString().c_str());
-                        }
-                    }
-                    delete_key_map.clear();
-                    key_cnt.clear();
-                    key_cnt.insert(std::make_pair(ts_idx, 1));
-                    last_pk = cur_pk;
-                }
-                it->Next();
-            }
-            for (const auto& kv : delete_key_map) {
-                std::string combine_key1 = CombineKeyTs(last_pk, kv.second, kv.first);
-                std::string combine_key2 = CombineKeyTs(last_pk, 0, kv.first);
-                rocksdb::Status s = db_->DeleteRange(write_opts_, cf_hs_[idx + 1], rocksdb::Slice(combine_key1),
-                                                     rocksdb::Slice(combine_key2));
-                if (!s.ok()) {
-                    PDLOG(WARNING, "Delete failed. tid %u pid %u msg %s", id_, pid_, s.ToString().c_str());
-                }
-            }
-        } else {
-            auto index = indexs.front();
-            auto ttl_num = index->GetTTL()->lat_ttl;
-            if (ttl_num < 1) {
-                continue;
-            }
-            std::string last_pk;
-            uint64_t count = 0;
-            while (it->Valid()) {
-                std::string cur_pk;
-                uint64_t ts = 0;
-                ParseKeyAndTs(it->key(), cur_pk, ts);
-                if (!last_pk.empty() && cur_pk == last_pk) {
-                    if (ts == 0 || count < ttl_num) {
-                        it->Next();
-                        count++;
-                        continue;
-                    } else {
-                        std::string combine_key1 = CombineKeyTs(cur_pk, ts);
-                        std::string combine_key2 = CombineKeyTs(cur_pk, 0);
-                        rocksdb::Status s = db_->DeleteRange(write_opts_, cf_hs_[idx + 1], rocksdb::Slice(combine_key1),
-                                                             rocksdb::Slice(combine_key2));
-                        if (!s.ok()) {
-                            PDLOG(WARNING, "Delete failed. tid %u pid %u msg %s", id_, pid_, s.ToString().c_str());
-                        }
-                        it->Seek(rocksdb::Slice(combine_key2));
-                    }
-                } else {
-                    count = 1;
-                    last_pk = cur_pk;
-                    it->Next();
-                }
+        bool need_gc = false;
+        for (const auto& index : inner_index->GetIndex()) {
+            auto ttl = index->GetTTL();
+            if (ttl->ttl_type != ::openmldb::storage::TTLType::kAbsoluteTime && ttl->lat_ttl > 0 && ttl->NeedGc()) {
+                need_gc = true;
+                break;
             }
         }
-        delete it;
-        db_->ReleaseSnapshot(snapshot);
+        if (!need_gc) {
+            continue;
+        }
+        // the rows out of latest ttl are dropped by TTLCompactionFilter
+        uint32_t idx = inner_index->GetId();
+        rocksdb::CompactRangeOptions options;
+        options.exclusive_manual_compaction = false;
+        rocksdb::Status s = db_->CompactRange(options, cf_hs_[idx + 1], nullptr, nullptr);
+        if (!s.ok()) {
+            PDLOG(WARNING, "compact failed. tid %u pid %u idx %u msg %s", id_, pid_, idx, s.ToString().c_str());
+        }
+        compacted = true;
+    }
+    if (compacted && row_cf_ != NULL) {
+        // the rows of the dropped entries are dropped by RowRefCompactionFilter
+        rocksdb::CompactRangeOptions options;
+        options.exclusive_manual_compaction = false;
+        rocksdb::Status s = db_->CompactRange(options, row_cf_, nullptr, nullptr);
+        if (!s.ok()) {
+            PDLOG(WARNING, "compact rows failed. tid %u pid %u msg %s", id_, pid_, s.ToString().c_str());
+        }
     }
     uint64_t time_used = ::baidu::common::timer::get_micros() / 1000 - start_time;
     PDLOG(INFO, "Gc used %lu second. tid %u pid %u", time_used / 1000, id_, pid_);
@@ -472,6 +571,345 @@ int DiskTable::CreateCheckPoint(const std::string& checkpoint_dir) {
     return 0;
 }
 
+rocksdb::Iterator* DiskTable::NewIndexIterator(const rocksdb::ReadOptions& ro, uint32_t inner_pos) {
+    return NewDiskIndexIterator(db_, ro, cf_hs_[inner_pos + 1], row_cf_);
+}
+
+bool DiskTable::IsRowReferred(const rocksdb::Slice& row_id, const rocksdb::Slice& row) const {
+    if (!row_gc_ready_.load(std::memory_order_acquire)) {
+        return true;
+    }
+    bool referred = false;
+    // the entries are read once by the filter, so they are kept out of the block cache
+    rocksdb::ReadOptions ro;
+    ro.fill_cache = false;
+    bool ok = DecodeRow(
+        row,
+        [this, &ro, &row_id, &referred](uint32_t inner_pos, const rocksdb::Slice& key) {
+            // the row column family is the last one
+            if (inner_pos + 2 >= cf_hs_.size()) {
+                return false;
+            }
+            rocksdb::PinnableSlice value;
+            rocksdb::Status s = db_->Get(ro, cf_hs_[inner_pos + 1], key, &value);
+            // keep the row if the entry can not be read
+            referred = s.ok() ? value == row_id : !s.IsNotFound();
+            return referred;
+        },
+        NULL);
+    return !ok || referred;
+}
+
+rocksdb::Iterator* DiskTable::NewTTLIterator(uint32_t inner_pos) const {
+    if (!ttl_ready_.load(std::memory_order_acquire) || inner_pos + 1 >= cf_hs_.size()) {
+        return NULL;
+    }
+    rocksdb::ReadOptions ro;
+    ro.prefix_same_as_start = true;
+    return db_->NewIterator(ro, cf_hs_[inner_pos + 1]);
+}
+
+uint32_t TTLCompactionFilter::GetLiveRecordIdx(const rocksdb::Slice& prefix, uint64_t ts, uint32_t lat_ttl) const {
+    if (!live_loaded_) {
+        live_loaded_ = true;
+        if (!it_) {
+            it_.reset(table_->NewTTLIterator(inner_pos_));
+        }
+        if (!it_) {
+            return 1;
+        }
+        // the max ts is the first key of the prefix
+        std::string start(prefix.data(), prefix.size());
+        start.append(TS_LEN, static_cast<char>(0xFF));
+        for (it_->Seek(rocksdb::Slice(start)); it_->Valid() && live_ts_.size() < lat_ttl; it_->Next()) {
+            rocksdb::Slice cur = it_->key();
+            if (cur.size() != prefix.size() + TS_LEN || memcmp(cur.data(), prefix.data(), prefix.size()) != 0) {
+                break;
+            }
+            uint64_t cur_ts = 0;
+            memcpy(static_cast<void*>(&cur_ts), cur.data() + prefix.size(), TS_LEN);
+            memrev64ifbe(static_cast<void*>(&cur_ts));
+            live_ts_.push_back(cur_ts);
+        }
+    }
+    // the keys come in ts desc order too
+    while (live_pos_ < live_ts_.size() && live_ts_[live_pos_] > ts) {
+        live_pos_++;
+    }
+    return live_pos_ + 1;
+}
+
+bool TTLCompactionFilter::Filter(int /*level*/, const rocksdb::Slice& key, const rocksdb::Slice& /*existing_value*/,
+                                 std::string* /*new_value*/, bool* /*value_changed*/) const {
+    uint32_t len = has_ts_idx_ ? TS_LEN + TS_POS_LEN : TS_LEN;
+    if (key.size() < len) {
+        return false;
+    }
+    rocksdb::Slice prefix(key.data(), key.size() - TS_LEN);
+    if (prefix != rocksdb::Slice(last_prefix_)) {
+        last_prefix_.assign(prefix.data(), prefix.size());
+        input_cnt_ = 0;
+        live_ts_.clear();
+        live_pos_ = 0;
+        live_loaded_ = false;
+    }
+    const TTLSt* ttl = &ttl_;
+    if (has_ts_idx_) {
+        uint32_t ts_idx = 0;
+        memcpy(static_cast<void*>(&ts_idx), key.data() + key.size() - len, TS_POS_LEN);
+        auto iter = ts_ttl_.find(ts_idx);
+        if (iter == ts_ttl_.end()) {
+            return false;
+        }
+        ttl = &iter->second;
+    }
+    uint64_t ts = 0;
+    memcpy(static_cast<void*>(&ts), key.data() + key.size() - TS_LEN, TS_LEN);
+    memrev64ifbe(static_cast<void*>(&ts));
+    uint32_t record_idx = 1;
+    if (ttl->ttl_type != ::openmldb::storage::TTLType::kAbsoluteTime && ttl->lat_ttl > 0) {
+        // the keys of a prefix come in ts desc order. the input has only a part of the live keys, so the
+        // count is not greater than the record idx if no key is hidden
+        record_idx = ++input_cnt_;
+        if (check_live_ && ttl->IsExpired(ts, record_idx)) {
+            record_idx = GetLiveRecordIdx(prefix, ts, ttl->lat_ttl);
+        }
+    }
+    return ttl->IsExpired(ts, record_idx);
+}
+
+uint64_t DiskTable::GetOldestVisibleSeq() const {
+    if (!row_gc_ready_.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    // the snapshots taken after it have a newer sequence
+    uint64_t seq = db_->GetLatestSequenceNumber();
+    uint64_t cnt = 0;
+    if (!db_->GetIntProperty("rocksdb.num-snapshots", &cnt)) {
+        return 0;
+    }
+    if (cnt == 0) {
+        return seq;
+    }
+    uint64_t oldest = 0;
+    if (!db_->GetIntProperty("rocksdb.oldest-snapshot-sequence", &oldest)) {
+        return 0;
+    }
+    return std::min(seq, oldest);
+}
+
+RowRefCompactionFilter::RowRefCompactionFilter(const DiskTable* table)
+    : table_(table), visible_seq_(table->GetOldestVisibleSeq()) {}
+
+bool RowRefCompactionFilter::Filter(int /*level*/, const rocksdb::Slice& key, const rocksdb::Slice& existing_value,
+                                    std::string* new_value, bool* value_changed) const {
+    uint32_t cnt = 0;
+    if (existing_value.size() < sizeof(cnt)) {
+        return false;
+    }
+    memcpy(&cnt, existing_value.data(), sizeof(cnt));
+    if (cnt & ROW_UNREFERRED_FLAG) {
+        uint64_t seq = UINT64_MAX;
+        if (existing_value.size() >= sizeof(cnt) + sizeof(seq)) {
+            memcpy(&seq, existing_value.data() + sizeof(cnt), sizeof(seq));
+        }
+        // no snapshot can see the entries which are removed before the mark
+        return seq <= visible_seq_;
+    }
+    if (table_->IsRowReferred(key, existing_value)) {
+        return false;
+    }
+    // the entries are removed before the sequence got after the check
+    uint64_t seq = table_->db_->GetLatestSequenceNumber();
+    cnt |= ROW_UNREFERRED_FLAG;
+    new_value->clear();
+    new_value->reserve(existing_value.size() + sizeof(seq));
+    new_value->append(reinterpret_cast<const char*>(&cnt), sizeof(cnt));
+    new_value->append(reinterpret_cast<const char*>(&seq), sizeof(seq));
+    new_value->append(existing_value.data() + sizeof(cnt), existing_value.size() - sizeof(cnt));
+    *value_changed = true;
+    return false;
+}
+
+rocksdb::Iterator* NewDiskIndexIterator(rocksdb::DB* db, const rocksdb::ReadOptions& ro,
+                                        rocksdb::ColumnFamilyHandle* index_cf, rocksdb::ColumnFamilyHandle* row_cf) {
+    if (row_cf == NULL) {
+        return db->NewIterator(ro, index_cf);
+    }
+    return new RowRefIterator(db, ro, index_cf, row_cf);
+}
+
+RowRefIterator::RowRefIterator(rocksdb::DB* db, const rocksdb::ReadOptions& ro, rocksdb::ColumnFamilyHandle* index_cf,
+                               rocksdb::ColumnFamilyHandle* row_cf)
+    : db_(db),
+      ro_(ro),
+      it_(db->NewIterator(ro, index_cf)),
+      row_cf_(row_cf),
+      read_ahead_(1),
+      pos_(0),
+      keys_(),
+      row_ids_(),
+      status_(),
+      fetched_(false),
+      fetch_pos_(0),
+      statuses_(),
+      rows_(NULL),
+      row_batches_() {}
+
+RowRefIterator::~RowRefIterator() { delete it_; }
+
+void RowRefIterator::SeekToFirst() {
+    status_ = rocksdb::Status::OK();
+    it_->SeekToFirst();
+    Fill(1);
+}
+
+void RowRefIterator::Seek(const rocksdb::Slice& target) {
+    status_ = rocksdb::Status::OK();
+    it_->Seek(target);
+    Fill(1);
+}
+
+void RowRefIterator::SeekToLast() {
+    status_ = rocksdb::Status::NotSupported("RowRefIterator only iterates forward");
+    keys_.clear();
+    pos_ = 0;
+}
+
+void RowRefIterator::SeekForPrev(const rocksdb::Slice& /*target*/) { SeekToLast(); }
+
+void RowRefIterator::Prev() { SeekToLast(); }
+
+void RowRefIterator::Next() {
+    pos_++;
+    if (pos_ >= keys_.size()) {
+        Fill(std::min(read_ahead_ * 2, MAX_ROW_READ_AHEAD));
+    }
+}
+
+void RowRefIterator::Fill(uint32_t size) {
+    read_ahead_ = size;
+    keys_.clear();
+    row_ids_.clear();
+    pos_ = 0;
+    fetched_ = false;
+    rows_ = NULL;
+    while (keys_.size() < size && it_->Valid()) {
+        rocksdb::Slice key = it_->key();
+        if (!keys_.empty()) {
+            // only read ahead the entries of the same prefix
+            const std::string& first = keys_.front();
+            if (key.size() != first.size() ||
+                memcmp(key.data(), first.data(), first.size() > TS_LEN ? first.size() - TS_LEN : 0) != 0) {
+                break;
+            }
+        }
+        keys_.emplace_back(key.data(), key.size());
+        row_ids_.emplace_back(it_->value().data(), it_->value().size());
+        it_->Next();
+    }
+}
+
+void RowRefIterator::Fetch() const {
+    size_t cnt = keys_.size() - pos_;
+    std::vector<rocksdb::Slice> ids;
+    ids.reserve(cnt);
+    for (size_t i = pos_; i < keys_.size(); i++) {
+        ids.emplace_back(row_ids_[i]);
+    }
+    row_batches_.emplace_back(new rocksdb::PinnableSlice[cnt]);
+    rows_ = row_batches_.back().get();
+    statuses_.assign(cnt, rocksdb::Status());
+    db_->MultiGet(ro_, row_cf_, cnt, ids.data(), rows_, statuses_.data());
+    fetch_pos_ = pos_;
+    fetched_ = true;
+}
+
+rocksdb::Slice RowRefIterator::value() const {
+    if (!fetched_) {
+        Fetch();
+    }
+    size_t idx = pos_ - fetch_pos_;
+    rocksdb::Slice data;
+    if (!statuses_[idx].ok()) {
+        // the row of an entry is kept while the entry can be seen, so it's an error even if it's not found
+        status_ = statuses_[idx].IsNotFound() ? rocksdb::Status::Corruption("the row of the entry is not found")
+                                              : statuses_[idx];
+    } else if (!DecodeRow(rows_[idx], [](uint32_t, const rocksdb::Slice&) { return false; }, &data)) {
+        status_ = rocksdb::Status::Corruption("fail to decode the row");
+    } else {
+        return data;
+    }
+    PDLOG(WARNING, "fail to read the row of the entry. %s", status_.ToString().c_str());
+    return rocksdb::Slice();
+}
+
+rocksdb::Status RowRefIterator::status() const {
+    if (!status_.ok()) {
+        return status_;
+    }
+    return it_->status();
+}
+
+// get the rows of the key from the row cache, they are read into it on miss. Return NULL if the cache is
+// disabled or the key has too many rows to cache
+static std::shared_ptr<const DiskRowCache::Rows> GetCachedRows(DiskRowCache* cache, rocksdb::DB* db,
+                                                               rocksdb::ColumnFamilyHandle* index_cf,
+                                                               rocksdb::ColumnFamilyHandle* row_cf, bool has_ts_idx,
+                                                               uint32_t ts_idx, const std::string& pk) {
+    if (cache == NULL) {
+        return NULL;
+    }
+    std::string key = DiskRowCache::GetKey(index_cf->GetID(), has_ts_idx ? ts_idx : UINT32_MAX, pk);
+    std::shared_ptr<const DiskRowCache::Rows> cached = cache->Lookup(key);
+    if (cached) {
+        return cached->too_many ? NULL : cached;
+    }
+    uint64_t version = cache->GetVersion(key);
+    auto rows = std::make_shared<DiskRowCache::Rows>();
+    // the rows are read from a snapshot taken after the version, so a write not in it invalidates the key
+    // and the rows are dropped by Insert
+    const rocksdb::Snapshot* snapshot = db->GetSnapshot();
+    rocksdb::ReadOptions ro = rocksdb::ReadOptions();
+    ro.snapshot = snapshot;
+    ro.prefix_same_as_start = true;
+    ro.pin_data = true;
+    std::unique_ptr<rocksdb::Iterator> it(NewDiskIndexIterator(db, ro, index_cf, row_cf));
+    std::string combine_key = has_ts_idx ? CombineKeyTs(pk, UINT64_MAX, ts_idx) : CombineKeyTs(pk, UINT64_MAX);
+    std::string cur_pk;
+    uint64_t ts = 0;
+    for (it->Seek(rocksdb::Slice(combine_key)); it->Valid(); it->Next()) {
+        uint32_t cur_ts_idx = UINT32_MAX;
+        ParseKeyAndTs(has_ts_idx, it->key(), cur_pk, ts, cur_ts_idx);
+        if (cur_pk != pk || (has_ts_idx && cur_ts_idx != ts_idx)) {
+            break;
+        }
+        if (rows->rows.size() >= cache->GetMaxKeyRows()) {
+            rows->too_many = true;
+            rows->rows.clear();
+            break;
+        }
+        rows->rows.emplace_back(ts, it->value().ToString());
+    }
+    bool ok = it->status().ok();
+    it.reset();
+    db->ReleaseSnapshot(snapshot);
+    if (!ok) {
+        return NULL;
+    }
+    cache->Insert(key, rows, version);
+    return rows->too_many ? NULL : rows;
+}
+
+void DiskTable::InvalidateRowCache(const std::vector<std::string>& keys) {
+    if (!row_cache_) {
+        return;
+    }
+    for (const auto& key : keys) {
+        row_cache_->Invalidate(key);
+    }
+}
+
 TableIterator* DiskTable::NewIterator(const std::string& pk, Ticket& ticket) {
     return DiskTable::NewIterator(0, pk, ticket);
 }
@@ -484,17 +922,27 @@ TableIterator* DiskTable::NewIterator(uint32_t idx, const std::string& pk, Ticke
     }
     uint32_t inner_pos = index_def->GetInnerPos();
     auto inner_index = table_index_.GetInnerIndex(inner_pos);
+    bool has_ts_idx = false;
+    uint32_t ts_idx = 0;
+    if (inner_index && inner_index->GetIndex().size() > 1) {
+        auto ts_col = index_def->GetTsColumn();
+        if (ts_col) {
+            has_ts_idx = true;
+            ts_idx = ts_col->GetId();
+        }
+    }
+    auto rows = GetCachedRows(row_cache_.get(), db_, cf_hs_[inner_pos + 1], row_cf_, has_ts_idx, ts_idx, pk);
+    if (rows) {
+        return new DiskTableCacheIterator(rows, pk);
+    }
     rocksdb::ReadOptions ro = rocksdb::ReadOptions();
     const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
     ro.snapshot = snapshot;
     ro.prefix_same_as_start = true;
     ro.pin_data = true;
-    rocksdb::Iterator* it = db_->NewIterator(ro, cf_hs_[inner_pos + 1]);
-    if (inner_index && inner_index->GetIndex().size() > 1) {
-        auto ts_col = index_def->GetTsColumn();
-        if (ts_col) {
-            return new DiskTableIterator(db_, it, snapshot, pk, ts_col->GetId());
-        }
+    rocksdb::Iterator* it = NewIndexIterator(ro, inner_pos);
+    if (has_ts_idx) {
+        return new DiskTableIterator(db_, it, snapshot, pk, ts_idx);
     }
     return new DiskTableIterator(db_, it, snapshot, pk);
 }
@@ -512,9 +960,10 @@ TraverseIterator* DiskTable::NewTraverseIterator(uint32_t index) {
     rocksdb::ReadOptions ro = rocksdb::ReadOptions();
     const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
     ro.snapshot = snapshot;
-    // ro.prefix_same_as_start = true;
+    // it goes over all pks, so the prefix bloom filter should not be used on seek
+    ro.total_order_seek = true;
     ro.pin_data = true;
-    rocksdb::Iterator* it = db_->NewIterator(ro, cf_hs_[inner_pos + 1]);
+    rocksdb::Iterator* it = NewIndexIterator(ro, inner_pos);
     if (inner_index && inner_index->GetIndex().size() > 1) {
         auto ts_col = index_def->GetTsColumn();
         if (ts_col) {
@@ -846,23 +1295,26 @@ void DiskTableTraverseIterator::NextPK() {
     rocksdb::ReadOptions ro = rocksdb::ReadOptions();
     const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
     ro.snapshot = snapshot;
-    // ro.prefix_same_as_start = true;
+    // it goes over all pks, so the prefix bloom filter should not be used on seek
+    ro.total_order_seek = true;
     ro.pin_data = true;
     rocksdb::Iterator* it = db_->NewIterator(ro, cf_hs_[inner_pos + 1]);
     if (inner_index && inner_index->GetIndex().size() > 1) {
         auto ts_col = index_def->GetTsColumn();
         if (ts_col) {
             return new DiskTableKeyIterator(db_, it, snapshot, ttl->ttl_type, expire_time, expire_cnt,
-                                                 ts_col->GetId(), cf_hs_[inner_pos + 1]);
+                                            ts_col->GetId(), cf_hs_[inner_pos + 1], row_cf_, row_cache_.get());
         }
     }
-    return new DiskTableKeyIterator(db_, it, snapshot, ttl->ttl_type, expire_time, expire_cnt, cf_hs_[inner_pos + 1]);
+    return new DiskTableKeyIterator(db_, it, snapshot, ttl->ttl_type, expire_time, expire_cnt, cf_hs_[inner_pos + 1],
+                                    row_cf_, row_cache_.get());
 }
 
 DiskTableKeyIterator::DiskTableKeyIterator(rocksdb::DB* db, rocksdb::Iterator* it,
                                            const rocksdb::Snapshot* snapshot, ::openmldb::storage::TTLType ttl_type,
                                            const uint64_t& expire_time, const uint64_t& expire_cnt,
-                                           rocksdb::ColumnFamilyHandle* column_handle)
+                                           rocksdb::ColumnFamilyHandle* column_handle,
+                                           rocksdb::ColumnFamilyHandle* row_handle, DiskRowCache* row_cache)
     : db_(db),
       it_(it),
       snapshot_(snapshot),
@@ -871,12 +1323,15 @@ DiskTableKeyIterator::DiskTableKeyIterator(rocksdb::DB* db, rocksdb::Iterator* i
       expire_cnt_(expire_cnt),
       has_ts_idx_(false),
       ts_idx_(0),
-      column_handle_(column_handle) {}
+      column_handle_(column_handle),
+      row_handle_(row_handle),
+      row_cache_(row_cache) {}
 
 DiskTableKeyIterator::DiskTableKeyIterator(rocksdb::DB* db, rocksdb::Iterator* it,
                                            const rocksdb::Snapshot* snapshot, ::openmldb::storage::TTLType ttl_type,
                                            const uint64_t& expire_time, const uint64_t& expire_cnt, int32_t ts_idx,
-                                           rocksdb::ColumnFamilyHandle* column_handle)
+                                           rocksdb::ColumnFamilyHandle* column_handle,
+                                           rocksdb::ColumnFamilyHandle* row_handle, DiskRowCache* row_cache)
     : db_(db),
       it_(it),
       snapshot_(snapshot),
@@ -885,7 +1340,9 @@ DiskTableKeyIterator::DiskTableKeyIterator(rocksdb::DB* db, rocksdb::Iterator* i
       expire_cnt_(expire_cnt),
       has_ts_idx_(true),
       ts_idx_(ts_idx),
-      column_handle_(column_handle) {}
+      column_handle_(column_handle),
+      row_handle_(row_handle),
+      row_cache_(row_cache) {}
 
 DiskTableKeyIterator::~DiskTableKeyIterator() {
     delete it_;
@@ -956,24 +1413,20 @@ const hybridse::codec::Row DiskTableKeyIterator::GetKey() {
 }
 
 std::unique_ptr<::hybridse::vm::RowIterator> DiskTableKeyIterator::GetValue() {
-    rocksdb::ReadOptions ro = rocksdb::ReadOptions();
-    const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
-    ro.snapshot = snapshot;
-    // ro.prefix_same_as_start = true;
-    ro.pin_data = true;
-    rocksdb::Iterator* it = db_->NewIterator(ro, column_handle_);
-    std::unique_ptr<DiskTableRowIterator> wit(new DiskTableRowIterator(db_, it, snapshot, ttl_type_, expire_time_,
-                                                                       expire_cnt_, pk_, ts_, has_ts_idx_, ts_idx_));
-    return wit;
+    return std::unique_ptr<::hybridse::vm::RowIterator>(GetRawValue());
 }
 
 ::hybridse::vm::RowIterator* DiskTableKeyIterator::GetRawValue() {
+    auto rows = GetCachedRows(row_cache_, db_, column_handle_, row_handle_, has_ts_idx_, ts_idx_, pk_);
+    if (rows) {
+        return new DiskTableCacheRowIterator(rows, ttl_type_, expire_time_, expire_cnt_);
+    }
     rocksdb::ReadOptions ro = rocksdb::ReadOptions();
     const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
     ro.snapshot = snapshot;
     // ro.prefix_same_as_start = true;
     ro.pin_data = true;
-    rocksdb::Iterator* it = db_->NewIterator(ro, column_handle_);
+    rocksdb::Iterator* it = NewDiskIndexIterator(db_, ro, column_handle_, row_handle_);
     return new DiskTableRowIterator(db_, it, snapshot, ttl_type_, expire_time_, expire_cnt_, pk_, ts_, has_ts_idx_,
                                     ts_idx_);
 }
@@ -1091,6 +1544,53 @@ void DiskTableRowIterator::SeekToFirst() {
 }
 inline bool DiskTableRowIterator::IsSeekable() const { return true; }
 
+DiskTableCacheIterator::DiskTableCacheIterator(std::shared_ptr<const DiskRowCache::Rows> rows,
+                                               const std::string& pk)
+    : rows_(rows), pk_(pk), pos_(0) {}
+
+openmldb::base::Slice DiskTableCacheIterator::GetValue() const {
+    const std::string& value = rows_->rows[pos_].second;
+    return openmldb::base::Slice(value.data(), value.size());
+}
+
+void DiskTableCacheIterator::Seek(uint64_t time) {
+    // the rows are in time desc order
+    auto it = std::lower_bound(rows_->rows.begin(), rows_->rows.end(), time,
+                               [](const std::pair<uint64_t, std::string>& row, uint64_t t) { return row.first > t; });
+    pos_ = it - rows_->rows.begin();
+}
+
+DiskTableCacheRowIterator::DiskTableCacheRowIterator(std::shared_ptr<const DiskRowCache::Rows> rows,
+                                                     ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
+                                                     uint64_t expire_cnt)
+    : rows_(rows), pos_(0), record_idx_(1), expire_value_(expire_time, expire_cnt, ttl_type), row_() {}
+
+bool DiskTableCacheRowIterator::Valid() const {
+    return pos_ < rows_->rows.size() && !expire_value_.IsExpired(rows_->rows[pos_].first, record_idx_);
+}
+
+void DiskTableCacheRowIterator::Next() {
+    pos_++;
+    record_idx_++;
+}
+
+const ::hybridse::codec::Row& DiskTableCacheRowIterator::GetValue() {
+    const std::string& value = rows_->rows[pos_].second;
+    row_.Reset(reinterpret_cast<const int8_t*>(value.data()), value.size());
+    return row_;
+}
+
+void DiskTableCacheRowIterator::Seek(const uint64_t& key) {
+    auto it = std::lower_bound(rows_->rows.begin(), rows_->rows.end(), key,
+                               [](const std::pair<uint64_t, std::string>& row, uint64_t t) { return row.first > t; });
+    pos_ = it - rows_->rows.begin();
+}
+
+void DiskTableCacheRowIterator::SeekToFirst() {
+    pos_ = 0;
+    record_idx_ = 1;
+}
+
 bool DiskTable::DeleteIndex(const std::string& idx_name) {
     // TODO(litongxin)
     return true;
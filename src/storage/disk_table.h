@@ -37,6 +37,7 @@
 #include "rocksdb/status.h"
 #include "rocksdb/table.h"
 #include "rocksdb/utilities/checkpoint.h"
+#include "storage/disk_row_cache.h"
 #include "storage/iterator.h"
 #include "storage/table.h"
 
@@ -102,28 +103,38 @@ static inline std::string CombineKeyTs(const std::string& key, uint64_t ts, uint
     return result;
 }
 
+// KeyTSComparator orders the keys by the key bytes asc, then the ts desc. It compares the slices in place
+// as it runs on every memtable insert, seek and compaction merge
 class KeyTSComparator : public rocksdb::Comparator {
  public:
     KeyTSComparator() {}
     const char* Name() const override { return "KeyTSComparator"; }
 
     int Compare(const rocksdb::Slice& a, const rocksdb::Slice& b) const override {
-        std::string key1, key2;
-        uint64_t ts1 = 0, ts2 = 0;
-        ParseKeyAndTs(a, key1, ts1);
-        ParseKeyAndTs(b, key2, ts2);
-
-        int ret = key1.compare(key2);
+        size_t len1 = a.size() > TS_LEN ? a.size() - TS_LEN : 0;
+        size_t len2 = b.size() > TS_LEN ? b.size() - TS_LEN : 0;
+        int ret = rocksdb::Slice(a.data(), len1).compare(rocksdb::Slice(b.data(), len2));
         if (ret != 0) {
             return ret;
-        } else {
-            if (ts1 > ts2) return -1;
-            if (ts1 < ts2) return 1;
-            return 0;
         }
+        uint64_t ts1 = DecodeTs(a);
+        uint64_t ts2 = DecodeTs(b);
+        if (ts1 > ts2) return -1;
+        if (ts1 < ts2) return 1;
+        return 0;
     }
     void FindShortestSeparator(std::string* /*start*/, const rocksdb::Slice& /*limit*/) const override {}
     void FindShortSuccessor(std::string* /*key*/) const override {}
+
+ private:
+    static inline uint64_t DecodeTs(const rocksdb::Slice& s) {
+        uint64_t ts = 0;
+        if (s.size() >= TS_LEN) {
+            memcpy(static_cast<void*>(&ts), s.data() + s.size() - TS_LEN, TS_LEN);
+            memrev64ifbe(static_cast<void*>(&ts));
+        }
+        return ts;
+    }
 };
 
 class KeyTsPrefixTransform : public rocksdb::SliceTransform {
@@ -143,74 +154,188 @@ class KeyTsPrefixTransform : public rocksdb::SliceTransform {
     bool SameResultWhenAppended(const rocksdb::Slice& prefix) const override { return InDomain(prefix); }
 };
 
-class AbsoluteTTLCompactionFilter : public rocksdb::CompactionFilter {
- public:
-    explicit AbsoluteTTLCompactionFilter(std::shared_ptr<InnerIndexSt> inner_index) : inner_index_(inner_index) {}
-    virtual ~AbsoluteTTLCompactionFilter() {}
-
-    const char* Name() const override { return "AbsoluteTTLCompactionFilter"; }
+class DiskTable;
 
-    bool Filter(int /*level*/, const rocksdb::Slice& key, const rocksdb::Slice& /*existing_value*/,
-                std::string* /*new_value*/, bool* /*value_changed*/) const override {
-        if (key.size() < TS_LEN) {
-            return false;
-        }
-        uint64_t real_ttl = 0;
-        const auto& indexs = inner_index_->GetIndex();
-        if (indexs.size() > 1) {
-            if (key.size() < TS_LEN + TS_POS_LEN) {
-                return false;
-            }
-            uint32_t ts_idx = *((uint32_t*)(key.data() + key.size() - TS_LEN -  // NOLINT
-                                          TS_POS_LEN));
-            bool has_found = false;
-            for (const auto index : indexs) {
-                auto ts_col = index->GetTsColumn();
-                if (!ts_col) {
-                    return false;
-                }
-                if (ts_col->GetId() == ts_idx) {
-                    real_ttl = index->GetTTL()->abs_ttl;
-                    has_found = true;
-                    break;
-                }
+// TTLCompactionFilter drops the expired rows of an inner index while compacting. The keys of a prefix (pk, and
+// ts pos if the inner index has more than one ts) come in ts desc order, so the record idx of latest ttl is
+// the count of the keys of the prefix in the compaction input, and a row is dropped only when the input has
+// lat_ttl newer keys of it. The keys deleted by a range tombstone are still passed to the filter, so if the
+// table has range tombstones, a key out of latest ttl by the count is ranked again among the live keys of the
+// prefix read from the table. The live keys are read once per prefix and at most lat_ttl of them.
+// A filter is created for every compaction and is not shared between threads.
+class TTLCompactionFilter : public rocksdb::CompactionFilter {
+ public:
+    TTLCompactionFilter(const DiskTable* table, std::shared_ptr<InnerIndexSt> inner_index)
+        : table_(table), inner_pos_(inner_index->GetId()), has_ts_idx_(false), ttl_(), ts_ttl_(),
+          check_live_(table->MayHideKeys()), it_(), last_prefix_(), input_cnt_(0), live_ts_(), live_pos_(0),
+          live_loaded_(false) {
+        uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+        const auto& indexs = inner_index->GetIndex();
+        has_ts_idx_ = indexs.size() > 1;
+        for (const auto& index : indexs) {
+            auto ttl = index->GetTTL();
+            TTLSt expire(ttl->abs_ttl == 0 ? 0 : cur_time - ttl->abs_ttl, ttl->lat_ttl, ttl->ttl_type);
+            if (!has_ts_idx_) {
+                ttl_ = expire;
+                break;
             }
-            if (!has_found) {
-                return false;
+            auto ts_col = index->GetTsColumn();
+            if (ts_col) {
+                ts_ttl_.emplace(ts_col->GetId(), expire);
             }
-        } else {
-            real_ttl = indexs.front()->GetTTL()->abs_ttl;
-        }
-        if (real_ttl < 1) {
-            return false;
-        }
-        uint64_t ts = 0;
-        memcpy(static_cast<void*>(&ts), key.data() + key.size() - TS_LEN, TS_LEN);
-        memrev64ifbe(static_cast<void*>(&ts));
-        uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
-        if (ts < cur_time - real_ttl) {
-            return true;
         }
-        return false;
     }
+    virtual ~TTLCompactionFilter() {}
+
+    const char* Name() const override { return "TTLCompactionFilter"; }
+
+    bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& existing_value, std::string* new_value,
+                bool* value_changed) const override;
 
  private:
-    std::shared_ptr<InnerIndexSt> inner_index_;
+    // get the record idx of ts in the live keys of the prefix, 1 if they can not be read
+    uint32_t GetLiveRecordIdx(const rocksdb::Slice& prefix, uint64_t ts, uint32_t lat_ttl) const;
+
+ private:
+    const DiskTable* table_;
+    uint32_t inner_pos_;
+    bool has_ts_idx_;
+    // abs_ttl is the expire time
+    TTLSt ttl_;
+    std::map<uint32_t, TTLSt> ts_ttl_;
+    // the keys of the compaction input may be hidden by range tombstones, so a key out of latest ttl by the
+    // count of the input is checked against the live keys
+    bool check_live_;
+    // reads the live keys, it's created on the first use
+    mutable std::unique_ptr<rocksdb::Iterator> it_;
+    mutable std::string last_prefix_;
+    // the count of the keys of last_prefix_ in the compaction input
+    mutable uint32_t input_cnt_;
+    // the ts of the latest live keys of last_prefix_ in desc order
+    mutable std::vector<uint64_t> live_ts_;
+    mutable size_t live_pos_;
+    mutable bool live_loaded_;
 };
 
-class AbsoluteTTLFilterFactory : public rocksdb::CompactionFilterFactory {
+class TTLFilterFactory : public rocksdb::CompactionFilterFactory {
  public:
-    explicit AbsoluteTTLFilterFactory(const std::shared_ptr<InnerIndexSt>& inner_index) : inner_index_(inner_index) {}
+    TTLFilterFactory(const DiskTable* table, const std::shared_ptr<InnerIndexSt>& inner_index)
+        : table_(table), inner_index_(inner_index) {}
     std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
         const rocksdb::CompactionFilter::Context& context) override {
-        return std::unique_ptr<rocksdb::CompactionFilter>(new AbsoluteTTLCompactionFilter(inner_index_));
+        return std::unique_ptr<rocksdb::CompactionFilter>(new TTLCompactionFilter(table_, inner_index_));
     }
-    const char* Name() const override { return "AbsoluteTTLFilterFactory"; }
+    const char* Name() const override { return "TTLFilterFactory"; }
 
  private:
+    const DiskTable* table_;
     std::shared_ptr<InnerIndexSt> inner_index_;
 };
 
+// the column family of the rows in single copy layout, the index column families only keep the row ids
+static const char ROW_CF_NAME[] = "__row__";
+static const uint32_t ROW_ID_LEN = sizeof(uint64_t);
+
+// the row id is in big endian, so the rows are in id order
+static inline std::string EncodeRowId(uint64_t id) {
+    std::string result(ROW_ID_LEN, '\0');
+    for (uint32_t i = 0; i < ROW_ID_LEN; i++) {
+        result[i] = static_cast<char>((id >> (8 * (ROW_ID_LEN - 1 - i))) & 0xFF);
+    }
+    return result;
+}
+
+static inline uint64_t DecodeRowId(const rocksdb::Slice& s) {
+    uint64_t id = 0;
+    for (uint32_t i = 0; i < ROW_ID_LEN && i < s.size(); i++) {
+        id = (id << 8) | static_cast<uint8_t>(s[i]);
+    }
+    return id;
+}
+
+// RowRefCompactionFilter drops the rows which are not referred by any index entry any more, as the entries are
+// dropped by ttl, deleted or overwritten. A row keeps the keys of its index entries to check them.
+// The compaction filters ignore the snapshots, so an iterator may still see the entries of a row which is not
+// referred now. The row is marked with the sequence it's found not referred at first, and it's dropped by a
+// later compaction once all the snapshots are newer than the mark.
+class RowRefCompactionFilter : public rocksdb::CompactionFilter {
+ public:
+    explicit RowRefCompactionFilter(const DiskTable* table);
+    virtual ~RowRefCompactionFilter() {}
+
+    const char* Name() const override { return "RowRefCompactionFilter"; }
+
+    bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& existing_value, std::string* new_value,
+                bool* value_changed) const override;
+
+ private:
+    const DiskTable* table_;
+    // the sequence all the snapshots are newer than or equal to when the compaction begins
+    uint64_t visible_seq_;
+};
+
+class RowRefFilterFactory : public rocksdb::CompactionFilterFactory {
+ public:
+    explicit RowRefFilterFactory(const DiskTable* table) : table_(table) {}
+    std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
+        const rocksdb::CompactionFilter::Context& context) override {
+        return std::unique_ptr<rocksdb::CompactionFilter>(new RowRefCompactionFilter(table_));
+    }
+    const char* Name() const override { return "RowRefFilterFactory"; }
+
+ private:
+    const DiskTable* table_;
+};
+
+// RowRefIterator iterates an index column family of the single copy layout. It reads ahead the entries of the
+// same prefix and gets their rows by one MultiGet when a value is read, the read ahead size doubles on Next
+// and is reset on Seek. The values are valid until the iterator is deleted like pin_data. Only forward
+// iteration is supported
+class RowRefIterator : public rocksdb::Iterator {
+ public:
+    RowRefIterator(rocksdb::DB* db, const rocksdb::ReadOptions& ro, rocksdb::ColumnFamilyHandle* index_cf,
+                   rocksdb::ColumnFamilyHandle* row_cf);
+    ~RowRefIterator() override;
+
+    // it turns false if the row of the current entry can not be read by value(), and status() tells the error
+    bool Valid() const override { return pos_ < keys_.size() && status_.ok(); }
+    void SeekToFirst() override;
+    void SeekToLast() override;
+    void Seek(const rocksdb::Slice& target) override;
+    void SeekForPrev(const rocksdb::Slice& target) override;
+    void Next() override;
+    void Prev() override;
+    rocksdb::Slice key() const override { return rocksdb::Slice(keys_[pos_]); }
+    rocksdb::Slice value() const override;
+    rocksdb::Status status() const override;
+
+ private:
+    void Fill(uint32_t size);
+    void Fetch() const;
+
+ private:
+    rocksdb::DB* db_;
+    rocksdb::ReadOptions ro_;
+    rocksdb::Iterator* it_;
+    rocksdb::ColumnFamilyHandle* row_cf_;
+    uint32_t read_ahead_;
+    size_t pos_;
+    std::vector<std::string> keys_;
+    std::vector<std::string> row_ids_;
+    mutable rocksdb::Status status_;
+    mutable bool fetched_;
+    // the rows are fetched from this pos of the batch
+    mutable size_t fetch_pos_;
+    mutable std::vector<rocksdb::Status> statuses_;
+    // the rows of the current batch, all batches are kept until the iterator is deleted
+    mutable rocksdb::PinnableSlice* rows_;
+    mutable std::vector<std::unique_ptr<rocksdb::PinnableSlice[]>> row_batches_;
+};
+
+// create the iterator of an index column family, the values are read from the row column family if it's not NULL
+rocksdb::Iterator* NewDiskIndexIterator(rocksdb::DB* db, const rocksdb::ReadOptions& ro,
+                                        rocksdb::ColumnFamilyHandle* index_cf, rocksdb::ColumnFamilyHandle* row_cf);
+
 class DiskTableIterator : public TableIterator {
  public:
     DiskTableIterator(rocksdb::DB* db, rocksdb::Iterator* it, const rocksdb::Snapshot* snapshot, const std::string& pk);
@@ -305,15 +430,57 @@ class DiskTableRowIterator : public ::hybridse::vm::RowIterator {
     bool pk_valid_;
 };
 
+// DiskTableCacheIterator iterates the rows of a key in the row cache
+class DiskTableCacheIterator : public TableIterator {
+ public:
+    DiskTableCacheIterator(std::shared_ptr<const DiskRowCache::Rows> rows, const std::string& pk);
+    bool Valid() override { return pos_ < rows_->rows.size(); }
+    void Next() override { pos_++; }
+    openmldb::base::Slice GetValue() const override;
+    std::string GetPK() const override { return pk_; }
+    uint64_t GetKey() const override { return rows_->rows[pos_].first; }
+    void SeekToFirst() override { pos_ = 0; }
+    void Seek(uint64_t time) override;
+
+ private:
+    std::shared_ptr<const DiskRowCache::Rows> rows_;
+    std::string pk_;
+    size_t pos_;
+};
+
+// DiskTableCacheRowIterator is the window of a key in the row cache
+class DiskTableCacheRowIterator : public ::hybridse::vm::RowIterator {
+ public:
+    DiskTableCacheRowIterator(std::shared_ptr<const DiskRowCache::Rows> rows, ::openmldb::storage::TTLType ttl_type,
+                              uint64_t expire_time, uint64_t expire_cnt);
+
+    bool Valid() const override;
+    void Next() override;
+    const uint64_t& GetKey() const override { return rows_->rows[pos_].first; }
+    const ::hybridse::codec::Row& GetValue() override;
+    void Seek(const uint64_t& key) override;
+    void SeekToFirst() override;
+    bool IsSeekable() const override { return true; }
+
+ private:
+    std::shared_ptr<const DiskRowCache::Rows> rows_;
+    size_t pos_;
+    uint32_t record_idx_;
+    TTLSt expire_value_;
+    ::hybridse::codec::Row row_;
+};
+
 class DiskTableKeyIterator : public ::hybridse::vm::WindowIterator {
  public:
     DiskTableKeyIterator(rocksdb::DB* db, rocksdb::Iterator* it, const rocksdb::Snapshot* snapshot,
                          ::openmldb::storage::TTLType ttl_type, const uint64_t& expire_time, const uint64_t& expire_cnt,
-                         int32_t ts_idx, rocksdb::ColumnFamilyHandle* column_handle);
+                         int32_t ts_idx, rocksdb::ColumnFamilyHandle* column_handle,
+                         rocksdb::ColumnFamilyHandle* row_handle = NULL, DiskRowCache* row_cache = NULL);
 
     DiskTableKeyIterator(rocksdb::DB* db, rocksdb::Iterator* it, const rocksdb::Snapshot* snapshot,
                          ::openmldb::storage::TTLType ttl_type, const uint64_t& expire_time, const uint64_t& expire_cnt,
-                         rocksdb::ColumnFamilyHandle* column_handle);
+                         rocksdb::ColumnFamilyHandle* column_handle, rocksdb::ColumnFamilyHandle* row_handle = NULL,
+                         DiskRowCache* row_cache = NULL);
 
     ~DiskTableKeyIterator() override;
 
@@ -345,6 +512,8 @@ class DiskTableKeyIterator : public ::hybridse::vm::WindowIterator {
     uint64_t ts_;
     uint32_t ts_idx_;
     rocksdb::ColumnFamilyHandle* column_handle_;
+    rocksdb::ColumnFamilyHandle* row_handle_;
+    DiskRowCache* row_cache_;
 };
 
 class DiskTable : public Table {
@@ -425,6 +594,35 @@ class DiskTable : public Table {
 
     int GetCount(uint32_t index, const std::string& pk, uint64_t& count) override; // NOLINT
 
+    // the rows are stored once in the row column family
+    bool IsSingleCopy() const { return row_cf_ != NULL; }
+
+    // return NULL if the row cache is disabled
+    DiskRowCache* GetRowCache() const { return row_cache_.get(); }
+
+ private:
+    friend class RowRefCompactionFilter;
+    friend class TTLCompactionFilter;
+
+    rocksdb::Iterator* NewIndexIterator(const rocksdb::ReadOptions& ro, uint32_t inner_pos);
+
+    bool IsRowReferred(const rocksdb::Slice& row_id, const rocksdb::Slice& row) const;
+
+    // the iterator of the keys of an inner index for the ttl filter, NULL if the table is not opened
+    rocksdb::Iterator* NewTTLIterator(uint32_t inner_pos) const;
+
+    // whether the index column families may have keys hidden by the range tombstones of Delete, the ttl
+    // filter can't count the keys of its input then
+    bool MayHideKeys() const {
+        return !ttl_ready_.load(std::memory_order_acquire) || has_range_del_.load(std::memory_order_acquire);
+    }
+
+    // the sequence the snapshots taken now and later are newer than or equal to
+    uint64_t GetOldestVisibleSeq() const;
+
+    // drop the keys written from the row cache
+    void InvalidateRowCache(const std::vector<std::string>& keys);
+
  private:
     rocksdb::DB* db_;
     rocksdb::WriteOptions write_opts_;
@@ -434,6 +632,16 @@ class DiskTable : public Table {
     KeyTSComparator cmp_;
     std::atomic<uint64_t> offset_;
     std::string table_path_;
+    bool single_copy_;
+    rocksdb::ColumnFamilyHandle* row_cf_;
+    std::atomic<uint64_t> row_id_;
+    // the row filter checks the index entries only after the column families are opened
+    std::atomic<bool> row_gc_ready_;
+    // the ttl filter reads the index column families only after they are opened
+    std::atomic<bool> ttl_ready_;
+    // set by Delete or by the range tombstones found on open, it's kept until the table is reopened
+    std::atomic<bool> has_range_del_;
+    std::unique_ptr<DiskRowCache> row_cache_;
 };
 
 }  // namespace storage
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "storage/disk_table.h"
+
+namespace openmldb {
+namespace storage {
+
+// the keys of range(0) pks with range(1) bytes, every pk has 8 ts
+static std::vector<std::string> GenKeys(uint64_t pk_num, uint64_t pk_len) {
+    std::vector<std::string> keys;
+    for (uint64_t i = 0; i < pk_num; i++) {
+        std::string pk = std::to_string(i);
+        pk.insert(0, pk_len > pk.size() ? pk_len - pk.size() : 0, 'k');
+        for (uint64_t ts = 0; ts < 8; ts++) {
+            keys.push_back(CombineKeyTs(pk, 1650000000000 + ts));
+        }
+    }
+    return keys;
+}
+
+// compare by copying the keys out as KeyTSComparator did before, as the baseline
+static int ParseCompare(const rocksdb::Slice& a, const rocksdb::Slice& b) {
+    std::string key1, key2;
+    uint64_t ts1 = 0, ts2 = 0;
+    ParseKeyAndTs(a, key1, ts1);
+    ParseKeyAndTs(b, key2, ts2);
+    int ret = key1.compare(key2);
+    if (ret != 0) {
+        return ret;
+    }
+    if (ts1 > ts2) return -1;
+    if (ts1 < ts2) return 1;
+    return 0;
+}
+
+static void BM_KeyTSComparator(benchmark::State& state) {  // NOLINT
+    auto keys = GenKeys(state.range(0), state.range(1));
+    KeyTSComparator cmp;
+    size_t idx = 0;
+    for (auto _ : state) {
+        const auto& a = keys[idx % keys.size()];
+        const auto& b = keys[(idx * 7 + 1) % keys.size()];
+        benchmark::DoNotOptimize(cmp.Compare(rocksdb::Slice(a), rocksdb::Slice(b)));
+        idx++;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_KeyTSComparatorParse(benchmark::State& state) {  // NOLINT
+    auto keys = GenKeys(state.range(0), state.range(1));
+    size_t idx = 0;
+    for (auto _ : state) {
+        const auto& a = keys[idx % keys.size()];
+        const auto& b = keys[(idx * 7 + 1) % keys.size()];
+        benchmark::DoNotOptimize(ParseCompare(rocksdb::Slice(a), rocksdb::Slice(b)));
+        idx++;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_KeyTsPrefixTransform(benchmark::State& state) {  // NOLINT
+    auto keys = GenKeys(state.range(0), state.range(1));
+    KeyTsPrefixTransform transform;
+    size_t idx = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(transform.Transform(rocksdb::Slice(keys[idx % keys.size()])));
+        idx++;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_KeyTSComparator)->Args({1024, 8})->Args({1024, 32})->Args({1024, 128});
+BENCHMARK(BM_KeyTSComparatorParse)->Args({1024, 8})->Args({1024, 32})->Args({1024, 128});
+BENCHMARK(BM_KeyTsPrefixTransform)->Args({1024, 32});
+
+}  // namespace storage
+}  // namespace openmldb
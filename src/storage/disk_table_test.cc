@@ -33,6 +33,9 @@ DECLARE_string(ssd_root_path);
 DECLARE_string(hdd_root_path);
 DECLARE_uint32(max_traverse_cnt);
 DECLARE_int32(gc_safe_offset);
+DECLARE_bool(disk_table_single_copy);
+DECLARE_uint32(disk_row_cache_mb);
+DECLARE_bool(disk_gc_compact_range);
 
 namespace openmldb {
 namespace storage {
@@ -77,6 +80,20 @@ TEST_F(DiskTableTest, ParseKeyAndTs) {
     ASSERT_EQ(1122, (int64_t)ts);
 }
 
+TEST_F(DiskTableTest, KeyTSComparator) {
+    KeyTSComparator cmp;
+    ASSERT_EQ(0, cmp.Compare(CombineKeyTs("key1", 10), CombineKeyTs("key1", 10)));
+    ASSERT_GT(0, cmp.Compare(CombineKeyTs("key1", 10), CombineKeyTs("key1", 9)));
+    ASSERT_LT(0, cmp.Compare(CombineKeyTs("key1", 1), CombineKeyTs("key1", 1552619498000)));
+    ASSERT_GT(0, cmp.Compare(CombineKeyTs("key1", 1), CombineKeyTs("key2", 10)));
+    ASSERT_GT(0, cmp.Compare(CombineKeyTs("key", 1), CombineKeyTs("key1", 10)));
+    ASSERT_LT(0, cmp.Compare(CombineKeyTs("key1", 10), CombineKeyTs("", 10)));
+    ASSERT_GT(0, cmp.Compare(CombineKeyTs("key1", 10, 2), CombineKeyTs("key1", 20, 3)));
+    ASSERT_GT(0, cmp.Compare(CombineKeyTs("key1", 20, 2), CombineKeyTs("key1", 10, 2)));
+    ASSERT_LT(0, cmp.Compare("abc", CombineKeyTs("", 1)));
+    ASSERT_EQ(0, cmp.Compare("abc", "ab"));
+}
+
 TEST_F(DiskTableTest, Put) {
     std::map<std::string, uint32_t> mapping;
     mapping.insert(std::make_pair("idx0", 0));
@@ -946,6 +963,116 @@ TEST_F(DiskTableTest, CompactFilterMulTs) {
     RemoveData(table_path);
 }
 
+TEST_F(DiskTableTest, CompactFilterAbsAndLat) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_tid(16);
+    table_meta.set_pid(1);
+    table_meta.set_storage_mode(::openmldb::common::kHDD);
+    table_meta.set_format_version(1);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "mcc", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts1", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts1", ::openmldb::type::kAbsAndLat, 10, 4);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "mcc", "mcc", "ts1", ::openmldb::type::kAbsOrLat, 10, 2);
+
+    std::string table_path = FLAGS_hdd_root_path + "/16_1";
+    DiskTable* table = new DiskTable(table_meta, table_path);
+    ASSERT_TRUE(table->Init());
+    codec::SDKCodec codec(table_meta);
+
+    uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+    auto get_ts = [cur_time](int k) -> uint64_t { return k > 2 ? cur_time - k - 20 * 60 * 1000 : cur_time - k; };
+    for (int idx = 0; idx < 100; idx++) {
+        Dimensions dims;
+        ::openmldb::api::Dimension* dim = dims.Add();
+        dim->set_key("card" + std::to_string(idx));
+        dim->set_idx(0);
+        ::openmldb::api::Dimension* dim1 = dims.Add();
+        dim1->set_key("mcc" + std::to_string(idx));
+        dim1->set_idx(1);
+        for (int k = 0; k < 6; k++) {
+            std::vector<std::string> row = {"card" + std::to_string(idx), "mcc" + std::to_string(idx),
+                                            std::to_string(get_ts(k))};
+            std::string value;
+            ASSERT_EQ(0, codec.EncodeRow(row, &value));
+            ASSERT_TRUE(table->Put(get_ts(k), value, dims));
+        }
+    }
+    table->CompactDB();
+    for (int idx = 0; idx < 100; idx++) {
+        std::string key = "card" + std::to_string(idx);
+        std::string key1 = "mcc" + std::to_string(idx);
+        for (int k = 0; k < 6; k++) {
+            std::string value;
+            // absandlat drops the rows both expired and out of the latest 4
+            ASSERT_EQ(k < 4, table->Get(0, key, get_ts(k), value));
+            // absorlat drops the rows either expired or out of the latest 2
+            ASSERT_EQ(k < 2, table->Get(1, key1, get_ts(k), value));
+        }
+    }
+    delete table;
+    RemoveData(table_path);
+}
+
+TEST_F(DiskTableTest, CompactFilterDeletedKey) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::string table_path = FLAGS_hdd_root_path + "/19_1";
+    DiskTable* table = new DiskTable("t1", 19, 1, mapping, 2, ::openmldb::type::TTLType::kLatestTime,
+                                     ::openmldb::common::StorageMode::kHDD, table_path);
+    ASSERT_TRUE(table->Init());
+    for (int k = 0; k < 3; k++) {
+        ASSERT_TRUE(table->Put("test", 100 + k, "value", 5));
+    }
+    ASSERT_TRUE(table->Delete("test", 0));
+    // the new rows are older than the deleted ones, which are only hidden by the range tombstone
+    ASSERT_TRUE(table->Put("test", 10, "value1", 6));
+    ASSERT_TRUE(table->Put("test", 11, "value2", 6));
+    ASSERT_TRUE(table->Put("test", 9, "value0", 6));
+    table->CompactDB();
+    std::string value;
+    ASSERT_TRUE(table->Get("test", 11, value));
+    ASSERT_EQ("value2", value);
+    ASSERT_TRUE(table->Get("test", 10, value));
+    ASSERT_EQ("value1", value);
+    ASSERT_FALSE(table->Get("test", 9, value));
+    ASSERT_FALSE(table->Get("test", 100, value));
+    delete table;
+    RemoveData(table_path);
+}
+
+TEST_F(DiskTableTest, CompactFilterDeletedKeyReopen) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::string table_path = FLAGS_hdd_root_path + "/21_1";
+    DiskTable* table = new DiskTable("t1", 21, 1, mapping, 2, ::openmldb::type::TTLType::kLatestTime,
+                                     ::openmldb::common::StorageMode::kHDD, table_path);
+    ASSERT_TRUE(table->Init());
+    for (int k = 0; k < 3; k++) {
+        ASSERT_TRUE(table->Put("test", 100 + k, "value", 5));
+    }
+    table->CompactDB();
+    ASSERT_TRUE(table->Delete("test", 0));
+    delete table;
+    // the range tombstone is flushed on reopen and found in the table properties
+    table = new DiskTable("t1", 21, 1, mapping, 2, ::openmldb::type::TTLType::kLatestTime,
+                          ::openmldb::common::StorageMode::kHDD, table_path);
+    ASSERT_TRUE(table->Init());
+    ASSERT_TRUE(table->Put("test", 10, "value1", 6));
+    ASSERT_TRUE(table->Put("test", 11, "value2", 6));
+    ASSERT_TRUE(table->Put("test", 9, "value0", 6));
+    table->CompactDB();
+    std::string value;
+    ASSERT_TRUE(table->Get("test", 11, value));
+    ASSERT_EQ("value2", value);
+    ASSERT_TRUE(table->Get("test", 10, value));
+    ASSERT_EQ("value1", value);
+    ASSERT_FALSE(table->Get("test", 9, value));
+    ASSERT_FALSE(table->Get("test", 100, value));
+    delete table;
+    RemoveData(table_path);
+}
+
 TEST_F(DiskTableTest, GcHeadMulTs) {
     ::openmldb::api::TableMeta table_meta;
     table_meta.set_tid(12);
@@ -1125,6 +1252,132 @@ TEST_F(DiskTableTest, GcHead) {
     RemoveData(table_path);
 }
 
+TEST_F(DiskTableTest, SingleCopy) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_tid(17);
+    table_meta.set_pid(1);
+    table_meta.set_storage_mode(::openmldb::common::kHDD);
+    table_meta.set_format_version(1);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "mcc", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts1", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts1", ::openmldb::type::kLatestTime, 0, 3);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "mcc", "mcc", "ts1", ::openmldb::type::kLatestTime, 0, 3);
+
+    std::string table_path = FLAGS_hdd_root_path + "/17_1";
+    FLAGS_disk_table_single_copy = true;
+    DiskTable* table = new DiskTable(table_meta, table_path);
+    ASSERT_TRUE(table->Init());
+    FLAGS_disk_table_single_copy = false;
+    ASSERT_TRUE(table->IsSingleCopy());
+    codec::SDKCodec codec(table_meta);
+
+    uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+    auto encode = [&codec, cur_time](int idx, int k) {
+        std::vector<std::string> row = {"card" + std::to_string(idx), "mcc" + std::to_string(idx),
+                                        std::to_string(cur_time - k)};
+        std::string value;
+        codec.EncodeRow(row, &value);
+        return value;
+    };
+    for (int idx = 0; idx < 100; idx++) {
+        Dimensions dims;
+        ::openmldb::api::Dimension* dim = dims.Add();
+        dim->set_key("card" + std::to_string(idx));
+        dim->set_idx(0);
+        ::openmldb::api::Dimension* dim1 = dims.Add();
+        dim1->set_key("mcc" + std::to_string(idx));
+        dim1->set_idx(1);
+        for (int k = 0; k < 5; k++) {
+            ASSERT_TRUE(table->Put(cur_time - k, encode(idx, k), dims));
+        }
+    }
+    for (int idx = 0; idx < 100; idx++) {
+        for (int k = 0; k < 5; k++) {
+            std::string value;
+            ASSERT_TRUE(table->Get(0, "card" + std::to_string(idx), cur_time - k, value));
+            ASSERT_EQ(encode(idx, k), value);
+            ASSERT_TRUE(table->Get(1, "mcc" + std::to_string(idx), cur_time - k, value));
+            ASSERT_EQ(encode(idx, k), value);
+        }
+    }
+    TableIterator* it = table->NewTraverseIterator(1);
+    it->SeekToFirst();
+    int count = 0;
+    while (it->Valid()) {
+        std::string pk = it->GetPK();
+        int idx = std::stoi(pk.substr(3));
+        ASSERT_EQ(encode(idx, static_cast<int>(cur_time - it->GetKey())), it->GetValue().ToString());
+        count++;
+        it->Next();
+    }
+    delete it;
+    ASSERT_EQ(300, count);
+
+    table->GcHead();
+    for (int idx = 0; idx < 100; idx++) {
+        for (int k = 0; k < 5; k++) {
+            std::string value;
+            ASSERT_EQ(k < 3, table->Get(0, "card" + std::to_string(idx), cur_time - k, value));
+            ASSERT_EQ(k < 3, table->Get(1, "mcc" + std::to_string(idx), cur_time - k, value));
+        }
+    }
+    delete table;
+
+    // the layout is kept on reopen
+    table = new DiskTable(table_meta, table_path);
+    ASSERT_TRUE(table->Init());
+    ASSERT_TRUE(table->IsSingleCopy());
+    std::string value;
+    ASSERT_TRUE(table->Get(1, "mcc10", cur_time - 2, value));
+    ASSERT_EQ(encode(10, 2), value);
+    Dimensions dims;
+    ::openmldb::api::Dimension* dim = dims.Add();
+    dim->set_key("card10");
+    dim->set_idx(0);
+    ASSERT_TRUE(table->Put(cur_time + 1, encode(10, -1), dims));
+    ASSERT_TRUE(table->Get(0, "card10", cur_time + 1, value));
+    ASSERT_EQ(encode(10, -1), value);
+    delete table;
+    RemoveData(table_path);
+}
+
+TEST_F(DiskTableTest, SingleCopySnapshot) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::string table_path = FLAGS_hdd_root_path + "/20_1";
+    FLAGS_disk_table_single_copy = true;
+    DiskTable* table = new DiskTable("t1", 20, 1, mapping, 0, ::openmldb::type::TTLType::kLatestTime,
+                                     ::openmldb::common::StorageMode::kHDD, table_path);
+    ASSERT_TRUE(table->Init());
+    FLAGS_disk_table_single_copy = false;
+    ASSERT_TRUE(table->IsSingleCopy());
+    for (int k = 0; k < 3; k++) {
+        ASSERT_TRUE(table->Put("test", 100 + k, "value" + std::to_string(k), 6));
+    }
+    Ticket ticket;
+    TableIterator* it = table->NewIterator("test", ticket);
+    ASSERT_TRUE(table->Delete("test", 0));
+    // the rows not referred now are kept for the snapshot of the iterator
+    table->CompactDB();
+    it->SeekToFirst();
+    for (int k = 2; k >= 0; k--) {
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(100u + k, it->GetKey());
+        ASSERT_EQ("value" + std::to_string(k), it->GetValue().ToString());
+        it->Next();
+    }
+    ASSERT_FALSE(it->Valid());
+    delete it;
+    table->CompactDB();
+    it = table->NewIterator("test", ticket);
+    it->SeekToFirst();
+    ASSERT_FALSE(it->Valid());
+    delete it;
+    delete table;
+    RemoveData(table_path);
+}
+
 TEST_F(DiskTableTest, CheckPoint) {
     std::map<std::string, uint32_t> mapping;
     mapping.insert(std::make_pair("idx0", 0));
@@ -1198,6 +1451,60 @@ TEST_F(DiskTableTest, CheckPoint) {
     RemoveData(table_path);
 }
 
+TEST_F(DiskTableTest, RowCache) {
+    uint32_t old_cache_mb = FLAGS_disk_row_cache_mb;
+    FLAGS_disk_row_cache_mb = 1;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::string table_path = FLAGS_hdd_root_path + "/18_1";
+    DiskTable* table = new DiskTable("yjtable18", 18, 1, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime,
+                                     ::openmldb::common::StorageMode::kHDD, table_path);
+    ASSERT_TRUE(table->Init());
+    FLAGS_disk_row_cache_mb = old_cache_mb;
+    DiskRowCache* row_cache = table->GetRowCache();
+    ASSERT_TRUE(row_cache != NULL);
+    for (int k = 0; k < 10; k++) {
+        ASSERT_TRUE(table->Put("test1", 9537 + k, "value", 5));
+    }
+    Ticket ticket;
+    for (int i = 0; i < 2; i++) {
+        TableIterator* it = table->NewIterator("test1", ticket);
+        it->Seek(9540);
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(9540u, it->GetKey());
+        ASSERT_EQ("value", it->GetValue().ToString());
+        ASSERT_EQ("test1", it->GetPK());
+        delete it;
+    }
+    ASSERT_EQ(1u, row_cache->GetMissCnt());
+    ASSERT_EQ(1u, row_cache->GetHitCnt());
+    ASSERT_EQ(1u, row_cache->GetKeyCnt());
+
+    // the put invalidates the cached rows
+    ASSERT_TRUE(table->Put("test1", 9600, "value2", 6));
+    TableIterator* it = table->NewIterator("test1", ticket);
+    it->SeekToFirst();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(9600u, it->GetKey());
+    ASSERT_EQ("value2", it->GetValue().ToString());
+    int count = 0;
+    while (it->Valid()) {
+        count++;
+        it->Next();
+    }
+    ASSERT_EQ(11, count);
+    delete it;
+
+    table->Delete("test1", 0);
+    it = table->NewIterator("test1", ticket);
+    it->SeekToFirst();
+    ASSERT_FALSE(it->Valid());
+    delete it;
+
+    delete table;
+    RemoveData(table_path);
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
@@ -1206,6 +1513,8 @@ int main(int argc, char** argv) {
     ::openmldb::base::SetLogLevel(INFO);
     FLAGS_hdd_root_path = "/tmp/" + std::to_string(::openmldb::storage::GenRand());
     FLAGS_ssd_root_path = "/tmp/" + std::to_string(::openmldb::storage::GenRand());
+    // the gc tests check the rows dropped by the compaction of GcHead
+    FLAGS_disk_gc_compact_range = true;
     // FLAGS_hdd_root_path = "/tmp/1";
     // FLAGS_ssd_root_path = "/tmp/1";
     return RUN_ALL_TESTS();
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/epoch.h"
+
+#include <gflags/gflags.h>
+
+#include <utility>
+#include <vector>
+
+DECLARE_uint32(epoch_reclaim_interval_ms);
+
+namespace openmldb {
+namespace storage {
+
+EpochManager* EpochManager::Default() {
+    static EpochManager* manager = [] {
+        auto* manager = new EpochManager();
+        manager->StartReclaimThread(FLAGS_epoch_reclaim_interval_ms);
+        return manager;
+    }();
+    return manager;
+}
+
+EpochManager::EpochManager(uint32_t slot_num)
+    : slot_num_(slot_num > 0 ? slot_num : 1),
+      slots_(new Slot[slot_num_]),
+      epoch_(1),
+      mu_(),
+      retired_(),
+      reclaim_thread_(),
+      stop_(false),
+      cv_() {}
+
+EpochManager::~EpochManager() {
+    StopReclaimThread();
+    for (auto& item : retired_) {
+        item.free();
+    }
+}
+
+uint32_t EpochManager::Enter() {
+    // start from the slot used last time, it's likely idle and cached
+    static thread_local uint32_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+    while (true) {
+        uint64_t epoch = epoch_.load();
+        for (uint32_t i = 0; i < slot_num_; i++) {
+            uint32_t slot = (hint + i) % slot_num_;
+            uint64_t idle = 0;
+            if (slots_[slot].epoch.load(std::memory_order_relaxed) == 0 &&
+                slots_[slot].epoch.compare_exchange_strong(idle, epoch)) {
+                hint = slot;
+                // a Reclaim may scan the slot before it's taken, publish the epoch it advanced to
+                uint64_t cur = epoch_.load();
+                while (cur != epoch) {
+                    slots_[slot].epoch.store(cur);
+                    epoch = cur;
+                    cur = epoch_.load();
+                }
+                return slot;
+            }
+        }
+        // more readers than slots, wait for one to exit
+        std::this_thread::yield();
+    }
+}
+
+void EpochManager::Exit(uint32_t slot) { slots_[slot].epoch.store(0, std::memory_order_release); }
+
+void EpochManager::Retire(const void* owner, std::function<void()> free) {
+    std::lock_guard<std::mutex> lock(mu_);
+    retired_.push_back({epoch_.load(), owner, std::move(free)});
+}
+
+uint64_t EpochManager::Reclaim() {
+    // the readers enter from now on can't see the memory retired before
+    uint64_t min_epoch = epoch_.fetch_add(1) + 1;
+    for (uint32_t i = 0; i < slot_num_; i++) {
+        uint64_t epoch = slots_[i].epoch.load();
+        if (epoch != 0 && epoch < min_epoch) {
+            min_epoch = epoch;
+        }
+    }
+    std::vector<std::function<void()>> frees;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        while (!retired_.empty() && retired_.front().epoch < min_epoch) {
+            frees.push_back(std::move(retired_.front().free));
+            retired_.pop_front();
+        }
+    }
+    for (auto& free : frees) {
+        free();
+    }
+    return frees.size();
+}
+
+void EpochManager::Flush(const void* owner) {
+    std::vector<std::function<void()>> frees;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        std::deque<Retired> left;
+        for (auto& item : retired_) {
+            if (item.owner == owner) {
+                frees.push_back(std::move(item.free));
+            } else {
+                left.push_back(std::move(item));
+            }
+        }
+        retired_.swap(left);
+    }
+    for (auto& free : frees) {
+        free();
+    }
+}
+
+uint64_t EpochManager::GetRetiredCnt() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return retired_.size();
+}
+
+void EpochManager::StartReclaimThread(uint32_t interval_ms) {
+    if (interval_ms == 0 || reclaim_thread_.joinable()) {
+        return;
+    }
+    reclaim_thread_ = std::thread([this, interval_ms] {
+        std::unique_lock<std::mutex> lock(mu_);
+        while (!stop_) {
+            cv_.wait_for(lock, std::chrono::milliseconds(interval_ms));
+            lock.unlock();
+            Reclaim();
+            lock.lock();
+        }
+    });
+}
+
+void EpochManager::StopReclaimThread() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stop_ = true;
+        cv_.notify_all();
+    }
+    if (reclaim_thread_.joinable()) {
+        reclaim_thread_.join();
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_EPOCH_H_
+#define SRC_STORAGE_EPOCH_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+
+namespace openmldb {
+namespace storage {
+
+// EpochManager frees the memory unlinked from the memtable lists once no reader may still see it.
+// A reader publishes the global epoch in a slot when it enters and clears the slot when it exits. The writer
+// retires the memory with the epoch after it's unlinked, and the memory is freed when all the readers in
+// the slots have a newer epoch. The slots are not bound to threads, so a guard can move to another thread.
+class EpochManager {
+ public:
+    static constexpr uint32_t kDefaultSlotNum = 2048;
+
+    // the one shared by all memtables, the retired memory is freed by its thread every
+    // epoch_reclaim_interval_ms
+    static EpochManager* Default();
+
+    explicit EpochManager(uint32_t slot_num = kDefaultSlotNum);
+    // the retired memory left is freed
+    ~EpochManager();
+
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    // return the slot which should be passed to Exit
+    uint32_t Enter();
+    void Exit(uint32_t slot);
+
+    // free is called once no reader entered before can see the memory. owner is only used by Flush
+    void Retire(const void* owner, std::function<void()> free);
+
+    // advance the epoch and free the memory no reader can see, return the count of retired items freed
+    uint64_t Reclaim();
+
+    // free the retired memory of owner now, the caller makes sure no reader can see it
+    void Flush(const void* owner);
+
+    uint64_t GetRetiredCnt();
+
+    // free the retired memory every interval_ms in a background thread
+    void StartReclaimThread(uint32_t interval_ms);
+
+ private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        const void* owner;
+        std::function<void()> free;
+    };
+
+    void StopReclaimThread();
+
+ private:
+    const uint32_t slot_num_;
+    std::unique_ptr<Slot[]> slots_;
+    // 0 means the slot is idle, so the epoch starts from 1
+    std::atomic<uint64_t> epoch_;
+    std::mutex mu_;
+    // the epochs are not decreasing
+    std::deque<Retired> retired_;
+    std::thread reclaim_thread_;
+    bool stop_;
+    std::condition_variable cv_;
+};
+
+// EpochGuard keeps the memory seen from being freed while it's alive
+class EpochGuard {
+ public:
+    explicit EpochGuard(EpochManager* manager = EpochManager::Default())
+        : manager_(manager), slot_(manager->Enter()) {}
+    ~EpochGuard() { manager_->Exit(slot_); }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+ private:
+    EpochManager* manager_;
+    uint32_t slot_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_EPOCH_H_
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/epoch.h"
+
+#include <atomic>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace storage {
+
+class EpochTest : public ::testing::Test {
+ public:
+    EpochTest() {}
+    ~EpochTest() {}
+};
+
+TEST_F(EpochTest, Reclaim) {
+    EpochManager manager(4);
+    int freed = 0;
+    manager.Retire(NULL, [&freed] { freed++; });
+    ASSERT_EQ(1u, manager.GetRetiredCnt());
+    ASSERT_EQ(1u, manager.Reclaim());
+    ASSERT_EQ(1, freed);
+    {
+        EpochGuard guard(&manager);
+        manager.Retire(NULL, [&freed] { freed++; });
+        // the guard may see the memory retired after it enters
+        ASSERT_EQ(0u, manager.Reclaim());
+        ASSERT_EQ(1, freed);
+        // the guard entered later doesn't block the memory retired before
+        {
+            EpochGuard guard2(&manager);
+            ASSERT_EQ(0u, manager.Reclaim());
+        }
+    }
+    ASSERT_EQ(1u, manager.Reclaim());
+    ASSERT_EQ(2, freed);
+    ASSERT_EQ(0u, manager.GetRetiredCnt());
+}
+
+TEST_F(EpochTest, Flush) {
+    EpochManager manager(4);
+    int a = 0;
+    int b = 0;
+    EpochGuard guard(&manager);
+    manager.Retire(&a, [&a] { a++; });
+    manager.Retire(&b, [&b] { b++; });
+    manager.Flush(&a);
+    ASSERT_EQ(1, a);
+    ASSERT_EQ(0, b);
+    ASSERT_EQ(1u, manager.GetRetiredCnt());
+}
+
+TEST_F(EpochTest, ConcurrentGuard) {
+    // more threads than slots, the guards wait for a slot
+    EpochManager manager(2);
+    manager.StartReclaimThread(1);
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> readers;
+    std::atomic<int*> value(new int(0));
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&manager, &stop, &value] {
+            while (!stop.load()) {
+                EpochGuard guard(&manager);
+                int* cur = value.load();
+                ASSERT_GE(*cur, 0);
+            }
+        });
+    }
+    for (int i = 1; i <= 1000; i++) {
+        int* old = value.exchange(new int(i));
+        manager.Retire(NULL, [old] {
+            *old = -1;
+            delete old;
+        });
+    }
+    stop.store(true);
+    for (auto& t : readers) {
+        t.join();
+    }
+    delete value.load();
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_EXPIRE_WHEEL_H_
+#define SRC_STORAGE_EXPIRE_WHEEL_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>  // NOLINT
+#include <vector>
+
+namespace openmldb {
+namespace storage {
+
+// ExpireWheel buckets the keys of a segment by the time of their oldest row, so the gc of absolute ttl
+// only visits the keys in the expired buckets instead of the whole segment. A key is added again when
+// its oldest time moves to an older bucket, the stale ones are checked and skipped by the gc.
+// The wheel holds the handles of the keys, the owner keeps a handle alive until it's popped. A handle
+// costs 8 bytes in the bucket, a key takes one handle per bucket it's added to and a key added in order
+// is added only once, so Add and its lock are only on the puts of new keys and of older rows.
+template <typename T>
+class ExpireWheel {
+ public:
+    explicit ExpireWheel(uint64_t bucket_span = 60 * 1000) : bucket_span_(bucket_span > 0 ? bucket_span : 1) {}
+
+    ExpireWheel(const ExpireWheel&) = delete;
+    ExpireWheel& operator=(const ExpireWheel&) = delete;
+
+    uint64_t GetBucket(uint64_t time) const { return time / bucket_span_; }
+
+    void Add(uint64_t bucket, T* handle) {
+        std::lock_guard<std::mutex> lock(mu_);
+        buckets_[bucket].push_back(handle);
+        key_cnt_++;
+    }
+
+    // take out the handles of the buckets not newer than the one of time, the handles are sorted and
+    // a key added several times is in it several times
+    void Pop(uint64_t time, std::vector<T*>* handles) {
+        uint64_t bucket = GetBucket(time);
+        std::lock_guard<std::mutex> lock(mu_);
+        auto end = buckets_.upper_bound(bucket);
+        for (auto it = buckets_.begin(); it != end; ++it) {
+            key_cnt_ -= it->second.size();
+            handles->insert(handles->end(), it->second.begin(), it->second.end());
+        }
+        buckets_.erase(buckets_.begin(), end);
+        std::sort(handles->begin(), handles->end());
+    }
+
+    // take out all the handles
+    void PopAll(std::vector<T*>* handles) { Pop(UINT64_MAX, handles); }
+
+    uint64_t GetKeyCnt() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return key_cnt_;
+    }
+
+ private:
+    const uint64_t bucket_span_;
+    std::mutex mu_;
+    std::map<uint64_t, std::vector<T*>> buckets_;
+    uint64_t key_cnt_ = 0;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_EXPIRE_WHEEL_H_
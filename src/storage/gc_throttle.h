@@ -0,0 +1,73 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_GC_THROTTLE_H_
+#define SRC_STORAGE_GC_THROTTLE_H_
+
+#include <stdint.h>
+
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+
+#include "common/timer.h"
+
+namespace openmldb {
+namespace storage {
+
+// GcThrottle caps the cpu a gc thread takes. Yield is called once per key, and every time slice the
+// thread has worked it sleeps in proportion, so a long gc round is spread out instead of running in a burst.
+class GcThrottle {
+ public:
+    static constexpr uint32_t kCheckCnt = 256;
+    static constexpr uint64_t kSliceUs = 10 * 1000;
+
+    // cpu_percent of 0 or not less than 100 means no limit
+    explicit GcThrottle(uint32_t cpu_percent) : cpu_percent_(cpu_percent), cnt_(0), start_(0), sleep_us_(0) {}
+
+    // the time before it is not counted as worked, call it at the start of a round
+    void Reset() {
+        cnt_ = 0;
+        start_ = ::baidu::common::timer::get_micros();
+    }
+
+    void Yield() {
+        if (cpu_percent_ == 0 || cpu_percent_ >= 100 || ++cnt_ < kCheckCnt) {
+            return;
+        }
+        cnt_ = 0;
+        uint64_t worked = ::baidu::common::timer::get_micros() - start_;
+        if (worked < kSliceUs) {
+            return;
+        }
+        uint64_t sleep_us = worked * (100 - cpu_percent_) / cpu_percent_;
+        std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+        sleep_us_ += sleep_us;
+        start_ = ::baidu::common::timer::get_micros();
+    }
+
+    // the total time slept
+    uint64_t GetSleepUs() const { return sleep_us_; }
+
+ private:
+    const uint32_t cpu_percent_;
+    uint32_t cnt_;
+    uint64_t start_;
+    uint64_t sleep_us_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_GC_THROTTLE_H_
@@ -17,13 +17,18 @@
 #include "storage/mem_table.h"
 
 #include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <mutex>  // NOLINT
+#include <tuple>
 #include <utility>
 
 #include "base/glog_wapper.h"
 #include "base/hash.h"
 #include "base/slice.h"
+#include "base/taskpool.hpp"
 #include "common/timer.h"
 #include "gflags/gflags.h"
+#include "storage/disk_table.h"
 #include "storage/record.h"
 
 DECLARE_uint32(skiplist_max_height);
@@ -32,11 +37,16 @@ DECLARE_uint32(key_entry_max_height);
 DECLARE_uint32(absolute_default_skiplist_height);
 DECLARE_uint32(latest_default_skiplist_height);
 DECLARE_uint32(max_traverse_cnt);
+DECLARE_uint32(cold_block_age);
+DECLARE_uint32(gc_segment_thread_num);
+DECLARE_uint32(mem_table_tier_age);
 
 namespace openmldb {
 namespace storage {
 
 static const uint32_t SEED = 0xe17a1465;
+// DumpImage holds a ticket for this many keys, so the reclamation is not held back for a whole segment
+static const uint32_t DUMP_IMAGE_KEY_BATCH = 64;
 
 MemTable::MemTable(const std::string& name, uint32_t id, uint32_t pid, uint32_t seg_cnt,
                    const std::map<std::string, uint32_t>& mapping, uint64_t ttl, ::openmldb::type::TTLType ttl_type)
@@ -47,18 +57,30 @@ MemTable::MemTable(const std::string& name, uint32_t id, uint32_t pid, uint32_t
       enable_gc_(true),
       record_cnt_(0),
       segment_released_(false),
-      record_byte_size_(0) {}
+      record_byte_size_(0),
+      gc_byte_rate_(0),
+      gc_lag_(0),
+      tier_path_(),
+      tier_(),
+      tier_inner_cnt_(0),
+      spill_time_(0) {}
 
 MemTable::MemTable(const ::openmldb::api::TableMeta& table_meta)
     : Table(table_meta.storage_mode(), table_meta.name(), table_meta.tid(), table_meta.pid(), 0, true, 60 * 1000,
             std::map<std::string, uint32_t>(), ::openmldb::type::TTLType::kAbsoluteTime,
             ::openmldb::type::CompressType::kNoCompress),
-      segments_(MAX_INDEX_NUM, NULL) {
+      segments_(MAX_INDEX_NUM, NULL),
+      tier_path_(),
+      tier_(),
+      tier_inner_cnt_(0),
+      spill_time_(0) {
     seg_cnt_ = 8;
     enable_gc_ = true;
     record_cnt_ = 0;
     segment_released_ = false;
     record_byte_size_ = 0;
+    gc_byte_rate_ = 0;
+    gc_lag_ = 0;
     diskused_ = 0;
     table_meta_ = std::make_shared<::openmldb::api::TableMeta>(table_meta);
 }
@@ -67,6 +89,7 @@ MemTable::~MemTable() {
     if (segments_.empty()) {
         return;
     }
+    // Release keeps the segments, they own the slab chunks which must be freed below
     Release();
     for (uint32_t i = 0; i < segments_.size(); i++) {
         if (segments_[i] != NULL) {
@@ -119,10 +142,31 @@ bool MemTable::Init() {
         segments_[i] = seg_arr;
         key_entry_max_height_ = cur_key_entry_max_height;
     }
+    if (FLAGS_mem_table_tier_age > 0 && !tier_path_.empty()) {
+        ::openmldb::api::TableMeta tier_meta(*table_meta_);
+        tier_meta.set_storage_mode(::openmldb::common::StorageMode::kHDD);
+        tier_.reset(new DiskTable(tier_meta, tier_path_));
+        if (!tier_->Init()) {
+            PDLOG(WARNING, "fail to init disk tier with path %s. tid %u pid %u", tier_path_.c_str(), id_, pid_);
+            tier_.reset();
+            return false;
+        }
+        tier_inner_cnt_ = inner_indexs->size();
+        // the rows spilled before restart are not newer than it
+        spill_time_.store(::baidu::common::timer::get_micros() / 1000 - FLAGS_mem_table_tier_age * 60 * 1000ul);
+        PDLOG(INFO, "init disk tier with path %s. tid %u pid %u", tier_path_.c_str(), id_, pid_);
+    }
     PDLOG(INFO, "init table name %s, id %d, pid %d, seg_cnt %d", name_.c_str(), id_, pid_, seg_cnt_);
     return true;
 }
 
+uint32_t MemTable::GetSegIdx(const Slice& key) const {
+    if (seg_cnt_ > 1) {
+        return ::openmldb::base::hash(key.data(), key.size(), SEED) % seg_cnt_;
+    }
+    return 0;
+}
+
 void MemTable::SetCompressType(::openmldb::type::CompressType compress_type) { compress_type_ = compress_type; }
 
 ::openmldb::type::CompressType MemTable::GetCompressType() { return compress_type_; }
@@ -168,12 +212,23 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
         return false;
     }
     std::map<int32_t, uint64_t> ts_map;
+    // the row older than the spill time goes to the disk tier directly, e.g. the rows replayed on recovery
+    bool to_tier = tier_ != NULL;
+    // the index id, key and ts of the row in the disk tier
+    std::vector<std::tuple<uint32_t, Slice, uint64_t>> tier_keys;
+    uint64_t tier_time = 0;
+    if (to_tier) {
+        tier_time = ::baidu::common::timer::get_micros() / 1000 - FLAGS_mem_table_tier_age * 60 * 1000ul;
+    }
     for (const auto& kv : inner_index_key_map) {
         auto inner_index = table_index_.GetInnerIndex(kv.first);
         if (!inner_index) {
             PDLOG(WARNING, "invalid inner index pos %d. tid %u pid %u", kv.first, id_, pid_);
             return false;
         }
+        if (to_tier && !IsSpillable(kv.first, inner_index)) {
+            to_tier = false;
+        }
         for (const auto& index_def : inner_index->GetIndex()) {
             auto ts_col = index_def->GetTsColumn();
             if (ts_col) {
@@ -185,6 +240,11 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
                     return false;
                 }
                 ts_map.emplace(ts_col->GetId(), ts);
+                if (static_cast<uint64_t>(ts) > tier_time) {
+                    to_tier = false;
+                } else if (to_tier) {
+                    tier_keys.emplace_back(index_def->GetId(), kv.second, ts);
+                }
             }
             if (index_def->IsReady()) {
                 real_ref_cnt++;
@@ -194,7 +254,32 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
     if (ts_map.empty()) {
         return false;
     }
-    auto* block = new DataBlock(real_ref_cnt, value.c_str(), value.length());
+    if (to_tier) {
+        // a row of the same key and ts in the disk tier would be overwritten, so the row is kept in memory
+        std::vector<std::pair<uint64_t, Slice>> rows(1, std::make_pair(0, Slice(value.data(), value.size())));
+        for (const auto& tier_key : tier_keys) {
+            rows[0].first = std::get<2>(tier_key);
+            if (HasTierConflict(std::get<0>(tier_key), std::get<1>(tier_key), rows)) {
+                to_tier = false;
+                break;
+            }
+        }
+    }
+    if (to_tier) {
+        // the readers go to the disk tier for the rows not newer than the spill time
+        uint64_t cur = spill_time_.load(std::memory_order_relaxed);
+        while (cur < tier_time && !spill_time_.compare_exchange_weak(cur, tier_time)) {
+        }
+        return tier_->Put(time, value, dimensions);
+    }
+    // the row is carved out of the slab of the first dimension's segment
+    uint32_t first_seg_idx = 0;
+    if (seg_cnt_ > 1) {
+        const Slice& first_key = inner_index_key_map.begin()->second;
+        first_seg_idx = ::openmldb::base::hash(first_key.data(), first_key.size(), SEED) % seg_cnt_;
+    }
+    SlabAllocator* slab = segments_[inner_index_key_map.begin()->first][first_seg_idx]->GetSlab();
+    auto* block = NewDataBlock(slab, real_ref_cnt, value.c_str(), value.length());
     for (const auto& kv : inner_index_key_map) {
         auto inner_index = table_index_.GetInnerIndex(kv.first);
         bool need_put = false;
@@ -231,7 +316,11 @@ bool MemTable::Delete(const std::string& pk, uint32_t idx) {
     }
     uint32_t real_idx = index_def->GetInnerPos();
     Segment* segment = segments_[real_idx][seg_idx];
-    return segment->Delete(spk);
+    bool ok = segment->Delete(spk);
+    if (tier_ != NULL && real_idx < tier_inner_cnt_) {
+        ok = tier_->Delete(pk, idx) || ok;
+    }
+    return ok;
 }
 
 uint64_t MemTable::Release() {
@@ -250,16 +339,67 @@ uint64_t MemTable::Release() {
         }
     }
     segment_released_ = true;
-    segments_.clear();
     return total_cnt;
 }
 
+// the counters of the gc of a segment
+struct SegmentGcCnt {
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    uint64_t freeze_cnt = 0;
+    uint64_t freeze_byte_size = 0;
+    uint64_t spill_cnt = 0;
+    uint64_t spill_record_cnt = 0;
+    uint64_t spill_byte_size = 0;
+};
+
+// the segments of an index are gc in parallel by it if gc_segment_thread_num is more than 1, it's shared by all tables
+static ::openmldb::base::TaskPool* GetSegmentGcPool() {
+    static ::openmldb::base::TaskPool pool(FLAGS_gc_segment_thread_num, 1024);
+    return &pool;
+}
+
+// the rows not newer than spill_time are spilled by writer if it's not NULL
+static void GcSegment(Segment* segment, const std::map<uint32_t, TTLSt>& ttl_st_map, const SpillWriter* writer,
+                      uint64_t spill_time, bool is_first, SegmentGcCnt* cnt) {
+    segment->IncrGcVersion();
+    segment->GcFreeList(cnt->gc_idx_cnt, cnt->gc_record_cnt, cnt->gc_record_byte_size);
+    if (ttl_st_map.size() == 1) {
+        segment->ExecuteGc(ttl_st_map.begin()->second, cnt->gc_idx_cnt, cnt->gc_record_cnt,
+                           cnt->gc_record_byte_size);
+    } else {
+        segment->ExecuteGc(ttl_st_map, cnt->gc_idx_cnt, cnt->gc_record_cnt, cnt->gc_record_byte_size);
+    }
+    if (writer != NULL) {
+        segment->Spill(spill_time, *writer, is_first, cnt->spill_cnt, cnt->spill_record_cnt, cnt->spill_byte_size);
+    }
+    if (FLAGS_cold_block_age > 0 && ttl_st_map.size() == 1 &&
+        ttl_st_map.begin()->second.ttl_type == ::openmldb::storage::TTLType::kAbsoluteTime) {
+        uint64_t freeze_time = ::baidu::common::timer::get_micros() / 1000 - FLAGS_cold_block_age * 60 * 1000ul;
+        segment->FreezeCold(freeze_time, cnt->freeze_cnt, cnt->freeze_byte_size);
+    }
+}
+
 void MemTable::SchedGc() {
     uint64_t consumed = ::baidu::common::timer::get_micros();
     PDLOG(INFO, "start making gc for table %s, tid %u, pid %u", name_.c_str(), id_, pid_);
     uint64_t gc_idx_cnt = 0;
     uint64_t gc_record_cnt = 0;
     uint64_t gc_record_byte_size = 0;
+    uint64_t freeze_cnt = 0;
+    uint64_t freeze_byte_size = 0;
+    uint64_t spill_cnt = 0;
+    uint64_t spill_record_cnt = 0;
+    uint64_t spill_byte_size = 0;
+    uint64_t spill_time = 0;
+    if (tier_ != NULL) {
+        spill_time = ::baidu::common::timer::get_micros() / 1000 - FLAGS_mem_table_tier_age * 60 * 1000ul;
+        // it's raised before the rows are written, so the readers never miss the rows dropped from memory
+        uint64_t cur = spill_time_.load(std::memory_order_relaxed);
+        while (cur < spill_time && !spill_time_.compare_exchange_weak(cur, spill_time)) {
+        }
+    }
     auto inner_indexs = table_index_.GetAllInnerIndex();
     for (uint32_t i = 0; i < inner_indexs->size(); i++) {
         const std::vector<std::shared_ptr<IndexDef>>& real_index = inner_indexs->at(i)->GetIndex();
@@ -299,29 +439,154 @@ void MemTable::SchedGc() {
         if (deleted_num == real_index.size() || ttl_st_map.empty()) {
             continue;
         }
-        for (uint32_t j = 0; j < seg_cnt_; j++) {
-            uint64_t seg_gc_time = ::baidu::common::timer::get_micros() / 1000;
-            Segment* segment = segments_[i][j];
-            segment->IncrGcVersion();
-            segment->GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            if (ttl_st_map.size() == 1) {
-                segment->ExecuteGc(ttl_st_map.begin()->second, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            } else {
-                segment->ExecuteGc(ttl_st_map, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        std::unique_ptr<SpillWriter> writer;
+        if (ttl_st_map.size() == 1 && IsSpillable(i, inner_indexs->at(i))) {
+            uint32_t index_id = real_index.front()->GetId();
+            writer.reset(new SpillWriter([this, index_id](const Slice& key,
+                                                         const std::vector<std::pair<uint64_t, Slice>>& rows) {
+                return SpillToTier(index_id, key, rows);
+            }));
+        }
+        uint64_t index_gc_time = ::baidu::common::timer::get_micros() / 1000;
+        // a row may be shared by the indexes and its dimension count is not atomic, so only the segments of
+        // one index are gc at the same time
+        std::vector<SegmentGcCnt> cnts(seg_cnt_);
+        if (FLAGS_gc_segment_thread_num > 1 && seg_cnt_ > 1) {
+            std::mutex mu;
+            std::condition_variable cv;
+            uint32_t pending = seg_cnt_;
+            for (uint32_t j = 0; j < seg_cnt_; j++) {
+                Segment* segment = segments_[i][j];
+                SegmentGcCnt* cnt = &cnts[j];
+                GetSegmentGcPool()->AddTask([segment, &ttl_st_map, &writer, spill_time, i, cnt, &mu, &cv, &pending] {
+                    GcSegment(segment, ttl_st_map, writer.get(), spill_time, i == 0, cnt);
+                    std::lock_guard<std::mutex> lock(mu);
+                    if (--pending == 0) {
+                        cv.notify_all();
+                    }
+                });
             }
-            seg_gc_time = ::baidu::common::timer::get_micros() / 1000 - seg_gc_time;
-            PDLOG(INFO, "gc segment[%u][%u] done consumed %lu for table %s tid %u pid %u", i, j, seg_gc_time,
-                  name_.c_str(), id_, pid_);
+            std::unique_lock<std::mutex> lock(mu);
+            cv.wait(lock, [&pending] { return pending == 0; });
+        } else {
+            for (uint32_t j = 0; j < seg_cnt_; j++) {
+                GcSegment(segments_[i][j], ttl_st_map, writer.get(), spill_time, i == 0, &cnts[j]);
+            }
+        }
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            DEBUGLOG("gc segment[%u][%u] done, gc_idx_cnt %lu for table %s tid %u pid %u", i, j,
+                     cnts[j].gc_idx_cnt, name_.c_str(), id_, pid_);
+            gc_idx_cnt += cnts[j].gc_idx_cnt;
+            gc_record_cnt += cnts[j].gc_record_cnt;
+            gc_record_byte_size += cnts[j].gc_record_byte_size;
+            freeze_cnt += cnts[j].freeze_cnt;
+            freeze_byte_size += cnts[j].freeze_byte_size;
+            spill_cnt += cnts[j].spill_cnt;
+            spill_record_cnt += cnts[j].spill_record_cnt;
+            spill_byte_size += cnts[j].spill_byte_size;
         }
+        index_gc_time = ::baidu::common::timer::get_micros() / 1000 - index_gc_time;
+        PDLOG(INFO, "gc index %u done consumed %lu for table %s tid %u pid %u", i, index_gc_time, name_.c_str(), id_,
+              pid_);
     }
     consumed = ::baidu::common::timer::get_micros() - consumed;
-    record_cnt_.fetch_sub(gc_record_cnt, std::memory_order_relaxed);
-    record_byte_size_.fetch_sub(gc_record_byte_size, std::memory_order_relaxed);
+    record_cnt_.fetch_sub(gc_record_cnt + spill_record_cnt, std::memory_order_relaxed);
+    uint64_t freed_byte_size = gc_record_byte_size + freeze_byte_size + spill_byte_size;
+    record_byte_size_.fetch_sub(freed_byte_size, std::memory_order_relaxed);
+    gc_byte_rate_.store(freed_byte_size * 1000000 / (consumed > 0 ? consumed : 1), std::memory_order_relaxed);
+    gc_lag_.store(consumed / 1000, std::memory_order_relaxed);
     PDLOG(INFO,
-          "gc finished, gc_idx_cnt %lu, gc_record_cnt %lu consumed %lu ms for "
+          "gc finished, gc_idx_cnt %lu, gc_record_cnt %lu, freeze_cnt %lu, spill_cnt %lu consumed %lu ms for "
           "table %s tid %u pid %u",
-          gc_idx_cnt, gc_record_cnt, consumed / 1000, name_.c_str(), id_, pid_);
+          gc_idx_cnt, gc_record_cnt, freeze_cnt, spill_cnt, consumed / 1000, name_.c_str(), id_, pid_);
     UpdateTTL();
+    if (tier_ != NULL) {
+        SyncTierTTL();
+        tier_->SchedGc();
+    }
+}
+
+bool MemTable::IsSpillable(uint32_t inner_pos, const std::shared_ptr<InnerIndexSt>& inner_index) const {
+    if (tier_ == NULL || inner_pos >= tier_inner_cnt_ || inner_index->GetTsIdx().size() > 1) {
+        return false;
+    }
+    for (const auto& index_def : inner_index->GetIndex()) {
+        if (index_def->GetTTL()->ttl_type != ::openmldb::storage::TTLType::kAbsoluteTime) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MemTable::HasTierConflict(uint32_t index, const Slice& key,
+                               const std::vector<std::pair<uint64_t, Slice>>& rows) {
+    if (rows.empty()) {
+        return false;
+    }
+    std::vector<std::pair<uint64_t, Slice>> sorted(rows);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<uint64_t, Slice>& a, const std::pair<uint64_t, Slice>& b) { return a.first > b.first; });
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(tier_->NewIterator(index, key.ToString(), ticket));
+    if (!it) {
+        return false;
+    }
+    // only the tier rows in the ts range of the rows are read
+    auto cur = sorted.begin();
+    for (it->Seek(sorted.front().first); it->Valid() && it->GetKey() >= sorted.back().first; it->Next()) {
+        while (cur != sorted.end() && cur->first > it->GetKey()) {
+            ++cur;
+        }
+        if (cur != sorted.end() && cur->first == it->GetKey() && it->GetValue().compare(cur->second) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SpillStatus MemTable::SpillToTier(uint32_t index, const Slice& key,
+                                  const std::vector<std::pair<uint64_t, Slice>>& rows) {
+    if (HasTierConflict(index, key, rows)) {
+        return SpillStatus::kKept;
+    }
+    Dimensions dimensions;
+    auto dimension = dimensions.Add();
+    dimension->set_key(key.data(), key.size());
+    dimension->set_idx(index);
+    std::string value;
+    for (const auto& row : rows) {
+        value.assign(row.second.data(), row.second.size());
+        // the time is the ts of the row in the list, it's only used by the auto generated ts column
+        if (!tier_->Put(row.first, value, dimensions)) {
+            return SpillStatus::kFailed;
+        }
+    }
+    return SpillStatus::kSpilled;
+}
+
+void MemTable::SyncTierTTL() {
+    for (const auto& index_def : table_index_.GetAllIndex()) {
+        auto tier_index = tier_->GetIndex(index_def->GetName());
+        if (!tier_index) {
+            continue;
+        }
+        auto ttl = index_def->GetTTL();
+        auto tier_ttl = tier_index->GetTTL();
+        if (ttl->abs_ttl != tier_ttl->abs_ttl || ttl->lat_ttl != tier_ttl->lat_ttl ||
+            ttl->ttl_type != tier_ttl->ttl_type) {
+            tier_->SetTTL(UpdateTTLMeta(*ttl, index_def->GetName()));
+        }
+    }
+}
+
+uint64_t MemTable::GetRecordCnt() const {
+    // the tier counts the rows of the first inner index, and a row spilled by it is not counted in memory though
+    // other indexes still refer to it. So a row spilled by several indexes is counted once
+    uint64_t cnt = record_cnt_.load(std::memory_order_relaxed);
+    if (tier_ != NULL) {
+        cnt += tier_->GetRecordCnt();
+    }
+    return cnt;
 }
 
 // tll as ms
@@ -436,10 +701,21 @@ int MemTable::GetCount(uint32_t index, const std::string& pk, uint64_t& count) {
     uint32_t real_idx = index_def->GetInnerPos();
     Segment* segment = segments_[real_idx][seg_idx];
     auto ts_col = index_def->GetTsColumn();
+    int ret = 0;
     if (ts_col) {
-        return segment->GetCount(spk, ts_col->GetId(), count);
+        ret = segment->GetCount(spk, ts_col->GetId(), count);
+    } else {
+        ret = segment->GetCount(spk, count);
     }
-    return segment->GetCount(spk, count);
+    uint64_t tier_cnt = 0;
+    if (tier_ != NULL && real_idx < tier_inner_cnt_ && tier_->GetCount(index, pk, tier_cnt) == 0 && tier_cnt > 0) {
+        if (ret < 0) {
+            count = 0;
+            ret = 0;
+        }
+        count += tier_cnt;
+    }
+    return ret;
 }
 
 TableIterator* MemTable::NewIterator(const std::string& pk, Ticket& ticket) { return NewIterator(0, pk, ticket); }
@@ -458,10 +734,16 @@ TableIterator* MemTable::NewIterator(uint32_t index, const std::string& pk, Tick
     uint32_t real_idx = index_def->GetInnerPos();
     Segment* segment = segments_[real_idx][seg_idx];
     auto ts_col = index_def->GetTsColumn();
+    TableIterator* it = NULL;
     if (ts_col) {
-        return segment->NewIterator(spk, ts_col->GetId(), ticket);
+        it = segment->NewIterator(spk, ts_col->GetId(), ticket);
+    } else {
+        it = segment->NewIterator(spk, ticket);
     }
-    return segment->NewIterator(spk, ticket);
+    if (tier_ != NULL && real_idx < tier_inner_cnt_) {
+        return new TieredTableIterator(it, tier_.get(), index, pk, &spill_time_);
+    }
+    return it;
 }
 
 uint64_t MemTable::GetRecordIdxByteSize() {
@@ -667,6 +949,10 @@ bool MemTable::DeleteIndex(const std::string& idx_name) {
     if (ts_col) {
         ts_idx = ts_col->GetId();
     }
+    if (tier_ != NULL && real_idx < tier_inner_cnt_) {
+        return new MemTableKeyIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt, ts_idx,
+                                       tier_.get(), index, &spill_time_);
+    }
     return new MemTableKeyIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt, ts_idx);
 }
 
@@ -776,8 +1062,264 @@ bool MemTable::BulkLoad(const std::vector<DataBlock*>& data_blocks,
     return true;
 }
 
+void MemTable::GetImageHeader(MemTableImageHeader* header) {
+    header->tid = id_;
+    header->pid = pid_;
+    header->seg_cnt = seg_cnt_;
+    header->ts_cnts.clear();
+    auto inner_indexes = table_index_.GetAllInnerIndex();
+    for (uint32_t i = 0; i < inner_indexes->size(); i++) {
+        header->ts_cnts.push_back(segments_[i][0]->GetTsCnt());
+    }
+}
+
+static bool IsInnerIndexReady(const std::shared_ptr<InnerIndexSt>& inner_index) {
+    for (const auto& index_def : inner_index->GetIndex()) {
+        if (index_def->IsReady()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MemTable::DumpImage(MemTableImageWriter* writer) {
+    auto inner_indexes = table_index_.GetAllInnerIndex();
+    std::vector<MemTableImageRow> rows;
+    for (uint32_t inner_pos = 0; inner_pos < inner_indexes->size(); inner_pos++) {
+        if (!IsInnerIndexReady(inner_indexes->at(inner_pos))) {
+            continue;
+        }
+        for (uint32_t seg_idx = 0; seg_idx < seg_cnt_; seg_idx++) {
+            Segment* segment = segments_[inner_pos][seg_idx];
+            uint32_t ts_cnt = segment->GetTsCnt();
+            // the ticket keeps the keys and rows of a batch from gc until they are written, the next batch
+            // seeks to the key after the last one with a new ticket
+            std::string last_key;
+            bool first = true;
+            bool done = false;
+            while (!done) {
+                Ticket ticket;
+                std::unique_ptr<KeyEntries::Iterator> pk_it(segment->GetKeyEntries()->NewIterator());
+                if (first) {
+                    first = false;
+                    pk_it->SeekToFirst();
+                } else {
+                    pk_it->Seek(Slice(last_key));
+                    if (pk_it->Valid() && pk_it->GetKey().compare(Slice(last_key)) == 0) {
+                        pk_it->Next();
+                    }
+                }
+                for (uint32_t key_cnt = 0; key_cnt < DUMP_IMAGE_KEY_BATCH && pk_it->Valid(); key_cnt++) {
+                    for (uint32_t key_entry_id = 0; key_entry_id < ts_cnt; key_entry_id++) {
+                        KeyEntry* entry = ts_cnt > 1 ? ((KeyEntry**)pk_it->GetValue())[key_entry_id]  // NOLINT
+                                                     : (KeyEntry*)pk_it->GetValue();                  // NOLINT
+                        rows.clear();
+                        std::unique_ptr<KeyEntry::Iterator> it(entry->NewIterator());
+                        it->SeekToFirst();
+                        while (it->Valid()) {
+                            rows.push_back(MemTableImageRow{it->GetKey(), it->GetValue(), it->GetRefCnt()});
+                            it->Next();
+                        }
+                        if (rows.empty()) {
+                            continue;
+                        }
+                        if (!writer->AddKey(inner_pos, seg_idx, key_entry_id, pk_it->GetKey(), rows)) {
+                            PDLOG(WARNING, "fail to dump image. tid %u pid %u", id_, pid_);
+                            return false;
+                        }
+                    }
+                    last_key = pk_it->GetKey().ToString();
+                    pk_it->Next();
+                }
+                done = !pk_it->Valid();
+            }
+        }
+    }
+    return true;
+}
+
+bool MemTable::LoadImage(MemTableImageReader* reader) {
+    auto inner_indexes = table_index_.GetAllInnerIndex();
+    // blocks[i] is the row which id is i
+    std::vector<DataBlock*> blocks;
+    std::vector<std::pair<uint64_t, DataBlock*>> rows;
+    uint32_t inner_pos = 0;
+    uint32_t seg_idx = 0;
+    uint32_t key_entry_id = 0;
+    std::string key;
+    bool ok = true;
+    int ret = 0;
+    while (ok && (ret = reader->NextKey(&inner_pos, &seg_idx, &key_entry_id, &key)) == 1) {
+        if (inner_pos >= inner_indexes->size() || seg_idx >= seg_cnt_) {
+            PDLOG(WARNING, "invalid inner pos %u seg idx %u in image. tid %u pid %u", inner_pos, seg_idx, id_, pid_);
+            ok = false;
+            break;
+        }
+        Segment* segment = segments_[inner_pos][seg_idx];
+        bool ready = IsInnerIndexReady(inner_indexes->at(inner_pos));
+        rows.clear();
+        uint64_t time = 0;
+        uint64_t row_id = 0;
+        bool is_new = false;
+        Slice data;
+        while ((ret = reader->NextRow(&time, &row_id, &is_new, &data)) == 1) {
+            if (is_new) {
+                blocks.push_back(NewDataBlock(segment->GetSlab(), 0, data.data(), data.size()));
+            }
+            if (ready) {
+                blocks[row_id]->dim_cnt_down++;
+                rows.emplace_back(time, blocks[row_id]);
+            }
+        }
+        if (ret < 0) {
+            ok = false;
+            break;
+        }
+        segment->Append(Slice(key), key_entry_id, rows);
+    }
+    if (ret < 0) {
+        ok = false;
+    }
+    uint64_t record_cnt = 0;
+    uint64_t record_byte_size = 0;
+    for (auto* block : blocks) {
+        if (block->dim_cnt_down == 0) {
+            FreeDataBlock(block);
+        } else {
+            record_cnt++;
+            record_byte_size += GetRecordSize(block->size);
+        }
+    }
+    record_cnt_.fetch_add(record_cnt, std::memory_order_relaxed);
+    record_byte_size_.fetch_add(record_byte_size);
+    PDLOG(INFO, "load %lu rows from image. tid %u pid %u", record_cnt, id_, pid_);
+    return ok;
+}
+
+bool MemTable::PutIfAbsent(const ::openmldb::api::LogEntry& entry) {
+    if (entry.dimensions_size() == 0 || entry.value().length() < codec::HEADER_LENGTH) {
+        return Table::Put(entry);
+    }
+    const auto& dimension = entry.dimensions(0);
+    std::shared_ptr<IndexDef> index_def = table_index_.GetIndex(dimension.idx());
+    if (!index_def || !index_def->IsReady()) {
+        return Table::Put(entry);
+    }
+    int64_t ts = entry.ts();
+    auto ts_col = index_def->GetTsColumn();
+    if (ts_col && !ts_col->IsAutoGenTs()) {
+        const int8_t* data = reinterpret_cast<const int8_t*>(entry.value().data());
+        auto decoder = GetVersionDecoder(codec::RowView::GetSchemaVersion(data));
+        if (decoder == nullptr || decoder->GetInteger(data, ts_col->GetId(), ts_col->GetType(), &ts) != 0) {
+            return Table::Put(entry);
+        }
+    }
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(NewIterator(dimension.idx(), dimension.key(), ticket));
+    if (it) {
+        uint64_t time = static_cast<uint64_t>(ts);
+        it->Seek(time);
+        while (it->Valid() && it->GetKey() == time) {
+            if (it->GetValue().compare(Slice(entry.value())) == 0) {
+                return true;
+            }
+            it->Next();
+        }
+    }
+    return Table::Put(entry);
+}
+
+TieredTableIterator::TieredTableIterator(TableIterator* mem_it, DiskTable* tier, uint32_t index, const std::string& pk,
+                                         const std::atomic<uint64_t>* spill_time)
+    : mem_it_(mem_it),
+      disk_it_(NULL),
+      tier_(tier),
+      index_(index),
+      pk_(pk),
+      spill_time_(spill_time),
+      cursor_(UINT64_MAX),
+      disk_opened_(false),
+      is_disk_(false),
+      key_(0),
+      ticket_() {}
+
+TieredTableIterator::~TieredTableIterator() {
+    delete mem_it_;
+    delete disk_it_;
+}
+
+void TieredTableIterator::ResetDisk() {
+    delete disk_it_;
+    disk_it_ = NULL;
+    disk_opened_ = false;
+}
+
+void TieredTableIterator::Pick() {
+    if (!disk_opened_ && (!mem_it_->Valid() || mem_it_->GetKey() <= spill_time_->load(std::memory_order_acquire))) {
+        disk_opened_ = true;
+        disk_it_ = tier_->NewIterator(index_, pk_, ticket_);
+        if (disk_it_ != NULL) {
+            disk_it_->Seek(cursor_);
+        }
+    }
+    is_disk_ = false;
+    if (disk_it_ != NULL) {
+        // the rows being spilled are in both memory and the disk tier
+        while (disk_it_->Valid() && mem_it_->Valid() && disk_it_->GetKey() == mem_it_->GetKey() &&
+               disk_it_->GetValue().compare(mem_it_->GetValue()) == 0) {
+            disk_it_->Next();
+        }
+        is_disk_ = disk_it_->Valid() && (!mem_it_->Valid() || disk_it_->GetKey() > mem_it_->GetKey());
+    }
+    if (is_disk_) {
+        key_ = disk_it_->GetKey();
+    } else if (mem_it_->Valid()) {
+        key_ = mem_it_->GetKey();
+    }
+}
+
+void TieredTableIterator::Next() {
+    if (is_disk_) {
+        disk_it_->Next();
+    } else {
+        mem_it_->Next();
+    }
+    // the rows newer than the current one have been seen
+    cursor_ = key_ > 0 ? key_ - 1 : 0;
+    Pick();
+}
+
+openmldb::base::Slice TieredTableIterator::GetValue() const {
+    return is_disk_ ? disk_it_->GetValue() : mem_it_->GetValue();
+}
+
+void TieredTableIterator::SeekToFirst() {
+    mem_it_->SeekToFirst();
+    ResetDisk();
+    cursor_ = UINT64_MAX;
+    Pick();
+}
+
+void TieredTableIterator::SeekToLast() {
+    mem_it_->SeekToLast();
+    ResetDisk();
+    disk_opened_ = true;
+    is_disk_ = false;
+    if (mem_it_->Valid()) {
+        key_ = mem_it_->GetKey();
+    }
+}
+
+void TieredTableIterator::Seek(uint64_t time) {
+    mem_it_->Seek(time);
+    ResetDisk();
+    cursor_ = time;
+    Pick();
+}
+
 MemTableKeyIterator::MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, ::openmldb::storage::TTLType ttl_type,
-                                         uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index)
+                                         uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index,
+                                         DiskTable* tier, uint32_t index, const std::atomic<uint64_t>* spill_time)
     : segments_(segments),
       seg_cnt_(seg_cnt),
       seg_idx_(0),
@@ -787,7 +1329,12 @@ MemTableKeyIterator::MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, :
       expire_time_(expire_time),
       expire_cnt_(expire_cnt),
       ticket_(),
-      ts_idx_(0) {
+      ts_idx_(0),
+      tier_(tier),
+      index_(index),
+      spill_time_(spill_time),
+      disk_it_(NULL),
+      in_disk_(false) {
     uint32_t idx = 0;
     if (segments_[0]->GetTsIdx(ts_index, idx) == 0) {
         ts_idx_ = idx;
@@ -796,10 +1343,11 @@ MemTableKeyIterator::MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, :
 
 MemTableKeyIterator::~MemTableKeyIterator() {
     if (pk_it_ != NULL) delete pk_it_;
+    delete disk_it_;
 }
 
 void MemTableKeyIterator::SeekToFirst() {
-    ticket_.Pop();
+    in_disk_ = false;
     if (pk_it_ != NULL) {
         delete pk_it_;
         pk_it_ = NULL;
@@ -811,41 +1359,105 @@ void MemTableKeyIterator::SeekToFirst() {
         delete pk_it_;
         pk_it_ = NULL;
     }
+    SeekDiskToFirst();
+}
+
+void MemTableKeyIterator::SeekDiskToFirst() {
+    if (tier_ == NULL) {
+        return;
+    }
+    if (disk_it_ == NULL) {
+        disk_it_ = tier_->NewWindowIterator(index_);
+        if (disk_it_ == NULL) {
+            return;
+        }
+    }
+    in_disk_ = true;
+    disk_it_->SeekToFirst();
+    SkipMemKeys();
+}
+
+void MemTableKeyIterator::SkipMemKeys() {
+    while (disk_it_->Valid()) {
+        std::string pk = disk_it_->GetKey().ToString();
+        uint32_t seg_idx = 0;
+        if (seg_cnt_ > 1) {
+            seg_idx = ::openmldb::base::hash(pk.c_str(), pk.length(), SEED) % seg_cnt_;
+        }
+        void* entry = NULL;
+        if (segments_[seg_idx]->GetKeyEntries()->Get(Slice(pk), entry) < 0 || entry == NULL) {
+            return;
+        }
+        disk_it_->Next();
+    }
 }
 
 void MemTableKeyIterator::Seek(const std::string& key) {
+    in_disk_ = false;
     if (pk_it_ != NULL) {
         delete pk_it_;
         pk_it_ = NULL;
     }
-    ticket_.Pop();
     if (seg_cnt_ > 1) {
         seg_idx_ = ::openmldb::base::hash(key.c_str(), key.length(), SEED) % seg_cnt_;
     }
     Slice spk(key);
     pk_it_ = segments_[seg_idx_]->GetKeyEntries()->NewIterator();
     pk_it_->Seek(spk);
+    if (tier_ != NULL && !(pk_it_->Valid() && pk_it_->GetKey().compare(spk) == 0)) {
+        // the rows of the key may be all spilled
+        if (disk_it_ == NULL) {
+            disk_it_ = tier_->NewWindowIterator(index_);
+        }
+        if (disk_it_ != NULL) {
+            disk_it_->Seek(key);
+            if (disk_it_->Valid() && disk_it_->GetKey().ToString() == key) {
+                in_disk_ = true;
+                return;
+            }
+        }
+    }
     if (!pk_it_->Valid()) {
         NextPK();
     }
 }
 
 bool MemTableKeyIterator::Valid() {
+    if (in_disk_) {
+        return disk_it_->Valid();
+    }
     return pk_it_ != NULL && pk_it_->Valid();
 }
 
-void MemTableKeyIterator::Next() { NextPK(); }
+void MemTableKeyIterator::Next() {
+    if (in_disk_) {
+        disk_it_->Next();
+        SkipMemKeys();
+        return;
+    }
+    NextPK();
+    if (pk_it_ == NULL) {
+        SeekDiskToFirst();
+    }
+}
 
 ::hybridse::vm::RowIterator* MemTableKeyIterator::GetRawValue() {
-    TimeEntries::Iterator* it = NULL;
+    if (in_disk_) {
+        return disk_it_->GetRawValue();
+    }
+    KeyEntry::Iterator* it = NULL;
     if (segments_[seg_idx_]->GetTsCnt() > 1) {
         KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[ts_idx_];  // NOLINT
-        it = entry->entries.NewIterator();
-        ticket_.Push(entry);
+        it = entry->NewIterator();
     } else {
         it = ((KeyEntry*)pk_it_->GetValue())  // NOLINT
-                 ->entries.NewIterator();
-        ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
+                 ->NewIterator();
+    }
+    if (tier_ != NULL) {
+        auto tiered_it = new TieredTableIterator(new MemTableIterator(it), tier_, index_,
+                                                 pk_it_->GetKey().ToString(), spill_time_);
+        tiered_it->SeekToFirst();
+        return new TieredWindowIterator(tiered_it, ttl_type_, expire_time_, expire_cnt_);
     }
     it->SeekToFirst();
     return new MemTableWindowIterator(it, ttl_type_, expire_time_, expire_cnt_);
@@ -856,6 +1468,9 @@ std::unique_ptr<::hybridse::vm::RowIterator> MemTableKeyIterator::GetValue() {
 }
 
 const hybridse::codec::Row MemTableKeyIterator::GetKey() {
+    if (in_disk_) {
+        return disk_it_->GetKey();
+    }
     hybridse::codec::Row row(
         ::hybridse::base::RefCountedSlice::Create(pk_it_->GetKey().data(), pk_it_->GetKey().size()));
     return row;
@@ -863,7 +1478,6 @@ const hybridse::codec::Row MemTableKeyIterator::GetKey() {
 
 void MemTableKeyIterator::NextPK() {
     do {
-        ticket_.Pop();
         if (pk_it_->Valid()) {
             pk_it_->Next();
         }
@@ -927,7 +1541,6 @@ void MemTableTraverseIterator::NextPK() {
     delete it_;
     it_ = NULL;
     do {
-        ticket_.Pop();
         if (pk_it_->Valid()) {
             pk_it_->Next();
         }
@@ -951,12 +1564,10 @@ void MemTableTraverseIterator::NextPK() {
         }
         if (segments_[seg_idx_]->GetTsCnt() > 1) {
             KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[0];  // NOLINT
-            it_ = entry->entries.NewIterator();
-            ticket_.Push(entry);
+            it_ = entry->NewIterator();
         } else {
             it_ = ((KeyEntry*)pk_it_->GetValue())  // NOLINT
-                      ->entries.NewIterator();
-            ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
+                      ->NewIterator();
         }
         it_->SeekToFirst();
         record_idx_ = 1;
@@ -976,7 +1587,6 @@ void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
         delete it_;
         it_ = NULL;
     }
-    ticket_.Pop();
     if (seg_cnt_ > 1) {
         seg_idx_ = ::openmldb::base::hash(key.c_str(), key.length(), SEED) % seg_cnt_;
     }
@@ -986,12 +1596,10 @@ void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
     if (pk_it_->Valid()) {
         if (segments_[seg_idx_]->GetTsCnt() > 1) {
             KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[ts_idx_];  // NOLINT
-            ticket_.Push(entry);
-            it_ = entry->entries.NewIterator();
+            it_ = entry->NewIterator();
         } else {
-            ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
             it_ = ((KeyEntry*)pk_it_->GetValue())         // NOLINT
-                      ->entries.NewIterator();
+                      ->NewIterator();
         }
         if (spk.compare(pk_it_->GetKey()) != 0 || ts == 0) {
             it_->SeekToFirst();
@@ -1029,9 +1637,7 @@ void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
     }
 }
 
-openmldb::base::Slice MemTableTraverseIterator::GetValue() const {
-    return openmldb::base::Slice(it_->GetValue()->data, it_->GetValue()->size);
-}
+openmldb::base::Slice MemTableTraverseIterator::GetValue() const { return it_->GetValue(); }
 
 uint64_t MemTableTraverseIterator::GetKey() const {
     if (it_ != NULL && it_->Valid()) {
@@ -1048,7 +1654,6 @@ std::string MemTableTraverseIterator::GetPK() const {
 }
 
 void MemTableTraverseIterator::SeekToFirst() {
-    ticket_.Pop();
     if (pk_it_ != NULL) {
         delete pk_it_;
         pk_it_ = NULL;
@@ -1063,12 +1668,10 @@ void MemTableTraverseIterator::SeekToFirst() {
         while (pk_it_->Valid()) {
             if (segments_[seg_idx_]->GetTsCnt() > 1) {
                 KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[ts_idx_];  // NOLINT
-                ticket_.Push(entry);
-                it_ = entry->entries.NewIterator();
+                it_ = entry->NewIterator();
             } else {
-                ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
                 it_ = ((KeyEntry*)pk_it_->GetValue())         // NOLINT
-                          ->entries.NewIterator();
+                          ->NewIterator();
             }
             it_->SeekToFirst();
             traverse_cnt_++;
@@ -1079,7 +1682,6 @@ void MemTableTraverseIterator::SeekToFirst() {
             delete it_;
             it_ = NULL;
             pk_it_->Next();
-            ticket_.Pop();
             if (traverse_cnt_ >= FLAGS_max_traverse_cnt) {
                 return;
             }
@@ -21,10 +21,12 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "proto/tablet.pb.h"
 #include "storage/iterator.h"
+#include "storage/mem_table_image.h"
 #include "storage/segment.h"
 #include "storage/table.h"
 #include "storage/ticket.h"
@@ -38,9 +40,11 @@ namespace storage {
 
 typedef google::protobuf::RepeatedPtrField<::openmldb::api::Dimension> Dimensions;
 
+class DiskTable;
+
 class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
  public:
-    MemTableWindowIterator(TimeEntries::Iterator* it, ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
+    MemTableWindowIterator(KeyEntry::Iterator* it, ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
                            uint64_t expire_cnt)
         : it_(it), record_idx_(1), expire_value_(expire_time, expire_cnt, ttl_type), row_() {}
 
@@ -62,7 +66,8 @@ class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
 
     // TODO(wangtaize) unify the row object
     const ::hybridse::codec::Row& GetValue() override {
-        row_.Reset(reinterpret_cast<const int8_t*>(it_->GetValue()->data), it_->GetValue()->size);
+        ::openmldb::base::Slice value = it_->GetValue();
+        row_.Reset(reinterpret_cast<const int8_t*>(value.data()), value.size());
         return row_;
     }
 
@@ -74,7 +79,82 @@ class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
     bool IsSeekable() const override { return true; }
 
  private:
-    TimeEntries::Iterator* it_;
+    KeyEntry::Iterator* it_;
+    uint32_t record_idx_;
+    TTLSt expire_value_;
+    ::hybridse::codec::Row row_;
+};
+
+// TieredTableIterator merges the rows of a key in memory with the ones spilled to the disk tier in time desc order.
+// The disk iterator is opened only when the memory rows run out or get to the spill time, so the short windows
+// don't touch the disk
+class TieredTableIterator : public TableIterator {
+ public:
+    TieredTableIterator(TableIterator* mem_it, DiskTable* tier, uint32_t index, const std::string& pk,
+                        const std::atomic<uint64_t>* spill_time);
+    ~TieredTableIterator() override;
+    bool Valid() override { return is_disk_ || mem_it_->Valid(); }
+    void Next() override;
+    openmldb::base::Slice GetValue() const override;
+    std::string GetPK() const override { return pk_; }
+    uint64_t GetKey() const override { return key_; }
+    const uint64_t& GetKeyRef() const { return key_; }
+    void SeekToFirst() override;
+    // the disk tier is not seen, it's only used to check the latest ttl which is not spilled
+    void SeekToLast() override;
+    void Seek(uint64_t time) override;
+
+ private:
+    void ResetDisk();
+    void Pick();
+
+ private:
+    TableIterator* mem_it_;
+    TableIterator* disk_it_;
+    DiskTable* tier_;
+    uint32_t index_;
+    std::string pk_;
+    const std::atomic<uint64_t>* spill_time_;
+    // the disk iterator is opened at the rows not newer than it
+    uint64_t cursor_;
+    bool disk_opened_;
+    bool is_disk_;
+    uint64_t key_;
+    Ticket ticket_;
+};
+
+class TieredWindowIterator : public ::hybridse::vm::RowIterator {
+ public:
+    TieredWindowIterator(TieredTableIterator* it, ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
+                         uint64_t expire_cnt)
+        : it_(it), record_idx_(1), expire_value_(expire_time, expire_cnt, ttl_type), row_() {}
+
+    ~TieredWindowIterator() { delete it_; }
+
+    bool Valid() const override { return it_->Valid() && !expire_value_.IsExpired(it_->GetKey(), record_idx_); }
+
+    void Next() override {
+        it_->Next();
+        record_idx_++;
+    }
+
+    const uint64_t& GetKey() const override { return it_->GetKeyRef(); }
+
+    const ::hybridse::codec::Row& GetValue() override {
+        ::openmldb::base::Slice value = it_->GetValue();
+        row_.Reset(reinterpret_cast<const int8_t*>(value.data()), value.size());
+        return row_;
+    }
+
+    void Seek(const uint64_t& key) override { it_->Seek(key); }
+    void SeekToFirst() override {
+        record_idx_ = 1;
+        it_->SeekToFirst();
+    }
+    bool IsSeekable() const override { return true; }
+
+ private:
+    TieredTableIterator* it_;
     uint32_t record_idx_;
     TTLSt expire_value_;
     ::hybridse::codec::Row row_;
@@ -82,8 +162,10 @@ class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
 
 class MemTableKeyIterator : public ::hybridse::vm::WindowIterator {
  public:
+    // the keys whose rows are all spilled are iterated after the ones in memory if tier is set
     MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, ::openmldb::storage::TTLType ttl_type,
-                        uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index);
+                        uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index, DiskTable* tier = NULL,
+                        uint32_t index = 0, const std::atomic<uint64_t>* spill_time = NULL);
 
     ~MemTableKeyIterator() override;
 
@@ -103,18 +185,29 @@ class MemTableKeyIterator : public ::hybridse::vm::WindowIterator {
  private:
     void NextPK();
 
+    void SeekDiskToFirst();
+
+    // skip the keys of the disk tier which are in memory
+    void SkipMemKeys();
+
  private:
     Segment** segments_;
     uint32_t const seg_cnt_;
     uint32_t seg_idx_;
     KeyEntries::Iterator* pk_it_;
-    TimeEntries::Iterator* it_;
+    KeyEntry::Iterator* it_;
     ::openmldb::storage::TTLType ttl_type_;
     uint64_t expire_time_;
     uint64_t expire_cnt_;
     uint32_t ts_index_{};
+    // keeps the keys and rows seen from gc while the iterator is alive
     Ticket ticket_;
     uint32_t ts_idx_;
+    DiskTable* tier_;
+    uint32_t index_;
+    const std::atomic<uint64_t>* spill_time_;
+    ::hybridse::vm::WindowIterator* disk_it_;
+    bool in_disk_;
 };
 
 class MemTableTraverseIterator : public TraverseIterator {
@@ -137,11 +230,12 @@ class MemTableTraverseIterator : public TraverseIterator {
     uint32_t const seg_cnt_;
     uint32_t seg_idx_;
     KeyEntries::Iterator* pk_it_;
-    TimeEntries::Iterator* it_;
+    KeyEntry::Iterator* it_;
     uint32_t record_idx_;
     uint32_t ts_idx_;
     // uint64_t expire_value_;
     TTLSt expire_value_;
+    // keeps the keys and rows seen from gc while the iterator is alive
     Ticket ticket_;
     uint64_t traverse_cnt_;
 };
@@ -158,6 +252,12 @@ class MemTable : public Table {
 
     bool Init() override;
 
+    // the rows older than mem_table_tier_age are spilled to a disk table at path, it should be set before Init
+    void SetTierPath(const std::string& path) { tier_path_ = path; }
+
+    // return NULL if the disk tier is disabled
+    DiskTable* GetTier() const { return tier_.get(); }
+
     bool Put(const std::string& pk, uint64_t time, const char* data, uint32_t size) override;
 
     bool Put(uint64_t time, const std::string& value, const Dimensions& dimensions) override;
@@ -167,6 +267,19 @@ class MemTable : public Table {
     bool BulkLoad(const std::vector<DataBlock*>& data_blocks,
                   const ::google::protobuf::RepeatedPtrField<::openmldb::api::BulkLoadIndex>& indexes);
 
+    // fill the table id, segment count and ts count of every inner index
+    void GetImageHeader(MemTableImageHeader* header);
+
+    // dump the time lists of the ready indexes, the puts along with it may be in the image or not
+    bool DumpImage(MemTableImageWriter* writer);
+
+    // load the image into the empty table, it must not run along with other writers
+    bool LoadImage(MemTableImageReader* reader);
+
+    // put the entry unless the same row is in the list of its first dimension, it's used to replay
+    // the binlog which may be in the memory image already
+    bool PutIfAbsent(const ::openmldb::api::LogEntry& entry);
+
     bool Delete(const std::string& pk, uint32_t idx) override;
 
     // use the first demission
@@ -195,10 +308,20 @@ class MemTable : public Table {
 
     uint64_t GetRecordByteSize() const override { return record_byte_size_.load(std::memory_order_relaxed); }
 
-    uint64_t GetRecordCnt() const override { return record_cnt_.load(std::memory_order_relaxed); }
+    // the rows in the disk tier are included
+    uint64_t GetRecordCnt() const override;
+
+    // the bytes freed per second by the last gc round
+    uint64_t GetGcByteRate() const { return gc_byte_rate_.load(std::memory_order_relaxed); }
+
+    // the time the last gc round took in ms, the expired rows are kept up to gc_interval plus it
+    uint64_t GetGcLag() const { return gc_lag_.load(std::memory_order_relaxed); }
 
     inline uint32_t GetSegCnt() const { return seg_cnt_; }
 
+    // the segment of the key in every index
+    uint32_t GetSegIdx(const Slice& key) const;
+
     inline void SetExpire(bool is_expire) { enable_gc_.store(is_expire, std::memory_order_relaxed); }
 
     uint64_t GetExpireTime(const TTLSt& ttl_st) override;
@@ -222,6 +345,19 @@ class MemTable : public Table {
 
     bool CheckLatest(uint32_t index_id, const std::string& key, uint64_t ts);
 
+    // the rows of the inner index can be spilled if it has only one ts and is gc by absolute time
+    bool IsSpillable(uint32_t inner_pos, const std::shared_ptr<InnerIndexSt>& inner_index) const;
+
+    // put the rows of a key spilled from an inner index to the disk tier
+    SpillStatus SpillToTier(uint32_t index, const Slice& key, const std::vector<std::pair<uint64_t, Slice>>& rows);
+
+    // whether the disk tier has a row of the key with the ts of one of the rows but another value, which the
+    // rows would overwrite. The rows spilled before but not dropped from memory are written again
+    bool HasTierConflict(uint32_t index, const Slice& key, const std::vector<std::pair<uint64_t, Slice>>& rows);
+
+    // the ttl of the disk tier follows the one of memory
+    void SyncTierTTL();
+
  private:
     uint32_t seg_cnt_;
     std::vector<Segment**> segments_;
@@ -231,6 +367,14 @@ class MemTable : public Table {
     bool segment_released_;
     std::atomic<uint64_t> record_byte_size_;
     uint32_t key_entry_max_height_;
+    std::atomic<uint64_t> gc_byte_rate_;
+    std::atomic<uint64_t> gc_lag_;
+    std::string tier_path_;
+    std::unique_ptr<DiskTable> tier_;
+    // the inner indexes when the tier is opened, the ones added later are not spilled
+    uint32_t tier_inner_cnt_;
+    // all rows in the disk tier are not newer than it, the readers open the disk tier only for the older rows
+    std::atomic<uint64_t> spill_time_;
 };
 
 }  // namespace storage
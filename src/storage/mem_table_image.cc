@@ -0,0 +1,242 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/mem_table_image.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <string_view>
+
+#include "base/glog_wapper.h"
+
+namespace openmldb {
+namespace storage {
+
+static const char IMAGE_MAGIC[8] = {'O', 'M', 'I', 'M', 'A', 'G', 'E', '1'};
+static const char KEY_TAG = 'K';
+static const char END_TAG = 'E';
+// the end offset is after magic, tid, pid and offset
+static const long END_OFFSET_POS = 24;  // NOLINT
+static const long FOOTER_SIZE = 1 + 8 + 8 + sizeof(IMAGE_MAGIC);  // NOLINT
+static const size_t IO_BUFFER_SIZE = 4 * 1024 * 1024;
+// about 64MB of the shared rows in tracking
+static const size_t MAX_SHARED_ROWS = 1024 * 1024;
+
+MemTableImageWriter::MemTableImageWriter(const std::string& path)
+    : path_(path), fd_(NULL), share_rows_(false), shared_rows_(), row_cnt_(0), entry_cnt_(0) {}
+
+MemTableImageWriter::~MemTableImageWriter() {
+    if (fd_ != NULL) {
+        fclose(fd_);
+    }
+}
+
+bool MemTableImageWriter::Write(const void* data, size_t size) {
+    if (fwrite(data, 1, size, fd_) != size) {
+        PDLOG(WARNING, "fail to write image %s. error %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool MemTableImageWriter::Open(const MemTableImageHeader& header, bool share_rows) {
+    fd_ = fopen(path_.c_str(), "wb");
+    if (fd_ == NULL) {
+        PDLOG(WARNING, "fail to create image %s. error %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    setvbuf(fd_, NULL, _IOFBF, IO_BUFFER_SIZE);
+    share_rows_ = share_rows;
+    uint32_t inner_cnt = header.ts_cnts.size();
+    return Write(IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) && Write(&header.tid, 4) && Write(&header.pid, 4) &&
+           Write(&header.offset, 8) && Write(&header.end_offset, 8) && Write(&header.seg_cnt, 4) &&
+           Write(&inner_cnt, 4) && Write(header.ts_cnts.data(), 4 * inner_cnt);
+}
+
+bool MemTableImageWriter::AddKey(uint32_t inner_pos, uint32_t seg_idx, uint32_t key_entry_id,
+                                 const ::openmldb::base::Slice& key,
+                                 const std::vector<MemTableImageRow>& rows) {
+    uint32_t key_size = key.size();
+    uint64_t cnt = rows.size();
+    if (!Write(&KEY_TAG, 1) || !Write(&inner_pos, 4) || !Write(&seg_idx, 4) || !Write(&key_entry_id, 4) ||
+        !Write(&key_size, 4) || !Write(key.data(), key_size) || !Write(&cnt, 8)) {
+        return false;
+    }
+    for (const auto& row : rows) {
+        uint64_t row_id = row_cnt_;
+        if (share_rows_ && row.ref_cnt > 1) {
+            size_t hash = std::hash<std::string_view>()(std::string_view(row.data.data(), row.data.size()));
+            auto it = shared_rows_.find(row.data.data());
+            if (it != shared_rows_.end() && it->second.hash == hash) {
+                row_id = it->second.id;
+                if (--it->second.left == 0) {
+                    shared_rows_.erase(it);
+                }
+            } else if (it != shared_rows_.end()) {
+                it->second = SharedRow{row_cnt_, hash, row.ref_cnt - 1};
+            } else if (shared_rows_.size() < MAX_SHARED_ROWS) {
+                shared_rows_.emplace(row.data.data(), SharedRow{row_cnt_, hash, row.ref_cnt - 1});
+            }
+        }
+        if (!Write(&row.time, 8) || !Write(&row_id, 8)) {
+            return false;
+        }
+        if (row_id == row_cnt_) {
+            uint32_t size = row.data.size();
+            if (!Write(&size, 4) || !Write(row.data.data(), size)) {
+                return false;
+            }
+            row_cnt_++;
+        }
+        entry_cnt_++;
+    }
+    return true;
+}
+
+bool MemTableImageWriter::Finish(uint64_t end_offset) {
+    if (!Write(&END_TAG, 1) || !Write(&row_cnt_, 8) || !Write(&entry_cnt_, 8) ||
+        !Write(IMAGE_MAGIC, sizeof(IMAGE_MAGIC))) {
+        return false;
+    }
+    if (fseek(fd_, END_OFFSET_POS, SEEK_SET) != 0 || !Write(&end_offset, 8)) {
+        return false;
+    }
+    if (fflush(fd_) != 0 || fsync(fileno(fd_)) != 0) {
+        PDLOG(WARNING, "fail to sync image %s. error %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    fclose(fd_);
+    fd_ = NULL;
+    shared_rows_.clear();
+    return true;
+}
+
+MemTableImageReader::MemTableImageReader(const std::string& path)
+    : path_(path),
+      fd_(NULL),
+      row_cnt_(0),
+      entry_cnt_(0),
+      expect_row_cnt_(0),
+      expect_entry_cnt_(0),
+      key_rows_(0),
+      buffer_() {}
+
+MemTableImageReader::~MemTableImageReader() {
+    if (fd_ != NULL) {
+        fclose(fd_);
+    }
+}
+
+bool MemTableImageReader::Read(void* data, size_t size) {
+    if (fread(data, 1, size, fd_) != size) {
+        PDLOG(WARNING, "fail to read image %s", path_.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MemTableImageReader::Open(MemTableImageHeader* header) {
+    fd_ = fopen(path_.c_str(), "rb");
+    if (fd_ == NULL) {
+        PDLOG(WARNING, "fail to open image %s. error %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    setvbuf(fd_, NULL, _IOFBF, IO_BUFFER_SIZE);
+    char magic[sizeof(IMAGE_MAGIC)];
+    uint32_t inner_cnt = 0;
+    if (!Read(magic, sizeof(magic)) || memcmp(magic, IMAGE_MAGIC, sizeof(magic)) != 0 || !Read(&header->tid, 4) ||
+        !Read(&header->pid, 4) || !Read(&header->offset, 8) || !Read(&header->end_offset, 8) ||
+        !Read(&header->seg_cnt, 4) || !Read(&inner_cnt, 4)) {
+        PDLOG(WARNING, "invalid image header %s", path_.c_str());
+        return false;
+    }
+    header->ts_cnts.resize(inner_cnt);
+    if (!Read(header->ts_cnts.data(), 4 * inner_cnt)) {
+        return false;
+    }
+    long data_pos = ftell(fd_);  // NOLINT
+    char tag = 0;
+    if (fseek(fd_, -FOOTER_SIZE, SEEK_END) != 0 || !Read(&tag, 1) || tag != END_TAG ||
+        !Read(&expect_row_cnt_, 8) || !Read(&expect_entry_cnt_, 8) || !Read(magic, sizeof(magic)) ||
+        memcmp(magic, IMAGE_MAGIC, sizeof(magic)) != 0) {
+        PDLOG(WARNING, "image %s is not complete", path_.c_str());
+        return false;
+    }
+    return fseek(fd_, data_pos, SEEK_SET) == 0;
+}
+
+int MemTableImageReader::NextKey(uint32_t* inner_pos, uint32_t* seg_idx, uint32_t* key_entry_id,
+                                 std::string* key) {
+    if (key_rows_ > 0) {
+        PDLOG(WARNING, "the rows of last key are not read. image %s", path_.c_str());
+        return -1;
+    }
+    char tag = 0;
+    if (!Read(&tag, 1)) {
+        return -1;
+    }
+    if (tag == END_TAG) {
+        if (row_cnt_ != expect_row_cnt_ || entry_cnt_ != expect_entry_cnt_) {
+            PDLOG(WARNING, "image %s expect %lu rows %lu entries, but read %lu rows %lu entries", path_.c_str(),
+                  expect_row_cnt_, expect_entry_cnt_, row_cnt_, entry_cnt_);
+            return -1;
+        }
+        return 0;
+    }
+    uint32_t key_size = 0;
+    if (tag != KEY_TAG || !Read(inner_pos, 4) || !Read(seg_idx, 4) || !Read(key_entry_id, 4) ||
+        !Read(&key_size, 4)) {
+        return -1;
+    }
+    key->resize(key_size);
+    if (!Read(&(*key)[0], key_size) || !Read(&key_rows_, 8)) {
+        return -1;
+    }
+    return 1;
+}
+
+int MemTableImageReader::NextRow(uint64_t* time, uint64_t* row_id, bool* is_new, ::openmldb::base::Slice* data) {
+    if (key_rows_ == 0) {
+        return 0;
+    }
+    if (!Read(time, 8) || !Read(row_id, 8)) {
+        return -1;
+    }
+    *is_new = false;
+    if (*row_id == row_cnt_) {
+        uint32_t size = 0;
+        if (!Read(&size, 4)) {
+            return -1;
+        }
+        buffer_.resize(size);
+        if (!Read(&buffer_[0], size)) {
+            return -1;
+        }
+        data->reset(buffer_.data(), size);
+        *is_new = true;
+        row_cnt_++;
+    } else if (*row_id > row_cnt_) {
+        PDLOG(WARNING, "invalid row id %lu in image %s", *row_id, path_.c_str());
+        return -1;
+    }
+    key_rows_--;
+    entry_cnt_++;
+    return 1;
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_MEM_TABLE_IMAGE_H_
+#define SRC_STORAGE_MEM_TABLE_IMAGE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/slice.h"
+
+namespace openmldb {
+namespace storage {
+
+// The memory image of a table is the time lists of all segments in index order, so the table can be
+// rebuilt by appending to the lists without parsing and decoding every row. The file layout:
+//   header: magic, tid, pid, offset, end offset, segment count, the ts count of every inner index
+//   key record: inner index pos, segment idx, key entry id, key, row count, then the time and the row id
+//     of every row in time desc order. A row shared by several lists is written once if it's still tracked
+//     when the other lists are dumped, the row id seen for the first time is followed by the row data
+//   footer: row count, time entry count, magic
+// The rows of binlog offset <= offset are in the image, the ones after it may be in it and the ones after the
+// end offset are not in it. The end offset is the binlog offset when the dump and the puts along with it are done.
+struct MemTableImageHeader {
+    uint32_t tid = 0;
+    uint32_t pid = 0;
+    uint64_t offset = 0;
+    uint64_t end_offset = 0;
+    uint32_t seg_cnt = 0;
+    std::vector<uint32_t> ts_cnts;
+};
+
+// a row of a time list, ref_cnt is the count of lists which have the row
+struct MemTableImageRow {
+    uint64_t time;
+    ::openmldb::base::Slice data;
+    uint32_t ref_cnt;
+};
+
+class MemTableImageWriter {
+ public:
+    explicit MemTableImageWriter(const std::string& path);
+    ~MemTableImageWriter();
+
+    MemTableImageWriter(const MemTableImageWriter&) = delete;
+    MemTableImageWriter& operator=(const MemTableImageWriter&) = delete;
+
+    // share_rows should be set if a row can be in more than one list
+    bool Open(const MemTableImageHeader& header, bool share_rows);
+
+    bool AddKey(uint32_t inner_pos, uint32_t seg_idx, uint32_t key_entry_id, const ::openmldb::base::Slice& key,
+                const std::vector<MemTableImageRow>& rows);
+
+    // write the footer and the end offset, the file is synced and closed
+    bool Finish(uint64_t end_offset);
+
+    uint64_t GetRowCnt() const { return row_cnt_; }
+
+ private:
+    bool Write(const void* data, size_t size);
+
+ private:
+    std::string path_;
+    FILE* fd_;
+    bool share_rows_;
+    struct SharedRow {
+        uint64_t id;
+        // the hash tells a new row which reuses the address of a freed one
+        size_t hash;
+        // the count of lists which have not written the row
+        uint32_t left;
+    };
+    // the data address of the shared rows written, a row is dropped once all its lists are written. at most
+    // MAX_SHARED_ROWS rows are tracked, the others are written again by the other lists
+    std::unordered_map<const char*, SharedRow> shared_rows_;
+    uint64_t row_cnt_;
+    uint64_t entry_cnt_;
+};
+
+class MemTableImageReader {
+ public:
+    explicit MemTableImageReader(const std::string& path);
+    ~MemTableImageReader();
+
+    MemTableImageReader(const MemTableImageReader&) = delete;
+    MemTableImageReader& operator=(const MemTableImageReader&) = delete;
+
+    // read the header and check the footer, return false if the image is not complete
+    bool Open(MemTableImageHeader* header);
+
+    // read the next key record, return 1 if a key is read, 0 at the end and -1 on error
+    int NextKey(uint32_t* inner_pos, uint32_t* seg_idx, uint32_t* key_entry_id, std::string* key);
+
+    // read the next row of the current key, return 1 if a row is read, 0 at the end of the key and -1 on error.
+    // is_new is set if the row id is seen for the first time, and data is only valid before the next call
+    int NextRow(uint64_t* time, uint64_t* row_id, bool* is_new, ::openmldb::base::Slice* data);
+
+ private:
+    bool Read(void* data, size_t size);
+
+ private:
+    std::string path_;
+    FILE* fd_;
+    uint64_t row_cnt_;
+    uint64_t entry_cnt_;
+    uint64_t expect_row_cnt_;
+    uint64_t expect_entry_cnt_;
+    // the rows left of the current key
+    uint64_t key_rows_;
+    std::string buffer_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_MEM_TABLE_IMAGE_H_
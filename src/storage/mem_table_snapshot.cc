@@ -21,9 +21,12 @@
 #undef DISALLOW_COPY_AND_ASSIGN
 #endif
 #include <snappy.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <set>
+#include <thread>  // NOLINT
 #include <utility>
 
 #include "base/file_util.h"
@@ -31,8 +34,6 @@
 #include "base/hash.h"
 #include "base/slice.h"
 #include "base/strings.h"
-#include "base/taskpool.hpp"
-#include "boost/bind.hpp"
 #include "codec/row_codec.h"
 #include "common/thread_pool.h"
 #include "common/timer.h"
@@ -40,6 +41,9 @@
 #include "log/log_reader.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "storage/mem_table.h"
+#include "storage/mem_table_image.h"
+#include "storage/table_loader.h"
 
 using google::protobuf::RepeatedPtrField;
 using ::openmldb::codec::SchemaCodec;
@@ -50,6 +54,7 @@ DECLARE_uint32(make_snapshot_max_deleted_keys);
 DECLARE_uint32(load_table_batch);
 DECLARE_uint32(load_table_thread_num);
 DECLARE_uint32(load_table_queue_size);
+DECLARE_uint32(load_table_read_thread_num);
 DECLARE_string(snapshot_compression);
 
 namespace openmldb {
@@ -58,6 +63,7 @@ namespace storage {
 const std::string SNAPSHOT_SUBFIX = ".sdb";  // NOLINT
 const uint32_t KEY_NUM_DISPLAY = 1000000;    // NOLINT
 const std::string MANIFEST = "MANIFEST";     // NOLINT
+const std::string IMAGE = "table.img";       // NOLINT
 
 MemTableSnapshot::MemTableSnapshot(uint32_t tid, uint32_t pid, LogParts* log_part, const std::string& db_root_path)
     : Snapshot(tid, pid), log_part_(log_part), db_root_path_(db_root_path) {}
@@ -84,13 +90,103 @@ bool MemTableSnapshot::Recover(std::shared_ptr<Table> table, uint64_t& latest_of
         return false;
     }
     if (ret == 0) {
-        RecoverFromSnapshot(manifest.name(), manifest.count(), table);
-        latest_offset = manifest.offset();
-        offset_ = latest_offset;
+        int image_ret = RecoverFromImage(table, manifest.offset(), &latest_offset);
+        if (image_ret < 0) {
+            return false;
+        } else if (image_ret == 0) {
+            RecoverFromSnapshot(manifest.name(), manifest.count(), table);
+            latest_offset = manifest.offset();
+        }
+        offset_ = manifest.offset();
     }
     return true;
 }
 
+int MemTableSnapshot::RecoverFromImage(std::shared_ptr<Table> table, uint64_t offset, uint64_t* latest_offset) {
+    std::string full_path = snapshot_path_ + IMAGE;
+    auto mem_table = std::dynamic_pointer_cast<MemTable>(table);
+    if (!mem_table || !::openmldb::base::IsExists(full_path)) {
+        return 0;
+    }
+    MemTableImageReader reader(full_path);
+    MemTableImageHeader header;
+    if (!reader.Open(&header)) {
+        return 0;
+    }
+    MemTableImageHeader expect;
+    mem_table->GetImageHeader(&expect);
+    // the image made before the last snapshot or the index change is skipped
+    if (header.tid != expect.tid || header.pid != expect.pid || header.offset != offset ||
+        header.end_offset < offset || header.seg_cnt != expect.seg_cnt || header.ts_cnts != expect.ts_cnts) {
+        PDLOG(WARNING, "image %s does not match the table, recover from snapshot. tid %u pid %u", full_path.c_str(),
+              tid_, pid_);
+        return 0;
+    }
+    uint64_t start_time = ::baidu::common::timer::now_time();
+    if (!mem_table->LoadImage(&reader)) {
+        PDLOG(WARNING, "fail to load image %s. tid %u pid %u", full_path.c_str(), tid_, pid_);
+        return -1;
+    }
+    ReplayImageBinlog(table, header.offset, header.end_offset, latest_offset);
+    PDLOG(INFO, "recover from image %s. offset %lu end offset %lu, use %lu second. tid %u pid %u",
+          full_path.c_str(), header.offset, header.end_offset, ::baidu::common::timer::now_time() - start_time, tid_,
+          pid_);
+    return 1;
+}
+
+void MemTableSnapshot::ReplayImageBinlog(std::shared_ptr<Table> table, uint64_t offset, uint64_t end_offset,
+                                         uint64_t* latest_offset) {
+    auto mem_table = std::dynamic_pointer_cast<MemTable>(table);
+    ::openmldb::log::LogReader log_reader(log_part_, log_path_, false);
+    log_reader.SetOffset(offset);
+    uint64_t cur_offset = offset;
+    std::string buffer;
+    int last_log_index = log_reader.GetLogIndex();
+    while (true) {
+        buffer.clear();
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = log_reader.ReadNextRecord(&record, &buffer);
+        if (status.ok()) {
+            ::openmldb::api::LogEntry entry;
+            if (!entry.ParseFromString(record.ToString())) {
+                PDLOG(WARNING, "fail to parse LogEntry. tid %u pid %u", tid_, pid_);
+                continue;
+            }
+            if (entry.log_index() <= cur_offset) {
+                continue;
+            }
+            if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+                if (entry.dimensions_size() > 0) {
+                    table->Delete(entry.dimensions(0).key(), entry.dimensions(0).idx());
+                }
+            } else if (entry.log_index() <= end_offset) {
+                // the rows put along with the dump may be in the image
+                mem_table->PutIfAbsent(entry);
+            } else {
+                table->Put(entry);
+            }
+            cur_offset = entry.log_index();
+        } else if (status.IsEof()) {
+            if (log_reader.GetLogIndex() != last_log_index) {
+                last_log_index = log_reader.GetLogIndex();
+                continue;
+            }
+            break;
+        } else if (status.IsWaitRecord()) {
+            int end_log_index = log_reader.GetEndLogIndex();
+            int cur_log_index = log_reader.GetLogIndex();
+            if (end_log_index >= 0 && end_log_index > cur_log_index) {
+                log_reader.RollRLogFile();
+                continue;
+            }
+            break;
+        } else {
+            PDLOG(WARNING, "fail to get record. status is %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
+        }
+    }
+    *latest_offset = cur_offset;
+}
+
 void MemTableSnapshot::RecoverFromSnapshot(const std::string& snapshot_name, uint64_t expect_cnt,
                                            std::shared_ptr<Table> table) {
     std::string full_path = snapshot_path_ + "/" + snapshot_name;
@@ -107,91 +203,98 @@ void MemTableSnapshot::RecoverFromSnapshot(const std::string& snapshot_name, uin
 
 void MemTableSnapshot::RecoverSingleSnapshot(const std::string& path, std::shared_ptr<Table> table,
                                              std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt) {
-    ::openmldb::base::TaskPool load_pool_(FLAGS_load_table_thread_num, FLAGS_load_table_batch);
-    std::atomic<uint64_t> succ_cnt, failed_cnt;
-    succ_cnt = failed_cnt = 0;
-
-    do {
-        if (table == NULL) {
-            PDLOG(WARNING, "table input is NULL");
-            break;
-        }
-        FILE* fd = fopen(path.c_str(), "rb");
-        if (fd == NULL) {
-            PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
-            break;
-        }
-        bool compressed = IsCompressed(path);
-        ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(path, fd);
-        ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
-        std::string buffer;
-        // second
-        uint64_t consumed = ::baidu::common::timer::now_time();
-        std::vector<std::string*> recordPtr;
-        recordPtr.reserve(FLAGS_load_table_batch);
-
-        while (true) {
-            buffer.clear();
-            ::openmldb::base::Slice record;
-            ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
-            if (status.IsWaitRecord() || status.IsEof()) {
-                consumed = ::baidu::common::timer::now_time() - consumed;
-                PDLOG(INFO,
-                      "read path %s for table tid %u pid %u completed, "
-                      "succ_cnt %lu, failed_cnt %lu, consumed %us",
-                      path.c_str(), tid_, pid_, succ_cnt.load(std::memory_order_relaxed),
-                      failed_cnt.load(std::memory_order_relaxed), consumed);
+    if (table == NULL) {
+        PDLOG(WARNING, "table input is NULL");
+        return;
+    }
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) != 0) {
+        PDLOG(WARNING, "fail to stat path %s for error %s", path.c_str(), strerror(errno));
+        return;
+    }
+    uint64_t file_size = file_stat.st_size;
+    bool compressed = IsCompressed(path);
+    // the compressed blocks are not aligned, so a compressed file is read by one thread
+    uint32_t read_thread_num = compressed ? 1 : std::max(FLAGS_load_table_read_thread_num, 1u);
+    uint64_t range_size = (file_size / read_thread_num + ::openmldb::log::kBlockSize - 1) /
+                          ::openmldb::log::kBlockSize * ::openmldb::log::kBlockSize;
+    if (range_size == 0) {
+        range_size = ::openmldb::log::kBlockSize;
+    }
+    std::atomic<uint64_t> succ_cnt(0);
+    std::atomic<uint64_t> failed_cnt(0);
+    uint64_t consumed = ::baidu::common::timer::now_time();
+    {
+        TableLoader loader(table, FLAGS_load_table_thread_num, FLAGS_load_table_batch, FLAGS_load_table_queue_size);
+        std::vector<std::thread> readers;
+        for (uint64_t start = 0; start == 0 || start < file_size; start += range_size) {
+            uint64_t end = start + range_size >= file_size ? UINT64_MAX : start + range_size;
+            readers.emplace_back(&MemTableSnapshot::RecoverSnapshotRange, this, path, compressed, start, end, &loader,
+                                 &succ_cnt, &failed_cnt);
+            if (end == UINT64_MAX) {
                 break;
             }
-
-            if (!status.ok()) {
-                PDLOG(WARNING, "fail to read record for tid %u, pid %u with error %s", tid_, pid_,
-                      status.ToString().c_str());
-                failed_cnt.fetch_add(1, std::memory_order_relaxed);
-                continue;
-            }
-            std::string* sp = new std::string(record.data(), record.size());
-            recordPtr.push_back(sp);
-            if (recordPtr.size() >= FLAGS_load_table_batch) {
-                load_pool_.AddTask(
-                    boost::bind(&MemTableSnapshot::Put, this, path, table, recordPtr, &succ_cnt, &failed_cnt));
-                recordPtr.clear();
-            }
-        }
-        if (recordPtr.size() > 0) {
-            load_pool_.AddTask(
-                boost::bind(&MemTableSnapshot::Put, this, path, table, recordPtr, &succ_cnt, &failed_cnt));
         }
-        // will close the fd atomic
-        delete seq_file;
-        if (g_succ_cnt) {
-            g_succ_cnt->fetch_add(succ_cnt, std::memory_order_relaxed);
+        for (auto& reader : readers) {
+            reader.join();
         }
-        if (g_failed_cnt) {
-            g_failed_cnt->fetch_add(failed_cnt, std::memory_order_relaxed);
-        }
-    } while (false);
-    load_pool_.Stop();
+        loader.Wait();
+    }
+    consumed = ::baidu::common::timer::now_time() - consumed;
+    PDLOG(INFO, "read path %s for table tid %u pid %u completed, succ_cnt %lu, failed_cnt %lu, consumed %us",
+          path.c_str(), tid_, pid_, succ_cnt.load(std::memory_order_relaxed),
+          failed_cnt.load(std::memory_order_relaxed), consumed);
+    if (g_succ_cnt) {
+        g_succ_cnt->fetch_add(succ_cnt, std::memory_order_relaxed);
+    }
+    if (g_failed_cnt) {
+        g_failed_cnt->fetch_add(failed_cnt, std::memory_order_relaxed);
+    }
 }
 
-void MemTableSnapshot::Put(std::string& path, std::shared_ptr<Table>& table, std::vector<std::string*> recordPtr,
-                           std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt) {
+void MemTableSnapshot::RecoverSnapshotRange(const std::string& path, bool compressed, uint64_t start, uint64_t end,
+                                            TableLoader* loader, std::atomic<uint64_t>* succ_cnt,
+                                            std::atomic<uint64_t>* failed_cnt) {
+    FILE* fd = fopen(path.c_str(), "rb");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
+        return;
+    }
+    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(path, fd);
+    // the reader skips the record which starts before the range
+    ::openmldb::log::Reader reader(seq_file, NULL, false, start, compressed);
+    TableLoader::Writer writer(loader);
+    std::string buffer;
     ::openmldb::api::LogEntry entry;
-    for (auto it = recordPtr.cbegin(); it != recordPtr.cend(); it++) {
-        bool ok = entry.ParseFromString(**it);
-        if (!ok) {
+    while (true) {
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+        if (status.IsWaitRecord() || status.IsEof()) {
+            break;
+        }
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to read record for tid %u, pid %u with error %s", tid_, pid_,
+                  status.ToString().c_str());
+            failed_cnt->fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (reader.LastRecordOffset() >= end) {
+            break;
+        }
+        if (!entry.ParseFromArray(record.data(), record.size())) {
             failed_cnt->fetch_add(1, std::memory_order_relaxed);
-            delete *it;
             continue;
         }
+        writer.Put(&entry);
         auto scount = succ_cnt->fetch_add(1, std::memory_order_relaxed);
         if (scount % 100000 == 0) {
             PDLOG(INFO, "load snapshot %s with succ_cnt %lu, failed_cnt %lu", path.c_str(), scount,
                   failed_cnt->load(std::memory_order_relaxed));
         }
-        table->Put(entry);
-        delete *it;
     }
+    writer.Flush();
+    // will close the fd atomic
+    delete seq_file;
 }
 
 int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
@@ -512,6 +615,52 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
     return ret;
 }
 
+int MemTableSnapshot::MakeImage(std::shared_ptr<Table> table, const std::function<uint64_t()>& get_offset) {
+    auto mem_table = std::dynamic_pointer_cast<MemTable>(table);
+    if (!mem_table) {
+        return -1;
+    }
+    if (making_snapshot_.exchange(true, std::memory_order_acq_rel)) {
+        PDLOG(INFO, "snapshot is doing now!");
+        return 0;
+    }
+    std::string full_path = snapshot_path_ + IMAGE;
+    std::string tmp_file_path = full_path + ".tmp";
+    uint64_t start_time = ::baidu::common::timer::now_time();
+    MemTableImageHeader header;
+    mem_table->GetImageHeader(&header);
+    // the rows of binlog offset <= offset_ are in the table, the ones after it are replayed on recovery
+    header.offset = offset_;
+    bool share_rows = header.ts_cnts.size() > 1 || (!header.ts_cnts.empty() && header.ts_cnts[0] > 1);
+    int ret = 0;
+    {
+        MemTableImageWriter writer(tmp_file_path);
+        bool ok = writer.Open(header, share_rows) && mem_table->DumpImage(&writer);
+        if (ok) {
+            // the leader puts a row before appending it to the binlog, so the end offset is got after the puts
+            // along with the dump are appended
+            mem_table->WaitWrites();
+            ok = writer.Finish(get_offset());
+        }
+        if (!ok) {
+            ret = -1;
+        } else {
+            PDLOG(INFO, "make image %s success. offset %lu, write %lu rows, use %lu second. tid %u pid %u",
+                  full_path.c_str(), header.offset, writer.GetRowCnt(),
+                  ::baidu::common::timer::now_time() - start_time, tid_, pid_);
+        }
+    }
+    if (ret == 0 && rename(tmp_file_path.c_str(), full_path.c_str()) != 0) {
+        PDLOG(WARNING, "rename %s failed. tid %u pid %u", tmp_file_path.c_str(), tid_, pid_);
+        ret = -1;
+    }
+    if (ret != 0) {
+        unlink(tmp_file_path.c_str());
+    }
+    making_snapshot_.store(false, std::memory_order_release);
+    return ret;
+}
+
 int MemTableSnapshot::RemoveDeletedKey(const ::openmldb::api::LogEntry& entry, const std::set<uint32_t>& deleted_index,
                                        std::string* buffer) {
     uint64_t cur_offset = entry.log_index();
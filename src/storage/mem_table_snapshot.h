@@ -17,6 +17,7 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
@@ -37,6 +38,8 @@ namespace storage {
 
 using ::openmldb::log::WriteHandle;
 
+class TableLoader;
+
 typedef ::openmldb::base::Skiplist<uint32_t, uint64_t, ::openmldb::base::DefaultComparator> LogParts;
 
 // table snapshot
@@ -57,13 +60,14 @@ class MemTableSnapshot : public Snapshot {
                      uint64_t end_offset,
                      uint64_t term = 0) override;
 
+    // dump the table into a memory image after the snapshot is made, the table can be recovered from it
+    // without decoding the rows. get_offset returns the current binlog offset
+    int MakeImage(std::shared_ptr<Table> table, const std::function<uint64_t()>& get_offset);
+
     int TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest, WriteHandle* wh,
                     uint64_t& count, uint64_t& expired_key_num,  // NOLINT
                     uint64_t& deleted_key_num);                  // NOLINT
 
-    void Put(std::string& path, std::shared_ptr<Table>& table,  // NOLINT
-             std::vector<std::string*> recordPtr, std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt);
-
     std::string GenSnapshotName();
 
     base::Status GetAllDecoder(std::shared_ptr<Table> table, std::map<uint8_t, codec::RowView>* decoder_map);
@@ -116,12 +120,24 @@ class MemTableSnapshot : public Snapshot {
                          std::string* buffer);
 
  private:
-    // load single snapshot to table
+    // load single snapshot to table, the file is split into ranges on block boundaries and read in parallel
     void RecoverSingleSnapshot(const std::string& path, std::shared_ptr<Table> table, std::atomic<uint64_t>* g_succ_cnt,
                                std::atomic<uint64_t>* g_failed_cnt);
 
+    // read the records which start in [start, end) and hand them to the loader
+    void RecoverSnapshotRange(const std::string& path, bool compressed, uint64_t start, uint64_t end,
+                              TableLoader* loader, std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt);
+
     uint64_t CollectDeletedKey(uint64_t end_offset);
 
+    // return 1 if the table is recovered from the image, 0 if the image is not usable and -1 on error
+    int RecoverFromImage(std::shared_ptr<Table> table, uint64_t offset, uint64_t* latest_offset);
+
+    // replay the binlog after offset on the table loaded from the image. the rows up to end_offset may be in the
+    // image, so they are only put if absent
+    void ReplayImageBinlog(std::shared_ptr<Table> table, uint64_t offset, uint64_t end_offset,
+                           uint64_t* latest_offset);
+
     int DecodeData(std::shared_ptr<Table> table, const openmldb::api::LogEntry& entry, uint32_t maxIdx,
                    std::vector<std::string>& row);  // NOLINT
 
@@ -18,6 +18,9 @@
 
 #include <gflags/gflags.h>
 
+#include <algorithm>
+#include <string>
+
 #include "base/glog_wapper.h"
 #include "base/strings.h"
 #include "common/timer.h"
@@ -25,12 +28,27 @@
 
 DECLARE_int32(gc_safe_offset);
 DECLARE_uint32(skiplist_max_height);
-DECLARE_uint32(gc_deleted_pk_version_delta);
+DECLARE_bool(enable_slab_allocator);
+DECLARE_uint32(slab_chunk_size);
+DECLARE_bool(enable_gc_expire_index);
+DECLARE_uint32(gc_cpu_percent);
 
 namespace openmldb {
 namespace storage {
 
 static const SliceComparator scmp;
+
+static inline SlabAllocator* NewSlab() {
+    return FLAGS_enable_slab_allocator ? new SlabAllocator(FLAGS_slab_chunk_size) : nullptr;
+}
+
+static inline KeyExpireWheel* NewExpireWheel(uint32_t ts_cnt) {
+    return FLAGS_enable_gc_expire_index && ts_cnt <= 1 ? new KeyExpireWheel() : NULL;
+}
+
+// set in KeyEntry::wheel_ref_ once the segment frees the key
+static const uint32_t WHEEL_REF_FREED = 0x80000000;
+
 Segment::Segment()
     : entries_(NULL),
       mu_(),
@@ -39,7 +57,11 @@ Segment::Segment()
       pk_cnt_(0),
       ts_cnt_(1),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      slab_(NewSlab()),
+      wheel_(NewExpireWheel(1)),
+      wheel_active_(false),
+      gc_throttle_(FLAGS_gc_cpu_percent) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     key_entry_max_height_ = (uint8_t)FLAGS_skiplist_max_height;
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
@@ -54,7 +76,11 @@ Segment::Segment(uint8_t height)
       key_entry_max_height_(height),
       ts_cnt_(1),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      slab_(NewSlab()),
+      wheel_(NewExpireWheel(1)),
+      wheel_active_(false),
+      gc_throttle_(FLAGS_gc_cpu_percent) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
 }
@@ -68,7 +94,11 @@ Segment::Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec)
       key_entry_max_height_(height),
       ts_cnt_(ts_idx_vec.size()),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      slab_(NewSlab()),
+      wheel_(NewExpireWheel(ts_idx_vec.size())),
+      wheel_active_(false),
+      gc_throttle_(FLAGS_gc_cpu_percent) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
     for (uint32_t i = 0; i < ts_idx_vec.size(); i++) {
@@ -78,12 +108,19 @@ Segment::Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec)
 }
 
 Segment::~Segment() {
+    // the table is dropped, no reader can see the memory retired
+    EpochManager::Default()->Flush(this);
+    ClearExpireWheel();
     delete entries_;
     delete entry_free_list_;
+    delete slab_;
+    delete wheel_;
 }
 
 uint64_t Segment::Release() {
     uint64_t cnt = 0;
+    // the keys are deleted below, so the wheel must not hold them
+    ClearExpireWheel();
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
@@ -92,39 +129,39 @@ uint64_t Segment::Release() {
             if (ts_cnt_ > 1) {
                 KeyEntry** entry_arr = (KeyEntry**)it->GetValue();  // NOLINT
                 for (uint32_t i = 0; i < ts_cnt_; i++) {
-                    cnt += entry_arr[i]->Release();
+                    cnt += entry_arr[i]->Release(slab_);
                     delete entry_arr[i];
                 }
                 delete[] entry_arr;
             } else {
                 KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
-                cnt += entry->Release();
+                cnt += entry->Release(slab_);
                 delete entry;
             }
         }
         it->Next();
     }
-    entries_->Clear();
+    entries_->Clear(slab_);
     delete it;
 
     KeyEntryNodeList::Iterator* f_it = entry_free_list_->NewIterator();
     f_it->SeekToFirst();
     while (f_it->Valid()) {
-        ::openmldb::base::Node<Slice, void*>* node = f_it->GetValue();
+        KeyEntryNode* node = f_it->GetValue();
         delete[] node->GetKey().data();
         if (ts_cnt_ > 1) {
             KeyEntry** entry_arr = (KeyEntry**)node->GetValue();  // NOLINT
             for (uint32_t i = 0; i < ts_cnt_; i++) {
-                entry_arr[i]->Release();
+                entry_arr[i]->Release(slab_);
                 delete entry_arr[i];
             }
             delete[] entry_arr;
         } else {
             KeyEntry* entry = (KeyEntry*)node->GetValue();  // NOLINT
-            entry->Release();
+            entry->Release(slab_);
             delete entry;
         }
-        delete node;
+        KeyEntries::FreeNode(node, slab_);
         f_it->Next();
     }
     delete f_it;
@@ -138,9 +175,9 @@ void Segment::ReleaseAndCount(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uin
     it->SeekToFirst();
     while (it->Valid()) {
         Slice key = it->GetKey();
-        ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
+        KeyEntryNode* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             entry_node = entries_->Remove(key);
         }
         if (entry_node != NULL) {
@@ -152,6 +189,7 @@ void Segment::ReleaseAndCount(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uin
     delete it;
     uint64_t cur_version = gc_version_.load(std::memory_order_relaxed);
     GcEntryFreeList(cur_version, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    RetireFreed();
     Release();
 }
 
@@ -159,7 +197,7 @@ void Segment::Put(const Slice& key, uint64_t time, const char* data, uint32_t si
     if (ts_cnt_ > 1) {
         return;
     }
-    auto* db = new DataBlock(1, data, size);
+    auto* db = NewDataBlock(slab_, 1, data, size);
     Put(key, time, db);
 }
 
@@ -167,56 +205,76 @@ void Segment::Put(const Slice& key, uint64_t time, DataBlock* row) {
     if (ts_cnt_ > 1) {
         return;
     }
-    std::lock_guard<std::mutex> lock(mu_);
+    std::shared_lock<std::shared_mutex> lock(mu_);
     PutUnlock(key, time, row);
 }
 
-void Segment::PutUnlock(const Slice& key, uint64_t time, DataBlock* row) {
+void* Segment::GetOrCreateEntry(const Slice& key, uint32_t& byte_size) {
     void* entry = nullptr;
-    uint32_t byte_size = 0;
     int ret = entries_->Get(key, entry);
-    if (ret < 0 || entry == NULL) {
-        char* pk = new char[key.size()];
-        memcpy(pk, key.data(), key.size());
-        // need to delete memory when free node
-        Slice skey(pk, key.size());
+    if (ret == 0 && entry != nullptr) {
+        return entry;
+    }
+    char* pk = new char[key.size()];
+    memcpy(pk, key.data(), key.size());
+    // need to delete memory when free node
+    Slice skey(pk, key.size());
+    if (ts_cnt_ > 1) {
+        auto** entry_arr = new KeyEntry*[ts_cnt_];
+        for (uint32_t i = 0; i < ts_cnt_; i++) {
+            entry_arr[i] = new KeyEntry(key_entry_max_height_);
+        }
+        entry = (void*)entry_arr;  // NOLINT
+    } else {
         entry = (void*)new KeyEntry(key_entry_max_height_);  // NOLINT
-        uint8_t height = entries_->Insert(skey, entry);
+    }
+    void* new_entry = entry;
+    uint8_t height = entries_->ConcurrentInsertIfAbsent(skey, entry, slab_);
+    if (height == 0) {
+        // another writer has inserted the key, entry is set to its one
+        delete[] pk;
+        if (ts_cnt_ > 1) {
+            auto** entry_arr = (KeyEntry**)new_entry;  // NOLINT
+            for (uint32_t i = 0; i < ts_cnt_; i++) {
+                delete entry_arr[i];
+            }
+            delete[] entry_arr;
+        } else {
+            delete (KeyEntry*)new_entry;  // NOLINT
+        }
+        return entry;
+    }
+    if (ts_cnt_ > 1) {
+        byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
+    } else {
         byte_size += GetRecordPkIdxSize(height, key.size(), key_entry_max_height_);
-        pk_cnt_.fetch_add(1, std::memory_order_relaxed);
     }
+    pk_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return entry;
+}
+
+void Segment::PutUnlock(const Slice& key, uint64_t time, DataBlock* row) {
+    uint32_t byte_size = 0;
+    void* entry = GetOrCreateEntry(key, byte_size);
     idx_cnt_.fetch_add(1, std::memory_order_relaxed);
-    uint8_t height = ((KeyEntry*)entry)->entries.Insert(time, row);  // NOLINT
-    ((KeyEntry*)entry)                                               // NOLINT
+    uint8_t height = ((KeyEntry*)entry)->entries.ConcurrentInsert(time, row, slab_);  // NOLINT
+    ((KeyEntry*)entry)                                                            // NOLINT
         ->count_.fetch_add(1, std::memory_order_relaxed);
     byte_size += GetRecordTsIdxSize(height);
     idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+    AddExpire((KeyEntry*)entry, key, time);  // NOLINT
 }
 
 void Segment::BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t time, DataBlock* row) {
-    void* key_entry_or_list = nullptr;
-    uint32_t byte_size = 0;
-    std::lock_guard<std::mutex> lock(mu_);  // TODO(hw): need lock?
-    int ret = entries_->Get(key, key_entry_or_list);
+    std::shared_lock<std::shared_mutex> lock(mu_);
     if (ts_cnt_ == 1) {
         PutUnlock(key, time, row);
     } else {
-        if (ret < 0 || key_entry_or_list == nullptr) {
-            char* pk = new char[key.size()];
-            memcpy(pk, key.data(), key.size());
-            Slice skey(pk, key.size());
-            auto** entry_arr_tmp = new KeyEntry*[ts_cnt_];
-            for (uint32_t i = 0; i < ts_cnt_; i++) {
-                entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_);
-            }
-            auto entry_arr = (void*)entry_arr_tmp;  // NOLINT
-            uint8_t height = entries_->Insert(skey, entry_arr);
-            byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
-            pk_cnt_.fetch_add(1, std::memory_order_relaxed);
-        }
-        uint8_t height = ((KeyEntry**)key_entry_or_list)[key_entry_id]->entries.Insert(  // NOLINT
-            time, row);
-        ((KeyEntry**)key_entry_or_list)[key_entry_id]->count_.fetch_add(  // NOLINT
+        uint32_t byte_size = 0;
+        void* entry_arr = GetOrCreateEntry(key, byte_size);
+        uint8_t height = ((KeyEntry**)entry_arr)[key_entry_id]->entries.ConcurrentInsert(  // NOLINT
+            time, row, slab_);
+        ((KeyEntry**)entry_arr)[key_entry_id]->count_.fetch_add(  // NOLINT
             1, std::memory_order_relaxed);
         byte_size += GetRecordTsIdxSize(height);
         idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
@@ -224,6 +282,34 @@ void Segment::BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t
     }
 }
 
+void Segment::Append(const Slice& key, uint32_t key_entry_id, std::vector<std::pair<uint64_t, DataBlock*>>& rows) {
+    if (rows.empty() || key_entry_id >= ts_cnt_) {
+        return;
+    }
+    std::lock_guard<std::shared_mutex> lock(mu_);
+    uint32_t byte_size = 0;
+    void* entry_arr = GetOrCreateEntry(key, byte_size);
+    KeyEntry* entry = ts_cnt_ > 1 ? ((KeyEntry**)entry_arr)[key_entry_id] : (KeyEntry*)entry_arr;  // NOLINT
+    TimeEntries::Appender appender(&entry->entries);
+    for (auto& row : rows) {
+        uint8_t height = appender.Append(row.first, row.second, slab_);
+        if (height == 0) {
+            // the time is newer than the last one in the list, fall back to insert
+            height = entry->entries.Insert(row.first, row.second, slab_);
+            appender = TimeEntries::Appender(&entry->entries);
+        }
+        byte_size += GetRecordTsIdxSize(height);
+    }
+    entry->count_.fetch_add(rows.size(), std::memory_order_relaxed);
+    if (ts_cnt_ > 1) {
+        idx_cnt_vec_[key_entry_id]->fetch_add(rows.size(), std::memory_order_relaxed);
+    } else {
+        idx_cnt_.fetch_add(rows.size(), std::memory_order_relaxed);
+        AddExpire(entry, key, rows.back().first);
+    }
+    idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+}
+
 void Segment::Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, DataBlock* row) {
     uint32_t ts_size = ts_map.size();
     if (ts_size == 0) {
@@ -237,7 +323,7 @@ void Segment::Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, D
         return;
     }
     void* entry_arr = NULL;
-    std::lock_guard<std::mutex> lock(mu_);
+    std::shared_lock<std::shared_mutex> lock(mu_);
     for (const auto& kv : ts_map) {
         uint32_t byte_size = 0;
         auto pos = ts_idx_map_.find(kv.first);
@@ -245,23 +331,10 @@ void Segment::Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, D
             continue;
         }
         if (entry_arr == NULL) {
-            int ret = entries_->Get(key, entry_arr);
-            if (ret < 0 || entry_arr == NULL) {
-                char* pk = new char[key.size()];
-                memcpy(pk, key.data(), key.size());
-                Slice skey(pk, key.size());
-                KeyEntry** entry_arr_tmp = new KeyEntry*[ts_cnt_];
-                for (uint32_t i = 0; i < ts_cnt_; i++) {
-                    entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_);
-                }
-                entry_arr = (void*)entry_arr_tmp;  // NOLINT
-                uint8_t height = entries_->Insert(skey, entry_arr);
-                byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
-                pk_cnt_.fetch_add(1, std::memory_order_relaxed);
-            }
+            entry_arr = GetOrCreateEntry(key, byte_size);
         }
-        uint8_t height = ((KeyEntry**)entry_arr)[pos->second]->entries.Insert(  // NOLINT
-            kv.second, row);
+        uint8_t height = ((KeyEntry**)entry_arr)[pos->second]->entries.ConcurrentInsert(  // NOLINT
+            kv.second, row, slab_);
         ((KeyEntry**)entry_arr)[pos->second]->count_.fetch_add(  // NOLINT
             1, std::memory_order_relaxed);
         byte_size += GetRecordTsIdxSize(height);
@@ -302,9 +375,9 @@ bool Segment::Get(const Slice& key, uint32_t idx, const uint64_t time, DataBlock
 }
 
 bool Segment::Delete(const Slice& key) {
-    ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
+    KeyEntryNode* entry_node = NULL;
     {
-        std::lock_guard<std::mutex> lock(mu_);
+        std::lock_guard<std::shared_mutex> lock(mu_);
         entry_node = entries_->Remove(key);
         if (entry_node == NULL) {
             return false;
@@ -317,33 +390,44 @@ bool Segment::Delete(const Slice& key) {
     return true;
 }
 
-void Segment::FreeList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,
-                       uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+void Segment::FreeList(TimeEntryNode* node, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                       uint64_t& gc_record_byte_size, bool mark_spilled) {
+    if (node == NULL) {
+        return;
+    }
+    // the nodes and blocks may be still visible to the readers, they are freed by RetireFreed
+    freed_lists_.push_back(node);
     while (node != NULL) {
         gc_idx_cnt++;
-        ::openmldb::base::Node<uint64_t, DataBlock*>* tmp = node;
+        TimeEntryNode* tmp = node;
         idx_byte_size_.fetch_sub(GetRecordTsIdxSize(tmp->Height()));
         node = node->GetNextNoBarrier(0);
         DEBUGLOG("delete key %lu with height %u", tmp->GetKey(), tmp->Height());
-        if (tmp->GetValue()->dim_cnt_down > 1) {
-            tmp->GetValue()->dim_cnt_down--;
+        DataBlock* block = tmp->GetValue();
+        if (block->dim_cnt_down > 1) {
+            block->dim_cnt_down--;
+            if (mark_spilled && !block->spilled) {
+                block->spilled = true;
+                gc_record_cnt++;
+            }
         } else {
             DEBUGLOG("delele data block for key %lu", tmp->GetKey());
-            gc_record_byte_size += GetRecordSize(tmp->GetValue()->size);
-            delete tmp->GetValue();
-            gc_record_cnt++;
+            gc_record_byte_size += GetRecordSize(block->size);
+            freed_blocks_.push_back(block);
+            if (!block->spilled) {
+                gc_record_cnt++;
+            }
         }
-        delete tmp;
     }
 }
 
-void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+void Segment::FreeEntry(KeyEntryNode* entry_node, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
                         uint64_t& gc_record_byte_size) {
     if (entry_node == NULL) {
         return;
     }
-    // free pk memory
-    delete[] entry_node->GetKey().data();
+    // the key and the key entries are freed by RetireFreed
+    freed_entry_nodes_.push_back(entry_node);
     if (ts_cnt_ > 1) {
         KeyEntry** entry_arr = (KeyEntry**)entry_node->GetValue();  // NOLINT
         for (uint32_t i = 0; i < ts_cnt_; i++) {
@@ -353,14 +437,13 @@ void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64
             it->SeekToFirst();
             if (it->Valid()) {
                 uint64_t ts = it->GetKey();
-                ::openmldb::base::Node<uint64_t, DataBlock*>* data_node = entry->entries.Split(ts);
+                TimeEntryNode* data_node = entry->entries.Split(ts);
                 FreeList(data_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
             }
             delete it;
-            delete entry;
+            FreeColdList(entry->cold_.exchange(NULL, std::memory_order_relaxed), gc_idx_cnt, gc_record_cnt);
             idx_cnt_vec_[i]->fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
         }
-        delete[] entry_arr;
         uint64_t byte_size =
             GetRecordPkMultiIdxSize(entry_node->Height(), entry_node->GetKey().size(), key_entry_max_height_, ts_cnt_);
         idx_byte_size_.fetch_sub(byte_size, std::memory_order_relaxed);
@@ -371,11 +454,11 @@ void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64
         it->SeekToFirst();
         if (it->Valid()) {
             uint64_t ts = it->GetKey();
-            ::openmldb::base::Node<uint64_t, DataBlock*>* data_node = entry->entries.Split(ts);
+            TimeEntryNode* data_node = entry->entries.Split(ts);
             FreeList(data_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
         }
         delete it;
-        delete entry;
+        FreeColdList(entry->cold_.exchange(NULL, std::memory_order_relaxed), gc_idx_cnt, gc_record_cnt);
         uint64_t byte_size =
             GetRecordPkIdxSize(entry_node->Height(), entry_node->GetKey().size(), key_entry_max_height_);
         idx_byte_size_.fetch_sub(byte_size, std::memory_order_relaxed);
@@ -385,16 +468,15 @@ void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64
 
 void Segment::GcEntryFreeList(uint64_t version, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
                               uint64_t& gc_record_byte_size) {
-    ::openmldb::base::Node<uint64_t, ::openmldb::base::Node<Slice, void*>*>* node = NULL;
+    ::openmldb::base::Node<uint64_t, KeyEntryNode*>* node = NULL;
     {
         std::lock_guard<std::mutex> lock(gc_mu_);
         node = entry_free_list_->Split(version);
     }
     while (node != NULL) {
-        ::openmldb::base::Node<Slice, void*>* entry_node = node->GetValue();
+        KeyEntryNode* entry_node = node->GetValue();
         FreeEntry(entry_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-        delete entry_node;
-        ::openmldb::base::Node<uint64_t, ::openmldb::base::Node<Slice, void*>*>* tmp = node;
+        ::openmldb::base::Node<uint64_t, KeyEntryNode*>* tmp = node;
         node = node->GetNextNoBarrier(0);
         delete tmp;
         pk_cnt_.fetch_sub(1, std::memory_order_relaxed);
@@ -402,17 +484,83 @@ void Segment::GcEntryFreeList(uint64_t version, uint64_t& gc_idx_cnt, uint64_t&
 }
 
 void Segment::GcFreeList(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+    // the readers are protected by the epoch, so the deleted keys can be freed in the next round
     uint64_t cur_version = gc_version_.load(std::memory_order_relaxed);
-    if (cur_version < FLAGS_gc_deleted_pk_version_delta) {
+    GcEntryFreeList(cur_version, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    RetireFreed();
+}
+
+void Segment::RetireFreed() {
+    if (freed_lists_.empty() && freed_blocks_.empty() && freed_cold_blocks_.empty() &&
+        freed_entry_nodes_.empty()) {
         return;
     }
-    uint64_t free_list_version = cur_version - FLAGS_gc_deleted_pk_version_delta;
-    GcEntryFreeList(free_list_version, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    // one item is retired for the memory freed by a gc call
+    auto lists = std::make_shared<std::vector<TimeEntryNode*>>();
+    auto blocks = std::make_shared<std::vector<DataBlock*>>();
+    auto cold_blocks = std::make_shared<std::vector<ColdBlock*>>();
+    auto entry_nodes = std::make_shared<std::vector<KeyEntryNode*>>();
+    lists->swap(freed_lists_);
+    blocks->swap(freed_blocks_);
+    cold_blocks->swap(freed_cold_blocks_);
+    entry_nodes->swap(freed_entry_nodes_);
+    EpochManager::Default()->Retire(this, [this, lists, blocks, cold_blocks, entry_nodes] {
+        FreeRetired(lists.get(), blocks.get(), cold_blocks.get(), entry_nodes.get());
+    });
+}
+
+void Segment::FreeRetired(std::vector<TimeEntryNode*>* lists, std::vector<DataBlock*>* blocks,
+                          std::vector<ColdBlock*>* cold_blocks, std::vector<KeyEntryNode*>* entry_nodes) {
+    for (TimeEntryNode* node : *lists) {
+        while (node != NULL) {
+            TimeEntryNode* tmp = node;
+            node = node->GetNextNoBarrier(0);
+            TimeEntries::FreeNode(tmp, slab_);
+        }
+    }
+    for (DataBlock* block : *blocks) {
+        FreeDataBlock(block);
+    }
+    for (ColdBlock* block : *cold_blocks) {
+        delete block;
+    }
+    for (KeyEntryNode* entry_node : *entry_nodes) {
+        if (ts_cnt_ == 1) {
+            KeyEntry* entry = (KeyEntry*)entry_node->GetValue();  // NOLINT
+            if (entry->wheel_ref_.fetch_or(WHEEL_REF_FREED, std::memory_order_acq_rel) != 0) {
+                // the wheel still holds the key, it's deleted by the last UnrefExpire
+                continue;
+            }
+        }
+        DeleteEntryNode(entry_node);
+    }
+}
+
+void Segment::DeleteEntryNode(KeyEntryNode* entry_node) {
+    delete[] entry_node->GetKey().data();
+    if (ts_cnt_ > 1) {
+        KeyEntry** entry_arr = (KeyEntry**)entry_node->GetValue();  // NOLINT
+        for (uint32_t i = 0; i < ts_cnt_; i++) {
+            delete entry_arr[i];
+        }
+        delete[] entry_arr;
+    } else {
+        delete (KeyEntry*)entry_node->GetValue();  // NOLINT
+    }
+    KeyEntries::FreeNode(entry_node, slab_);
 }
 
 void Segment::ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
                         uint64_t& gc_record_byte_size) {
     uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+    gc_throttle_.Reset();
+    // only Gc4TTL goes through the expire wheel
+    bool gc_by_time = ttl_st.abs_ttl > 0 && (ttl_st.ttl_type == ::openmldb::storage::TTLType::kAbsoluteTime ||
+                                             (ttl_st.ttl_type == ::openmldb::storage::TTLType::kAbsOrLat &&
+                                              ttl_st.lat_ttl == 0));
+    if (!gc_by_time) {
+        DisableExpireWheel();
+    }
     switch (ttl_st.ttl_type) {
         case ::openmldb::storage::TTLType::kAbsoluteTime: {
             if (ttl_st.abs_ttl == 0) {
@@ -471,6 +619,7 @@ void Segment::ExecuteGc(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
     if (!need_gc) {
         return;
     }
+    gc_throttle_.Reset();
     GcAllType(ttl_st_map, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
 }
 
@@ -484,13 +633,12 @@ void Segment::Gc4Head(uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_reco
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
+        gc_throttle_.Yield();
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
+        TimeEntryNode* node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
-            if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                node = entry->entries.SplitByPos(keep_cnt);
-            }
+            std::lock_guard<std::shared_mutex> lock(mu_);
+            node = entry->entries.SplitByPos(keep_cnt);
         }
         uint64_t entry_gc_idx_cnt = 0;
         FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
@@ -502,6 +650,7 @@ void Segment::Gc4Head(uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_reco
              (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     delete it;
+    RetireFreed();
 }
 
 void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
@@ -511,6 +660,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
+        gc_throttle_.Yield();
         KeyEntry** entry_arr = (KeyEntry**)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
@@ -524,7 +674,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                 continue;
             }
             KeyEntry* entry = entry_arr[pos->second];
-            ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
+            TimeEntryNode* node = NULL;
             bool continue_flag = false;
             switch (kv.second.ttl_type) {
                 case ::openmldb::storage::TTLType::kAbsoluteTime: {
@@ -533,7 +683,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         continue_flag = true;
                     } else {
                         node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
+                        std::lock_guard<std::shared_mutex> lock(mu_);
                         SplitList(entry, kv.second.abs_ttl, &node);
                         if (entry->entries.IsEmpty()) {
                             empty_cnt++;
@@ -542,10 +692,8 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                     break;
                 }
                 case ::openmldb::storage::TTLType::kLatestTime: {
-                    std::lock_guard<std::mutex> lock(mu_);
-                    if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                        node = entry->entries.SplitByPos(kv.second.lat_ttl);
-                    }
+                    std::lock_guard<std::shared_mutex> lock(mu_);
+                    node = entry->entries.SplitByPos(kv.second.lat_ttl);
                     break;
                 }
                 case ::openmldb::storage::TTLType::kAbsAndLat: {
@@ -554,10 +702,8 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         continue_flag = true;
                     } else {
                         node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
-                        if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                            node = entry->entries.SplitByKeyAndPos(kv.second.abs_ttl, kv.second.lat_ttl);
-                        }
+                        std::lock_guard<std::shared_mutex> lock(mu_);
+                        node = entry->entries.SplitByKeyAndPos(kv.second.abs_ttl, kv.second.lat_ttl);
                     }
                     break;
                 }
@@ -567,15 +713,13 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         continue_flag = true;
                     } else {
                         node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
-                        if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                            if (kv.second.abs_ttl == 0) {
-                                node = entry->entries.SplitByPos(kv.second.lat_ttl);
-                            } else if (kv.second.lat_ttl == 0) {
-                                node = entry->entries.Split(kv.second.abs_ttl);
-                            } else {
-                                node = entry->entries.SplitByKeyOrPos(kv.second.abs_ttl, kv.second.lat_ttl);
-                            }
+                        std::lock_guard<std::shared_mutex> lock(mu_);
+                        if (kv.second.abs_ttl == 0) {
+                            node = entry->entries.SplitByPos(kv.second.lat_ttl);
+                        } else if (kv.second.lat_ttl == 0) {
+                            node = entry->entries.Split(kv.second.abs_ttl);
+                        } else {
+                            node = entry->entries.SplitByKeyOrPos(kv.second.abs_ttl, kv.second.lat_ttl);
                         }
                         if (entry->entries.IsEmpty()) {
                             empty_cnt++;
@@ -597,9 +741,9 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
         }
         if (empty_cnt == ts_cnt_) {
             bool is_empty = true;
-            ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
+            KeyEntryNode* entry_node = NULL;
             {
-                std::lock_guard<std::mutex> lock(mu_);
+                std::lock_guard<std::shared_mutex> lock(mu_);
                 for (uint32_t i = 0; i < ts_cnt_; i++) {
                     if (!entry_arr[i]->entries.IsEmpty()) {
                         is_empty = false;
@@ -619,58 +763,410 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
     DEBUGLOG("[GcAll] segment gc consumed %lu, count %lu", (::baidu::common::timer::get_micros() - consumed) / 1000,
              gc_idx_cnt - old);
     delete it;
+    RetireFreed();
 }
 
-void Segment::SplitList(KeyEntry* entry, uint64_t ts, ::openmldb::base::Node<uint64_t, DataBlock*>** node) {
-    // skip entry that ocupied by reader
-    if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-        *node = entry->entries.Split(ts);
+void Segment::SplitList(KeyEntry* entry, uint64_t ts, TimeEntryNode** node) {
+    *node = entry->entries.Split(ts);
+}
+
+void Segment::SplitCold(KeyEntry* entry, uint64_t ts, ColdBlock** block) {
+    ColdBlock* pre = NULL;
+    ColdBlock* cur = entry->GetColdBlock();
+    while (cur != NULL && cur->GetMaxTime() > ts) {
+        pre = cur;
+        cur = cur->GetNext();
+    }
+    if (cur == NULL) {
+        return;
     }
+    if (pre == NULL) {
+        entry->cold_.store(NULL, std::memory_order_release);
+    } else {
+        pre->SetNext(NULL);
+    }
+    *block = cur;
 }
 
-// fast gc with no global pause
-void Segment::Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
-                     uint64_t& gc_record_byte_size) {
+void Segment::FreeColdList(ColdBlock* block, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt) {
+    while (block != NULL) {
+        ColdBlock* tmp = block;
+        block = block->GetNext();
+        gc_idx_cnt += tmp->GetCount();
+        // the other rows are counted by the index which frees their data block
+        gc_record_cnt += tmp->GetOwnedCount();
+        idx_byte_size_.fetch_sub(tmp->GetByteSize(), std::memory_order_relaxed);
+        freed_cold_blocks_.push_back(tmp);
+    }
+}
+
+void Segment::FreezeCold(const uint64_t time, uint64_t& freeze_cnt, uint64_t& freeze_byte_size) {
+    if (ts_cnt_ > 1) {
+        return;
+    }
     uint64_t consumed = ::baidu::common::timer::get_micros();
-    uint64_t old = gc_idx_cnt;
+    uint64_t old = freeze_cnt;
+    gc_throttle_.Reset();
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
+        gc_throttle_.Yield();
+        KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
+        it->Next();
+        TimeEntryNode* node = entry->entries.GetLast();
+        if (node == NULL || node->GetKey() > time) {
+            continue;
+        }
+        // a row referred by other indexes would be copied into the block of every index, so only the rows
+        // older than the oldest shared one are frozen. A spilled row is kept too, its count is gone already
+        uint64_t freeze_time = time;
+        bool shared_oldest = false;
+        TimeEntries::Iterator* hot_it = entry->entries.NewIterator();
+        for (hot_it->Seek(time); hot_it->Valid(); hot_it->Next()) {
+            if (hot_it->GetValue()->dim_cnt_down > 1 || hot_it->GetValue()->spilled) {
+                if (hot_it->GetKey() == 0) {
+                    shared_oldest = true;
+                    break;
+                }
+                freeze_time = hot_it->GetKey() - 1;
+            }
+        }
+        if (shared_oldest || node->GetKey() > freeze_time) {
+            delete hot_it;
+            continue;
+        }
+        // the cold blocks are only changed by the gc thread, so they are read without lock.
+        // the frozen rows are merged with the blocks whose time range overlaps with them
+        ColdBlock* head = entry->GetColdBlock();
+        ColdBlock* remain = head;
+        while (remain != NULL && remain->GetMaxTime() >= node->GetKey()) {
+            remain = remain->GetNext();
+        }
+        ColdBlockBuilder builder;
+        uint32_t hot_cnt = 0;
+        hot_it->Seek(freeze_time);
+        ColdBlock::Iterator cold_it(head);
+        cold_it.SeekToFirst();
+        while (true) {
+            bool cold_valid = cold_it.Valid() && cold_it.GetBlock() != remain;
+            if (hot_it->Valid() && (!cold_valid || hot_it->GetKey() >= cold_it.GetKey())) {
+                DataBlock* block = hot_it->GetValue();
+                // the data block is freed after frozen if no other index refers it
+                builder.Add(hot_it->GetKey(), block->data, block->size, block->dim_cnt_down <= 1);
+                hot_cnt++;
+                hot_it->Next();
+            } else if (cold_valid) {
+                Slice value = cold_it.GetValue();
+                builder.Add(cold_it.GetKey(), value.data(), value.size(), cold_it.IsOwned());
+                cold_it.Next();
+            } else {
+                break;
+            }
+        }
+        ColdBlock* block = builder.Finish();
+        if (hot_cnt == 0) {
+            delete hot_it;
+            delete block;
+            continue;
+        }
+        block->SetNext(remain);
+        TimeEntryNode* frozen = NULL;
+        {
+            std::lock_guard<std::shared_mutex> lock(mu_);
+            // a put with an old time may come after the block is built, freeze it next time
+            uint32_t cnt = 0;
+            for (hot_it->Seek(freeze_time); hot_it->Valid(); hot_it->Next()) {
+                cnt++;
+            }
+            if (cnt == hot_cnt) {
+                entry->cold_.store(block, std::memory_order_release);
+                frozen = entry->entries.Split(freeze_time);
+            }
+        }
+        delete hot_it;
+        if (frozen == NULL) {
+            block->SetNext(NULL);
+            delete block;
+            continue;
+        }
+        idx_byte_size_.fetch_add(block->GetByteSize(), std::memory_order_relaxed);
+        while (head != remain) {
+            ColdBlock* tmp = head;
+            head = head->GetNext();
+            idx_byte_size_.fetch_sub(tmp->GetByteSize(), std::memory_order_relaxed);
+            freed_cold_blocks_.push_back(tmp);
+        }
+        // the rows are still there, only the index and data block size is released
+        uint64_t frozen_idx_cnt = 0;
+        uint64_t frozen_record_cnt = 0;
+        FreeList(frozen, frozen_idx_cnt, frozen_record_cnt, freeze_byte_size);
+        freeze_cnt += frozen_idx_cnt;
+    }
+    DEBUGLOG("[FreezeCold] segment freeze with key %lu, consumed %lu, count %lu", time,
+             (::baidu::common::timer::get_micros() - consumed) / 1000, freeze_cnt - old);
+    delete it;
+    RetireFreed();
+}
+
+void Segment::Spill(const uint64_t time, const SpillWriter& writer, bool is_first, uint64_t& spill_cnt,
+                    uint64_t& spill_record_cnt, uint64_t& spill_byte_size) {
+    if (ts_cnt_ > 1) {
+        return;
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t old = spill_cnt;
+    gc_throttle_.Reset();
+    std::vector<std::pair<uint64_t, Slice>> rows;
+    std::vector<uint64_t> times;
+    KeyEntries::Iterator* it = entries_->NewIterator();
+    it->SeekToFirst();
+    while (it->Valid()) {
+        gc_throttle_.Yield();
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
-        if (node == NULL) {
+        ColdBlock* cold = entry->GetColdBlock();
+        while (cold != NULL && cold->GetMaxTime() > time) {
+            cold = cold->GetNext();
+        }
+        TimeEntryNode* node = entry->entries.GetLast();
+        if ((node == NULL || node->GetKey() > time) && cold == NULL) {
             continue;
-        } else if (node->GetKey() > time) {
-            DEBUGLOG(
-                "[Gc4TTL] segment gc with key %lu need not ttl, last node "
-                "key %lu",
-                time, node->GetKey());
+        }
+        // the rows are read without lock, the memory is not freed until the gc thread retires it
+        rows.clear();
+        uint32_t hot_cnt = 0;
+        TimeEntries::Iterator* hot_it = entry->entries.NewIterator();
+        for (hot_it->Seek(time); hot_it->Valid(); hot_it->Next()) {
+            DataBlock* block = hot_it->GetValue();
+            rows.emplace_back(hot_it->GetKey(), Slice(block->data, block->size));
+            hot_cnt++;
+        }
+        ColdBlock::Iterator cold_it(cold);
+        for (cold_it.SeekToFirst(); cold_it.Valid(); cold_it.Next()) {
+            rows.emplace_back(cold_it.GetKey(), cold_it.GetValue());
+        }
+        // the cold rows may be newer than the hot ones put late, so the ts are sorted to find the duplicates
+        times.clear();
+        for (const auto& row : rows) {
+            times.push_back(row.first);
+        }
+        std::sort(times.begin(), times.end());
+        SpillStatus status = SpillStatus::kKept;
+        if (std::adjacent_find(times.begin(), times.end()) == times.end()) {
+            status = writer(key, rows);
+        }
+        if (status == SpillStatus::kFailed) {
+            delete hot_it;
+            PDLOG(WARNING, "fail to spill key %s, stop spilling the segment", key.ToString().c_str());
+            break;
+        } else if (status == SpillStatus::kKept) {
+            delete hot_it;
+            DEBUGLOG("keep key %s in memory as the disk tier can not keep its rows apart", key.ToString().c_str());
             continue;
         }
         node = NULL;
-        ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
+        ColdBlock* spilled_cold = NULL;
+        KeyEntryNode* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
-            SplitList(entry, time, &node);
-            if (entry->entries.IsEmpty()) {
-                entry_node = entries_->Remove(key);
+            std::lock_guard<std::shared_mutex> lock(mu_);
+            // a put with an old time may come after the rows are written, spill it next time. The rows written
+            // are read from both the memory and the disk tier until the next gc, and the readers skip the duplicates
+            uint32_t cnt = 0;
+            for (hot_it->Seek(time); hot_it->Valid(); hot_it->Next()) {
+                cnt++;
+            }
+            if (cnt == hot_cnt) {
+                SplitList(entry, time, &node);
+                SplitCold(entry, time, &spilled_cold);
+                if (entry->IsEmpty()) {
+                    entry_node = entries_->Remove(key);
+                }
             }
         }
+        delete hot_it;
         if (entry_node != NULL) {
             std::lock_guard<std::mutex> lock(gc_mu_);
             entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
         }
-        uint64_t entry_gc_idx_cnt = 0;
-        FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-        entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
-        gc_idx_cnt += entry_gc_idx_cnt;
+        uint64_t entry_spill_cnt = 0;
+        FreeList(node, entry_spill_cnt, spill_record_cnt, spill_byte_size, is_first);
+        FreeColdList(spilled_cold, entry_spill_cnt, spill_record_cnt);
+        entry->count_.fetch_sub(entry_spill_cnt, std::memory_order_relaxed);
+        spill_cnt += entry_spill_cnt;
+    }
+    DEBUGLOG("[Spill] segment spill with key %lu, consumed %lu, count %lu", time,
+             (::baidu::common::timer::get_micros() - consumed) / 1000, spill_cnt - old);
+    idx_cnt_.fetch_sub(spill_cnt - old, std::memory_order_relaxed);
+    delete it;
+    RetireFreed();
+}
+
+void Segment::AddExpire(KeyEntry* entry, const Slice& key, uint64_t time) {
+    if (wheel_ == NULL || !wheel_active_.load()) {
+        return;
+    }
+    // the rows after year 10000 share the last bucket
+    uint32_t bucket = std::min(wheel_->GetBucket(time), (uint64_t)UINT32_MAX - 1);
+    uint32_t cur = entry->expire_bucket_.load(std::memory_order_relaxed);
+    while (bucket < cur) {
+        if (entry->expire_bucket_.compare_exchange_weak(cur, bucket, std::memory_order_relaxed)) {
+            // the node is only looked up for a new key or an older row. it's not freed here as puts hold
+            // the shared lock and only the gc thread retires the removed nodes
+            KeyEntryNode* entry_node = entries_->GetNode(key);
+            if (entry_node == NULL || entry_node->GetValue() != (void*)entry) {  // NOLINT
+                // the key is removed by the gc or a delete
+                return;
+            }
+            entry->wheel_ref_.fetch_add(1, std::memory_order_relaxed);
+            wheel_->Add(bucket, entry_node);
+            return;
+        }
+    }
+}
+
+void Segment::UnrefExpire(KeyEntryNode* entry_node) {
+    KeyEntry* entry = (KeyEntry*)entry_node->GetValue();  // NOLINT
+    if (entry->wheel_ref_.fetch_sub(1, std::memory_order_acq_rel) == (WHEEL_REF_FREED | 1)) {
+        DeleteEntryNode(entry_node);
+    }
+}
+
+void Segment::ClearExpireWheel() {
+    if (wheel_ == NULL) {
+        return;
+    }
+    std::vector<KeyEntryNode*> entry_nodes;
+    wheel_->PopAll(&entry_nodes);
+    for (KeyEntryNode* entry_node : entry_nodes) {
+        UnrefExpire(entry_node);
+    }
+}
+
+void Segment::ResetExpire(KeyEntry* entry, const Slice& key) {
+    entry->expire_bucket_.store(UINT32_MAX, std::memory_order_relaxed);
+    // a put after the reset adds the key by itself
+    TimeEntryNode* node = entry->entries.GetLast();
+    ColdBlock* cold = entry->GetColdBlock();
+    while (cold != NULL && cold->GetNext() != NULL) {
+        cold = cold->GetNext();
+    }
+    if (node != NULL) {
+        AddExpire(entry, key, node->GetKey());
+    }
+    if (cold != NULL) {
+        AddExpire(entry, key, cold->GetMinTime());
+    }
+}
+
+void Segment::DisableExpireWheel() {
+    if (wheel_ != NULL && wheel_active_.exchange(false)) {
+        ClearExpireWheel();
+    }
+}
+
+bool Segment::GcEntry4TTL(KeyEntry* entry, const Slice& key, const uint64_t time, uint64_t& gc_idx_cnt,
+                          uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+    TimeEntryNode* node = entry->entries.GetLast();
+    ColdBlock* cold = entry->GetColdBlock();
+    while (cold != NULL && cold->GetNext() != NULL) {
+        cold = cold->GetNext();
+    }
+    bool gc_cold = cold != NULL && cold->GetMaxTime() <= time;
+    if (node == NULL && !gc_cold) {
+        return false;
+    } else if ((node == NULL || node->GetKey() > time) && !gc_cold) {
+        DEBUGLOG(
+            "[Gc4TTL] segment gc with key %lu need not ttl, last node "
+            "key %lu",
+            time, node->GetKey());
+        return false;
+    }
+    node = NULL;
+    cold = NULL;
+    KeyEntryNode* entry_node = NULL;
+    {
+        std::lock_guard<std::shared_mutex> lock(mu_);
+        SplitList(entry, time, &node);
+        SplitCold(entry, time, &cold);
+        if (entry->IsEmpty()) {
+            entry_node = entries_->Remove(key);
+        }
+    }
+    if (entry_node != NULL) {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
+    }
+    uint64_t entry_gc_idx_cnt = 0;
+    FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    FreeColdList(cold, entry_gc_idx_cnt, gc_record_cnt);
+    entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
+    gc_idx_cnt += entry_gc_idx_cnt;
+    return entry_node != NULL;
+}
+
+// fast gc with no global pause
+void Segment::Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                     uint64_t& gc_record_byte_size) {
+    if (wheel_ != NULL && wheel_active_.load()) {
+        Gc4TTLByWheel(time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        return;
+    }
+    // the puts from now on add their keys to the wheel, and the scan adds the others
+    bool build_wheel = wheel_ != NULL;
+    if (build_wheel) {
+        wheel_active_.store(true);
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t old = gc_idx_cnt;
+    KeyEntries::Iterator* it = entries_->NewIterator();
+    it->SeekToFirst();
+    while (it->Valid()) {
+        gc_throttle_.Yield();
+        KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
+        Slice key = it->GetKey();
+        it->Next();
+        if (!GcEntry4TTL(entry, key, time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size) && build_wheel) {
+            ResetExpire(entry, key);
+        }
     }
     DEBUGLOG("[Gc4TTL] segment gc with key %lu ,consumed %lu, count %lu", time,
              (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     delete it;
+    RetireFreed();
+}
+
+void Segment::Gc4TTLByWheel(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                            uint64_t& gc_record_byte_size) {
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t old = gc_idx_cnt;
+    std::vector<KeyEntryNode*> entry_nodes;
+    wheel_->Pop(time, &entry_nodes);
+    for (size_t i = 0; i < entry_nodes.size(); i++) {
+        KeyEntryNode* entry_node = entry_nodes[i];
+        // the handles are sorted, a key added several times is gc once
+        if (i > 0 && entry_node == entry_nodes[i - 1]) {
+            continue;
+        }
+        gc_throttle_.Yield();
+        // the node is kept by the handles, but the key may be deleted or gc since it's added
+        Slice key = entry_node->GetKey();
+        if (entries_->GetNode(key) != entry_node) {
+            continue;
+        }
+        KeyEntry* entry = (KeyEntry*)entry_node->GetValue();  // NOLINT
+        if (!GcEntry4TTL(entry, key, time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size)) {
+            ResetExpire(entry, key);
+        }
+    }
+    for (KeyEntryNode* entry_node : entry_nodes) {
+        UnrefExpire(entry_node);
+    }
+    DEBUGLOG("[Gc4TTL] segment gc by wheel with key %lu, consumed %lu, key cnt %lu, count %lu", time,
+             (::baidu::common::timer::get_micros() - consumed) / 1000, entry_nodes.size(), gc_idx_cnt - old);
+    idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
+    RetireFreed();
 }
 
 void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
@@ -684,8 +1180,9 @@ void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
+        gc_throttle_.Yield();
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
+        TimeEntryNode* node = entry->entries.GetLast();
         it->Next();
         if (node == NULL) {
             continue;
@@ -698,10 +1195,8 @@ void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64
         }
         node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
-            if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                node = entry->entries.SplitByKeyAndPos(time, keep_cnt);
-            }
+            std::lock_guard<std::shared_mutex> lock(mu_);
+            node = entry->entries.SplitByKeyAndPos(time, keep_cnt);
         }
         uint64_t entry_gc_idx_cnt = 0;
         FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
@@ -714,6 +1209,7 @@ void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64
         time, keep_cnt, (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     delete it;
+    RetireFreed();
 }
 
 void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
@@ -733,20 +1229,19 @@ void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
+        gc_throttle_.Yield();
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
+        TimeEntryNode* node = entry->entries.GetLast();
         if (node == NULL) {
             continue;
         }
         node = NULL;
-        ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
+        KeyEntryNode* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
-            if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                node = entry->entries.SplitByKeyOrPos(time, keep_cnt);
-            }
+            std::lock_guard<std::shared_mutex> lock(mu_);
+            node = entry->entries.SplitByKeyOrPos(time, keep_cnt);
             if (entry->entries.IsEmpty()) {
                 entry_node = entries_->Remove(key);
             }
@@ -766,12 +1261,14 @@ void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_
         time, keep_cnt, (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     delete it;
+    RetireFreed();
 }
 
 int Segment::GetCount(const Slice& key, uint64_t& count) {
     if (ts_cnt_ > 1) {
         return -1;
     }
+    EpochGuard guard;
     void* entry = NULL;
     if (entries_->Get(key, entry) < 0 || entry == NULL) {
         return -1;
@@ -788,6 +1285,7 @@ int Segment::GetCount(const Slice& key, uint32_t idx, uint64_t& count) {
     if (ts_cnt_ == 1) {
         return GetCount(key, count);
     }
+    EpochGuard guard;
     void* entry_arr = NULL;
     if (entries_->Get(key, entry_arr) < 0 || entry_arr == NULL) {
         return -1;
@@ -797,6 +1295,65 @@ int Segment::GetCount(const Slice& key, uint32_t idx, uint64_t& count) {
     return 0;
 }
 
+KeyEntry::Iterator::Iterator(KeyEntry* entry)
+    : hot_(entry->entries.NewIterator()), cold_(entry->GetColdBlock()), is_cold_(false) {}
+
+KeyEntry::Iterator::~Iterator() { delete hot_; }
+
+void KeyEntry::Iterator::Pick() {
+    // the row in time entries goes first if the time is equal
+    is_cold_ = cold_.Valid() && (!hot_->Valid() || cold_.GetKey() > hot_->GetKey());
+}
+
+void KeyEntry::Iterator::Next() {
+    if (is_cold_) {
+        cold_.Next();
+    } else {
+        hot_->Next();
+    }
+    Pick();
+}
+
+Slice KeyEntry::Iterator::GetValue() const {
+    if (is_cold_) {
+        return cold_.GetValue();
+    }
+    DataBlock* block = hot_->GetValue();
+    return Slice(block->data, block->size);
+}
+
+void KeyEntry::Iterator::Seek(const uint64_t& time) {
+    hot_->Seek(time);
+    cold_.Seek(time);
+    Pick();
+}
+
+void KeyEntry::Iterator::SeekToFirst() {
+    hot_->SeekToFirst();
+    cold_.SeekToFirst();
+    Pick();
+}
+
+void KeyEntry::Iterator::SeekToLast() {
+    hot_->SeekToLast();
+    cold_.SeekToLast();
+    if (hot_->Valid() && cold_.Valid()) {
+        // only the older one is the last
+        if (cold_.GetKey() > hot_->GetKey()) {
+            cold_.Seek(0);
+            while (cold_.Valid()) {
+                cold_.Next();
+            }
+        } else {
+            hot_->Seek(0);
+            while (hot_->Valid()) {
+                hot_->Next();
+            }
+        }
+    }
+    Pick();
+}
+
 // Iterator
 MemTableIterator* Segment::NewIterator(const Slice& key, Ticket& ticket) {
     if (entries_ == NULL || ts_cnt_ > 1) {
@@ -806,8 +1363,7 @@ MemTableIterator* Segment::NewIterator(const Slice& key, Ticket& ticket) {
     if (entries_->Get(key, entry) < 0 || entry == NULL) {
         return new MemTableIterator(NULL);
     }
-    ticket.Push((KeyEntry*)entry);                                           // NOLINT
-    return new MemTableIterator(((KeyEntry*)entry)->entries.NewIterator());  // NOLINT
+    return new MemTableIterator(((KeyEntry*)entry)->NewIterator());  // NOLINT
 }
 
 MemTableIterator* Segment::NewIterator(const Slice& key, uint32_t idx, Ticket& ticket) {
@@ -822,11 +1378,10 @@ MemTableIterator* Segment::NewIterator(const Slice& key, uint32_t idx, Ticket& t
     if (entries_->Get(key, entry_arr) < 0 || entry_arr == NULL) {
         return new MemTableIterator(NULL);
     }
-    ticket.Push(((KeyEntry**)entry_arr)[pos->second]);                                         // NOLINT
-    return new MemTableIterator(((KeyEntry**)entry_arr)[pos->second]->entries.NewIterator());  // NOLINT
+    return new MemTableIterator(((KeyEntry**)entry_arr)[pos->second]->NewIterator());  // NOLINT
 }
 
-MemTableIterator::MemTableIterator(TimeEntries::Iterator* it) : it_(it) {}
+MemTableIterator::MemTableIterator(KeyEntry::Iterator* it) : it_(it) {}
 
 MemTableIterator::~MemTableIterator() {
     if (it_ != NULL) {
@@ -855,9 +1410,7 @@ void MemTableIterator::Next() {
     it_->Next();
 }
 
-::openmldb::base::Slice MemTableIterator::GetValue() const {
-    return ::openmldb::base::Slice(it_->GetValue()->data, it_->GetValue()->size);
-}
+::openmldb::base::Slice MemTableIterator::GetValue() const { return it_->GetValue(); }
 
 uint64_t MemTableIterator::GetKey() const { return it_->GetKey(); }
 
@@ -18,14 +18,22 @@
 #define SRC_STORAGE_SEGMENT_H_
 
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <shared_mutex>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "base/skiplist.h"
+#include "base/slab_allocator.h"
 #include "base/slice.h"
 #include "proto/tablet.pb.h"
+#include "storage/cold_block.h"
+#include "storage/epoch.h"
+#include "storage/expire_wheel.h"
+#include "storage/gc_throttle.h"
 #include "storage/iterator.h"
 #include "storage/schema.h"
 #include "storage/ticket.h"
@@ -36,6 +44,7 @@ namespace storage {
 typedef google::protobuf::RepeatedPtrField<::openmldb::api::TSDimension> TSDimensions;
 
 using ::openmldb::base::Slice;
+using ::openmldb::base::SlabAllocator;
 
 class Segment;
 class Ticket;
@@ -43,16 +52,22 @@ class Ticket;
 struct DataBlock {
     // dimension count down
     uint8_t dim_cnt_down;
+    // the block is carved out of a slab, see NewDataBlock
+    bool in_slab;
+    // the row is spilled to the disk tier by the first inner index while other indexes still refer to it,
+    // it's not counted as a row in memory any more
+    bool spilled;
     uint32_t size;
     char* data;
 
-    DataBlock(uint8_t dim_cnt, const char* input, uint32_t len) : dim_cnt_down(dim_cnt), size(len), data(NULL) {
+    DataBlock(uint8_t dim_cnt, const char* input, uint32_t len)
+        : dim_cnt_down(dim_cnt), in_slab(false), spilled(false), size(len), data(NULL) {
         data = new char[len];
         memcpy(data, input, len);
     }
 
     DataBlock(uint8_t dim_cnt, char* input, uint32_t len, bool skip_copy)
-        : dim_cnt_down(dim_cnt), size(len), data(NULL) {
+        : dim_cnt_down(dim_cnt), in_slab(false), spilled(false), size(len), data(NULL) {
         if (skip_copy) {
             data = input;
         } else {
@@ -67,6 +82,36 @@ struct DataBlock {
     }
 };
 
+// The block and the row are allocated in one slab block, which is prefixed with the owner slab.
+// So the segments of other indexes which share the block can free it
+static inline uint32_t GetSlabDataBlockSize(uint32_t len) {
+    return sizeof(SlabAllocator*) + sizeof(DataBlock) + len;
+}
+
+static inline DataBlock* NewDataBlock(SlabAllocator* slab, uint8_t dim_cnt, const char* input, uint32_t len) {
+    if (slab == nullptr) {
+        return new DataBlock(dim_cnt, input, len);
+    }
+    char* buf = static_cast<char*>(slab->Allocate(GetSlabDataBlockSize(len)));
+    *reinterpret_cast<SlabAllocator**>(buf) = slab;
+    char* data = buf + sizeof(SlabAllocator*) + sizeof(DataBlock);
+    memcpy(data, input, len);
+    auto* block = new (buf + sizeof(SlabAllocator*)) DataBlock(dim_cnt, data, len, true);
+    block->in_slab = true;
+    return block;
+}
+
+static inline void FreeDataBlock(DataBlock* block) {
+    if (!block->in_slab) {
+        delete block;
+        return;
+    }
+    char* buf = reinterpret_cast<char*>(block) - sizeof(SlabAllocator*);
+    SlabAllocator* slab = *reinterpret_cast<SlabAllocator**>(buf);
+    // the data is inlined, so the destructor is skipped
+    slab->Free(buf, GetSlabDataBlockSize(block->size));
+}
+
 // the desc time comparator
 struct TimeComparator {
     int operator()(const uint64_t& a, const uint64_t& b) const {
@@ -80,32 +125,20 @@ struct TimeComparator {
 };
 
 static const TimeComparator tcmp;
-typedef ::openmldb::base::Skiplist<uint64_t, DataBlock*, TimeComparator> TimeEntries;
-
-class MemTableIterator : public TableIterator {
- public:
-    explicit MemTableIterator(TimeEntries::Iterator* it);
-    virtual ~MemTableIterator();
-    void Seek(const uint64_t time) override;
-    bool Valid() override;
-    void Next() override;
-    openmldb::base::Slice GetValue() const override;
-    uint64_t GetKey() const override;
-    void SeekToFirst() override;
-    void SeekToLast() override;
-
- private:
-    TimeEntries::Iterator* it_;
-};
+// the time and key lists use the node with inlined next pointers to save a cache miss per hop
+typedef ::openmldb::base::InlineNode<uint64_t, DataBlock*> TimeEntryNode;
+typedef ::openmldb::base::Skiplist<uint64_t, DataBlock*, TimeComparator, TimeEntryNode> TimeEntries;
 
 class KeyEntry {
  public:
-    KeyEntry() : entries(12, 4, tcmp), refs_(0), count_(0) {}
-    explicit KeyEntry(uint8_t height) : entries(height, 4, tcmp), refs_(0), count_(0) {}
+    KeyEntry() : entries(12, 4, tcmp), count_(0), cold_(NULL), expire_bucket_(UINT32_MAX), wheel_ref_(0) {}
+    explicit KeyEntry(uint8_t height)
+        : entries(height, 4, tcmp), count_(0), cold_(NULL), expire_bucket_(UINT32_MAX), wheel_ref_(0) {}
     ~KeyEntry() {}
 
     // just return the count of datablock
-    uint64_t Release() {
+    // the slab must be the one used to insert the time entries
+    uint64_t Release(SlabAllocator* slab = nullptr) {
         uint64_t cnt = 0;
         TimeEntries::Iterator* it = entries.NewIterator();
         it->SeekToFirst();
@@ -116,34 +149,110 @@ class KeyEntry {
             if (block->dim_cnt_down > 1) {
                 block->dim_cnt_down--;
             } else {
-                delete block;
+                FreeDataBlock(block);
             }
             it->Next();
         }
-        entries.Clear();
+        entries.Clear(slab);
         delete it;
+        ColdBlock* cold = cold_.exchange(NULL, std::memory_order_relaxed);
+        while (cold != NULL) {
+            ColdBlock* tmp = cold;
+            cold = cold->GetNext();
+            cnt += tmp->GetCount();
+            delete tmp;
+        }
         return cnt;
     }
 
-    void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t GetCount() { return count_.load(std::memory_order_relaxed); }
 
-    void UnRef() { refs_.fetch_sub(1, std::memory_order_relaxed); }
+    // the newest cold block, the older ones are chained after it
+    ColdBlock* GetColdBlock() { return cold_.load(std::memory_order_acquire); }
 
-    uint64_t GetCount() { return count_.load(std::memory_order_relaxed); }
+    bool IsEmpty() { return entries.IsEmpty() && GetColdBlock() == NULL; }
+
+    // Iterator merges the time entries and the cold blocks in time desc order
+    class Iterator {
+     public:
+        explicit Iterator(KeyEntry* entry);
+        ~Iterator();
+
+        bool Valid() const { return is_cold_ || hot_->Valid(); }
+
+        void Next();
+
+        const uint64_t& GetKey() const { return is_cold_ ? cold_.GetKey() : hot_->GetKey(); }
+
+        Slice GetValue() const;
+
+        // the count of lists which have the row, a cold row is only in one list
+        uint32_t GetRefCnt() const { return is_cold_ ? 1 : hot_->GetValue()->dim_cnt_down; }
+
+        void Seek(const uint64_t& time);
+
+        void SeekToFirst();
+
+        void SeekToLast();
+
+     private:
+        void Pick();
+
+     private:
+        TimeEntries::Iterator* hot_;
+        ColdBlock::Iterator cold_;
+        bool is_cold_;
+    };
+
+    // delete the iterator after it's used
+    Iterator* NewIterator() { return new Iterator(this); }
 
  public:
     TimeEntries entries;
-    std::atomic<uint64_t> refs_;
     std::atomic<uint64_t> count_;
+    // only the gc thread changes it
+    std::atomic<ColdBlock*> cold_;
+    // the oldest bucket of the expire wheel the key is added to, UINT32_MAX if it's not in the wheel.
+    // a bucket of minutes fits in 32 bits, so it shares 8 bytes with wheel_ref_
+    std::atomic<uint32_t> expire_bucket_;
+    // the count of handles of the key in the expire wheel, the high bit is set once the segment frees the key.
+    // the key is deleted by the last one of them
+    std::atomic<uint32_t> wheel_ref_;
     friend Segment;
 };
 
+class MemTableIterator : public TableIterator {
+ public:
+    explicit MemTableIterator(KeyEntry::Iterator* it);
+    virtual ~MemTableIterator();
+    void Seek(const uint64_t time) override;
+    bool Valid() override;
+    void Next() override;
+    openmldb::base::Slice GetValue() const override;
+    uint64_t GetKey() const override;
+    void SeekToFirst() override;
+    void SeekToLast() override;
+
+ private:
+    KeyEntry::Iterator* it_;
+};
+
 struct SliceComparator {
     int operator()(const ::openmldb::base::Slice& a, const ::openmldb::base::Slice& b) const { return a.compare(b); }
 };
 
-typedef ::openmldb::base::Skiplist<::openmldb::base::Slice, void*, SliceComparator> KeyEntries;
-typedef ::openmldb::base::Skiplist<uint64_t, ::openmldb::base::Node<Slice, void*>*, TimeComparator> KeyEntryNodeList;
+typedef ::openmldb::base::InlineNode<Slice, void*> KeyEntryNode;
+typedef ::openmldb::base::Skiplist<::openmldb::base::Slice, void*, SliceComparator, KeyEntryNode> KeyEntries;
+typedef ::openmldb::base::Skiplist<uint64_t, KeyEntryNode*, TimeComparator> KeyEntryNodeList;
+// the wheel holds the key entry nodes, a node gives both the key and its entry
+typedef ExpireWheel<KeyEntryNode> KeyExpireWheel;
+
+// the disk tier keeps one row per key and ts, so a key is kept in memory if the rows can not be told apart there
+enum class SpillStatus { kSpilled = 0, kKept, kFailed };
+
+// it writes the rows of a key to the disk tier
+typedef std::function<SpillStatus(const Slice& key, const std::vector<std::pair<uint64_t, Slice>>& rows)>
+    SpillWriter;
 
 class Segment {
  public:
@@ -157,13 +266,19 @@ class Segment {
 
     void Put(const Slice& key, uint64_t time, DataBlock* row);
 
+    // the caller should hold mu_ shared at least
     void PutUnlock(const Slice& key, uint64_t time, DataBlock* row);
 
     void BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t time, DataBlock* row);
 
+    // append the rows of a key at the end of its time list, the rows are in time desc order. It's used to
+    // build the segment from a memory image and must not run along with other writers
+    void Append(const Slice& key, uint32_t key_entry_id, std::vector<std::pair<uint64_t, DataBlock*>>& rows);  // NOLINT
+
     void Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, DataBlock* row);
 
-    // Get time data
+    // Get time data, the rows in cold blocks are not visible. The caller should hold an epoch guard
+    // to read the block
     bool Get(const Slice& key, uint64_t time, DataBlock** block);
 
     bool Get(const Slice& key, uint32_t idx, uint64_t time, DataBlock** block);
@@ -194,6 +309,19 @@ class Segment {
     void GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt,  // NOLINT
                    uint64_t& gc_record_cnt,                                            // NOLINT
                    uint64_t& gc_record_byte_size);                                     // NOLINT
+    // Freeze the rows not newer than time into cold blocks. It works only if ts_cnt is 1 and runs in the gc thread.
+    // freeze_byte_size is the byte size of data blocks freed
+    void FreezeCold(const uint64_t time, uint64_t& freeze_cnt,  // NOLINT
+                    uint64_t& freeze_byte_size);                // NOLINT
+    // Spill the rows not newer than time to the disk tier by writer, then drop them from memory. A cold block is
+    // spilled only if all its rows are not newer than time. It works only if ts_cnt is 1 and runs in the gc thread.
+    // A key with rows of the same ts is not spilled, neither is the one the writer keeps.
+    // spill_record_cnt is the count of rows which are not counted in memory any more, a row shared by other
+    // indexes is counted once it's spilled by the segment of the first inner index, which is set by is_first.
+    // spill_byte_size is the byte size of data blocks freed
+    void Spill(const uint64_t time, const SpillWriter& writer, bool is_first, uint64_t& spill_cnt,  // NOLINT
+               uint64_t& spill_record_cnt, uint64_t& spill_byte_size);                           // NOLINT
+    // the iterator is valid while the ticket is alive
     MemTableIterator* NewIterator(const Slice& key, Ticket& ticket);                   // NOLINT
     MemTableIterator* NewIterator(const Slice& key, uint32_t idx,
                                   Ticket& ticket);  // NOLINT
@@ -245,23 +373,65 @@ class Segment {
                          uint64_t& gc_record_cnt,         // NOLINT
                          uint64_t& gc_record_byte_size);  // NOLINT
 
+    // return NULL if slab allocator is disabled
+    SlabAllocator* GetSlab() { return slab_; }
+
+    // return NULL if enable_gc_expire_index is not set or the segment has more than one ts
+    KeyExpireWheel* GetExpireWheel() { return wheel_; }
+
  private:
-    void FreeList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,  // NOLINT
-                  uint64_t& gc_record_cnt,         // NOLINT
-                  uint64_t& gc_record_byte_size);  // NOLINT
-    void SplitList(KeyEntry* entry, uint64_t ts, ::openmldb::base::Node<uint64_t, DataBlock*>** node);
+    // a row spilled before is not counted in gc_record_cnt again. The shared rows are marked spilled and
+    // counted if mark_spilled is set
+    void FreeList(TimeEntryNode* node, uint64_t& gc_idx_cnt,  // NOLINT
+                  uint64_t& gc_record_cnt,                    // NOLINT
+                  uint64_t& gc_record_byte_size,              // NOLINT
+                  bool mark_spilled = false);
+    void SplitList(KeyEntry* entry, uint64_t ts, TimeEntryNode** node);
+    // detach the cold blocks whose rows are all not newer than ts, a block is dropped only when it's expired entirely
+    void SplitCold(KeyEntry* entry, uint64_t ts, ColdBlock** block);
+    void FreeColdList(ColdBlock* block, uint64_t& gc_idx_cnt,  // NOLINT
+                      uint64_t& gc_record_cnt);                // NOLINT
+    // gc the rows of a key not newer than time, return true if the key is removed
+    bool GcEntry4TTL(KeyEntry* entry, const Slice& key, const uint64_t time,
+                     uint64_t& gc_idx_cnt,            // NOLINT
+                     uint64_t& gc_record_cnt,         // NOLINT
+                     uint64_t& gc_record_byte_size);  // NOLINT
+    // Gc4TTL by the keys in the expired buckets of the wheel
+    void Gc4TTLByWheel(const uint64_t time, uint64_t& gc_idx_cnt,  // NOLINT
+                       uint64_t& gc_record_cnt,                    // NOLINT
+                       uint64_t& gc_record_byte_size);             // NOLINT
+    // add the key to the wheel if the bucket of time is older than the one it's in
+    void AddExpire(KeyEntry* entry, const Slice& key, uint64_t time);
+    // add the key to the wheel by its oldest row again
+    void ResetExpire(KeyEntry* entry, const Slice& key);
+    // the wheel is stale once the index is not gc by absolute time, it's built again by a full scan
+    void DisableExpireWheel();
+    // take out all the handles of the wheel and drop them
+    void ClearExpireWheel();
+    // drop a handle popped from the wheel, the key is deleted if the segment has freed it
+    void UnrefExpire(KeyEntryNode* entry_node);
+    // delete the key, the key entries and the node
+    void DeleteEntryNode(KeyEntryNode* entry_node);
+
+    // hand the memory freed by gc to the epoch manager, it's called at the end of every gc
+    void RetireFreed();
+    void FreeRetired(std::vector<TimeEntryNode*>* lists, std::vector<DataBlock*>* blocks,
+                     std::vector<ColdBlock*>* cold_blocks, std::vector<KeyEntryNode*>* entry_nodes);
 
     void GcEntryFreeList(uint64_t version, uint64_t& gc_idx_cnt,  // NOLINT
                          uint64_t& gc_record_cnt,                 // NOLINT
                          uint64_t& gc_record_byte_size);          // NOLINT
-    void FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64_t& gc_idx_cnt,  // NOLINT
-                   uint64_t& gc_record_cnt,         // NOLINT
-                   uint64_t& gc_record_byte_size);  // NOLINT
+    void FreeEntry(KeyEntryNode* entry_node, uint64_t& gc_idx_cnt,  // NOLINT
+                   uint64_t& gc_record_cnt,                         // NOLINT
+                   uint64_t& gc_record_byte_size);                  // NOLINT
+    // return the entry of key, it's created if not exist. byte_size is increased by the pk index size
+    // if this writer creates it
+    void* GetOrCreateEntry(const Slice& key, uint32_t& byte_size);  // NOLINT
 
  private:
     KeyEntries* entries_;
-    // only Put need mutex
-    std::mutex mu_;
+    // Put shares it and inserts with CAS, the lists are only removed or split under the exclusive lock
+    std::shared_mutex mu_;
     std::mutex gc_mu_;
     std::atomic<uint64_t> idx_cnt_;
     std::atomic<uint64_t> idx_byte_size_;
@@ -273,6 +443,18 @@ class Segment {
     std::map<uint32_t, uint32_t> ts_idx_map_;
     std::vector<std::shared_ptr<std::atomic<uint64_t>>> idx_cnt_vec_;
     uint64_t ttl_offset_;
+    // nodes and rows are carved out of it if enable_slab_allocator is set
+    SlabAllocator* slab_;
+    KeyExpireWheel* wheel_;
+    // puts add keys to the wheel only if it's set, the first Gc4TTL sets it and adds all keys by a full scan
+    std::atomic<bool> wheel_active_;
+    // the gc loops yield to it once per key
+    GcThrottle gc_throttle_;
+    // the memory unlinked by the running gc, they are only touched by the gc thread
+    std::vector<TimeEntryNode*> freed_lists_;
+    std::vector<DataBlock*> freed_blocks_;
+    std::vector<ColdBlock*> freed_cold_blocks_;
+    std::vector<KeyEntryNode*> freed_entry_nodes_;
 };
 
 }  // namespace storage
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/slice.h"
+#include "benchmark/benchmark.h"
+#include "gflags/gflags.h"
+#include "storage/segment.h"
+
+DECLARE_bool(enable_slab_allocator);
+
+namespace openmldb {
+namespace storage {
+
+using ::openmldb::base::Slice;
+
+// all threads put into one segment
+static Segment* segment = nullptr;
+
+// range(0) is the pk count, the fewer pks the hotter they are. range(1) enables slab allocator
+static void BM_SegmentPut(benchmark::State& state) {  // NOLINT
+    if (state.thread_index == 0) {
+        FLAGS_enable_slab_allocator = state.range(1) > 0;
+        segment = new Segment(8);
+    }
+    uint64_t pk_num = state.range(0);
+    std::vector<std::string> pks;
+    for (uint64_t i = 0; i < pk_num; i++) {
+        pks.push_back("pk" + std::to_string(i));
+    }
+    std::string value(128, 'v');
+    uint64_t ts = state.thread_index;
+    uint64_t idx = state.thread_index;
+    for (auto _ : state) {
+        segment->Put(Slice(pks[idx % pk_num]), ts, value.c_str(), value.size());
+        idx++;
+        ts += state.threads;
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index == 0) {
+        segment->Release();
+        delete segment;
+        segment = nullptr;
+        FLAGS_enable_slab_allocator = false;
+    }
+}
+
+// ts_cnt is larger than 1, every row is put into two time lists of one pk
+static void BM_SegmentPutMultiTs(benchmark::State& state) {  // NOLINT
+    if (state.thread_index == 0) {
+        segment = new Segment(8, {1, 2});
+    }
+    uint64_t pk_num = state.range(0);
+    std::vector<std::string> pks;
+    for (uint64_t i = 0; i < pk_num; i++) {
+        pks.push_back("pk" + std::to_string(i));
+    }
+    std::string value(128, 'v');
+    uint64_t ts = state.thread_index;
+    uint64_t idx = state.thread_index;
+    for (auto _ : state) {
+        DataBlock* row = new DataBlock(2, value.c_str(), value.size());
+        std::map<int32_t, uint64_t> ts_map = {{1, ts}, {2, ts}};
+        segment->Put(Slice(pks[idx % pk_num]), ts_map, row);
+        idx++;
+        ts += state.threads;
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index == 0) {
+        segment->Release();
+        delete segment;
+        segment = nullptr;
+    }
+}
+
+BENCHMARK(BM_SegmentPut)
+    ->Args({1, 0})
+    ->Args({16, 0})
+    ->Args({1024, 0})
+    ->Args({1, 1})
+    ->Args({16, 1})
+    ->Args({1024, 1})
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+BENCHMARK(BM_SegmentPutMultiTs)->Arg(1)->Arg(1024)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace storage
+}  // namespace openmldb
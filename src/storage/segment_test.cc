@@ -16,16 +16,24 @@
 
 #include "storage/segment.h"
 
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/slice.h"
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "storage/record.h"
 
 using ::openmldb::base::Slice;
 
+DECLARE_bool(enable_slab_allocator);
+DECLARE_bool(enable_gc_expire_index);
+
 namespace openmldb {
 namespace storage {
 
@@ -37,7 +45,7 @@ class SegmentTest : public ::testing::Test {
 
 TEST_F(SegmentTest, Size) {
     ASSERT_EQ(16, (int64_t)sizeof(DataBlock));
-    ASSERT_EQ(40, (int64_t)sizeof(KeyEntry));
+    ASSERT_EQ(48, (int64_t)sizeof(KeyEntry));
 }
 
 TEST_F(SegmentTest, DataBlock) {
@@ -407,6 +415,496 @@ TEST_F(SegmentTest, PutAndGetTS) {
     ASSERT_EQ(e, t);
 }
 
+TEST_F(SegmentTest, SlabAllocator) {
+    FLAGS_enable_slab_allocator = true;
+    Segment segment(8);
+    FLAGS_enable_slab_allocator = false;
+    ASSERT_TRUE(segment.GetSlab() != NULL);
+    for (int i = 0; i < 100; i++) {
+        std::string pk = "pk" + std::to_string(i);
+        for (int j = 0; j < 10; j++) {
+            std::string value = "value" + std::to_string(j);
+            segment.Put(Slice(pk), 9760 + j, value.c_str(), value.size());
+        }
+    }
+    ASSERT_EQ(100, (int64_t)segment.GetPkCnt());
+    ASSERT_EQ(1000, (int64_t)segment.GetIdxCnt());
+    uint64_t used_size = segment.GetSlab()->GetUsedByteSize();
+    ASSERT_GT(used_size, 0u);
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.Gc4TTL(9764, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(500, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(500, (int64_t)gc_record_cnt);
+    // the nodes are freed to the slab once no reader can see them
+    EpochManager::Default()->Reclaim();
+    ASSERT_LT(segment.GetSlab()->GetUsedByteSize(), used_size);
+    Ticket ticket;
+    MemTableIterator* it = segment.NewIterator("pk10", ticket);
+    it->SeekToFirst();
+    int cnt = 0;
+    while (it->Valid()) {
+        std::string value(it->GetValue().data(), it->GetValue().size());
+        ASSERT_EQ("value" + std::to_string(9 - cnt), value);
+        it->Next();
+        cnt++;
+    }
+    ASSERT_EQ(5, cnt);
+    delete it;
+    ASSERT_TRUE(segment.Delete("pk10"));
+    for (int i = 0; i < 3; i++) {
+        segment.IncrGcVersion();
+        segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    }
+    ASSERT_EQ(505, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(99, (int64_t)segment.GetPkCnt());
+    segment.Release();
+}
+
+TEST_F(SegmentTest, ExpireWheel) {
+    FLAGS_enable_gc_expire_index = true;
+    Segment segment(8);
+    FLAGS_enable_gc_expire_index = false;
+    KeyExpireWheel* wheel = segment.GetExpireWheel();
+    ASSERT_TRUE(wheel != NULL);
+    // the rows of pk i are in the i-th minute
+    uint64_t base = 1650000000000;
+    for (int i = 0; i < 100; i++) {
+        std::string pk = "pk" + std::to_string(i);
+        for (int j = 0; j < 10; j++) {
+            std::string value = "value" + std::to_string(j);
+            segment.Put(Slice(pk), base + i * 60000 + j, value.c_str(), value.size());
+        }
+    }
+    // the keys are not added until the first gc
+    ASSERT_EQ(0, (int64_t)wheel->GetKeyCnt());
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.Gc4TTL(base + 4, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(5, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(100, (int64_t)wheel->GetKeyCnt());
+    // a put older than the rows of the key adds it again
+    segment.Put(Slice("pk50"), base - 1, "old", 3);
+    segment.Put(Slice("pk50"), base + 99 * 60000, "new", 3);
+    segment.Put(Slice("pk200"), base + 60000, "new", 3);
+    ASSERT_EQ(102, (int64_t)wheel->GetKeyCnt());
+    segment.Gc4TTL(base + 2 * 60000 + 9, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(5 + 5 + 10 + 10 + 1 + 1, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(gc_idx_cnt, gc_record_cnt);
+    // pk50 is added by its oldest row again, the stale one in its old bucket is skipped later
+    ASSERT_EQ(98, (int64_t)wheel->GetKeyCnt());
+    ASSERT_EQ(1000 + 3 - gc_idx_cnt, segment.GetIdxCnt());
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount("pk50", count));
+    ASSERT_EQ(11, (int64_t)count);
+    ASSERT_EQ(-1, segment.GetCount("pk1", count));
+    // the deleted key is skipped
+    ASSERT_TRUE(segment.Delete("pk3"));
+    segment.Gc4TTL(base + 3 * 60000 + 9, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(32, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(97, (int64_t)wheel->GetKeyCnt());
+    // the key read is gc, and the rows seen are kept until the ticket is released
+    {
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator("pk4", ticket);
+        it->SeekToFirst();
+        ASSERT_TRUE(it->Valid());
+        uint64_t ts = it->GetKey();
+        std::string value = it->GetValue().ToString();
+        segment.Gc4TTL(base + 4 * 60000 + 9, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        ASSERT_EQ(42, (int64_t)gc_idx_cnt);
+        ASSERT_EQ(96, (int64_t)wheel->GetKeyCnt());
+        EpochManager::Default()->Reclaim();
+        ASSERT_EQ(ts, it->GetKey());
+        ASSERT_EQ(value, it->GetValue().ToString());
+        delete it;
+    }
+    segment.Gc4TTL(base + 4 * 60000 + 9, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(42, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(96, (int64_t)wheel->GetKeyCnt());
+    // the wheel is dropped by the gc of latest ttl and built again by the next Gc4TTL
+    TTLSt ttl_st(0, 20, ::openmldb::storage::kLatestTime);
+    segment.ExecuteGc(ttl_st, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(0, (int64_t)wheel->GetKeyCnt());
+    segment.Put(Slice("pk10"), base, "old", 3);
+    segment.Gc4TTL(base + 5 * 60000 + 9, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(53, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(94, (int64_t)wheel->GetKeyCnt());
+    // a deleted key is freed by the segment, its node is kept until the wheel drops it
+    ASSERT_TRUE(segment.Delete("pk90"));
+    for (int i = 0; i < 2; i++) {
+        segment.IncrGcVersion();
+        segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        EpochManager::Default()->Reclaim();
+    }
+    // the rows of pk3 deleted before are freed too
+    ASSERT_EQ(73, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(94, (int64_t)wheel->GetKeyCnt());
+    segment.Gc4TTL(base + 90 * 60000 + 9, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(10, (int64_t)wheel->GetKeyCnt());
+    ASSERT_EQ(-1, segment.GetCount("pk90", count));
+    segment.Release();
+    ASSERT_EQ(0, (int64_t)wheel->GetKeyCnt());
+}
+
+TEST_F(SegmentTest, ConcurrentPut) {
+    Segment segment(8);
+    int thread_num = 8;
+    int pk_num = 10;
+    int ts_num = 1000;
+    uint64_t base_ts = 1000;
+    // the expired records are removed while puts are going on, the newest one keeps the pk alive
+    for (int j = 0; j < pk_num; j++) {
+        std::string pk = "pk" + std::to_string(j);
+        for (uint64_t ts = 1; ts <= 100; ts++) {
+            segment.Put(Slice(pk), ts, "expired", 7);
+        }
+        std::string value = "value" + std::to_string(ts_num);
+        segment.Put(Slice(pk), base_ts + ts_num, value.c_str(), value.size());
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; i++) {
+        threads.emplace_back([&segment, i, thread_num, pk_num, ts_num, base_ts] {
+            for (int ts = i; ts < ts_num; ts += thread_num) {
+                for (int j = 0; j < pk_num; j++) {
+                    std::string pk = "pk" + std::to_string(j);
+                    std::string value = "value" + std::to_string(ts);
+                    segment.Put(Slice(pk), base_ts + ts, value.c_str(), value.size());
+                }
+            }
+        });
+    }
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    for (int i = 0; i < 10; i++) {
+        segment.Gc4TTL(100, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(pk_num * 100, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(pk_num, (int64_t)segment.GetPkCnt());
+    ASSERT_EQ(pk_num * (ts_num + 1), (int64_t)segment.GetIdxCnt());
+    for (int j = 0; j < pk_num; j++) {
+        std::string pk = "pk" + std::to_string(j);
+        uint64_t count = 0;
+        ASSERT_EQ(0, segment.GetCount(pk, count));
+        ASSERT_EQ(ts_num + 1, (int64_t)count);
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator(pk, ticket);
+        it->SeekToFirst();
+        int cnt = 0;
+        while (it->Valid()) {
+            ASSERT_EQ(base_ts + ts_num - cnt, it->GetKey());
+            std::string value(it->GetValue().data(), it->GetValue().size());
+            ASSERT_EQ("value" + std::to_string(ts_num - cnt), value);
+            it->Next();
+            cnt++;
+        }
+        ASSERT_EQ(ts_num + 1, cnt);
+        delete it;
+    }
+    segment.Release();
+}
+
+TEST_F(SegmentTest, FreezeCold) {
+    Segment segment;
+    Slice pk("pk");
+    for (uint64_t ts = 1; ts <= 100; ts++) {
+        std::string value = "value" + std::to_string(ts);
+        segment.Put(pk, ts, value.c_str(), value.size());
+    }
+    uint64_t freeze_cnt = 0;
+    uint64_t freeze_byte_size = 0;
+    segment.FreezeCold(50, freeze_cnt, freeze_byte_size);
+    ASSERT_EQ(50, (int64_t)freeze_cnt);
+    ASSERT_GE(freeze_byte_size, 50 * GetRecordSize(6));
+    // an old row comes after freezing, it is merged into the block next time
+    segment.Put(pk, 40, "hot40", 5);
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount(pk, count));
+    ASSERT_EQ(101, (int64_t)count);
+    auto check = [&segment, &pk](int expect_cnt) {
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator(pk, ticket);
+        it->SeekToFirst();
+        int cnt = 0;
+        uint64_t last = UINT64_MAX;
+        while (it->Valid()) {
+            ASSERT_LE(it->GetKey(), last);
+            std::string value = it->GetValue().ToString();
+            if (it->GetKey() == last) {
+                ASSERT_EQ("value40", value);
+            } else if (value != "hot40") {
+                ASSERT_EQ("value" + std::to_string(it->GetKey()), value);
+            }
+            last = it->GetKey();
+            it->Next();
+            cnt++;
+        }
+        ASSERT_EQ(expect_cnt, cnt);
+        delete it;
+    };
+    check(101);
+    {
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator(pk, ticket);
+        it->Seek(40);
+        ASSERT_EQ(40, (int64_t)it->GetKey());
+        ASSERT_EQ("hot40", it->GetValue().ToString());
+        it->Next();
+        ASSERT_EQ(40, (int64_t)it->GetKey());
+        ASSERT_EQ("value40", it->GetValue().ToString());
+        it->SeekToLast();
+        ASSERT_EQ(1, (int64_t)it->GetKey());
+        // the entry is frozen while it is read, the rows seen are kept until the ticket is released
+        it->Seek(55);
+        segment.FreezeCold(60, freeze_cnt, freeze_byte_size);
+        ASSERT_EQ(61, (int64_t)freeze_cnt);
+        EpochManager::Default()->Reclaim();
+        ASSERT_EQ(55, (int64_t)it->GetKey());
+        ASSERT_EQ("value55", it->GetValue().ToString());
+        it->Next();
+        ASSERT_EQ(54, (int64_t)it->GetKey());
+        ASSERT_EQ("value54", it->GetValue().ToString());
+        delete it;
+    }
+    segment.FreezeCold(60, freeze_cnt, freeze_byte_size);
+    ASSERT_EQ(61, (int64_t)freeze_cnt);
+    check(101);
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    // the block expires as a whole
+    segment.Gc4TTL(59, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(0, (int64_t)gc_idx_cnt);
+    segment.Gc4TTL(60, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(61, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(61, (int64_t)gc_record_cnt);
+    ASSERT_EQ(0, segment.GetCount(pk, count));
+    ASSERT_EQ(40, (int64_t)count);
+    check(40);
+    segment.FreezeCold(100, freeze_cnt, freeze_byte_size);
+    ASSERT_EQ(101, (int64_t)freeze_cnt);
+    check(40);
+    segment.Gc4TTL(100, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(101, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(101, (int64_t)gc_record_cnt);
+    ASSERT_EQ(-1, segment.GetCount(pk, count));
+    segment.IncrGcVersion();
+    segment.IncrGcVersion();
+    segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(0, (int64_t)segment.GetPkCnt());
+}
+
+TEST_F(SegmentTest, FreezeColdSharedRow) {
+    Segment segment1;
+    Segment segment2;
+    Slice pk("pk");
+    for (uint64_t ts = 1; ts <= 20; ts++) {
+        std::string value = "value" + std::to_string(ts);
+        if (ts == 10) {
+            // the row is referred by both indexes
+            DataBlock* row = new DataBlock(2, value.c_str(), value.size());
+            segment1.Put(pk, ts, row);
+            segment2.Put(pk, ts, row);
+        } else {
+            segment1.Put(pk, ts, new DataBlock(1, value.c_str(), value.size()));
+            segment2.Put(pk, ts, new DataBlock(1, value.c_str(), value.size()));
+        }
+    }
+    uint64_t freeze_cnt = 0;
+    uint64_t freeze_byte_size = 0;
+    // the shared row and the newer ones are not frozen
+    segment1.FreezeCold(15, freeze_cnt, freeze_byte_size);
+    ASSERT_EQ(9, (int64_t)freeze_cnt);
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment2.Gc4TTL(10, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(10, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(9, (int64_t)gc_record_cnt);
+    // the row is only referred by segment1 now
+    segment1.FreezeCold(15, freeze_cnt, freeze_byte_size);
+    ASSERT_EQ(15, (int64_t)freeze_cnt);
+    EpochManager::Default()->Reclaim();
+    Ticket ticket;
+    MemTableIterator* it = segment1.NewIterator(pk, ticket);
+    it->Seek(10);
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(10, (int64_t)it->GetKey());
+    ASSERT_EQ("value10", it->GetValue().ToString());
+    int cnt = 0;
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        cnt++;
+    }
+    ASSERT_EQ(20, cnt);
+    delete it;
+}
+
+TEST_F(SegmentTest, Spill) {
+    Segment segment;
+    Slice pk1("pk1");
+    Slice pk2("pk2");
+    for (uint64_t ts = 1; ts <= 100; ts++) {
+        std::string value = "value" + std::to_string(ts);
+        segment.Put(pk1, ts, value.c_str(), value.size());
+        if (ts <= 30) {
+            segment.Put(pk2, ts, value.c_str(), value.size());
+        }
+    }
+    uint64_t freeze_cnt = 0;
+    uint64_t freeze_byte_size = 0;
+    segment.FreezeCold(20, freeze_cnt, freeze_byte_size);
+    ASSERT_EQ(40, (int64_t)freeze_cnt);
+    std::map<std::string, std::map<uint64_t, std::string>> tier;
+    bool fail = false;
+    SpillWriter writer = [&tier, &fail](const Slice& key, const std::vector<std::pair<uint64_t, Slice>>& rows) {
+        if (fail) {
+            return SpillStatus::kFailed;
+        }
+        for (const auto& row : rows) {
+            tier[key.ToString()][row.first] = row.second.ToString();
+        }
+        return SpillStatus::kSpilled;
+    };
+    uint64_t spill_cnt = 0;
+    uint64_t spill_record_cnt = 0;
+    uint64_t spill_byte_size = 0;
+    fail = true;
+    segment.Spill(50, writer, true, spill_cnt, spill_record_cnt, spill_byte_size);
+    ASSERT_EQ(0, (int64_t)spill_cnt);
+    fail = false;
+    segment.Spill(50, writer, true, spill_cnt, spill_record_cnt, spill_byte_size);
+    ASSERT_EQ(80, (int64_t)spill_cnt);
+    ASSERT_EQ(80, (int64_t)spill_record_cnt);
+    ASSERT_GE(spill_byte_size, 40 * GetRecordSize(7));
+    ASSERT_EQ(50u, tier["pk1"].size());
+    ASSERT_EQ(30u, tier["pk2"].size());
+    ASSERT_EQ("value1", tier["pk1"][1]);
+    ASSERT_EQ("value50", tier["pk1"][50]);
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount(pk1, count));
+    ASSERT_EQ(50, (int64_t)count);
+    // all rows of pk2 are spilled
+    ASSERT_EQ(-1, segment.GetCount(pk2, count));
+    Ticket ticket;
+    MemTableIterator* it = segment.NewIterator(pk1, ticket);
+    it->SeekToLast();
+    ASSERT_EQ(51, (int64_t)it->GetKey());
+    delete it;
+    segment.Spill(50, writer, true, spill_cnt, spill_record_cnt, spill_byte_size);
+    ASSERT_EQ(80, (int64_t)spill_cnt);
+    segment.IncrGcVersion();
+    segment.IncrGcVersion();
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(1, (int64_t)segment.GetPkCnt());
+}
+
+TEST_F(SegmentTest, SpillSharedRow) {
+    // the two segments are of two indexes which share the rows, the first one is of the first inner index
+    Segment first;
+    Segment second;
+    for (uint64_t ts = 1; ts <= 20; ts++) {
+        std::string value = "value" + std::to_string(ts);
+        DataBlock* block = NewDataBlock(nullptr, 2, value.c_str(), value.size());
+        first.Put(Slice("pk1"), ts, block);
+        second.Put(Slice("pk2"), ts, block);
+    }
+    SpillWriter writer = [](const Slice& key, const std::vector<std::pair<uint64_t, Slice>>& rows) {
+        return SpillStatus::kSpilled;
+    };
+    uint64_t spill_cnt = 0;
+    uint64_t spill_record_cnt = 0;
+    uint64_t spill_byte_size = 0;
+    // the rows spilled by the first inner index are not counted in memory though the other one refers to them
+    first.Spill(10, writer, true, spill_cnt, spill_record_cnt, spill_byte_size);
+    ASSERT_EQ(10, (int64_t)spill_cnt);
+    ASSERT_EQ(10, (int64_t)spill_record_cnt);
+    ASSERT_EQ(0, (int64_t)spill_byte_size);
+    // they are not counted again when they are freed
+    second.Spill(10, writer, false, spill_cnt, spill_record_cnt, spill_byte_size);
+    ASSERT_EQ(20, (int64_t)spill_cnt);
+    ASSERT_EQ(10, (int64_t)spill_record_cnt);
+    ASSERT_GT(spill_byte_size, 0u);
+    // the rows spilled by the other index are still counted in memory until the first one spills them
+    spill_byte_size = 0;
+    second.Spill(15, writer, false, spill_cnt, spill_record_cnt, spill_byte_size);
+    ASSERT_EQ(10, (int64_t)spill_record_cnt);
+    ASSERT_EQ(0, (int64_t)spill_byte_size);
+    first.Spill(15, writer, true, spill_cnt, spill_record_cnt, spill_byte_size);
+    ASSERT_EQ(30, (int64_t)spill_cnt);
+    ASSERT_EQ(15, (int64_t)spill_record_cnt);
+    ASSERT_GT(spill_byte_size, 0u);
+    first.Release();
+    second.Release();
+}
+
+TEST_F(SegmentTest, SpillDupTime) {
+    Segment segment;
+    for (uint64_t ts = 1; ts <= 10; ts++) {
+        std::string value = "value" + std::to_string(ts);
+        segment.Put(Slice("pk1"), ts, value.c_str(), value.size());
+        segment.Put(Slice("pk2"), ts, value.c_str(), value.size());
+        segment.Put(Slice("pk3"), ts, value.c_str(), value.size());
+    }
+    // pk1 has two rows of ts 5, the one put late is in the hot list while the other is frozen
+    uint64_t freeze_cnt = 0;
+    uint64_t freeze_byte_size = 0;
+    segment.FreezeCold(8, freeze_cnt, freeze_byte_size);
+    segment.Put(Slice("pk1"), 5, "dup5", 4);
+    std::map<std::string, std::map<uint64_t, std::string>> tier;
+    SpillWriter writer = [&tier](const Slice& key, const std::vector<std::pair<uint64_t, Slice>>& rows) {
+        // the writer keeps pk3 as if the tier has another row of its ts
+        if (key.ToString() == "pk3") {
+            return SpillStatus::kKept;
+        }
+        for (const auto& row : rows) {
+            EXPECT_TRUE(tier[key.ToString()].emplace(row.first, row.second.ToString()).second);
+        }
+        return SpillStatus::kSpilled;
+    };
+    uint64_t spill_cnt = 0;
+    uint64_t spill_record_cnt = 0;
+    uint64_t spill_byte_size = 0;
+    segment.Spill(8, writer, true, spill_cnt, spill_record_cnt, spill_byte_size);
+    ASSERT_EQ(8, (int64_t)spill_cnt);
+    ASSERT_EQ(0u, tier.count("pk1"));
+    ASSERT_EQ(0u, tier.count("pk3"));
+    ASSERT_EQ(8u, tier["pk2"].size());
+    // the kept keys are read back from memory with both rows of the same ts
+    for (const std::string& pk : {"pk1", "pk3"}) {
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator(Slice(pk), ticket);
+        std::vector<std::string> values;
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            if (it->GetKey() == 5) {
+                values.push_back(it->GetValue().ToString());
+            }
+        }
+        delete it;
+        if (pk == "pk1") {
+            ASSERT_EQ(2u, values.size());
+            ASSERT_TRUE(std::find(values.begin(), values.end(), "dup5") != values.end());
+            ASSERT_TRUE(std::find(values.begin(), values.end(), "value5") != values.end());
+        } else {
+            ASSERT_EQ(1u, values.size());
+        }
+    }
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount(Slice("pk1"), count));
+    ASSERT_EQ(11, (int64_t)count);
+    ASSERT_EQ(0, segment.GetCount(Slice("pk2"), count));
+    ASSERT_EQ(2, (int64_t)count);
+    segment.Release();
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
@@ -42,6 +42,7 @@
 
 DECLARE_string(db_root_path);
 DECLARE_string(snapshot_compression);
+DECLARE_uint32(load_table_read_thread_num);
 
 using ::openmldb::api::LogEntry;
 namespace openmldb {
@@ -1575,6 +1576,235 @@ TEST_F(SnapshotTest, MakeSnapshotWithEndOffset) {
     ASSERT_EQ(7, (int64_t)manifest.term());
 }
 
+TEST_F(SnapshotTest, RecoverFromImage) {
+    std::string snapshot_dir = FLAGS_db_root_path + "/11_0/snapshot/";
+    std::string binlog_dir = FLAGS_db_root_path + "/11_0/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, binlog_dir, binlog_index, offset);
+    auto write_entries = [&](const std::string& key, int start, int end) {
+        for (int i = start; i < end; i++) {
+            offset++;
+            auto entry = ::openmldb::test::PackKVEntry(offset, key, "value" + std::to_string(i), i, 0);
+            std::string buffer;
+            entry.SerializeToString(&buffer);
+            ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+        }
+        wh->Sync();
+    };
+    write_entries("key", 0, 10);
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 11, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    MemTableSnapshot snapshot(11, 0, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    Binlog binlog(log_part, binlog_dir);
+    uint64_t latest_offset = 0;
+    ASSERT_TRUE(binlog.RecoverFromBinlog(table, 0, latest_offset));
+    uint64_t offset_value = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ASSERT_EQ(10u, offset_value);
+    // the rows after the snapshot are in both the image and the binlog
+    write_entries("key2", 10, 15);
+    ASSERT_TRUE(binlog.RecoverFromBinlog(table, 10, latest_offset));
+    ASSERT_EQ(15u, table->GetRecordCnt());
+    ASSERT_EQ(0, snapshot.MakeImage(table, [&offset] { return offset; }));
+    ASSERT_TRUE(::openmldb::base::IsExists(snapshot_dir + "table.img"));
+    write_entries("key3", 15, 18);
+    // the same row is put again after the end offset, so it's not skipped
+    write_entries("key", 9, 10);
+
+    auto check_table = [](std::shared_ptr<MemTable> table) {
+        ASSERT_EQ(19u, table->GetRecordCnt());
+        Ticket ticket;
+        std::unique_ptr<TableIterator> it(table->NewIterator("key", ticket));
+        it->SeekToFirst();
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(9u, it->GetKey());
+        it->Next();
+        for (int i = 9; i >= 0; i--) {
+            ASSERT_TRUE(it->Valid());
+            ASSERT_EQ(static_cast<uint64_t>(i), it->GetKey());
+            std::string value(it->GetValue().data(), it->GetValue().size());
+            ASSERT_EQ("value" + std::to_string(i), ::openmldb::test::DecodeV(value));
+            it->Next();
+        }
+        ASSERT_FALSE(it->Valid());
+        it.reset(table->NewIterator("key2", ticket));
+        it->SeekToFirst();
+        int cnt = 0;
+        while (it->Valid()) {
+            cnt++;
+            it->Next();
+        }
+        ASSERT_EQ(5, cnt);
+    };
+    std::shared_ptr<MemTable> table1 =
+        std::make_shared<MemTable>("test", 11, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table1->Init();
+    MemTableSnapshot snapshot1(11, 0, log_part, FLAGS_db_root_path);
+    snapshot1.Init();
+    uint64_t snapshot_offset = 0;
+    ASSERT_TRUE(snapshot1.Recover(table1, snapshot_offset));
+    ASSERT_EQ(19u, snapshot_offset);
+    ASSERT_EQ(10u, snapshot1.GetOffset());
+    ASSERT_TRUE(binlog.RecoverFromBinlog(table1, snapshot_offset, latest_offset));
+    check_table(table1);
+
+    // the broken image is skipped
+    ASSERT_EQ(0, truncate((snapshot_dir + "table.img").c_str(), 100));
+    std::shared_ptr<MemTable> table2 =
+        std::make_shared<MemTable>("test", 11, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table2->Init();
+    MemTableSnapshot snapshot2(11, 0, log_part, FLAGS_db_root_path);
+    snapshot2.Init();
+    ASSERT_TRUE(snapshot2.Recover(table2, snapshot_offset));
+    ASSERT_EQ(10u, snapshot_offset);
+    ASSERT_TRUE(binlog.RecoverFromBinlog(table2, snapshot_offset, latest_offset));
+    check_table(table2);
+}
+
+TEST_F(SnapshotTest, RecoverFromImageManyKeys) {
+    std::string binlog_dir = FLAGS_db_root_path + "/13_0/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, binlog_dir, binlog_index, offset);
+    auto write_entries = [&](int start, int end) {
+        for (int i = start; i < end; i++) {
+            offset++;
+            auto entry = ::openmldb::test::PackKVEntry(offset, "key" + std::to_string(i), "value" + std::to_string(i),
+                                                       i + 1, 0);
+            std::string buffer;
+            entry.SerializeToString(&buffer);
+            ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+        }
+        wh->Sync();
+    };
+    write_entries(0, 150);
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 13, 0, 2, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    MemTableSnapshot snapshot(13, 0, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    Binlog binlog(log_part, binlog_dir);
+    uint64_t latest_offset = 0;
+    ASSERT_TRUE(binlog.RecoverFromBinlog(table, 0, latest_offset));
+    uint64_t offset_value = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ASSERT_EQ(150u, offset_value);
+    write_entries(150, 300);
+    ASSERT_TRUE(binlog.RecoverFromBinlog(table, 150, latest_offset));
+    // the 150 keys of a segment are dumped in several batches
+    ASSERT_EQ(0, snapshot.MakeImage(table, [&offset] { return offset; }));
+
+    std::shared_ptr<MemTable> table1 =
+        std::make_shared<MemTable>("test", 13, 0, 2, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table1->Init();
+    MemTableSnapshot snapshot1(13, 0, log_part, FLAGS_db_root_path);
+    snapshot1.Init();
+    uint64_t snapshot_offset = 0;
+    ASSERT_TRUE(snapshot1.Recover(table1, snapshot_offset));
+    ASSERT_EQ(300u, snapshot_offset);
+    ASSERT_EQ(300u, table1->GetRecordCnt());
+    for (int i = 0; i < 300; i++) {
+        Ticket ticket;
+        std::unique_ptr<TableIterator> it(table1->NewIterator("key" + std::to_string(i), ticket));
+        it->SeekToFirst();
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(static_cast<uint64_t>(i + 1), it->GetKey());
+        std::string value(it->GetValue().data(), it->GetValue().size());
+        ASSERT_EQ("value" + std::to_string(i), ::openmldb::test::DecodeV(value));
+        it->Next();
+        ASSERT_FALSE(it->Valid());
+    }
+}
+
+TEST_F(SnapshotTest, Recover_snapshot_parallel) {
+    std::string binlog_dir = FLAGS_db_root_path + "/12_0/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, binlog_dir, binlog_index, offset);
+    // some rows are larger than a block, so the ranges split them
+    for (int i = 0; i < 20000; i++) {
+        offset++;
+        std::string value = "value" + std::to_string(i);
+        if (i % 97 == 0) {
+            value.append(6000, 'x');
+        }
+        auto entry = ::openmldb::test::PackKVEntry(offset, "key" + std::to_string(i % 100), value, i + 1, 1);
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+        if (i % 1000 == 999) {
+            offset++;
+            ::openmldb::api::LogEntry entry1;
+            entry1.set_log_index(offset);
+            entry1.set_method_type(::openmldb::api::MethodType::kDelete);
+            ::openmldb::api::Dimension* dimension = entry1.add_dimensions();
+            dimension->set_key("key" + std::to_string(i % 100));
+            dimension->set_idx(0);
+            entry1.SerializeToString(&buffer);
+            ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+        }
+    }
+    wh->Sync();
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    // the deletes in the binlog wait for the puts before them
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 12, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    Binlog binlog(log_part, binlog_dir);
+    uint64_t latest_offset = 0;
+    ASSERT_TRUE(binlog.RecoverFromBinlog(table, 0, latest_offset));
+    ASSERT_EQ(offset, latest_offset);
+    auto get_count = [](std::shared_ptr<MemTable> table, const std::string& key) {
+        Ticket ticket;
+        std::unique_ptr<TableIterator> it(table->NewIterator(key, ticket));
+        it->SeekToFirst();
+        uint32_t cnt = 0;
+        while (it->Valid()) {
+            cnt++;
+            it->Next();
+        }
+        return cnt;
+    };
+    for (int k = 0; k < 100; k++) {
+        ASSERT_EQ(k == 99 ? 0u : 200u, get_count(table, "key" + std::to_string(k)));
+    }
+
+    MemTableSnapshot snapshot(12, 0, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    uint64_t offset_value = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    uint32_t read_thread_num = FLAGS_load_table_read_thread_num;
+    FLAGS_load_table_read_thread_num = 4;
+    std::shared_ptr<MemTable> table1 =
+        std::make_shared<MemTable>("test", 12, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table1->Init();
+    MemTableSnapshot snapshot1(12, 0, log_part, FLAGS_db_root_path);
+    snapshot1.Init();
+    uint64_t snapshot_offset = 0;
+    ASSERT_TRUE(snapshot1.Recover(table1, snapshot_offset));
+    FLAGS_load_table_read_thread_num = read_thread_num;
+    ASSERT_EQ(offset, snapshot_offset);
+    // the rows of the deleted key are not in the snapshot
+    ASSERT_EQ(19800u, table1->GetRecordCnt());
+    for (int k = 0; k < 100; k++) {
+        ASSERT_EQ(get_count(table, "key" + std::to_string(k)), get_count(table1, "key" + std::to_string(k)));
+    }
+}
+
 TEST_F(SnapshotTest, Recover_large_snapshot) {
     std::string snapshot_dir = FLAGS_db_root_path + "/100_0/snapshot/";
     std::string binlog_dir = FLAGS_db_root_path + "/100_0/binlog/";
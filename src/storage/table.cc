@@ -17,6 +17,8 @@
 #include "storage/table.h"
 
 #include <algorithm>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
 #include <utility>
 
 #include "base/glog_wapper.h"
@@ -196,5 +198,13 @@ bool Table::CheckFieldExist(const std::string& name) {
     return false;
 }
 
+void Table::WaitWrites() {
+    // the new writes count in the other phase, so only the ones began before are waited
+    uint32_t phase = write_phase_.fetch_xor(1);
+    while (write_cnt_[phase].load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
 }  // namespace storage
 }  // namespace openmldb
@@ -178,6 +178,20 @@ class Table {
 
     virtual int GetCount(uint32_t index, const std::string& pk, uint64_t& count) = 0; // NOLINT
 
+    // a put is wrapped by BeginWrite and EndWrite until it's appended to the binlog, the phase returned should be
+    // passed to EndWrite
+    uint32_t BeginWrite() {
+        uint32_t phase = write_phase_.load();
+        write_cnt_[phase].fetch_add(1);
+        return phase;
+    }
+
+    void EndWrite(uint32_t phase) { write_cnt_[phase].fetch_sub(1); }
+
+    // wait until the writes began before are done, so the binlog offset got after it covers all the rows seen
+    // before it. it must not be called concurrently
+    void WaitWrites();
+
  protected:
     void UpdateTTL();
     bool InitFromMeta();
@@ -197,6 +211,22 @@ class Table {
     std::shared_ptr<std::map<int32_t, std::shared_ptr<Schema>>> version_schema_;
     std::shared_ptr<std::map<int32_t, std::shared_ptr<codec::RowView>>> version_decoder_;
     std::shared_ptr<std::vector<::openmldb::storage::UpdateTTLMeta>> update_ttl_;
+    std::atomic<uint32_t> write_phase_{0};
+    std::atomic<uint64_t> write_cnt_[2] = {};
+};
+
+// TableWriteGuard marks a put in the table until it's appended to the binlog
+class TableWriteGuard {
+ public:
+    explicit TableWriteGuard(Table* table) : table_(table), phase_(table->BeginWrite()) {}
+    ~TableWriteGuard() { table_->EndWrite(phase_); }
+
+    TableWriteGuard(const TableWriteGuard&) = delete;
+    TableWriteGuard& operator=(const TableWriteGuard&) = delete;
+
+ private:
+    Table* table_;
+    uint32_t phase_;
 };
 
 }  // namespace storage
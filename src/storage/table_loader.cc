@@ -0,0 +1,113 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/table_loader.h"
+
+#include <utility>
+
+#include "base/hash.h"
+
+namespace openmldb {
+namespace storage {
+
+TableLoader::TableLoader(std::shared_ptr<Table> table, uint32_t thread_num, uint32_t batch_size,
+                         uint32_t queue_size)
+    : table_(table),
+      mem_table_(std::dynamic_pointer_cast<MemTable>(table)),
+      batch_size_(batch_size > 0 ? batch_size : 1),
+      appliers_(),
+      put_cnt_(0),
+      pending_(0),
+      mu_(),
+      cv_() {
+    if (thread_num == 0) {
+        thread_num = 1;
+    }
+    for (uint32_t i = 0; i < thread_num; i++) {
+        appliers_.emplace_back(new ::openmldb::base::TaskPool(1, queue_size > 0 ? queue_size : 1));
+    }
+}
+
+TableLoader::~TableLoader() {
+    Wait();
+    for (auto& applier : appliers_) {
+        applier->Stop();
+    }
+}
+
+uint32_t TableLoader::Route(const ::openmldb::api::LogEntry& entry) const {
+    if (appliers_.size() == 1 || entry.dimensions_size() == 0) {
+        return 0;
+    }
+    const std::string& key = entry.dimensions(0).key();
+    if (mem_table_) {
+        return mem_table_->GetSegIdx(Slice(key)) % appliers_.size();
+    }
+    return ::openmldb::base::hash(key.c_str(), key.length(), 0) % appliers_.size();
+}
+
+void TableLoader::Submit(uint32_t applier, std::shared_ptr<std::vector<::openmldb::api::LogEntry>> batch) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        pending_++;
+    }
+    appliers_[applier]->AddTask([this, batch] { Apply(batch); });
+}
+
+void TableLoader::Apply(std::shared_ptr<std::vector<::openmldb::api::LogEntry>> batch) {
+    for (const auto& entry : *batch) {
+        table_->Put(entry);
+    }
+    put_cnt_.fetch_add(batch->size(), std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mu_);
+    if (--pending_ == 0) {
+        cv_.notify_all();
+    }
+}
+
+void TableLoader::Wait() {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+TableLoader::Writer::Writer(TableLoader* loader) : loader_(loader), batches_(loader->appliers_.size()) {}
+
+void TableLoader::Writer::Put(::openmldb::api::LogEntry* entry) {
+    uint32_t applier = loader_->Route(*entry);
+    auto& batch = batches_[applier];
+    if (!batch) {
+        batch = std::make_shared<std::vector<::openmldb::api::LogEntry>>();
+        batch->reserve(loader_->batch_size_);
+    }
+    batch->emplace_back();
+    batch->back().Swap(entry);
+    if (batch->size() >= loader_->batch_size_) {
+        loader_->Submit(applier, std::move(batch));
+        batch.reset();
+    }
+}
+
+void TableLoader::Writer::Flush() {
+    for (uint32_t i = 0; i < batches_.size(); i++) {
+        if (batches_[i] && !batches_[i]->empty()) {
+            loader_->Submit(i, std::move(batches_[i]));
+        }
+        batches_[i].reset();
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
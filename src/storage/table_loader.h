@@ -0,0 +1,88 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_TABLE_LOADER_H_
+#define SRC_STORAGE_TABLE_LOADER_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "base/taskpool.hpp"
+#include "proto/tablet.pb.h"
+#include "storage/mem_table.h"
+#include "storage/table.h"
+
+namespace openmldb {
+namespace storage {
+
+// TableLoader puts the log entries into a table by several applier threads on recovery. An entry is routed
+// by the segment of its first dimension, so the rows of a segment are put by one applier in order and the
+// appliers don't contend on the same segment unless the table has more than one index.
+class TableLoader {
+ public:
+    TableLoader(std::shared_ptr<Table> table, uint32_t thread_num, uint32_t batch_size, uint32_t queue_size);
+    ~TableLoader();
+
+    TableLoader(const TableLoader&) = delete;
+    TableLoader& operator=(const TableLoader&) = delete;
+
+    // Writer batches the entries of one reader thread, every reader should have its own writer
+    class Writer {
+     public:
+        explicit Writer(TableLoader* loader);
+        ~Writer() { Flush(); }
+
+        // the content of entry is moved into the batch
+        void Put(::openmldb::api::LogEntry* entry);
+
+        // hand the batches to the appliers
+        void Flush();
+
+     private:
+        TableLoader* loader_;
+        std::vector<std::shared_ptr<std::vector<::openmldb::api::LogEntry>>> batches_;
+    };
+
+    // wait until the flushed entries are put
+    void Wait();
+
+    uint64_t GetPutCnt() const { return put_cnt_.load(std::memory_order_relaxed); }
+
+ private:
+    uint32_t Route(const ::openmldb::api::LogEntry& entry) const;
+
+    void Submit(uint32_t applier, std::shared_ptr<std::vector<::openmldb::api::LogEntry>> batch);
+
+    void Apply(std::shared_ptr<std::vector<::openmldb::api::LogEntry>> batch);
+
+ private:
+    std::shared_ptr<Table> table_;
+    std::shared_ptr<MemTable> mem_table_;
+    uint32_t batch_size_;
+    // every applier has a pool of one thread
+    std::vector<std::unique_ptr<::openmldb::base::TaskPool>> appliers_;
+    std::atomic<uint64_t> put_cnt_;
+    uint64_t pending_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_TABLE_LOADER_H_
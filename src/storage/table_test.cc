@@ -17,6 +17,8 @@
 #include <gflags/gflags.h>
 #include <atomic>
 #include <iostream>
+#include <set>
+#include <string>
 #include <utility>
 
 #include "base/glog_wapper.h"
@@ -38,6 +40,9 @@ DECLARE_string(ssd_root_path);
 DECLARE_string(hdd_root_path);
 DECLARE_uint32(max_traverse_cnt);
 DECLARE_int32(gc_safe_offset);
+DECLARE_uint32(gc_segment_thread_num);
+DECLARE_uint32(gc_cpu_percent);
+DECLARE_uint32(mem_table_tier_age);
 
 namespace openmldb {
 namespace storage {
@@ -1646,6 +1651,30 @@ TEST_F(TableTest, Release) {
     delete table;
 }
 
+TEST_F(TableTest, SchedGcInParallel) {
+    FLAGS_gc_segment_thread_num = 4;
+    FLAGS_gc_cpu_percent = 50;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    MemTable* table = new MemTable("tx_log", 1, 1, 8, mapping, 10, ::openmldb::type::kAbsoluteTime);
+    table->Init();
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    for (int i = 0; i < 1000; i++) {
+        std::string key = "test" + std::to_string(i);
+        table->Put(key, now, "tes2", 4);
+        table->Put(key, 9527, "test", 4);
+    }
+    ASSERT_EQ(2000, (int64_t)table->GetRecordCnt());
+    table->SchedGc();
+    ASSERT_EQ(1000, (int64_t)table->GetRecordCnt());
+    ASSERT_EQ(1000, (int64_t)table->GetRecordIdxCnt());
+    ASSERT_EQ(1000, (int64_t)table->GetRecordPkCnt());
+    ASSERT_GT(table->GetGcByteRate(), 0u);
+    delete table;
+    FLAGS_gc_segment_thread_num = 1;
+    FLAGS_gc_cpu_percent = 100;
+}
+
 TEST_P(TableTest, TSColIDLength) {
     ::openmldb::common::StorageMode storageMode = GetParam();
     ::openmldb::api::TableMeta table_meta;
@@ -1935,6 +1964,205 @@ TEST_P(TableTest, AbsAndLat) {
 INSTANTIATE_TEST_CASE_P(TestMemAndHDD, TableTest,
                         ::testing::Values(::openmldb::common::kMemory, ::openmldb::common::kHDD));
 
+class TieredTableTest : public ::testing::Test {
+ public:
+    TieredTableTest() {}
+    ~TieredTableTest() {}
+};
+
+TEST_F(TieredTableTest, SpillAndRead) {
+    uint32_t old_tier_age = FLAGS_mem_table_tier_age;
+    FLAGS_mem_table_tier_age = 60;
+    int id = ++counter;
+    std::string table_path = GetDBPath(FLAGS_hdd_root_path, id, 1);
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("tiered");
+    table_meta.set_tid(id);
+    table_meta.set_pid(1);
+    table_meta.set_seg_cnt(8);
+    table_meta.set_format_version(1);
+    table_meta.set_storage_mode(::openmldb::common::kMemory);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "price", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts", ::openmldb::type::kAbsoluteTime, 0, 0);
+    MemTable* table = new MemTable(table_meta);
+    table->SetTierPath(table_path + "/tier");
+    ASSERT_TRUE(table->Init());
+    ASSERT_TRUE(table->GetTier() != NULL);
+    codec::SDKCodec codec(table_meta);
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    auto put = [&table, &codec](const std::string& card, uint64_t ts) {
+        ::openmldb::api::PutRequest request;
+        ::openmldb::api::Dimension* dim = request.add_dimensions();
+        dim->set_idx(0);
+        dim->set_key(card);
+        std::string value;
+        ASSERT_EQ(0, codec.EncodeRow({card, std::to_string(ts), std::to_string(ts)}, &value));
+        ASSERT_TRUE(table->Put(ts, value, request.dimensions()));
+    };
+    auto scan = [&table](const std::string& card) {
+        Ticket ticket;
+        TableIterator* it = table->NewIterator(0, card, ticket);
+        int cnt = 0;
+        uint64_t last = UINT64_MAX;
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            EXPECT_LT(it->GetKey(), last);
+            last = it->GetKey();
+            cnt++;
+        }
+        delete it;
+        return cnt;
+    };
+    auto window = [&table](const std::string& card) {
+        std::unique_ptr<::hybridse::vm::WindowIterator> it(table->NewWindowIterator(0));
+        it->Seek(card);
+        if (!it->Valid() || it->GetKey().ToString() != card) {
+            return 0;
+        }
+        auto row_it = it->GetValue();
+        int cnt = 0;
+        uint64_t last = UINT64_MAX;
+        for (row_it->SeekToFirst(); row_it->Valid(); row_it->Next()) {
+            EXPECT_LT(row_it->GetKey(), last);
+            last = row_it->GetKey();
+            cnt++;
+        }
+        return cnt;
+    };
+    // a row per minute of the last two hours, the ones older than an hour go to the disk tier directly
+    for (int i = 0; i < 120; i++) {
+        put("card0", now - i * 60 * 1000);
+    }
+    // card1 has only the rows in the disk tier
+    for (int i = 0; i < 10; i++) {
+        put("card1", now - (100 + i) * 60 * 1000);
+    }
+    for (int i = 0; i < 10; i++) {
+        put("card2", now - (30 + i) * 60 * 1000);
+    }
+    ASSERT_EQ(120, scan("card0"));
+    ASSERT_EQ(10, scan("card1"));
+    ASSERT_EQ(10, scan("card2"));
+    ASSERT_EQ(120, window("card0"));
+    ASSERT_EQ(10, window("card1"));
+    {
+        Ticket ticket;
+        TableIterator* it = table->NewIterator(0, "card0", ticket);
+        it->Seek(now - 90 * 60 * 1000);
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(now - 90 * 60 * 1000, it->GetKey());
+        delete it;
+    }
+    uint64_t count = 0;
+    ASSERT_EQ(0, table->GetCount(0, "card1", count));
+    ASSERT_EQ(10u, count);
+    // the keys in memory are iterated first
+    {
+        std::unique_ptr<::hybridse::vm::WindowIterator> it(table->NewWindowIterator(0));
+        std::set<std::string> keys;
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            keys.insert(it->GetKey().ToString());
+        }
+        ASSERT_EQ(3u, keys.size());
+    }
+
+    // spill the rows older than 20 minutes
+    uint64_t byte_size = table->GetRecordByteSize();
+    FLAGS_mem_table_tier_age = 20;
+    table->SchedGc();
+    ASSERT_LT(table->GetRecordByteSize(), byte_size);
+    ASSERT_EQ(120, scan("card0"));
+    ASSERT_EQ(10, scan("card2"));
+    ASSERT_EQ(120, window("card0"));
+    ASSERT_EQ(10, window("card2"));
+    ASSERT_EQ(0, table->GetCount(0, "card2", count));
+    ASSERT_EQ(10u, count);
+
+    ASSERT_TRUE(table->Delete("card1", 0));
+    ASSERT_EQ(0, scan("card1"));
+    ASSERT_EQ(0, window("card1"));
+
+    FLAGS_mem_table_tier_age = old_tier_age;
+    delete table;
+    RemoveData(table_path);
+}
+
+TEST_F(TieredTableTest, SpillDupTime) {
+    uint32_t old_tier_age = FLAGS_mem_table_tier_age;
+    FLAGS_mem_table_tier_age = 60;
+    int id = ++counter;
+    std::string table_path = GetDBPath(FLAGS_hdd_root_path, id, 1);
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("tiered");
+    table_meta.set_tid(id);
+    table_meta.set_pid(1);
+    table_meta.set_seg_cnt(8);
+    table_meta.set_format_version(1);
+    table_meta.set_storage_mode(::openmldb::common::kMemory);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "price", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts", ::openmldb::type::kAbsoluteTime, 0, 0);
+    MemTable* table = new MemTable(table_meta);
+    table->SetTierPath(table_path + "/tier");
+    ASSERT_TRUE(table->Init());
+    ASSERT_TRUE(table->GetTier() != NULL);
+    codec::SDKCodec codec(table_meta);
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    auto put = [&table, &codec](const std::string& card, uint64_t ts, int64_t price) {
+        ::openmldb::api::PutRequest request;
+        ::openmldb::api::Dimension* dim = request.add_dimensions();
+        dim->set_idx(0);
+        dim->set_key(card);
+        std::string value;
+        ASSERT_EQ(0, codec.EncodeRow({card, std::to_string(price), std::to_string(ts)}, &value));
+        ASSERT_TRUE(table->Put(ts, value, request.dimensions()));
+    };
+    // the prices of the rows of card
+    auto scan = [&table, &codec](const std::string& card) {
+        Ticket ticket;
+        TableIterator* it = table->NewIterator(0, card, ticket);
+        std::multiset<std::string> prices;
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            std::vector<std::string> row;
+            EXPECT_EQ(0, codec.DecodeRow(it->GetValue().ToString(), &row));
+            prices.insert(row[1]);
+        }
+        delete it;
+        return prices;
+    };
+    // card0 has a row in the disk tier, the other row of the same ts stays in memory
+    put("card0", now - 90 * 60 * 1000, 1);
+    put("card0", now - 90 * 60 * 1000, 2);
+    put("card0", now - 91 * 60 * 1000, 3);
+    // the rows of card1 have the same ts and are in memory
+    put("card1", now - 30 * 60 * 1000, 1);
+    put("card1", now - 30 * 60 * 1000, 2);
+    put("card1", now - 31 * 60 * 1000, 3);
+    put("card2", now - 30 * 60 * 1000, 1);
+    ASSERT_EQ(std::multiset<std::string>({"1", "2", "3"}), scan("card0"));
+    ASSERT_EQ(std::multiset<std::string>({"1", "2", "3"}), scan("card1"));
+
+    // card0 and card1 are kept in memory by the gc, card2 is spilled
+    uint64_t byte_size = table->GetRecordByteSize();
+    FLAGS_mem_table_tier_age = 20;
+    table->SchedGc();
+    ASSERT_LT(table->GetRecordByteSize(), byte_size);
+    ASSERT_EQ(std::multiset<std::string>({"1", "2", "3"}), scan("card0"));
+    ASSERT_EQ(std::multiset<std::string>({"1", "2", "3"}), scan("card1"));
+    ASSERT_EQ(std::multiset<std::string>({"1"}), scan("card2"));
+    uint64_t count = 0;
+    ASSERT_EQ(0, table->GetCount(0, "card0", count));
+    ASSERT_EQ(3u, count);
+    ASSERT_EQ(0, table->GetCount(0, "card1", count));
+    ASSERT_EQ(3u, count);
+
+    FLAGS_mem_table_tier_age = old_tier_age;
+    delete table;
+    RemoveData(table_path);
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
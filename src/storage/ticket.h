@@ -17,15 +17,13 @@
 #ifndef SRC_STORAGE_TICKET_H_
 #define SRC_STORAGE_TICKET_H_
 
-#include <vector>
-
-#include "storage/segment.h"
+#include "storage/epoch.h"
 
 namespace openmldb {
 namespace storage {
 
-class KeyEntry;
-
+// Ticket keeps the rows and the lists seen by the iterators it's passed to from being freed by gc until it's
+// destroyed. It should not be kept long, the memory retired by all the tables is not freed while it's alive
 class Ticket {
  public:
     Ticket();
@@ -33,11 +31,8 @@ class Ticket {
     Ticket(const Ticket&) = delete;
     Ticket& operator=(const Ticket& s) = delete;
 
-    void Push(KeyEntry* entry);
-    void Pop();
-
  private:
-    std::vector<KeyEntry*> entries_;
+    EpochGuard guard_;
 };
 
 }  // namespace storage
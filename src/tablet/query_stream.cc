@@ -0,0 +1,89 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/query_stream.h"
+
+#include "base/glog_wapper.h"
+#include "base/status.h"
+#include "butil/iobuf.h"
+#include "butil/time.h"
+#include "codec/sql_rpc_row_codec.h"
+#include "gflags/gflags.h"
+
+DECLARE_int32(request_timeout_ms);
+DECLARE_uint32(stream_query_chunk_size);
+
+namespace openmldb {
+namespace tablet {
+
+// write the message to the stream, wait if the buffer of the stream is full as the client reads slower
+static bool WriteStream(brpc::StreamId stream_id, const butil::IOBuf& msg) {
+    while (true) {
+        int ret = brpc::StreamWrite(stream_id, msg);
+        if (ret == 0) {
+            return true;
+        }
+        if (ret != EAGAIN) {
+            PDLOG(WARNING, "fail to write query stream %lu, ret %d", stream_id, ret);
+            return false;
+        }
+        timespec due = butil::milliseconds_from_now(FLAGS_request_timeout_ms);
+        ret = brpc::StreamWait(stream_id, &due);
+        if (ret != 0) {
+            PDLOG(WARNING, "fail to wait query stream %lu, ret %d", stream_id, ret);
+            return false;
+        }
+    }
+}
+
+void PushQueryStream(brpc::StreamId stream_id, const std::string& sql, const StreamQueryRunner& run) {
+    butil::IOBuf rows;
+    uint32_t count = 0;
+    bool ok = true;
+    auto flush = [stream_id, &rows, &count]() {
+        butil::IOBuf msg;
+        ::openmldb::codec::EncodeQueryStreamHeader(::openmldb::base::kOk, count, rows.size(), &msg);
+        msg.append(butil::IOBuf::Movable(rows));
+        count = 0;
+        return WriteStream(stream_id, msg);
+    };
+    int32_t run_ret = run([&](const ::hybridse::codec::Row& row) {
+        rows.append(reinterpret_cast<void*>(row.buf()), row.size());
+        count++;
+        if (rows.size() >= FLAGS_stream_query_chunk_size) {
+            ok = flush();
+        }
+        return ok;
+    });
+    if (!ok) {
+        brpc::StreamClose(stream_id);
+        return;
+    }
+    if (run_ret != 0) {
+        std::string msg = "fail to run sql: " + sql;
+        butil::IOBuf error;
+        ::openmldb::codec::EncodeQueryStreamHeader(::openmldb::base::kSQLRunError, 0, msg.size(), &error);
+        error.append(msg);
+        WriteStream(stream_id, error);
+    } else if (count == 0 || flush()) {
+        // the rest rows are flushed, then a message without rows ends the stream
+        flush();
+    }
+    brpc::StreamClose(stream_id);
+}
+
+}  // namespace tablet
+}  // namespace openmldb
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "brpc/stream.h"
+#include "codec/row.h"
+
+namespace openmldb {
+namespace tablet {
+
+// runs a batch query and calls on_row for every output row until it returns false, returns 0 if the query succeeds
+using StreamQueryRunner = std::function<int32_t(const std::function<bool(const ::hybridse::codec::Row&)>& on_row)>;
+
+// PushQueryStream pushes the rows of a batch query to the stream accepted from the client in messages of about
+// stream_query_chunk_size bytes, then a message without rows or a message of the error of the query ends it.
+// It waits if the stream is full as the client reads slower, and gives up once it waits for request_timeout_ms.
+// The stream is closed when it returns.
+void PushQueryStream(brpc::StreamId stream_id, const std::string& sql, const StreamQueryRunner& run);
+
+}  // namespace tablet
+}  // namespace openmldb
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/row_ref_appender.h"
+
+#include <mutex>  // NOLINT
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "common/timer.h"
+#include "gflags/gflags.h"
+#include "storage/epoch.h"
+
+DECLARE_uint32(zero_copy_min_row_size);
+DECLARE_uint32(zero_copy_max_pinned_mb);
+DECLARE_uint32(zero_copy_max_pin_ms);
+
+namespace openmldb {
+namespace tablet {
+
+namespace {
+
+// The deleter of a user data block only gets the data, so the pins and the sizes of the rows in flight are looked
+// up by the address. A row may be in flight in several responses, any pin of it can be released as all of them
+// hold a ticket which covers the row
+struct PinShard {
+    std::mutex mu;
+    std::unordered_multimap<const void*, std::pair<void*, uint32_t>> pins;
+};
+
+constexpr uint32_t kPinShardNum = 64;
+
+PinShard* GetPinShard(const void* data) {
+    static PinShard shards[kPinShardNum];
+    return &shards[(reinterpret_cast<uintptr_t>(data) >> 4) % kPinShardNum];
+}
+
+std::atomic<uint64_t> pinned_cnt{0};
+std::atomic<uint64_t> pinned_bytes{0};
+
+// the start times of the pins which have rows in flight, so the age of the oldest one is read without the lock
+constexpr uint32_t kMaxLivePins = ::openmldb::storage::EpochManager::kDefaultSlotNum / 4;
+std::mutex live_pin_mu;
+std::multiset<uint64_t> live_pins;
+std::atomic<uint64_t> live_pin_cnt{0};
+std::atomic<uint64_t> oldest_pin_time{0};
+
+void AddLivePin(uint64_t time) {
+    std::lock_guard<std::mutex> lock(live_pin_mu);
+    live_pins.insert(time);
+    live_pin_cnt.store(live_pins.size(), std::memory_order_relaxed);
+    oldest_pin_time.store(*live_pins.begin(), std::memory_order_relaxed);
+}
+
+void RemoveLivePin(uint64_t time) {
+    std::lock_guard<std::mutex> lock(live_pin_mu);
+    live_pins.erase(live_pins.find(time));
+    live_pin_cnt.store(live_pins.size(), std::memory_order_relaxed);
+    oldest_pin_time.store(live_pins.empty() ? 0 : *live_pins.begin(), std::memory_order_relaxed);
+}
+
+}  // namespace
+
+RowRefAppender::RowRefAppender(butil::IOBuf* buf)
+    : buf_(buf), pin_(new Pin()), start_time_(::baidu::common::timer::get_micros() / 1000) {}
+
+RowRefAppender::~RowRefAppender() { Unref(pin_); }
+
+void RowRefAppender::Unref(Pin* pin) {
+    if (pin->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (pin->start_time > 0) {
+            RemoveLivePin(pin->start_time);
+        }
+        delete pin;
+    }
+}
+
+void RowRefAppender::ReleaseRow(void* data) {
+    void* pin = NULL;
+    uint32_t size = 0;
+    PinShard* shard = GetPinShard(data);
+    {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        auto it = shard->pins.find(data);
+        if (it != shard->pins.end()) {
+            pin = it->second.first;
+            size = it->second.second;
+            shard->pins.erase(it);
+        }
+    }
+    if (pin != NULL) {
+        pinned_cnt.fetch_sub(1, std::memory_order_relaxed);
+        pinned_bytes.fetch_sub(size, std::memory_order_relaxed);
+        Unref(static_cast<Pin*>(pin));
+    }
+}
+
+bool RowRefAppender::CanPin(uint32_t size) const {
+    if (pinned_bytes.load(std::memory_order_relaxed) + size >
+        static_cast<uint64_t>(FLAGS_zero_copy_max_pinned_mb) * 1024 * 1024) {
+        return false;
+    }
+    if (pin_->start_time == 0 && live_pin_cnt.load(std::memory_order_relaxed) >= kMaxLivePins) {
+        return false;
+    }
+    // the response being built counts too, so a long scan stops pinning as well
+    uint64_t oldest = oldest_pin_time.load(std::memory_order_relaxed);
+    if (oldest == 0 || oldest > start_time_) {
+        oldest = start_time_;
+    }
+    return ::baidu::common::timer::get_micros() / 1000 - oldest <= FLAGS_zero_copy_max_pin_ms;
+}
+
+void RowRefAppender::DeleteRow(void* data) { delete[] static_cast<char*>(data); }
+
+void RowRefAppender::Append(const char* data, uint32_t size) {
+    if (size < FLAGS_zero_copy_min_row_size || !CanPin(size)) {
+        buf_->append(data, size);
+        return;
+    }
+    if (pin_->start_time == 0) {
+        pin_->start_time = start_time_;
+        AddLivePin(start_time_);
+    }
+    pin_->refs.fetch_add(1, std::memory_order_relaxed);
+    pinned_cnt.fetch_add(1, std::memory_order_relaxed);
+    pinned_bytes.fetch_add(size, std::memory_order_relaxed);
+    PinShard* shard = GetPinShard(data);
+    {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        shard->pins.emplace(data, std::make_pair(static_cast<void*>(pin_), size));
+    }
+    if (buf_->append_user_data(const_cast<char*>(data), size, ReleaseRow) != 0) {
+        // the deleter is not called if the block is not created
+        ReleaseRow(const_cast<char*>(data));
+        buf_->append(data, size);
+    }
+}
+
+void RowRefAppender::AppendOwned(char* data, uint32_t size) {
+    if (size < FLAGS_zero_copy_min_row_size || buf_->append_user_data(data, size, DeleteRow) != 0) {
+        buf_->append(data, size);
+        delete[] data;
+    }
+}
+
+uint64_t RowRefAppender::GetPinnedCnt() { return pinned_cnt.load(std::memory_order_relaxed); }
+
+uint64_t RowRefAppender::GetPinnedBytes() { return pinned_bytes.load(std::memory_order_relaxed); }
+
+}  // namespace tablet
+}  // namespace openmldb
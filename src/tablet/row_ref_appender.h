@@ -0,0 +1,80 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "butil/iobuf.h"
+#include "storage/ticket.h"
+
+namespace openmldb {
+namespace tablet {
+
+// RowRefAppender appends the rows of memtables to a response attachment by reference instead of copying them.
+// The rows are pinned by a ticket until brpc drops the last block of them, which may be after the response is
+// sent. The appender must be created before the iterators which read the rows, so the ticket covers them.
+// The rows of disk tables and disk tiers are owned by the iterators and must be copied by AppendCopy.
+// A pinned response holds an epoch slot and holds back the reclamation until a slow client reads it, so the rows
+// are copied once the pinned bytes reach zero_copy_max_pinned_mb, the pinned responses take a quarter of the
+// epoch slots or the oldest one is pinned for longer than zero_copy_max_pin_ms.
+class RowRefAppender {
+ public:
+    explicit RowRefAppender(butil::IOBuf* buf);
+    ~RowRefAppender();
+
+    RowRefAppender(const RowRefAppender&) = delete;
+    RowRefAppender& operator=(const RowRefAppender&) = delete;
+
+    // the rows smaller than zero_copy_min_row_size are copied as the block of a reference costs more
+    void Append(const char* data, uint32_t size);
+
+    void AppendCopy(const void* data, uint32_t size) { buf_->append(data, size); }
+
+    // the data allocated by new[] is owned by the buffer and deleted with its block
+    void AppendOwned(char* data, uint32_t size);
+
+    butil::IOBuf* GetBuf() const { return buf_; }
+
+    // the count of the rows appended by reference and not released by brpc yet
+    static uint64_t GetPinnedCnt();
+
+    // the bytes of the rows appended by reference and not released by brpc yet
+    static uint64_t GetPinnedBytes();
+
+ private:
+    struct Pin {
+        ::openmldb::storage::Ticket ticket;
+        std::atomic<uint64_t> refs{1};
+        // the time in ms the appender is created, it's set once the first row is pinned
+        uint64_t start_time = 0;
+    };
+
+    bool CanPin(uint32_t size) const;
+
+    static void Unref(Pin* pin);
+    static void ReleaseRow(void* data);
+    static void DeleteRow(void* data);
+
+ private:
+    butil::IOBuf* buf_;
+    Pin* pin_;
+    uint64_t start_time_;
+};
+
+}  // namespace tablet
+}  // namespace openmldb
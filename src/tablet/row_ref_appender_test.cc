@@ -0,0 +1,168 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/row_ref_appender.h"
+
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include "storage/epoch.h"
+
+DECLARE_uint32(zero_copy_min_row_size);
+DECLARE_uint32(zero_copy_max_pinned_mb);
+DECLARE_uint32(zero_copy_max_pin_ms);
+
+namespace openmldb {
+namespace tablet {
+
+class RowRefAppenderTest : public ::testing::Test {
+ public:
+    RowRefAppenderTest() {}
+    ~RowRefAppenderTest() {}
+};
+
+TEST_F(RowRefAppenderTest, Pin) {
+    uint32_t old_min_size = FLAGS_zero_copy_min_row_size;
+    FLAGS_zero_copy_min_row_size = 8;
+    auto manager = ::openmldb::storage::EpochManager::Default();
+    manager->Reclaim();
+    std::string row(16, 'r');
+    char* data = new char[row.size()];
+    memcpy(data, row.data(), row.size());
+    char* owned = new char[row.size()];
+    memset(owned, 'o', row.size());
+    butil::IOBuf buf;
+    {
+        RowRefAppender appender(&buf);
+        appender.Append("small", 5);
+        appender.Append(data, row.size());
+        appender.AppendCopy("|", 1);
+        appender.AppendOwned(owned, row.size());
+    }
+    ASSERT_EQ(1u, RowRefAppender::GetPinnedCnt());
+    ASSERT_EQ("small" + row + "|" + std::string(16, 'o'), buf.to_string());
+    // the row is unlinked by gc, it's not freed until the buffer drops it
+    bool freed = false;
+    manager->Retire(NULL, [data, &freed] {
+        delete[] data;
+        freed = true;
+    });
+    manager->Reclaim();
+    ASSERT_FALSE(freed);
+    butil::IOBuf sent = buf;
+    buf.clear();
+    manager->Reclaim();
+    ASSERT_FALSE(freed);
+    ASSERT_EQ(1u, RowRefAppender::GetPinnedCnt());
+    sent.clear();
+    ASSERT_EQ(0u, RowRefAppender::GetPinnedCnt());
+    manager->Reclaim();
+    ASSERT_TRUE(freed);
+    FLAGS_zero_copy_min_row_size = old_min_size;
+}
+
+TEST_F(RowRefAppenderTest, SharedRow) {
+    uint32_t old_min_size = FLAGS_zero_copy_min_row_size;
+    FLAGS_zero_copy_min_row_size = 8;
+    std::string row(32, 'r');
+    butil::IOBuf buf1;
+    butil::IOBuf buf2;
+    {
+        RowRefAppender appender1(&buf1);
+        RowRefAppender appender2(&buf2);
+        appender1.Append(row.data(), row.size());
+        appender2.Append(row.data(), row.size());
+        appender1.Append(row.data(), row.size());
+    }
+    ASSERT_EQ(3u, RowRefAppender::GetPinnedCnt());
+    buf2.clear();
+    ASSERT_EQ(2u, RowRefAppender::GetPinnedCnt());
+    ASSERT_EQ(row + row, buf1.to_string());
+    buf1.clear();
+    ASSERT_EQ(0u, RowRefAppender::GetPinnedCnt());
+    FLAGS_zero_copy_min_row_size = old_min_size;
+}
+
+TEST_F(RowRefAppenderTest, MaxPinnedBytes) {
+    uint32_t old_min_size = FLAGS_zero_copy_min_row_size;
+    uint32_t old_max_mb = FLAGS_zero_copy_max_pinned_mb;
+    FLAGS_zero_copy_min_row_size = 8;
+    FLAGS_zero_copy_max_pinned_mb = 1;
+    std::string row(512 * 1024, 'r');
+    butil::IOBuf buf;
+    {
+        RowRefAppender appender(&buf);
+        appender.Append(row.data(), row.size());
+        appender.Append(row.data(), row.size());
+        // the row is copied as the pinned rows take 1MB
+        appender.Append(row.data(), row.size());
+    }
+    ASSERT_EQ(2u, RowRefAppender::GetPinnedCnt());
+    ASSERT_EQ(row.size() * 2, RowRefAppender::GetPinnedBytes());
+    ASSERT_EQ(row.size() * 3, buf.size());
+    buf.clear();
+    ASSERT_EQ(0u, RowRefAppender::GetPinnedCnt());
+    ASSERT_EQ(0u, RowRefAppender::GetPinnedBytes());
+    FLAGS_zero_copy_min_row_size = old_min_size;
+    FLAGS_zero_copy_max_pinned_mb = old_max_mb;
+}
+
+TEST_F(RowRefAppenderTest, MaxPinTime) {
+    uint32_t old_min_size = FLAGS_zero_copy_min_row_size;
+    uint32_t old_max_ms = FLAGS_zero_copy_max_pin_ms;
+    FLAGS_zero_copy_min_row_size = 8;
+    FLAGS_zero_copy_max_pin_ms = 10;
+    std::string row(32, 'r');
+    butil::IOBuf slow_buf;
+    {
+        RowRefAppender appender(&slow_buf);
+        appender.Append(row.data(), row.size());
+    }
+    ASSERT_EQ(1u, RowRefAppender::GetPinnedCnt());
+    // the client of slow_buf does not read it, so the new responses stop pinning
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    butil::IOBuf buf;
+    {
+        RowRefAppender appender(&buf);
+        appender.Append(row.data(), row.size());
+    }
+    ASSERT_EQ(1u, RowRefAppender::GetPinnedCnt());
+    ASSERT_EQ(row, buf.to_string());
+    slow_buf.clear();
+    ASSERT_EQ(0u, RowRefAppender::GetPinnedCnt());
+    buf.clear();
+    {
+        RowRefAppender appender(&buf);
+        appender.Append(row.data(), row.size());
+    }
+    ASSERT_EQ(1u, RowRefAppender::GetPinnedCnt());
+    buf.clear();
+    FLAGS_zero_copy_min_row_size = old_min_size;
+    FLAGS_zero_copy_max_pin_ms = old_max_ms;
+}
+
+}  // namespace tablet
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    return RUN_ALL_TESTS();
+}
@@ -48,6 +48,7 @@
 #include "base/status.h"
 #include "base/strings.h"
 #include "brpc/controller.h"
+#include "brpc/stream.h"
 #include "butil/iobuf.h"
 #include "codec/codec.h"
 #include "codec/row_codec.h"
@@ -58,6 +59,7 @@
 #include "storage/binlog.h"
 #include "storage/segment.h"
 #include "tablet/file_sender.h"
+#include "tablet/query_stream.h"
 #include "storage/table.h"
 #include "storage/disk_table_snapshot.h"
 #include "absl/cleanup/cleanup.h"
@@ -80,6 +82,7 @@ DECLARE_string(db_root_path);
 DECLARE_string(ssd_root_path);
 DECLARE_string(hdd_root_path);
 DECLARE_bool(binlog_notify_on_put);
+DECLARE_bool(binlog_sync_on_append);
 DECLARE_int32(task_pool_size);
 DECLARE_int32(io_pool_size);
 DECLARE_int32(make_snapshot_time);
@@ -97,6 +100,7 @@ DECLARE_uint32(load_index_max_wait_time);
 DECLARE_bool(use_name);
 DECLARE_bool(enable_distsql);
 DECLARE_string(snapshot_compression);
+DECLARE_bool(snapshot_memory_image);
 DECLARE_string(file_compression);
 
 // cluster config
@@ -116,6 +120,17 @@ DECLARE_uint32(snapshot_ttl_check_interval);
 DECLARE_uint32(put_slow_log_threshold);
 DECLARE_uint32(query_slow_log_threshold);
 DECLARE_int32(snapshot_pool_size);
+DECLARE_int32(stream_query_pool_size);
+DECLARE_uint32(stream_query_chunk_size);
+DECLARE_int32(request_timeout_ms);
+DECLARE_bool(enable_shared_jit);
+DECLARE_bool(enable_jit_disk_cache);
+DECLARE_bool(enable_deploy_jit_cache);
+DECLARE_uint32(jit_cache_max_mb);
+DECLARE_uint32(deploy_compile_threads);
+DECLARE_uint32(max_sql_cache_size);
+DECLARE_uint64(max_sql_cache_bytes);
+DECLARE_bool(enable_tiered_jit);
 
 namespace openmldb {
 namespace tablet {
@@ -125,6 +140,13 @@ static const uint32_t SEED = 0xe17a1465;
 
 static constexpr const char DEPLOY_STATS[] = "deploy_stats";
 
+// the rows of memtables are pinned by tickets, but the ones of disk tables and the disk tier of memtables
+// are owned by the iterators
+static bool IsRowPinned(const std::shared_ptr<Table>& table) {
+    auto mem_table = std::dynamic_pointer_cast<::openmldb::storage::MemTable>(table);
+    return mem_table && mem_table->GetTier() == NULL;
+}
+
 TabletImpl::TabletImpl()
     : tables_(),
       mu_(),
@@ -136,6 +158,7 @@ TabletImpl::TabletImpl()
       task_pool_(FLAGS_task_pool_size),
       io_pool_(FLAGS_io_pool_size),
       snapshot_pool_(FLAGS_snapshot_pool_size),
+      stream_query_pool_(FLAGS_stream_query_pool_size),
       mode_root_paths_(),
       mode_recycle_root_paths_(),
       follower_(false),
@@ -205,6 +228,16 @@ bool TabletImpl::Init(const std::string& zk_cluster, const std::string& zk_path,
     } else {
         options.SetClusterOptimized(false);
     }
+    options.SetMaxSqlCacheSize(FLAGS_max_sql_cache_size);
+    options.SetMaxSqlCacheBytes(FLAGS_max_sql_cache_bytes);
+    options.SetEnableTieredJit(FLAGS_enable_tiered_jit);
+    options.jit_options().SetEnableSharedJit(FLAGS_enable_shared_jit);
+    const auto& memory_root_paths = mode_root_paths_[::openmldb::common::kMemory];
+    if ((FLAGS_enable_jit_disk_cache || FLAGS_enable_deploy_jit_cache) && !memory_root_paths.empty()) {
+        options.jit_options().SetObjectCacheDir(memory_root_paths[0] + "/jit_cache");
+        options.jit_options().SetPersistObject(FLAGS_enable_shared_jit && FLAGS_enable_jit_disk_cache);
+        options.jit_options().SetMaxObjectCacheDirBytes(static_cast<uint64_t>(FLAGS_jit_cache_max_mb) * 1024 * 1024);
+    }
     engine_ = std::unique_ptr<::hybridse::vm::Engine>(new ::hybridse::vm::Engine(catalog_, options));
     catalog_->SetLocalTablet(
         std::shared_ptr<::hybridse::vm::Tablet>(new ::hybridse::vm::LocalTablet(engine_.get(), sp_cache_)));
@@ -727,9 +760,11 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
         response->set_msg("table is loading");
         return;
     }
+    // the row is in the table before it's in the binlog, the guard lets the memory image wait for it
+    ::openmldb::storage::TableWriteGuard write_guard(table.get());
     bool ok = false;
     if (request->dimensions_size() > 0) {
-        int32_t ret_code = CheckDimessionPut(request, table->GetIdxCnt());
+        int32_t ret_code = CheckDimessionPut(request->dimensions(), table->GetIdxCnt());
         if (ret_code != 0) {
             response->set_code(::openmldb::base::ReturnCode::kInvalidDimensionParameter);
             response->set_msg("invalid dimension parameter");
@@ -764,7 +799,12 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
         if (request->ts_dimensions_size() > 0) {
             entry.mutable_ts_dimensions()->CopyFrom(request->ts_dimensions());
         }
-        replicator->AppendEntry(entry);
+        if (!replicator->AppendEntry(entry) && FLAGS_binlog_sync_on_append) {
+            PDLOG(WARNING, "fail to write binlog. tid %u, pid %u", request->tid(), request->pid());
+            response->set_code(::openmldb::base::ReturnCode::kError);
+            response->set_msg("fail to write binlog");
+            return;
+        }
     } while (false);
 
     ok = UpdateAggrs(request->tid(), request->pid(), request->value(),
@@ -806,6 +846,113 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
     }
 }
 
+void TabletImpl::PutBatch(RpcController* controller, const ::openmldb::api::PutBatchRequest* request,
+                          ::openmldb::api::PutBatchResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    response->set_put_cnt(0);
+    if (follower_.load(std::memory_order_relaxed)) {
+        response->set_code(::openmldb::base::ReturnCode::kIsFollowerCluster);
+        response->set_msg("is follower cluster");
+        return;
+    }
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    std::shared_ptr<Table> table = GetTable(request->tid(), request->pid());
+    if (!table) {
+        PDLOG(WARNING, "table is not exist. tid %u, pid %u", request->tid(), request->pid());
+        response->set_code(::openmldb::base::ReturnCode::kTableIsNotExist);
+        response->set_msg("table is not exist");
+        return;
+    }
+    if (!table->IsLeader()) {
+        response->set_code(::openmldb::base::ReturnCode::kTableIsFollower);
+        response->set_msg("table is follower");
+        return;
+    }
+    if (table->GetTableStat() == ::openmldb::storage::kLoading) {
+        PDLOG(WARNING, "table is loading. tid %u, pid %u", request->tid(), request->pid());
+        response->set_code(::openmldb::base::ReturnCode::kTableIsLoading);
+        response->set_msg("table is loading");
+        return;
+    }
+    const butil::IOBuf& buf = static_cast<brpc::Controller*>(controller)->request_attachment();
+    uint64_t total_size = 0;
+    for (const auto& row : request->rows()) {
+        if (row.dimensions_size() == 0 || CheckDimessionPut(row.dimensions(), table->GetIdxCnt()) != 0) {
+            response->set_code(::openmldb::base::ReturnCode::kInvalidDimensionParameter);
+            response->set_msg("invalid dimension parameter");
+            return;
+        }
+        total_size += row.size();
+    }
+    if (total_size != buf.size()) {
+        PDLOG(WARNING, "row size mismatch. expect %lu, actual %lu. tid %u, pid %u", total_size, buf.size(),
+              request->tid(), request->pid());
+        response->set_code(::openmldb::base::ReturnCode::kInvalidParameter);
+        response->set_msg("row size mismatch");
+        return;
+    }
+    butil::IOBufBytesIterator buf_it(buf);
+    std::vector<::openmldb::api::LogEntry> entries(request->rows_size());
+    ::openmldb::storage::TableWriteGuard write_guard(table.get());
+    int put_cnt = 0;
+    for (; put_cnt < request->rows_size(); put_cnt++) {
+        const auto& row = request->rows(put_cnt);
+        auto& entry = entries[put_cnt];
+        std::string* value = entry.mutable_value();
+        value->resize(row.size());
+        buf_it.copy_and_forward(&(*value)[0], row.size());
+        if (!table->Put(row.time(), *value, row.dimensions())) {
+            break;
+        }
+        entry.set_ts(row.time());
+        entry.mutable_dimensions()->CopyFrom(row.dimensions());
+    }
+    entries.resize(put_cnt);
+    response->set_put_cnt(put_cnt);
+    if (put_cnt < request->rows_size()) {
+        response->set_code(::openmldb::base::ReturnCode::kPutFailed);
+        response->set_msg("put failed");
+    } else {
+        response->set_code(::openmldb::base::ReturnCode::kOk);
+    }
+    if (entries.empty()) {
+        return;
+    }
+    // the rows share one group commit of binlog
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(request->tid(), request->pid());
+    if (!replicator) {
+        PDLOG(WARNING, "fail to find table tid %u pid %u leader's log replicator", request->tid(), request->pid());
+    } else {
+        uint64_t term = replicator->GetLeaderTerm();
+        for (auto& entry : entries) {
+            entry.set_term(term);
+        }
+        if (!replicator->AppendEntries(entries) && FLAGS_binlog_sync_on_append) {
+            PDLOG(WARNING, "fail to write binlog. tid %u, pid %u", request->tid(), request->pid());
+            response->set_code(::openmldb::base::ReturnCode::kError);
+            response->set_msg("fail to write binlog");
+            return;
+        }
+    }
+    if (!UpdateAggrs(request->tid(), request->pid(), entries)) {
+        response->set_code(::openmldb::base::ReturnCode::kError);
+        response->set_msg("update aggr failed");
+        return;
+    }
+    uint64_t end_time = ::baidu::common::timer::get_micros();
+    if (start_time + FLAGS_put_slow_log_threshold < end_time) {
+        PDLOG(INFO, "slow log[put batch]. row cnt %d time %lu. tid %u, pid %u", put_cnt, end_time - start_time,
+              request->tid(), request->pid());
+    }
+    if (replicator && FLAGS_binlog_notify_on_put) {
+        replicator->Notify();
+    }
+    if (!IsClusterMode() && table->GetDB() == openmldb::nameserver::INFORMATION_SCHEMA_DB &&
+        table->GetName() == openmldb::nameserver::GLOBAL_VARIABLES) {
+        UpdateGlobalVarTable();
+    }
+}
+
 int TabletImpl::CheckTableMeta(const openmldb::api::TableMeta* table_meta, std::string& msg) {
     msg.clear();
     if (table_meta->name().empty()) {
@@ -885,9 +1032,10 @@ int TabletImpl::CheckTableMeta(const openmldb::api::TableMeta* table_meta, std::
 
 int32_t TabletImpl::ScanIndex(const ::openmldb::api::ScanRequest* request, const ::openmldb::api::TableMeta& meta,
                               const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema,
-                              CombineIterator* combine_it, butil::IOBuf* io_buf, uint32_t* count, bool* is_finish) {
+                              CombineIterator* combine_it, RowRefAppender* appender, bool rows_pinned,
+                              uint32_t* count, bool* is_finish) {
     uint32_t limit = request->limit();
-    if (combine_it == nullptr || io_buf == nullptr || count == nullptr || is_finish == nullptr) {
+    if (combine_it == nullptr || appender == nullptr || count == nullptr || is_finish == nullptr) {
         PDLOG(WARNING, "invalid args");
         return -1;
     }
@@ -920,6 +1068,8 @@ int32_t TabletImpl::ScanIndex(const ::openmldb::api::ScanRequest* request, const
         enable_project = true;
     }
     bool remove_duplicated_record = request->enable_remove_duplicated_record();
+    bool with_pairs = request->pairs_in_attachment();
+    char header[::openmldb::codec::PAIR_HEADER_SIZE];
     uint64_t last_time = 0;
     uint32_t total_block_size = 0;
     uint32_t record_count = 0;
@@ -954,11 +1104,23 @@ int32_t TabletImpl::ScanIndex(const ::openmldb::api::ScanRequest* request, const
                 PDLOG(WARNING, "fail to make a projection");
                 return -4;
             }
-            io_buf->append(reinterpret_cast<void*>(ptr), size);
+            if (with_pairs) {
+                ::openmldb::codec::EncodeHeader(ts, size, header);
+                appender->AppendCopy(header, sizeof(header));
+            }
+            appender->AppendOwned(reinterpret_cast<char*>(ptr), size);
             total_block_size += size;
         } else {
             openmldb::base::Slice data = combine_it->GetValue();
-            io_buf->append(reinterpret_cast<const void*>(data.data()), data.size());
+            if (with_pairs) {
+                ::openmldb::codec::EncodeHeader(ts, data.size(), header);
+                appender->AppendCopy(header, sizeof(header));
+            }
+            if (rows_pinned) {
+                appender->Append(data.data(), data.size());
+            } else {
+                appender->AppendCopy(data.data(), data.size());
+            }
             total_block_size += data.size();
         }
         record_count++;
@@ -1195,6 +1357,14 @@ void TabletImpl::Scan(RpcController* controller, const ::openmldb::api::ScanRequ
     std::vector<QueryIt> query_its(pid_num);
     std::shared_ptr<::openmldb::storage::TTLSt> ttl;
     ::openmldb::storage::TTLSt expired_value;
+    bool use_attachment = request->use_attachment() || request->pairs_in_attachment();
+    auto* cntl = dynamic_cast<brpc::Controller*>(controller);
+    // it's created before the iterators, so its ticket pins the rows they read
+    std::unique_ptr<RowRefAppender> appender;
+    if (use_attachment) {
+        appender.reset(new RowRefAppender(&cntl->response_attachment()));
+    }
+    bool rows_pinned = true;
     for (uint32_t idx = 0; idx < pid_num; idx++) {
         uint32_t pid = 0;
         if (request->pid_group_size() > 0) {
@@ -1243,6 +1413,7 @@ void TabletImpl::Scan(RpcController* controller, const ::openmldb::api::ScanRequ
             return;
         }
         query_its[idx].table = table;
+        rows_pinned = rows_pinned && IsRowPinned(table);
     }
     auto table_meta = query_its.begin()->table->GetTableMeta();
     const std::map<int32_t, std::shared_ptr<Schema>> vers_schema = query_its.begin()->table->GetAllVersionSchema();
@@ -1250,13 +1421,13 @@ void TabletImpl::Scan(RpcController* controller, const ::openmldb::api::ScanRequ
     uint32_t count = 0;
     int32_t code = 0;
     bool is_finish = true;
-    if (!request->has_use_attachment() || !request->use_attachment()) {
+    if (!use_attachment) {
         std::string* pairs = response->mutable_pairs();
         code = ScanIndex(request, *table_meta, vers_schema, &combine_it, pairs, &count, &is_finish);
     } else {
-        auto* cntl = dynamic_cast<brpc::Controller*>(controller);
         butil::IOBuf& buf = cntl->response_attachment();
-        code = ScanIndex(request, *table_meta, vers_schema, &combine_it, &buf, &count, &is_finish);
+        code = ScanIndex(request, *table_meta, vers_schema, &combine_it, appender.get(), rows_pinned, &count,
+                         &is_finish);
         response->set_buf_size(buf.size());
         DLOG(INFO) << " scan " << request->pk() << " with buf size " << buf.size();
     }
@@ -1407,6 +1578,11 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
         return;
     }
     index = index_def->GetId();
+    // it's created before the iterator, so its ticket pins the rows the iterator reads
+    std::unique_ptr<RowRefAppender> appender;
+    if (request->pairs_in_attachment()) {
+        appender.reset(new RowRefAppender(&dynamic_cast<brpc::Controller*>(controller)->response_attachment()));
+    }
     ::openmldb::storage::TableIterator* it = table->NewTraverseIterator(index);
     if (it == NULL) {
         response->set_code(::openmldb::base::ReturnCode::kTsNameNotFound);
@@ -1477,25 +1653,46 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
     } else if (scount < request->limit()) {
         is_finish = true;
     }
-    uint32_t total_size = scount * (8 + 4 + 4) + total_block_size;
-    std::string* pairs = response->mutable_pairs();
-    if (scount <= 0) {
-        pairs->resize(0);
+    if (appender) {
+        bool rows_pinned = IsRowPinned(table);
+        char header[::openmldb::codec::FULL_PAIR_HEADER_SIZE];
+        for (const auto& key : key_seq) {
+            auto iter = value_map.find(key);
+            if (iter == value_map.end()) {
+                continue;
+            }
+            for (const auto& pair : iter->second) {
+                ::openmldb::codec::EncodeFullHeader(key, pair.first, pair.second.size(), header);
+                appender->AppendCopy(header, sizeof(header));
+                appender->AppendCopy(key.data(), key.length());
+                if (rows_pinned) {
+                    appender->Append(pair.second.data(), pair.second.size());
+                } else {
+                    appender->AppendCopy(pair.second.data(), pair.second.size());
+                }
+            }
+        }
     } else {
-        pairs->resize(total_size);
-    }
-    char* rbuffer = reinterpret_cast<char*>(&((*pairs)[0]));
-    uint32_t offset = 0;
-    for (const auto& key : key_seq) {
-        auto iter = value_map.find(key);
-        if (iter == value_map.end()) {
-            continue;
+        uint32_t total_size = scount * (8 + 4 + 4) + total_block_size;
+        std::string* pairs = response->mutable_pairs();
+        if (scount <= 0) {
+            pairs->resize(0);
+        } else {
+            pairs->resize(total_size);
         }
-        for (const auto& pair : iter->second) {
-            DEBUGLOG("encode pk %s ts %lu size %u", key.c_str(), pair.first, pair.second.size());
-            ::openmldb::codec::EncodeFull(key, pair.first, pair.second.data(), pair.second.size(), rbuffer,
-                                          offset);
-            offset += (4 + 4 + 8 + key.length() + pair.second.size());
+        char* rbuffer = reinterpret_cast<char*>(&((*pairs)[0]));
+        uint32_t offset = 0;
+        for (const auto& key : key_seq) {
+            auto iter = value_map.find(key);
+            if (iter == value_map.end()) {
+                continue;
+            }
+            for (const auto& pair : iter->second) {
+                DEBUGLOG("encode pk %s ts %lu size %u", key.c_str(), pair.first, pair.second.size());
+                ::openmldb::codec::EncodeFull(key, pair.first, pair.second.data(), pair.second.size(), rbuffer,
+                                              offset);
+                offset += (4 + 4 + 8 + key.length() + pair.second.size());
+            }
         }
     }
     delete it;
@@ -1612,13 +1809,13 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
             }
             column->set_type(hybridse_type);
         }
-        ::hybridse::vm::BatchRunSession session;
+        auto session = std::make_shared<::hybridse::vm::BatchRunSession>();
         if (request->is_debug()) {
-            session.EnableDebug();
+            session->EnableDebug();
         }
-        session.SetParameterSchema(parameter_schema);
+        session->SetParameterSchema(parameter_schema);
         {
-            bool ok = engine_->Get(request->sql(), request->db(), session, status);
+            bool ok = engine_->Get(request->sql(), request->db(), *session, status);
             if (!ok) {
                 response->set_msg(status.msg);
                 response->set_code(::openmldb::base::kSQLCompileError);
@@ -1636,8 +1833,12 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
             response->set_msg("fail to decode parameter row");
             return;
         }
+        if (request->stream_result()) {
+            RunStreamQuery(ctrl, session, parameter_row, response);
+            return;
+        }
         std::vector<::hybridse::codec::Row> output_rows;
-        int32_t run_ret = session.Run(parameter_row, output_rows);
+        int32_t run_ret = session->Run(parameter_row, output_rows);
         if (run_ret != 0) {
             response->set_msg(status.msg);
             response->set_code(::openmldb::base::kSQLRunError);
@@ -1649,7 +1850,7 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
         for (auto& output_row : output_rows) {
             if (byte_size > FLAGS_scan_max_bytes_size) {
                 LOG(WARNING) << "reach the max byte size truncate result";
-                response->set_schema(session.GetEncodedSchema());
+                response->set_schema(session->GetEncodedSchema());
                 response->set_byte_size(byte_size);
                 response->set_count(count);
                 response->set_code(::openmldb::base::kOk);
@@ -1659,7 +1860,7 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
             buf->append(reinterpret_cast<void*>(output_row.buf()), output_row.size());
             count += 1;
         }
-        response->set_schema(session.GetEncodedSchema());
+        response->set_schema(session->GetEncodedSchema());
         response->set_byte_size(byte_size);
         response->set_count(count);
         response->set_code(::openmldb::base::kOk);
@@ -1706,6 +1907,30 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
     }
 }
 
+void TabletImpl::RunStreamQuery(RpcController* ctrl, const std::shared_ptr<::hybridse::vm::BatchRunSession>& session,
+                                const ::hybridse::codec::Row& parameter_row,
+                                openmldb::api::QueryResponse* response) {
+    brpc::StreamId stream_id;
+    brpc::StreamOptions options;
+    options.max_buf_size = 2 * FLAGS_stream_query_chunk_size;
+    if (brpc::StreamAccept(&stream_id, *static_cast<brpc::Controller*>(ctrl), &options) != 0) {
+        response->set_code(::openmldb::base::kSQLRunError);
+        response->set_msg("fail to accept the query stream");
+        PDLOG(WARNING, "fail to accept the query stream");
+        return;
+    }
+    // the rows are pushed once the response is sent, as the stream is connected then
+    stream_query_pool_.AddTask([stream_id, session, parameter_row]() {
+        PushQueryStream(stream_id, session->GetCompileInfo()->GetSql(),
+                        [&session, &parameter_row](const std::function<bool(const ::hybridse::codec::Row&)>& on_row) {
+                            return session->Run(parameter_row, on_row);
+                        });
+    });
+    response->set_schema(session->GetEncodedSchema());
+    response->set_stream_result(true);
+    response->set_code(::openmldb::base::kOk);
+}
+
 void TabletImpl::SubQuery(RpcController* ctrl, const openmldb::api::QueryRequest* request,
                           openmldb::api::QueryResponse* response, Closure* done) {
     DLOG(INFO) << "handle subquery request begin!";
@@ -2341,6 +2566,7 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
             std::shared_ptr<LogReplicator> replicator = GetReplicatorUnLock(table->GetId(), table->GetPid());
             if (replicator) {
                 status->set_offset(replicator->GetOffset());
+                status->set_binlog_sync_fail_cnt(replicator->GetSyncFailCnt());
             }
             status->set_record_cnt(table->GetRecordCnt());
             if (table->GetStorageMode() == common::kMemory) {
@@ -2350,6 +2576,8 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
                     status->set_record_idx_byte_size(mem_table->GetRecordIdxByteSize());
                     status->set_record_pk_cnt(mem_table->GetRecordPkCnt());
                     status->set_skiplist_height(mem_table->GetKeyEntryHeight());
+                    status->set_gc_byte_rate(mem_table->GetGcByteRate());
+                    status->set_gc_lag_ms(mem_table->GetGcLag());
                     uint64_t record_idx_cnt = 0;
                     auto indexs = table->GetAllIndex();
                     for (const auto& index_def : indexs) {
@@ -2368,9 +2596,24 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
                     }
                     status->set_idx_cnt(record_idx_cnt);
                 }
+            } else if (DiskTable* disk_table = dynamic_cast<DiskTable*>(table.get())) {
+                if (::openmldb::storage::DiskRowCache* row_cache = disk_table->GetRowCache()) {
+                    status->set_row_cache_hit_cnt(row_cache->GetHitCnt());
+                    status->set_row_cache_miss_cnt(row_cache->GetMissCnt());
+                    status->set_row_cache_byte_size(row_cache->GetByteSize());
+                }
             }
         }
     }
+    auto cache_stats = engine_->GetCacheStats();
+    auto sql_cache_status = response->mutable_sql_cache_status();
+    sql_cache_status->set_hit_cnt(cache_stats.hit_cnt);
+    sql_cache_status->set_miss_cnt(cache_stats.miss_cnt);
+    sql_cache_status->set_wait_cnt(cache_stats.wait_cnt);
+    sql_cache_status->set_compile_time_us(cache_stats.compile_time_us);
+    sql_cache_status->set_entry_cnt(cache_stats.entry_cnt);
+    sql_cache_status->set_byte_size(cache_stats.byte_size);
+    sql_cache_status->set_upgrade_cnt(cache_stats.upgrade_cnt);
     response->set_code(::openmldb::base::ReturnCode::kOk);
 }
 
@@ -2454,6 +2697,13 @@ void TabletImpl::MakeSnapshotInternal(uint32_t tid, uint32_t pid, uint64_t end_o
         ret = snapshot->MakeSnapshot(table, offset, end_offset, replicator->GetLeaderTerm());
         if (ret == 0) {
             replicator->SetSnapshotLogPartIndex(offset);
+            auto mem_snapshot = std::dynamic_pointer_cast<::openmldb::storage::MemTableSnapshot>(snapshot);
+            if (FLAGS_snapshot_memory_image && mem_snapshot) {
+                // the image only speeds up the recovery, the snapshot is still valid if it fails
+                if (mem_snapshot->MakeImage(table, [replicator] { return replicator->GetOffset(); }) < 0) {
+                    PDLOG(WARNING, "fail to make memory image. tid[%u] pid[%u]", tid, pid);
+                }
+            }
         }
     }
     {
@@ -3787,7 +4037,10 @@ int TabletImpl::CreateTableInternal(const ::openmldb::api::TableMeta* table_meta
     std::string table_db_path = GetDBPath(db_root_path, tid, pid);
     Table* table_ptr;
     if (table_meta->storage_mode() == openmldb::common::kMemory) {
-        table_ptr = new MemTable(*table_meta);
+        MemTable* mem_table = new MemTable(*table_meta);
+        // the disk tier is opened only if mem_table_tier_age is set
+        mem_table->SetTierPath(table_db_path + "/tier");
+        table_ptr = mem_table;
     } else {
         table_ptr = new DiskTable(*table_meta, table_db_path);
     }
@@ -4133,6 +4386,25 @@ bool TabletImpl::UpdateAggrs(uint32_t tid, uint32_t pid, const std::string& valu
     if (!aggrs) {
         return true;
     }
+    return UpdateAggrs(tid, pid, aggrs, value, dimensions, log_offset);
+}
+
+bool TabletImpl::UpdateAggrs(uint32_t tid, uint32_t pid, const std::vector<::openmldb::api::LogEntry>& entries) {
+    auto aggrs = GetAggregators(tid, pid);
+    if (!aggrs) {
+        return true;
+    }
+    for (const auto& entry : entries) {
+        if (!UpdateAggrs(tid, pid, aggrs, entry.value(), entry.dimensions(), entry.log_index())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TabletImpl::UpdateAggrs(uint32_t tid, uint32_t pid, const std::shared_ptr<Aggrs>& aggrs,
+                             const std::string& value, const ::openmldb::storage::Dimensions& dimensions,
+                             uint64_t log_offset) {
     for (auto iter = dimensions.begin(); iter != dimensions.end(); ++iter) {
         for (auto aggr : *aggrs) {
             if (aggr->GetIndexPos() != iter->idx()) {
@@ -4319,6 +4591,7 @@ void TabletImpl::RefreshTableInfo() {
     auto old_db_sp_map = catalog_->GetProcedures();
     catalog_->Refresh(table_info_vec, version, db_sp_map);
     // skip exist procedure, don`t need recompile
+    std::vector<std::shared_ptr<hybridse::sdk::ProcedureInfo>> new_sp_infos;
     for (const auto& db_sp_map_kv : db_sp_map) {
         const auto& db = db_sp_map_kv.first;
         auto old_db_sp_map_it = old_db_sp_map.find(db);
@@ -4330,15 +4603,16 @@ void TabletImpl::RefreshTableInfo() {
                 if (old_sp_map_it != old_sp_map.end()) {
                     continue;
                 } else {
-                    CreateProcedure(sp_map_kv.second);
+                    new_sp_infos.push_back(sp_map_kv.second);
                 }
             }
         } else {
             for (const auto& sp_map_kv : db_sp_map_kv.second) {
-                CreateProcedure(sp_map_kv.second);
+                new_sp_infos.push_back(sp_map_kv.second);
             }
         }
     }
+    CreateProcedures(new_sp_infos);
 
     RefreshAggrCatalog();
 }
@@ -4391,17 +4665,17 @@ bool TabletImpl::RefreshAggrCatalog() {
     return true;
 }
 
-int TabletImpl::CheckDimessionPut(const ::openmldb::api::PutRequest* request, uint32_t idx_cnt) {
-    for (int32_t i = 0; i < request->dimensions_size(); i++) {
-        if (idx_cnt <= request->dimensions(i).idx()) {
+int TabletImpl::CheckDimessionPut(const ::openmldb::storage::Dimensions& dimensions, uint32_t idx_cnt) {
+    for (int32_t i = 0; i < dimensions.size(); i++) {
+        if (idx_cnt <= dimensions.Get(i).idx()) {
             PDLOG(WARNING,
                   "invalid put request dimensions, request idx %u is greater "
                   "than table idx cnt %u",
-                  request->dimensions(i).idx(), idx_cnt);
+                  dimensions.Get(i).idx(), idx_cnt);
             return -1;
         }
-        if (request->dimensions(i).key().length() <= 0) {
-            PDLOG(WARNING, "invalid put request dimension key is empty with idx %u", request->dimensions(i).idx());
+        if (dimensions.Get(i).key().length() <= 0) {
+            PDLOG(WARNING, "invalid put request dimension key is empty with idx %u", dimensions.Get(i).idx());
             return 1;
         }
     }
@@ -5280,6 +5554,25 @@ bool TabletImpl::GetRealEp(uint64_t tid, uint64_t pid, std::map<std::string, std
     return true;
 }
 
+static std::shared_ptr<std::unordered_map<std::string, std::string>> GetProcedureOptions(
+    const std::shared_ptr<hybridse::sdk::ProcedureInfo>& sp_info) {
+    auto options = std::make_shared<std::unordered_map<std::string, std::string>>();
+    auto long_windows = sp_info->GetOption(hybridse::vm::LONG_WINDOWS);
+    if (long_windows) {
+        options->emplace(hybridse::vm::LONG_WINDOWS, *long_windows);
+    }
+    // the deployments are kept long, so they share the jit and the modules compiled even if it's disabled for the
+    // other sqls
+    options->emplace(hybridse::vm::SHARED_JIT, "true");
+    // the objects of the procedures are kept on disk, so they are loaded instead of compiled after a restart
+    if (FLAGS_enable_deploy_jit_cache) {
+        options->emplace(hybridse::vm::PERSIST_OBJECT, "true");
+    }
+    // the compiling results are kept in sp cache, which are not replaced by the tiered jit
+    options->emplace(hybridse::vm::FULL_OPTIMIZE, "true");
+    return options;
+}
+
 void TabletImpl::CreateProcedure(RpcController* controller, const openmldb::api::CreateProcedureRequest* request,
                                  openmldb::api::GeneralResponse* response, Closure* done) {
     brpc::ClosureGuard done_guard(done);
@@ -5296,12 +5589,7 @@ void TabletImpl::CreateProcedure(RpcController* controller, const openmldb::api:
     ::hybridse::base::Status status;
     auto sp_info_impl = std::make_shared<openmldb::catalog::ProcedureInfoImpl>(sp_info);
 
-    auto long_windows = sp_info_impl->GetOption(hybridse::vm::LONG_WINDOWS);
-    std::shared_ptr<std::unordered_map<std::string, std::string>> options = nullptr;
-    if (long_windows) {
-        options = std::make_shared<std::unordered_map<std::string, std::string>>();
-        options->emplace(hybridse::vm::LONG_WINDOWS, *long_windows);
-    }
+    auto options = GetProcedureOptions(sp_info_impl);
 
     // build for single request
     ::hybridse::vm::RequestRunSession session;
@@ -5425,16 +5713,29 @@ void TabletImpl::RunRequestQuery(RpcController* ctrl, const openmldb::api::Query
     response.set_code(::openmldb::base::kOk);
 }
 
+void TabletImpl::CreateProcedures(const std::vector<std::shared_ptr<hybridse::sdk::ProcedureInfo>>& sp_infos) {
+    if (sp_infos.size() <= 1 || FLAGS_deploy_compile_threads <= 1) {
+        for (const auto& sp_info : sp_infos) {
+            CreateProcedure(sp_info);
+        }
+        return;
+    }
+    // the procedures are all recompiled after a restart, compile them in parallel
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    ThreadPool pool(std::min(static_cast<uint32_t>(sp_infos.size()), FLAGS_deploy_compile_threads));
+    for (const auto& sp_info : sp_infos) {
+        pool.AddTask([this, sp_info] { CreateProcedure(sp_info); });
+    }
+    pool.Stop(true);
+    PDLOG(INFO, "create %lu procedures in %lu ms", sp_infos.size(),
+          (::baidu::common::timer::get_micros() - start_time) / 1000);
+}
+
 void TabletImpl::CreateProcedure(const std::shared_ptr<hybridse::sdk::ProcedureInfo>& sp_info) {
     const std::string& db_name = sp_info->GetDbName();
     const std::string& sp_name = sp_info->GetSpName();
     const std::string& sql = sp_info->GetSql();
-    auto long_windows = sp_info->GetOption(hybridse::vm::LONG_WINDOWS);
-    std::shared_ptr<std::unordered_map<std::string, std::string>> options = nullptr;
-    if (long_windows) {
-        options = std::make_shared<std::unordered_map<std::string, std::string>>();
-        options->emplace(hybridse::vm::LONG_WINDOWS, *long_windows);
-    }
+    auto options = GetProcedureOptions(sp_info);
 
     ::hybridse::base::Status status;
     // build for single request
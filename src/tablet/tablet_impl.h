@@ -42,6 +42,7 @@
 #include "tablet/bulk_load_mgr.h"
 #include "tablet/combine_iterator.h"
 #include "tablet/file_receiver.h"
+#include "tablet/row_ref_appender.h"
 #include "tablet/sp_cache.h"
 #include "vm/engine.h"
 #include "zk/zk_client.h"
@@ -86,6 +87,9 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     void Put(RpcController* controller, const ::openmldb::api::PutRequest* request,
              ::openmldb::api::PutResponse* response, Closure* done);
 
+    void PutBatch(RpcController* controller, const ::openmldb::api::PutBatchRequest* request,
+                  ::openmldb::api::PutBatchResponse* response, Closure* done);
+
     void Get(RpcController* controller, const ::openmldb::api::GetRequest* request,
              ::openmldb::api::GetResponse* response, Closure* done);
 
@@ -251,9 +255,11 @@ class TabletImpl : public ::openmldb::api::TabletServer {
                       const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, CombineIterator* combine_it,
                       std::string* pairs, uint32_t* count, bool* is_finish);
 
+    // the rows are appended to the attachment by reference if rows_pinned, and they are encoded as the pairs
+    // if the request asks for pairs_in_attachment
     int32_t ScanIndex(const ::openmldb::api::ScanRequest* request, const ::openmldb::api::TableMeta& meta,
                       const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, CombineIterator* combine_it,
-                      butil::IOBuf* buf, uint32_t* count, bool* is_finish);
+                      RowRefAppender* appender, bool rows_pinned, uint32_t* count, bool* is_finish);
 
     int32_t CountIndex(uint64_t expire_time, uint64_t expire_cnt, ::openmldb::storage::TTLType ttl_type,
                        ::openmldb::storage::TableIterator* it, const ::openmldb::api::CountRequest* request,
@@ -375,7 +381,7 @@ class TabletImpl : public ::openmldb::api::TabletServer {
 
     std::shared_ptr<::openmldb::api::TaskInfo> FindMultiTask(const ::openmldb::api::TaskInfo& task_info);
 
-    int CheckDimessionPut(const ::openmldb::api::PutRequest* request, uint32_t idx_cnt);
+    int CheckDimessionPut(const ::openmldb::storage::Dimensions& dimensions, uint32_t idx_cnt);
 
     // sync log data from page cache to disk
     void SchedSyncDisk(uint32_t tid, uint32_t pid);
@@ -417,6 +423,12 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     bool UpdateAggrs(uint32_t tid, uint32_t pid, const std::string& value,
                      const ::openmldb::storage::Dimensions& dimensions, uint64_t log_offset);
 
+    // update the aggregators with the entries, they are looked up once
+    bool UpdateAggrs(uint32_t tid, uint32_t pid, const std::vector<::openmldb::api::LogEntry>& entries);
+
+    bool UpdateAggrs(uint32_t tid, uint32_t pid, const std::shared_ptr<Aggrs>& aggrs, const std::string& value,
+                     const ::openmldb::storage::Dimensions& dimensions, uint64_t log_offset);
+
     bool CreateAggregatorInternal(const ::openmldb::api::CreateAggregatorRequest* request,
                                   std::string& msg); //NOLINT
 
@@ -435,8 +447,14 @@ class TabletImpl : public ::openmldb::api::TabletServer {
                          ::hybridse::vm::RequestRunSession& session,                  // NOLINT
                          openmldb::api::QueryResponse& response, butil::IOBuf& buf);  // NOLINT
 
+    // accept the stream created by the client and push the rows of the batch query to it in stream_query_pool_
+    void RunStreamQuery(RpcController* controller, const std::shared_ptr<::hybridse::vm::BatchRunSession>& session,
+                        const ::hybridse::codec::Row& parameter_row, openmldb::api::QueryResponse* response);
+
     void CreateProcedure(const std::shared_ptr<hybridse::sdk::ProcedureInfo>& sp_info);
 
+    void CreateProcedures(const std::vector<std::shared_ptr<hybridse::sdk::ProcedureInfo>>& sp_infos);
+
     // refresh the pre-aggr tables info
     bool RefreshAggrCatalog();
 
@@ -453,6 +471,7 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     ThreadPool task_pool_;
     ThreadPool io_pool_;
     ThreadPool snapshot_pool_;
+    ThreadPool stream_query_pool_;
     std::map<uint64_t, std::list<std::shared_ptr<::openmldb::api::TaskInfo>>> task_map_;
     std::set<std::string> sync_snapshot_set_;
     std::map<std::string, std::shared_ptr<FileReceiver>> file_receiver_map_;
@@ -0,0 +1,275 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <brpc/server.h>
+#include <gflags/gflags.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "base/glog_wapper.h"
+#include "codec/fe_row_codec.h"
+#include "codec/fe_schema_codec.h"
+#include "gtest/gtest.h"
+#include "nameserver/name_server_impl.h"
+#include "sdk/result_set_stream.h"
+#include "sdk/sql_router.h"
+#include "tablet/query_stream.h"
+#include "tablet/tablet_impl.h"
+
+DECLARE_string(endpoint);
+DECLARE_string(db_root_path);
+DECLARE_string(zk_cluster);
+DECLARE_string(zk_root_path);
+DECLARE_int32(zk_session_timeout);
+DECLARE_uint32(stream_query_chunk_size);
+DECLARE_uint32(system_table_replica_num);
+
+using ::openmldb::nameserver::NameServerImpl;
+
+namespace openmldb {
+namespace tablet {
+
+inline std::string GenRand() {
+    return std::to_string(rand() % 10000000 + 1);  // NOLINT
+}
+
+// StreamQueryTablet answers the batch queries as the tablet which fails to run the query after some rows are
+// pushed, or as the tablet which doesn't support streaming and ignores stream_result
+class StreamQueryTablet : public TabletImpl {
+ public:
+    enum Mode { kStream, kRunError, kLegacy };
+
+    void Query(RpcController* ctrl, const ::openmldb::api::QueryRequest* request,
+               ::openmldb::api::QueryResponse* response, Closure* done) override {
+        if (mode == kLegacy) {
+            ::openmldb::api::QueryRequest legacy_request(*request);
+            legacy_request.set_stream_result(false);
+            TabletImpl::Query(ctrl, &legacy_request, response, done);
+            return;
+        }
+        if (mode == kStream || !request->stream_result()) {
+            TabletImpl::Query(ctrl, request, response, done);
+            return;
+        }
+        brpc::ClosureGuard done_guard(done);
+        brpc::StreamId stream_id;
+        if (brpc::StreamAccept(&stream_id, *static_cast<brpc::Controller*>(ctrl), NULL) != 0) {
+            response->set_code(::openmldb::base::kSQLRunError);
+            return;
+        }
+        ::hybridse::vm::Schema schema;
+        auto column = schema.Add();
+        column->set_name("c1");
+        column->set_type(::hybridse::type::kVarchar);
+        column = schema.Add();
+        column->set_name("c3");
+        column->set_type(::hybridse::type::kInt32);
+        std::string encoded_schema;
+        ::hybridse::codec::SchemaCodec::Encode(schema, &encoded_schema);
+        std::string sql = request->sql();
+        std::thread([stream_id, schema, sql] {
+            PushQueryStream(stream_id, sql, [&schema](const std::function<bool(const ::hybridse::codec::Row&)>& on_row) {
+                ::hybridse::codec::RowBuilder builder(schema);
+                for (int32_t i = 0; i < 3; i++) {
+                    std::string key = "k" + std::to_string(i);
+                    uint32_t size = builder.CalTotalLength(key.size());
+                    std::string row(size, '\0');
+                    builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), size);
+                    builder.AppendString(key.data(), key.size());
+                    builder.AppendInt32(i);
+                    on_row(::hybridse::codec::Row(row));
+                }
+                return -1;
+            });
+        }).detach();
+        response->set_schema(encoded_schema);
+        response->set_stream_result(true);
+        response->set_code(::openmldb::base::kOk);
+    }
+
+    std::atomic<int32_t> mode{kStream};
+};
+
+class StreamQueryTest : public ::testing::Test {
+ public:
+    StreamQueryTest() {}
+    ~StreamQueryTest() {}
+
+    static void SetUpTestCase() {
+        FLAGS_zk_cluster = "127.0.0.1:6181";
+        FLAGS_zk_root_path = "/rtidb4" + GenRand();
+        FLAGS_endpoint = "127.0.0.1:9633";
+        NameServerImpl* nameserver = new NameServerImpl();
+        ASSERT_TRUE(nameserver->Init(""));
+        ns_server_ = new brpc::Server();
+        brpc::ServerOptions options;
+        ASSERT_EQ(0, ns_server_->AddService(nameserver, brpc::SERVER_OWNS_SERVICE));
+        ASSERT_EQ(0, ns_server_->Start(FLAGS_endpoint.c_str(), &options));
+        sleep(2);
+
+        FLAGS_endpoint = "127.0.0.1:9833";
+        FLAGS_db_root_path = "/tmp/" + GenRand();
+        tablet_ = new StreamQueryTablet();
+        ASSERT_TRUE(tablet_->Init(""));
+        tb_server_ = new brpc::Server();
+        ASSERT_EQ(0, tb_server_->AddService(tablet_, brpc::SERVER_DOESNT_OWN_SERVICE));
+        ASSERT_EQ(0, tb_server_->Start(FLAGS_endpoint.c_str(), &options));
+        ASSERT_TRUE(tablet_->RegisterZK());
+        sleep(2);
+
+        auto router = NewRouter(false);
+        ASSERT_TRUE(router != nullptr);
+        hybridse::sdk::Status status;
+        ASSERT_TRUE(router->CreateDB(db_, &status));
+        ASSERT_TRUE(router->ExecuteDDL(db_, "create table trans(c1 string, c3 int, c4 bigint, index(key=c1, ts=c4));",
+                                       &status));
+        ASSERT_TRUE(router->RefreshCatalog());
+        for (int32_t i = 0; i < kRowNum; i++) {
+            std::string insert_sql =
+                "insert into trans values(\"k" + std::to_string(i) + "\"," + std::to_string(i) + ",1000);";
+            ASSERT_TRUE(router->ExecuteInsert(db_, insert_sql, &status));
+        }
+    }
+
+    static void TearDownTestCase() {
+        auto router = NewRouter(false);
+        hybridse::sdk::Status status;
+        router->ExecuteDDL(db_, "drop table trans;", &status);
+        router->DropDB(db_, &status);
+        tb_server_->Stop(10);
+        ns_server_->Stop(10);
+        delete tb_server_;
+        delete ns_server_;
+        delete tablet_;
+    }
+
+    static std::shared_ptr<::openmldb::sdk::SQLRouter> NewRouter(bool stream, uint32_t max_chunks = 4) {
+        ::hybridse::vm::Engine::InitializeGlobalLLVM();
+        ::openmldb::sdk::SQLRouterOptions sql_opt;
+        sql_opt.zk_cluster = FLAGS_zk_cluster;
+        sql_opt.zk_path = FLAGS_zk_root_path;
+        sql_opt.stream_batch_query = stream;
+        sql_opt.stream_max_chunks = max_chunks;
+        return ::openmldb::sdk::NewClusterSQLRouter(sql_opt);
+    }
+
+ protected:
+    static constexpr int32_t kRowNum = 300;
+    static brpc::Server* ns_server_;
+    static brpc::Server* tb_server_;
+    static StreamQueryTablet* tablet_;
+    static std::string db_;
+};
+
+constexpr int32_t StreamQueryTest::kRowNum;
+brpc::Server* StreamQueryTest::ns_server_ = NULL;
+brpc::Server* StreamQueryTest::tb_server_ = NULL;
+StreamQueryTablet* StreamQueryTest::tablet_ = NULL;
+std::string StreamQueryTest::db_ = "stream_query_db";  // NOLINT
+
+TEST_F(StreamQueryTest, StreamRows) {
+    uint32_t old_chunk_size = FLAGS_stream_query_chunk_size;
+    FLAGS_stream_query_chunk_size = 256;
+    tablet_->mode = StreamQueryTablet::kStream;
+    auto router = NewRouter(true, 1);
+    ASSERT_TRUE(router != nullptr);
+    hybridse::sdk::Status status;
+    auto rs = router->ExecuteSQLParameterized(db_, "select c1, c3 from trans;", {}, &status);
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+    auto stream_rs = std::dynamic_pointer_cast<::openmldb::sdk::ResultSetStream>(rs);
+    ASSERT_TRUE(stream_rs != nullptr);
+    ASSERT_EQ(2, rs->GetSchema()->GetColumnCnt());
+    int64_t sum = 0;
+    int32_t count = 0;
+    while (rs->Next()) {
+        int32_t val = 0;
+        ASSERT_TRUE(rs->GetInt32(1, &val));
+        std::string key;
+        ASSERT_TRUE(rs->GetString(0, &key));
+        ASSERT_EQ("k" + std::to_string(val), key);
+        sum += val;
+        count++;
+        if (count <= 3) {
+            // the tablet gets EAGAIN once the stream is full and must wait for the client instead of closing it
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+    }
+    ASSERT_TRUE(stream_rs->GetStatus().IsOK()) << stream_rs->GetStatus().msg;
+    ASSERT_EQ(kRowNum, count);
+    ASSERT_EQ(kRowNum * (kRowNum - 1) / 2, sum);
+    FLAGS_stream_query_chunk_size = old_chunk_size;
+}
+
+TEST_F(StreamQueryTest, RunError) {
+    tablet_->mode = StreamQueryTablet::kRunError;
+    auto router = NewRouter(true);
+    ASSERT_TRUE(router != nullptr);
+    hybridse::sdk::Status status;
+    std::string sql = "select c1, c3 from trans;";
+    auto rs = router->ExecuteSQLParameterized(db_, sql, {}, &status);
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+    auto stream_rs = std::dynamic_pointer_cast<::openmldb::sdk::ResultSetStream>(rs);
+    ASSERT_TRUE(stream_rs != nullptr);
+    // the rows pushed before the error are read
+    for (int32_t i = 0; i < 3; i++) {
+        ASSERT_TRUE(rs->Next());
+        int32_t val = 0;
+        ASSERT_TRUE(rs->GetInt32(1, &val));
+        ASSERT_EQ(i, val);
+    }
+    ASSERT_FALSE(rs->Next());
+    ASSERT_EQ(::openmldb::base::kSQLRunError, stream_rs->GetStatus().code);
+    ASSERT_EQ("fail to run sql: " + sql, stream_rs->GetStatus().msg);
+    tablet_->mode = StreamQueryTablet::kStream;
+}
+
+TEST_F(StreamQueryTest, Fallback) {
+    tablet_->mode = StreamQueryTablet::kLegacy;
+    auto router = NewRouter(true);
+    ASSERT_TRUE(router != nullptr);
+    hybridse::sdk::Status status;
+    auto rs = router->ExecuteSQLParameterized(db_, "select c1, c3 from trans;", {}, &status);
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+    // the rows are read from the attachment as the tablet doesn't return stream_result
+    ASSERT_TRUE(std::dynamic_pointer_cast<::openmldb::sdk::ResultSetStream>(rs) == nullptr);
+    ASSERT_EQ(kRowNum, rs->Size());
+    int64_t sum = 0;
+    while (rs->Next()) {
+        int32_t val = 0;
+        ASSERT_TRUE(rs->GetInt32(1, &val));
+        sum += val;
+    }
+    ASSERT_EQ(kRowNum * (kRowNum - 1) / 2, sum);
+    tablet_->mode = StreamQueryTablet::kStream;
+}
+
+}  // namespace tablet
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    FLAGS_zk_session_timeout = 2000;
+    ::testing::InitGoogleTest(&argc, argv);
+    srand(time(NULL));
+    ::openmldb::base::SetLogLevel(INFO);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    FLAGS_system_table_replica_num = 0;
+    return RUN_ALL_TESTS();
+}
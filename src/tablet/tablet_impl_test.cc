@@ -918,6 +918,67 @@ int UpdateTTL(uint32_t tid, uint32_t pid, ::openmldb::type::TTLType ttl_type,
     return response.code();
 }
 
+TEST_P(TabletImplTest, PutBatch) {
+    ::openmldb::common::StorageMode storage_mode = GetParam();
+    TabletImpl tablet;
+    tablet.Init("");
+    uint32_t id = counter++;
+    ASSERT_EQ(0, CreateDefaultTable("", "t0", id, 1, 0, 0, kAbsoluteTime, storage_mode, &tablet));
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    {
+        ::openmldb::api::PutBatchRequest request;
+        request.set_tid(id);
+        request.set_pid(1);
+        brpc::Controller cntl;
+        for (int i = 0; i < 10; i++) {
+            std::string key = "key" + std::to_string(i % 3);
+            std::string value = ::openmldb::test::EncodeKV(key, "value" + std::to_string(i));
+            auto row = request.add_rows();
+            row->set_time(now - i);
+            row->set_size(value.size());
+            auto dimension = row->add_dimensions();
+            dimension->set_key(key);
+            dimension->set_idx(0);
+            cntl.request_attachment().append(value);
+        }
+        ::openmldb::api::PutBatchResponse response;
+        MockClosure closure;
+        tablet.PutBatch(&cntl, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+        ASSERT_EQ(10u, response.put_cnt());
+    }
+    for (int i = 0; i < 3; i++) {
+        ::openmldb::api::CountRequest request;
+        request.set_tid(id);
+        request.set_pid(1);
+        request.set_key("key" + std::to_string(i));
+        ::openmldb::api::CountResponse response;
+        MockClosure closure;
+        tablet.Count(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+        ASSERT_EQ(i == 0 ? 4u : 3u, response.count());
+    }
+    // the rows don't match the attachment
+    {
+        ::openmldb::api::PutBatchRequest request;
+        request.set_tid(id);
+        request.set_pid(1);
+        auto row = request.add_rows();
+        row->set_time(now);
+        row->set_size(100);
+        auto dimension = row->add_dimensions();
+        dimension->set_key("key0");
+        dimension->set_idx(0);
+        brpc::Controller cntl;
+        cntl.request_attachment().append("value");
+        ::openmldb::api::PutBatchResponse response;
+        MockClosure closure;
+        tablet.PutBatch(&cntl, &request, &response, &closure);
+        ASSERT_EQ(::openmldb::base::ReturnCode::kInvalidParameter, response.code());
+        ASSERT_EQ(0u, response.put_cnt());
+    }
+}
+
 TEST_P(TabletImplTest, UpdateTTLAbsoluteTime) {
     ::openmldb::common::StorageMode storage_mode = GetParam();
     int32_t old_gc_interval = FLAGS_gc_interval;